@@ -0,0 +1,120 @@
+/** @file Benchmark.hpp
+ *  @brief Benchmarks run from the command line instead of the game.
+ *
+ *  Usage: ./project --bench-billboards
+ *         ./project --bench-collision
+ *         ./project --bench-bvh
+ *
+ *  Each benchmark prints one line per configuration and returns.
+ *  Benchmarks that render expect the window and OpenGL context to
+ *  be setup already.
+ *
+ *  Checks (./project --check-occlusion, ...) print one line per case
+ *  and return whether every case passed, main exits with 1 if not.
+ *  They run without a window.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+/**
+* GPU and CPU time of the trees at 200, 10k and 100k trees, drawn with the
+* geometry shader path and the vertex shader path.
+*
+* @return void
+*/
+void BenchmarkBillboards();
+
+/**
+* Cost of a player collision query in CollisionGrid at 200 to 1M trees on
+* a map grown to keep the trees of the game as dense, next to scanning every
+* tree and structure, and the queries where both differ. Runs on the CPU only.
+*
+* @return bool false when the grid and the scan differ on a query
+*/
+bool BenchmarkCollision();
+
+/**
+* Build time of the BVH of each structure, and time per ray and per player
+* capsule query, with rays and capsules also scanned against every triangle
+* and the results of both compared. Runs on the CPU only, the meshes are read
+* without their textures.
+*
+* @return void
+*/
+void BenchmarkBVH();
+
+/**
+* Cost of the per-frame pickup query of TriggerSystem with 1k to 100k
+* batteries over a large map, next to testing every battery, and the cost
+* of removing them. The first steps of the walk are replayed against a list
+* of every battery that also removes the collected ones, and the collected
+* batteries of both compared. Runs on the CPU only.
+*
+* @return bool false when the triggers and the list collect different batteries
+*/
+bool BenchmarkTriggers();
+
+/**
+* Batched rays, sphere and box overlaps of SceneQuery over the structures
+* and 200 to 100k tree trunks, on one thread and split over every hardware
+* thread. The first 1000 queries of each kind are also tested against every
+* item, the structures on their triangles, and the results compared. Runs on
+* the CPU only, the meshes are read without their textures.
+*
+* @return bool false when a query differs from the scan or between threads
+*/
+bool BenchmarkSceneQuery();
+
+/**
+* Time of PoissonDisk at 10k to 1M trees, with the spacing of every sample
+* checked and the same seed sampled twice. Runs on the CPU only.
+*
+* @return void
+*/
+void BenchmarkPoisson();
+
+/**
+* Streamed maps of 256 to 4096 units: time to load the chunks around the start,
+* then a walk across the map with the time of Update() on the main thread, the
+* chunks missing under the player and the peak memory against the cap. Runs on
+* the CPU only.
+*
+* @return void
+*/
+void BenchmarkStreaming();
+
+/**
+* Terrain of a 4096 unit map seen from its middle with view distances of 20
+* to 2000 units: patches selected by the quadtree, their vertices and the time
+* of the selection, next to the leaves a single level of detail would draw.
+* Runs on the CPU only.
+*
+* @return void
+*/
+void BenchmarkTerrain();
+
+/**
+* SoftwareOcclusion with no window: a wall rasterized in front of the eye must
+* hide a box behind it and a trunk quad a small box behind it, while boxes in
+* front of the wall, beside it or over its edge stay visible. Rasterizes on the
+* worker thread, as the game does.
+* Then the inner box of each structure must hide a box behind it, and the
+* chalice, too thin for one, must hide nothing.
+*
+* @return bool whether every case passed
+*/
+bool CheckSoftwareOcclusion();
+
+/**
+* OrientedBoxList::ContainsPoint, 4 boxes per SSE step, against the scalar
+* OrientedBox2D::Contains on random boxes and points, with box counts that
+* are and are not a multiple of 4. Every mask bit and hit count must match;
+* a point closer than rounding to an edge may go either way.
+*
+* @return bool whether every case passed
+*/
+bool CheckOrientedBoxes();
+
+#endif
@@ -9,6 +9,11 @@
 #include "util.hpp"
 #include "globals.hpp"
 #include "Texture.hpp"
+#include "RenderQueue.hpp"
+#include "Frustum.hpp"
+#include "LightCone.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "FrameStats.hpp"
 
 /**
  * class for trees
@@ -20,15 +25,40 @@ public:
     
     // void SetPos(std::vector<float>& pos);
     void SetPos(std::vector<glm::vec2>& vectorList);
+    // Replace every tree, sizeMirror holds two floats per tree as from DrawLooks.
+    // Works before and after Initialize()
+    void SetTrees(const std::vector<glm::vec2>& coords, const std::vector<float>& sizeMirror);
+    // Append the size and mirroring of count trees drawn from generator to sizeMirror
+    static void DrawLooks(std::mt19937& generator, size_t count, std::vector<float>& sizeMirror);
     void RandomSetPos(int m, int n); 
     void Initialize();
-    void PreDraw();
-    void Draw();
+    // Keep only the trees inside frustum, lit by light and not behind occluders (may be null)
+    void Cull(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders, CullCounts& counts);
+    // Add the draw of the visible trees to the queue
+    void Submit(RenderQueue& queue);
+    // Number of trees in the list
+    inline size_t GetTreeCount() const { return mBounds.Size(); }
+    // Foot of tree i on the ground, and its height scale
+    inline glm::vec3 GetTreeBase(size_t i) const { return glm::vec3(treePos[i*3], treePos[i*3+1], treePos[i*3+2]); }
+    inline float GetTreeSize(size_t i) const { return mSizeMirror[i*2]; }
 private:
     std::vector<float> treePos;
+    std::vector<float> mSizeMirror;     // height scale and texture mirroring of each tree
+    SphereList mBounds;                 // bounding sphere of each tree quad
+    std::vector<uint32_t> mVisibleIndices;
+    std::vector<float> mVisiblePos;
+    std::vector<float> mVisibleSizeMirror;
+    size_t mVisibleCount = 0;           // trees currently in mVBO
     GLuint mVAO = 0;
     GLuint mVBO[2];
-    GLuint mShaderID = 0;
+    // Geometry shader path, one point per tree
+    GLuint mShaderID = 0;               // alpha tested with discard
+    GLuint mNoDiscardShaderID = 0;      // main pass after the depth pre-pass
+    GLuint mDepthShaderID = 0;          // depth pre-pass, same discard without lighting
+    // Vertex shader path, one 4 vertex strip per tree
+    GLuint mQuadShaderID = 0;
+    GLuint mQuadNoDiscardShaderID = 0;
+    GLuint mQuadDepthShaderID = 0;
     Texture* mTexture;
     void CreateGraphicsPipeline();
     void VertexSpecification();
@@ -20,8 +20,18 @@ public:
 	// Constructor to create a camera
     Camera();
     // Return a 'view' matrix with our
-    // camera transformation applied.
+    // camera transformation applied, from the interpolated eye.
     glm::mat4 GetViewMatrix() const;
+    // Set the perspective projection used for rendering
+    void SetProjection(float fovy, float aspect, float nearPlane, float farPlane);
+    // Return the perspective 'projection' matrix
+    glm::mat4 GetProjectionMatrix() const;
+    // Near and far clipping planes
+    inline float GetNearPlane() const { return m_near; }
+    inline float GetFarPlane() const { return m_far; }
+    // Vertical field of view in radians and aspect ratio
+    inline float GetFieldOfView() const { return m_fovy; }
+    inline float GetAspectRatio() const { return m_aspect; }
     // Move the camera around
     void MouseLook(int mouseX, int mouseY);
     void MoveForward(float speed);
@@ -56,6 +66,14 @@ public:
     glm::vec3 GetViewDirection();
     // Returns the eye position
     glm::vec3 GetEyePosition();
+    // Returns the eye position to draw from, between the last two steps
+    glm::vec3 GetRenderEyePosition() const;
+    // Simulation steps: remember where the eye was before the step
+    void BeginStep();
+    // Move the battery clock forward by one step
+    void AdvanceTime(double seconds);
+    // Place the drawn eye alpha of the way from the previous step to the last one
+    void Interpolate(float alpha);
     // Returns the initla eye postion
     glm::vec3 GetEyeInitialPosition(); 
     // head light scope
@@ -71,11 +89,18 @@ public:
     bool GetGameOver();
 
 private:
+    // Milliseconds of simulation, the clock of the battery and the walk cycle
+    Uint32 Now() const;
 
     // Track the old mouse position
     glm::vec2 m_oldMousePosition;
     // Where is our camera positioned
     glm::vec3 m_eyePosition;
+    // Eye at the start of the last step and eye drawn this frame
+    glm::vec3 m_previousEyePosition;
+    glm::vec3 m_renderEyePosition;
+    // Seconds simulated so far, advanced by the fixed steps only
+    double m_simulationTime = 0.0;
     // initial position for camera, used to reset view
     glm::vec3 m_eyeInitialPosition;
     // What direction is the camera looking
@@ -85,6 +110,11 @@ private:
     // to 'rock' or 'rattle' the camera you might play
     // with modifying this value.
     glm::vec3 m_upVector;
+    // Perspective projection parameters
+    float m_fovy = glm::radians(45.0f);
+    float m_aspect = 1200.0f / 720.0f;
+    float m_near = 0.1f;
+    float m_far = 20.0f;
     // initial height of camera position 
     float m_cameraYCoord = 0.35f; 
     // max height for walk cycle
@@ -0,0 +1,67 @@
+/** @file CollisionGrid.hpp
+ *  @brief Uniform grid over the map for collision tests of the player.
+ *
+ *  Footprints on the xz plane (the rotated bounding rectangles of
+ *  the structures and the squares of the tree trunks) are added
+ *  once, then Build() buckets each one into every cell its bounds
+ *  overlap. A point query then only tests the footprints of the
+ *  one cell it falls in, whatever the number of trees.
+ *
+ *  A footprint can have an owner, the index of a mesh that decides
+ *  with its exact geometry (see MeshBVH); the grid then reports the
+ *  owner instead of a collision.
+ *
+ *  Cells are sized from the number of footprints so that each one
+ *  holds a few of them, and are stored as one offset per cell into
+ *  a single index array.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef COLLISIONGRID_HPP
+#define COLLISIONGRID_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "OrientedBox.hpp"
+
+class CollisionGrid{
+public:
+    // Footprint of a placed object, grown by margin on every side. A footprint
+    // with an owner (>= 0) only collides after the owner's narrow phase
+    void AddBox(const OrientedBox2D& box, float margin, int32_t owner = -1);
+    // Axis aligned square, e.g. a tree trunk
+    void AddSquare(const glm::vec2& center, float halfSize);
+    // Bucket every footprint added so far into cells covering [minValue, maxValue]^2
+    void Build(float minValue, float maxValue);
+    // Whether point is inside any footprint
+    bool Collides(const glm::vec2& point) const;
+    // Whether point is inside a footprint without owner, the owners of the other
+    // footprints containing point are appended to owners
+    bool Collides(const glm::vec2& point, std::vector<int32_t>& owners) const;
+    // Footprints a query at point tests
+    size_t CandidatesAt(const glm::vec2& point) const;
+    // Remove every footprint and cell
+    void Clear();
+
+    inline size_t GetFootprintCount() const { return mFootprints.size(); }
+    inline int GetCellsPerSide() const { return mCellsPerSide; }
+    // Heap memory held by the footprints and cells
+    size_t GetMemoryBytes() const;
+
+private:
+    // Cell containing point, -1 outside the grid
+    int CellIndex(const glm::vec2& point) const;
+
+    std::vector<OrientedBox2D> mFootprints; // margin included in the half extents
+    std::vector<int32_t> mOwners;           // per footprint, -1 when the footprint is solid
+    std::vector<uint32_t> mCellStart;       // footprints of cell c are mCellItems[mCellStart[c], mCellStart[c + 1])
+    std::vector<uint32_t> mCellItems;
+    float mMinValue = 0.0f;
+    float mCellSize = 1.0f;
+    int mCellsPerSide = 0;
+};
+
+#endif
@@ -0,0 +1,47 @@
+/** @file FixedTimestep.hpp
+ *  @brief Fixed length simulation steps driven by the high-resolution counter.
+ *
+ *  The game is simulated in steps of a fixed length (movement,
+ *  collisions, triggers, battery timers), whatever the frame rate.
+ *  Every frame Advance() adds the time since the last frame, measured
+ *  with SDL_GetPerformanceCounter, and returns how many whole steps
+ *  are due; the rest carries to the next frame. The renderer draws
+ *  the state GetAlpha() of the way between the last two steps, so
+ *  motion stays smooth when frames and steps do not line up.
+ *
+ *  A frame longer than kMaxFrameSeconds (a window drag, a load) only
+ *  counts for kMaxFrameSeconds, the game pauses rather than running
+ *  dozens of steps at once.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FIXEDTIMESTEP_HPP
+#define FIXEDTIMESTEP_HPP
+
+#include <cstdint>
+
+class FixedTimestep{
+public:
+    static constexpr double kMaxFrameSeconds = 0.25;
+
+    // Start from now with steps of stepSeconds, nothing due yet
+    void Start(double stepSeconds);
+    // Add the time since the last call, returns the number of steps due
+    int Advance();
+    // Part of the next step already elapsed, in [0, 1)
+    inline float GetAlpha() const { return (float)(mAccumulator / mStepSeconds); }
+    inline double GetStepSeconds() const { return mStepSeconds; }
+    // Time between the last two calls to Advance()
+    inline double GetFrameSeconds() const { return mFrameSeconds; }
+
+    // Seconds since an arbitrary origin, from SDL_GetPerformanceCounter
+    static double Now();
+
+private:
+    double mStepSeconds = 1.0 / 60.0;
+    double mAccumulator = 0.0;
+    double mLastTime = 0.0;
+    double mFrameSeconds = 0.0;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/** @file FramePacer.hpp
+ *  @brief Frame pacing of the main loop and input to present latency.
+ *
+ *  A frame waits first and samples input second, so the input
+ *  drawn is as fresh as possible when the frame reaches the screen:
+ *
+ *      WaitForFrame()   the previous frame is done, then the frame
+ *                       cap and the extra delay, if any
+ *      MarkInput()      events polled, mouse look applied
+ *      ...              simulate and draw
+ *      Present()        swap, and a fence behind the swap
+ *
+ *  WaitForFrame() blocks on the fence of the previous frame, so the
+ *  driver never queues more than one frame ahead of the input. The
+ *  time from MarkInput() to the fence is the latency of that frame;
+ *  the fence passes when the GPU has run the swap, the scanout may
+ *  still be up to a refresh away. A fence that passed before the
+ *  wait reads late, the latency is then an upper bound.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEPACER_HPP
+#define FRAMEPACER_HPP
+
+#include <glad/glad.h>
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+class FramePacer{
+public:
+    ~FramePacer();
+
+    // 1 waits for the vertical blank, 0 does not and -1 is adaptive vsync, a late frame
+    // is swapped at once. Falls back to 1 when adaptive vsync is not supported.
+    // Returns the interval in use
+    static int SetSwapInterval(int interval);
+
+    // Wait for the previous frame to be presented, then until 1 / maxFrameRate seconds
+    // after the start of the previous frame (0 for no cap), then delayMs more
+    void WaitForFrame(float maxFrameRate, float delayMs);
+    // Input of the frame sampled now
+    void MarkInput();
+    // Swap the window and fence the frame
+    void Present(SDL_Window* window);
+
+    // Milliseconds from the input of the previous frame to its presentation
+    inline float GetLatencyMs() const { return mLatencyMs; }
+    // Milliseconds waited by the last WaitForFrame(), for the GPU and the cap
+    inline float GetWaitMs() const { return mWaitMs; }
+
+private:
+    GLsync mFence = nullptr;
+    double mFrameStart = 0.0;
+    double mInputTime = 0.0;
+    float mLatencyMs = 0.0f;
+    float mWaitMs = 0.0f;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/** @file FrameStats.hpp
+ *  @brief Per-frame counters of the renderer.
+ *  
+ *  Counters are reset at the start of every frame and
+ *  printed once per second while stats are enabled (F1).
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRAMESTATS_HPP
+#define FRAMESTATS_HPP
+
+// Visible and culled counts of one category of the scene
+struct CullCounts{
+    unsigned int visible = 0;
+    unsigned int culled = 0;        // outside the view frustum
+    unsigned int unlit = 0;         // inside the frustum but outside the head light
+    unsigned int occluded = 0;      // lit but hidden in the software depth buffer
+
+    inline void Add(unsigned int total, unsigned int inFrustum, unsigned int lit, unsigned int unoccluded){
+        visible += unoccluded;
+        culled += total - inFrustum;
+        unlit += inFrustum - lit;
+        occluded += lit - unoccluded;
+    }
+};
+
+struct FrameStats{
+    // Render queue
+    unsigned int packets = 0;               // draw packets submitted
+    unsigned int programSwitches = 0;       // glUseProgram issued
+    unsigned int vaoSwitches = 0;           // glBindVertexArray issued
+    unsigned int textureSwitches = 0;       // glBindTexture issued
+    unsigned int textureRequests = 0;       // textures used by the packets
+    unsigned int materialSwitches = 0;      // material uniform buffers bound
+    unsigned int depthPackets = 0;          // packets drawn in the depth pre-pass
+
+    // GL state cache
+    unsigned int stateCallsIssued = 0;      // state changes sent to the driver
+    unsigned int stateCallsElided = 0;      // redundant state changes dropped
+
+    // Frustum culling
+    CullCounts objects;                     // house, chapel, windmill, chalice
+    CullCounts batteries;
+    CullCounts trees;                       // billboard instances
+    CullCounts grass;                       // grass tile instances
+    CullCounts grassChunks;                 // chunks of the grass blades
+
+    // Occlusion queries
+    unsigned int occlusionQueries = 0;      // boxes drawn inside a query
+    unsigned int occlusionResults = 0;      // query results read back
+    unsigned int occludedObjects = 0;       // objects skipped as hidden
+    unsigned int conditionalDraws = 0;      // objects drawn under glBeginConditionalRender
+
+    // Impostors
+    unsigned int impostors = 0;             // structures drawn as their impostor quad
+
+    // Software occlusion
+    unsigned int occluderTriangles = 0;     // occluder triangles rasterized
+    float occlusionRasterMs = 0.0f;         // time the main thread waited for the rasterizer
+
+    // GPU time of the scene, measured a few frames late
+    bool depthPrePass = false;
+    float gpuDepthMs = 0.0f;                // depth pre-pass
+    float gpuShadeMs = 0.0f;                // shaded pass
+
+    // Multi-draw indirect static scene
+    bool multiDrawIndirect = false;
+    unsigned int indirectDraws = 0;         // glMultiDrawArraysIndirect calls
+    unsigned int indirectCommands = 0;      // commands in the indirect buffer, one per visible mesh
+    unsigned int indirectInstances = 0;     // placements drawn through the commands
+
+    // Grass blades
+    unsigned int grassBlades = 0;           // blades of the whole map
+    unsigned int grassBladesTested = 0;     // blades of the visible chunks sent to the GPU culling pass
+    unsigned int grassBladesDrawn = 0;      // blades kept by the GPU culling pass, a few frames late
+    unsigned int grassDraws = 0;            // glDrawTransformFeedback calls of the shaded pass
+
+    // Trees
+    bool treesInGeometryShader = false;     // quads expanded by billboard_geom.glsl instead of the vertex shader
+
+    // Head light
+    float litScreenFraction = 0.0f;         // scissor area / screen area, 0 when the scene pass is skipped
+    unsigned int headLightRays = 0;         // line of sight rays along and around the cone
+    unsigned int headLightRaysBlocked = 0;  // rays stopped by a structure or a trunk before the light range
+    float headLightSight = 0.0f;            // distance along the view direction to the first hit
+    float headLightQueryUs = 0.0f;          // CPU time of the ray batch
+
+    // Streamed world, zero on the fixed map
+    unsigned int streamedChunks = 0;        // resident chunks
+    unsigned int streamPending = 0;         // chunks queued or being generated
+    float streamedMB = 0.0f;                // memory of the resident chunks
+    float streamUploadMs = 0.0f;            // copy of the resident chunks to the renderer, when they changed
+
+    // Terrain, zero on the flat ground
+    unsigned int terrainPatches = 0;        // patches drawn, whole quadtree nodes or quadrants
+    float terrainSelectUs = 0.0f;           // CPU time of the quadtree selection
+
+    // Frame timing
+    float frameMs = 0.0f;                   // wall time since the last frame
+    unsigned int simulationSteps = 0;       // fixed steps run before drawing this frame
+    float frameWaitMs = 0.0f;               // waited for the previous frame and the frame cap
+    float latencyMs = 0.0f;                 // input to present of the previous frame
+
+    // Reset all counters, called at the start of a frame
+    void Reset();
+    // Print the counters of the last frame
+    void Print() const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/** @file Frustum.hpp
+ *  @brief View frustum planes and batched visibility tests.
+ *
+ *  Planes are extracted from the view-projection matrix.
+ *  Spheres and boxes are kept as structure of arrays so that
+ *  four of them are tested per SSE instruction; platforms
+ *  without SSE use the scalar loop.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Bounding spheres stored per component
+struct SphereList{
+    std::vector<float> x, y, z, radius;
+
+    void Add(const glm::vec3& center, float r);
+    void Clear();
+    inline size_t Size() const { return x.size(); }
+};
+
+// Axis aligned boxes stored as center and half extents per component
+struct BoxList{
+    std::vector<float> cx, cy, cz;
+    std::vector<float> ex, ey, ez;
+
+    void Add(const glm::vec3& center, const glm::vec3& extents);
+    void Clear();
+    inline size_t Size() const { return cx.size(); }
+};
+
+class Frustum{
+public:
+    // Extract the six planes of viewProjection, normals point inside
+    void Extract(const glm::mat4& viewProjection);
+
+    // Append the index of every sphere intersecting the frustum to visible
+    void CullSpheres(const SphereList& spheres, std::vector<uint32_t>& visible) const;
+    // Append the index of every box intersecting the frustum to visible
+    void CullBoxes(const BoxList& boxes, std::vector<uint32_t>& visible) const;
+
+    // Single tests, for callers with only a few bounds
+    bool ContainsSphere(const glm::vec3& center, float radius) const;
+    bool ContainsBox(const glm::vec3& center, const glm::vec3& extents) const;
+
+private:
+    glm::vec4 mPlanes[6];
+};
+
+/**
+* World space box of a local box that is rotated along y-axis and then translated.
+*
+* @param localMin Minimum corner in object space
+* @param localMax Maximum corner in object space
+* @param model Placement of the object (translation and rotation)
+* @param center Output center in world space
+* @param extents Output half extents in world space
+* @return void
+*/
+void TransformBox(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model,
+                  glm::vec3& center, glm::vec3& extents);
+
+#endif
@@ -0,0 +1,62 @@
+/** @file GLExtensions.hpp
+ *  @brief OpenGL entry points newer than the generated glad loader.
+ *
+ *  glad only covers OpenGL 3.3. Functions of later versions that
+ *  the renderer can use when the context has them are loaded here
+ *  through SDL, after gladLoadGLLoader. Each one is null when the
+ *  context is too old, callers must check before using it.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GLEXTENSIONS_HPP
+#define GLEXTENSIONS_HPP
+
+#include <glad/glad.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_TRANSFORM_FEEDBACK
+#define GL_TRANSFORM_FEEDBACK 0x8E22
+#endif
+
+// Layout of one command of glMultiDrawArraysIndirect
+struct DrawArraysIndirectCommand{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;    // first per-instance attribute read, needs OpenGL 4.2
+};
+
+// OpenGL 4.3
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTPROC)(GLenum mode, const void* indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWARRAYSINDIRECTPROC glMultiDrawArraysIndirectPtr;
+
+// OpenGL 4.0 transform feedback objects, they remember how many vertices were captured
+typedef void (APIENTRYP PFNGLGENTRANSFORMFEEDBACKSPROC)(GLsizei n, GLuint* ids);
+typedef void (APIENTRYP PFNGLDELETETRANSFORMFEEDBACKSPROC)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRYP PFNGLBINDTRANSFORMFEEDBACKPROC)(GLenum target, GLuint id);
+typedef void (APIENTRYP PFNGLDRAWTRANSFORMFEEDBACKPROC)(GLenum mode, GLuint id);
+extern PFNGLGENTRANSFORMFEEDBACKSPROC glGenTransformFeedbacksPtr;
+extern PFNGLDELETETRANSFORMFEEDBACKSPROC glDeleteTransformFeedbacksPtr;
+extern PFNGLBINDTRANSFORMFEEDBACKPROC glBindTransformFeedbackPtr;
+extern PFNGLDRAWTRANSFORMFEEDBACKPROC glDrawTransformFeedbackPtr;
+
+/**
+* Load the entry points the current context supports, must be called
+* after glad has been initialized.
+*
+* @return void
+*/
+void LoadGLExtensions();
+
+// Whether the context is at least major.minor
+bool HasGLVersion(int major, int minor);
+
+// Whether the whole scene can be drawn with glMultiDrawArraysIndirect
+bool HasMultiDrawIndirect();
+
+// Whether captured vertices can be drawn with glDrawTransformFeedback
+bool HasTransformFeedbackObjects();
+
+#endif
@@ -0,0 +1,86 @@
+/** @file GLState.hpp
+ *  @brief Shadow copy of OpenGL state that drops redundant calls.
+ *  
+ *  Tracks the bound program, VAO, textures per unit, indexed and
+ *  generic buffer bindings, enabled capabilities and a few fixed
+ *  function values. A call that would not change the state is not
+ *  forwarded to OpenGL. Code that changes the same state directly
+ *  must call Invalidate() afterwards.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+#include <glad/glad.h>
+
+#include <map>
+#include <utility>
+
+class GLState{
+public:
+    // Constructor, every state starts unknown
+    GLState();
+
+    // Each setter returns true if the call was issued to OpenGL
+    bool UseProgram(GLuint program);
+    bool BindVertexArray(GLuint vao);
+    // Bind texture to unit for GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY,
+    // glActiveTexture is only issued when the binding changes
+    bool BindTexture(unsigned int unit, GLenum target, GLuint texture);
+    // Generic buffer binding, only cached for GL_ARRAY_BUFFER
+    bool BindBuffer(GLenum target, GLuint buffer);
+    // Indexed buffer binding (uniform blocks, transform feedback)
+    bool BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    bool Enable(GLenum cap);
+    bool Disable(GLenum cap);
+    bool SetEnabled(GLenum cap, bool enabled);
+    bool Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    bool Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    bool ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    bool PolygonMode(GLenum mode);
+    bool DepthFunc(GLenum func);
+    bool DepthMask(GLboolean flag);
+    bool ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a);
+
+    // Delete objects and drop them from the cache, since names can be reused
+    void DeleteProgram(GLuint program);
+    void DeleteVertexArrays(GLsizei n, const GLuint* vaos);
+    void DeleteTextures(GLsizei n, const GLuint* textures);
+    void DeleteBuffers(GLsizei n, const GLuint* buffers);
+
+    // Forget everything, the next call of each setter is always issued
+    void Invalidate();
+
+    // Calls forwarded to OpenGL and calls dropped since the last reset
+    inline unsigned int GetIssuedCount() const { return mIssued; }
+    inline unsigned int GetElidedCount() const { return mElided; }
+    void ResetCounters();
+
+private:
+    bool Count(bool issued);
+
+    static const int kMaxTextureUnits = 32;
+    static const GLuint kUnknown = 0xFFFFFFFF;
+
+    GLuint mProgram = kUnknown;
+    GLuint mVAO = kUnknown;
+    GLuint mActiveUnit = kUnknown;
+    GLuint mTexture2D[kMaxTextureUnits];
+    GLuint mTexture2DArray[kMaxTextureUnits];
+    GLuint mArrayBuffer = kUnknown;
+    std::map<std::pair<GLenum, GLuint>, GLuint> mIndexedBuffers;
+    std::map<GLenum, bool> mCapabilities;
+    GLint mViewport[4] = {-1, -1, -1, -1};
+    GLint mScissor[4] = {-1, -1, -1, -1};
+    GLfloat mClearColor[4] = {-1.f, -1.f, -1.f, -1.f};
+    GLenum mPolygonMode = kUnknown;
+    GLenum mDepthFunc = kUnknown;
+    GLint mDepthMask = -1;
+    GLint mColorMask = -1;   // 4 bits, r is the lowest
+
+    unsigned int mIssued = 0;
+    unsigned int mElided = 0;
+};
+
+#endif
@@ -0,0 +1,39 @@
+/** @file GpuTimer.hpp
+ *  @brief GPU time of a range of commands with GL_TIME_ELAPSED queries.
+ *
+ *  A small ring of queries is used so that a result is only read
+ *  once the GPU has it, a few frames after it was measured. The
+ *  CPU never waits; a frame whose query slot is still busy is
+ *  simply not measured.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GPUTIMER_HPP
+#define GPUTIMER_HPP
+
+#include <glad/glad.h>
+
+class GpuTimer{
+public:
+    ~GpuTimer();
+
+    // Create the queries, must be called after OpenGL has been setup
+    void Initialize();
+    // Start and stop timing, ranges of different timers must not overlap
+    void Begin();
+    void End();
+
+    // Milliseconds of the latest range the GPU has finished
+    inline float GetLastMs() const { return mLastMs; }
+
+private:
+    static const int kQueryCount = 4;
+
+    GLuint mQueries[kQueryCount] = {0, 0, 0, 0};
+    bool mPending[kQueryCount] = {false, false, false, false};
+    int mCurrent = 0;
+    bool mRunning = false;
+    float mLastMs = 0.0f;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/** @file GrassField.hpp
+ *  @brief Grass blades scattered over the whole map, culled on the GPU.
+ *
+ *  The map is split into kChunksPerSide x kChunksPerSide chunks,
+ *  each with its own instance buffer of blades. Every blade has a
+ *  density rank in [0,1), the blades of a chunk are stored by
+ *  increasing rank so that any prefix is a uniform subset of it.
+ *
+ *  Each frame the chunks are culled on the CPU against the frustum,
+ *  the head light and the software occlusion buffer. The surviving
+ *  chunks submit the prefix their nearest point needs, and
+ *  grass_cull_geom.glsl tests every blade against distance, density,
+ *  head light and frustum. The blades kept are captured with
+ *  transform feedback into one compacted buffer that is drawn with
+ *  glDrawTransformFeedback, the count never comes back to the CPU.
+ *
+ *  Needs transform feedback objects (OpenGL 4.0).
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GRASSFIELD_HPP
+#define GRASSFIELD_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.hpp"
+#include "LightCone.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "GLState.hpp"
+#include "FrameStats.hpp"
+
+class GrassField{
+public:
+    // Chunks per side of the map
+    static const int kChunksPerSide = 10;
+
+    ~GrassField();
+
+    // Scatter bladesPerUnit blades per square unit over the map and setup the programs,
+    // returns false when the context has no transform feedback objects
+    bool Initialize(float minValue, float maxValue, float bladesPerUnit);
+    // Cull the chunks, then capture the visible blades of the frame on the GPU
+    void Cull(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders,
+              const glm::vec3& eyePosition, GLState& state, FrameStats& stats);
+    // Draw the blades captured by Cull, depthOnly for the pre-pass
+    void Draw(GLState& state, FrameStats& stats, bool depthOnly) const;
+    inline size_t GetBladeCount() const { return mBladeCount; }
+
+private:
+    // Vertex of grass_cull_vert.glsl, the captured vertex has the width in place of the rank
+    struct Blade{
+        glm::vec4 positionHeight;   // base of the blade, height in w
+        glm::vec4 shape;            // facing angle, bend, density rank, shade
+    };
+
+    struct Chunk{
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLsizei count = 0;
+    };
+
+    // Fraction of the blades kept at distance, same as Density in grass_cull_geom.glsl
+    float Density(float distance, float maxDistance) const;
+
+    std::vector<Chunk> mChunks;
+    BoxList mChunkBounds;
+    std::vector<uint32_t> mVisibleChunks;
+    size_t mBladeCount = 0;
+
+    GLuint mFeedback = 0;               // transform feedback object, owns the binding of mVisibleBuffer
+    GLuint mVisibleBuffer = 0;          // compacted blades of the frame
+    GLuint mVisibleVAO = 0;
+    bool mHasVisible = false;           // whether mFeedback holds blades of this frame
+
+    GLuint mCullShaderID = 0;
+    GLuint mShaderID = 0;
+    GLuint mDepthShaderID = 0;
+    GLint mMaxDistanceLocation = -1;
+    GLint mDensityNearLocation = -1;
+    GLint mMinDensityLocation = -1;
+    GLint mBladeWidthLocation = -1;
+
+    // Blades written, read back a few frames late without waiting
+    GLuint mWrittenQuery = 0;
+    bool mQueryPending = false;
+    unsigned int mLastWritten = 0;
+};
+
+#endif
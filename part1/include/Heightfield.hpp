@@ -0,0 +1,74 @@
+/** @file Heightfield.hpp
+ *  @brief Height of the ground, sampled on a regular grid over the map.
+ *
+ *  Heights are fractal value noise drawn from the world seed (see
+ *  Random::ChunkSeed), so the same seed gives the same hills. The
+ *  grid keeps at most kMaxSamplesPerSide samples a side whatever
+ *  the size of the map, lookups between samples are bilinear.
+ *
+ *  Everything standing on the ground asks it for its height: the
+ *  trees, the grass blades, the structures (on pads flattened under
+ *  them), the batteries, the eye of the player and the trunks of the
+ *  scene queries. The Terrain draws it. An empty heightfield is the
+ *  flat ground at y = 0.
+ *
+ *  Read only after Generate() and Flatten(), so the worker threads
+ *  of a streamed world may look it up too.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef HEIGHTFIELD_HPP
+#define HEIGHTFIELD_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class Heightfield{
+public:
+    // Samples per side at most, a 4 MB grid
+    static const int kMaxSamplesPerSide = 1024;
+    // Octaves of the noise, each half as wide and half as high as the last
+    static const int kOctaves = 4;
+
+    // Fill the square [minValue, maxValue]^2 with samples about spacing apart. Hills are
+    // featureSize wide and heights within [-amplitude, amplitude]
+    void Generate(float minValue, float maxValue, float spacing, float amplitude, float featureSize, uint32_t seed);
+    // Level the ground to its height at center within radius, blending back over blend
+    void Flatten(const glm::vec2& center, float radius, float blend);
+    // Back to the flat ground
+    void Clear();
+
+    // Height at point, clamped to the map
+    float HeightAt(const glm::vec2& point) const;
+    // Upward normal at point
+    glm::vec3 NormalAt(const glm::vec2& point) const;
+    // Lowest and highest sample of the square [boundsMin, boundsMax], the corners
+    // around it included so that the bilinear surface stays within them
+    void Range(const glm::vec2& boundsMin, const glm::vec2& boundsMax, float& lowest, float& highest) const;
+    // Distance along direction (unit length) from origin to the ground, maxDistance when
+    // it is not met before
+    float Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+    // Whether the climb from one point to the other is at most maxSlope (rise over run)
+    bool Walkable(const glm::vec2& from, const glm::vec2& to, float maxSlope) const;
+
+    inline bool IsFlat() const { return mHeights.empty(); }
+    inline int GetSamplesPerSide() const { return mSamplesPerSide; }
+    inline float GetSpacing() const { return mSpacing; }
+    inline float GetMinValue() const { return mMinValue; }
+    inline float GetMaxValue() const { return mMaxValue; }
+    // Row major, z rows of x samples, sample (i, j) at mMinValue + (i, j) * mSpacing
+    inline const std::vector<float>& GetHeights() const { return mHeights; }
+
+private:
+    inline float Sample(int x, int z) const { return mHeights[(size_t)z * mSamplesPerSide + x]; }
+
+    float mMinValue = 0.0f;
+    float mMaxValue = 0.0f;
+    float mSpacing = 1.0f;
+    int mSamplesPerSide = 0;
+    std::vector<float> mHeights;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/** @file Impostors.hpp
+ *  @brief Octahedral impostors of the structures.
+ *
+ *  At load time each structure is rendered with an orthographic
+ *  camera from kFrames x kFrames directions spread over the upper
+ *  hemisphere (hemi-octahedral mapping) into an atlas of albedo
+ *  and of object space normal + depth. Past g.gImpostorDistance
+ *  the structure is drawn as one camera facing quad that blends
+ *  the 4 frames nearest to the view direction, lit by the head
+ *  light and moved to the baked depth.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef IMPOSTORS_HPP
+#define IMPOSTORS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "OBJ.hpp"
+#include "RenderQueue.hpp"
+
+class Impostors{
+public:
+    // Frames per side of an atlas, must match impostor_vert.glsl and impostor_frag.glsl
+    static const int kFrames = 8;
+    // Pixels per side of a frame
+    static const int kFrameSize = 128;
+
+    ~Impostors();
+
+    // Bake the atlases of objects, in the same order as they are submitted later
+    void Bake(const std::vector<OBJ*>& objects);
+    // Whether object is far enough from eyePosition to be drawn as its impostor
+    bool IsFar(size_t index, const OBJ& object, const glm::vec3& eyePosition) const;
+    // Add the impostor quad of object to the queue
+    void Submit(size_t index, const OBJ& object, RenderQueue& queue) const;
+
+private:
+    struct Atlas{
+        GLuint albedo = 0;
+        GLuint normalDepth = 0;
+        glm::vec3 localCenter = glm::vec3(0.0f);    // center of the bounding sphere in object space
+        float radius = 1.0f;
+    };
+
+    void BakeAtlas(const OBJ& object, Atlas& atlas);
+    glm::vec3 WorldCenter(const Atlas& atlas, const OBJ& object) const;
+
+    std::vector<Atlas> mAtlases;
+    GLuint mFramebuffer = 0;
+    GLuint mDepthBuffer = 0;
+    GLuint mVAO = 0;                    // no attributes, quads come from gl_VertexID
+    GLuint mShaderID = 0;
+    GLint mModelMatrixLocation = -1;
+};
+
+#endif
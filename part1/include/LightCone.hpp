@@ -0,0 +1,53 @@
+/** @file LightCone.hpp
+ *  @brief Volume lit by the head light, used for culling.
+ *
+ *  The head light is the only light of the scene, so whatever is
+ *  outside its cone or beyond the distance where its attenuation
+ *  drops below one color step renders black. Culled bounds are
+ *  removed from an index list produced by the frustum test.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef LIGHTCONE_HPP
+#define LIGHTCONE_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.hpp"
+
+class LightCone{
+public:
+    // Cone with its apex at apex opening along axis, halfAngle in radians
+    void Set(const glm::vec3& apex, const glm::vec3& axis, float halfAngle, float range);
+
+    // Remove from indices the spheres the cone does not touch, returns how many were removed
+    size_t FilterSpheres(const SphereList& spheres, std::vector<uint32_t>& indices) const;
+    // Remove from indices the boxes the cone does not touch, returns how many were removed
+    size_t FilterBoxes(const BoxList& boxes, std::vector<uint32_t>& indices) const;
+
+    bool TouchesSphere(const glm::vec3& center, float radius) const;
+
+    inline float GetRange() const { return mRange; }
+
+    /**
+    * Distance at which the head light of frag.glsl and billboard_frag.glsl,
+    * scaled by strength, falls below threshold.
+    *
+    * @param strength Head light strength (u_HeadLightStrength)
+    * @param threshold Smallest contribution that is still visible
+    * @return distance, 0 when the light is too weak to be seen at all
+    */
+    static float AttenuationRange(float strength, float threshold);
+
+private:
+    glm::vec3 mApex = glm::vec3(0.0f);
+    glm::vec3 mAxis = glm::vec3(0.0f, 0.0f, -1.0f);
+    float mSin = 0.0f;
+    float mCos = 1.0f;
+    float mRange = 0.0f;
+};
+
+#endif
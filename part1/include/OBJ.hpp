@@ -20,6 +20,23 @@
 #include "util.hpp"
 #include "globals.hpp"
 #include "Texture.hpp"
+#include "UniformBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "Frustum.hpp"
+#include "OrientedBox.hpp"
+#include "LightCone.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "FrameStats.hpp"
+#include "generated/ShaderInterface.hpp"
+
+// Per-instance attributes for instanced objects (e.g. grass),
+// laid out to match attribute locations 5 and 6 of the INSTANCED vert.glsl
+struct InstanceData {
+    glm::vec3 offset;   // translation of the instance
+    float scale;        // uniform scale of the instance
+    float rotation;     // rotation along y-axis in radians
+    glm::vec3 tint;     // color multiplier of the instance
+};
 
 class OBJ{
 public:
@@ -32,15 +49,36 @@ public:
 
     // Render objects
     void Initialize();
-    void PreDraw(glm::vec3 objectCoord, float rot = 0.0f);
-    void Draw();
+    // Set where the object is drawn, rot is in degrees along y-axis
+    void Place(glm::vec3 objectCoord, float rot = 0.0f);
+    // Add this object's draw to the queue, optionally drawn only if conditionQuery passed
+    void Submit(RenderQueue& queue, GLuint conditionQuery = 0);
+    // Placement of the object as a model matrix
+    glm::mat4 GetModelMatrix() const;
+    // World space bounding box of the placed object
+    void GetWorldBounds(glm::vec3& center, glm::vec3& extents) const;
+    // Keep only the instances inside frustum, lit by light and not behind occluders (may be null)
+    void CullInstances(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders, CullCounts& counts);
 
     // Get vertex and normal data
-    inline std::vector<GLfloat> getVerticesArray() const { return mVerticesArray; }
-    inline std::vector<GLfloat> getNormalsArray() const { return mNormalsArray; }
+    inline const std::vector<GLfloat>& getVerticesArray() const { return mVerticesArray; }
+    inline const std::vector<GLfloat>& getNormalsArray() const { return mNormalsArray; }
+    // Get tangent space data, empty without a normal map
+    inline const std::vector<GLfloat>& getTangentArray() const { return mTangentArray; }
+    inline const std::vector<GLfloat>& getBitangentArray() const { return mBitangentArray; }
 
     // Get texture data
-    inline std::vector<GLfloat> getTextureArray() const { return mTextureArray; }
+    inline const std::vector<GLfloat>& getTextureArray() const { return mTextureArray; }
+    // Get material textures, null if the material has none
+    inline const Texture* getDiffuseTexture() const { return mTextureDiffuse; }
+    inline const Texture* getNormalTexture() const { return mTextureNormal; }
+    inline const Texture* getSpecularTexture() const { return mTextureSpecular; }
+    // Material constants as uploaded to the MaterialBlock
+    ShaderInterface::MaterialBlock GetMaterialConstants() const;
+    // Get the vertex array of the mesh
+    inline GLuint getVAO() const { return mVAO; }
+    // Get the file the object was loaded from
+    inline const std::string& getFileName() const { return mFileName; }
 
     // Get min coordinate 
     inline glm::vec3 getMinCoord() const { return mMin; }
@@ -49,13 +87,22 @@ public:
     // Get object coordinate
     inline glm::vec3 getObjectCoord() const { return mObjectCoord; }
     // Set object coordinate
-    inline void setObjectCoord(glm::vec3 coord) { mObjectCoord = coord; }
+    inline void setObjectCoord(glm::vec3 coord) { mObjectCoord = coord; UpdateFootprint(); }
     // Get object rotation
     inline float getRot() const { return mRot; }
+    // Get the rectangle covered on the xz plane where the object is placed
+    inline const OrientedBox2D& getFootprint() const { return mFootprint; }
     // gen rand x, z for battery
     void randomXZCoord(int min, int max);
+    // Replace the instances of an instanced object, e.g. the grass tiles of streamed chunks
+    void SetInstances(const std::vector<InstanceData>& instances);
+    // Get number of instances drawn for instanced objects
+    inline size_t getInstanceCount() const { return mInstances.size(); }
+    // Get the instances that passed the last CullInstances
+    inline const std::vector<InstanceData>& getVisibleInstances() const { return mVisibleInstances; }
 
 private:    
+    std::string mFileName;
     std::vector<GLfloat> mVertexIndex;
     std::vector<GLfloat> mVertices;
     std::vector<GLfloat> mNormals;  
@@ -79,10 +126,15 @@ private:
     };
     
     Material mMaterial;
+    bool mHasMTLFile = false;
 
     GLuint mVAO = 0;
     GLuint mVBO[5];
     GLuint mShaderID = 0;
+    GLint mModelMatrixLocation = -1;
+    GLuint mDepthShaderID = 0;          // position only program for the depth pre-pass
+    GLint mDepthModelMatrixLocation = -1;
+    UniformBuffer<ShaderInterface::MaterialBlock> mMaterialUniforms;
 
     Texture* mTextureDiffuse = nullptr;
     Texture* mTextureNormal = nullptr;
@@ -94,14 +146,23 @@ private:
     void VertexSpecification();
     int LoadMTLFile(std::string mtlFileName);
     void CalculateTB();
+    void GenerateGrassInstances();
+    void UpdateInstanceBounds();
+    void UpdateFootprint();
 
     glm::vec3 mMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);      // Minimum (x, y, z) coordinates
     glm::vec3 mMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);   // Maximum (x, y, z) coordinates
     glm::vec3 mObjectCoord = glm::vec3(0, 0, 0);  // origin of object being placed
-    float mRot;              // angle rotated along y-axis when being placed 
+    float mRot = 0.0f;       // angle rotated along y-axis when being placed 
+    OrientedBox2D mFootprint;   // xz rectangle of the placement, follows mObjectCoord and mRot
 
     bool mDrawGrass = false;            // check if we are drawing grass
-    glm::vec3 mTranslations[400];
+    std::vector<InstanceData> mInstances;   // per-instance data of every instance
+    SphereList mInstanceBounds;             // world space bounding sphere per instance
+    std::vector<uint32_t> mVisibleIndices;  // instances that passed culling
+    std::vector<InstanceData> mVisibleInstances;
+    size_t mVisibleInstanceCount = 0;       // instances currently in mInstanceVBO
+    GLuint mInstanceVBO = 0;
 };
 
 #endif
@@ -0,0 +1,86 @@
+/** @file OcclusionCuller.hpp
+ *  @brief Hardware occlusion queries for large objects.
+ *
+ *  After the scene is drawn, the bounding box of every tracked
+ *  object is rendered with color and depth writes off inside a
+ *  GL_ANY_SAMPLES_PASSED query. Results are read without waiting
+ *  in a later frame. An object is only treated as hidden after
+ *  several hidden results in a row, and is shown again as soon
+ *  as one query sees it, so it does not flicker on the border.
+ *
+ *  Modes (F3 cycles):
+ *  - off:          every object is drawn
+ *  - readback:     hidden objects are not submitted
+ *  - conditional:  hidden objects are drawn inside
+ *                  glBeginConditionalRender with their last query,
+ *                  so the GPU still draws them if they came back
+ *
+ *  @bug No known bugs.
+ */
+#ifndef OCCLUSIONCULLER_HPP
+#define OCCLUSIONCULLER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GLState.hpp"
+#include "FrameStats.hpp"
+
+enum OcclusionMode{
+    OCCLUSION_OFF = 0,
+    OCCLUSION_READBACK = 1,
+    OCCLUSION_CONDITIONAL = 2,
+};
+
+class OcclusionCuller{
+public:
+    ~OcclusionCuller();
+
+    // Create the box geometry, program and queries, must be called after OpenGL has been setup
+    void Initialize(size_t objectCount);
+
+    // Collect the query results that are ready, without waiting for the GPU
+    void BeginFrame(FrameStats& stats);
+
+    // Whether object should not be submitted this frame
+    bool IsOccluded(size_t object) const;
+    // Query to draw object under, 0 to draw it unconditionally
+    GLuint GetConditionQuery(size_t object) const;
+    // Object is outside the view this frame, forget its history
+    void MarkCulled(size_t object);
+    // Object passed the other culling tests, its box is queried after the scene
+    void MarkTested(size_t object, const glm::vec3& center, const glm::vec3& extents);
+
+    // Draw the boxes of the objects marked this frame inside their queries
+    void IssueQueries(GLState& state, const glm::vec3& eyePosition, float nearPlane, FrameStats& stats);
+
+    // Switch to the next mode
+    void CycleMode();
+    inline OcclusionMode GetMode() const { return mMode; }
+
+private:
+    struct Entry{
+        GLuint query = 0;
+        bool pending = false;           // query issued, result not read yet
+        bool queried = false;           // query has a result or is pending, usable for conditional render
+        unsigned int hiddenResults = 0; // hidden results in a row
+        bool tested = false;            // marked this frame
+        glm::vec3 center = glm::vec3(0.0f);
+        glm::vec3 extents = glm::vec3(0.0f);
+    };
+
+    // Hidden results in a row before an object is treated as hidden
+    static const unsigned int kHideAfter = 3;
+
+    OcclusionMode mMode = OCCLUSION_READBACK;
+    std::vector<Entry> mEntries;
+    GLuint mProgram = 0;
+    GLint mCenterLocation = -1;
+    GLint mExtentsLocation = -1;
+    GLuint mVAO = 0;
+    GLuint mVBO = 0;
+};
+
+#endif
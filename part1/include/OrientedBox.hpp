@@ -0,0 +1,67 @@
+/** @file OrientedBox.hpp
+ *  @brief Footprints of placed objects on the xz plane.
+ *
+ *  A placed object is a box rotated along the y-axis, so its
+ *  footprint is a rectangle with a center, the cosine and sine of
+ *  its rotation and half extents, computed once when the object is
+ *  placed. Point tests rotate the point into the box instead of
+ *  building matrices.
+ *
+ *  Many boxes are kept as structure of arrays so that one point is
+ *  tested against four of them per SSE instruction; platforms
+ *  without SSE use the scalar loop.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ORIENTEDBOX_HPP
+#define ORIENTEDBOX_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct OrientedBox2D{
+    glm::vec2 center = glm::vec2(0.0f);     // world x, z
+    float cosRot = 1.0f;
+    float sinRot = 0.0f;
+    glm::vec2 halfExtents = glm::vec2(0.0f);
+
+    /**
+    * Footprint of the local rectangle [localMin, localMax] of an object placed
+    * at origin and rotated by rotation degrees along the y-axis.
+    *
+    * @return OrientedBox2D
+    */
+    static OrientedBox2D FromLocal(const glm::vec2& origin, float rotation, const glm::vec2& localMin, const glm::vec2& localMax);
+
+    // Whether point is inside the box grown by margin on every side
+    bool Contains(const glm::vec2& point, float margin) const;
+    // Axis aligned bounds of the box grown by margin
+    void Bounds(float margin, glm::vec2& outMin, glm::vec2& outMax) const;
+};
+
+// Boxes stored per component
+struct OrientedBoxList{
+    std::vector<float> cx, cz;
+    std::vector<float> cosRot, sinRot;
+    std::vector<float> hx, hz;
+
+    void Add(const OrientedBox2D& box);
+    // Remove box index, later boxes move down by one
+    void Remove(size_t index);
+    // Remove box index, the last box takes its place
+    void RemoveSwap(size_t index);
+    void Clear();
+    inline size_t Size() const { return cx.size(); }
+
+    /**
+    * Test point against every box grown by margin. Bit i % 32 of mask[i / 32]
+    * is set when box i contains point.
+    *
+    * @return number of boxes containing point
+    */
+    size_t ContainsPoint(const glm::vec2& point, float margin, std::vector<uint32_t>& mask) const;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/** @file PoissonDisk.hpp
+ *  @brief Poisson-disk sampling of placements on the xz plane.
+ *
+ *  Bridson's algorithm: points grow from an active list, each one
+ *  trying kAttempts candidates in the ring between r and 2r around
+ *  it. A background grid of cells r / sqrt(2) wide holds at most one
+ *  point per cell, so a candidate is checked against the 5x5 cells
+ *  around it and the run is linear in the number of points.
+ *
+ *  Each Sample() is one class of objects with its own radius.
+ *  Exclusion zones (circles around structures, the start of the
+ *  player, ...) are bucketed into a second grid and no sample of
+ *  later classes falls inside them.
+ *
+ *  The sampler owns its random generator and maps it through Random,
+ *  so the same seed, bounds, exclusions and calls give the same
+ *  points on every platform.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef POISSONDISK_HPP
+#define POISSONDISK_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class PoissonDisk{
+public:
+    // Candidates tried around an active point before it retires
+    static const int kAttempts = 30;
+
+    // Samples inside [minValue, maxValue]^2
+    PoissonDisk(float minValue, float maxValue, uint32_t seed);
+
+    // No later sample falls within radius of center
+    void AddExclusion(const glm::vec2& center, float radius);
+
+    /**
+    * Fill the square with points at least radius apart and outside every
+    * exclusion, until no point fits. Regions cut off by exclusions are
+    * reached by restarting from random points.
+    *
+    * @return the points, in the order they were generated
+    */
+    std::vector<glm::vec2> Sample(float radius);
+
+    /**
+    * Sample(), then keep count points picked at random over the whole square.
+    * Fewer points are returned, with a warning, when fewer fit.
+    *
+    * @return the points
+    */
+    std::vector<glm::vec2> Sample(float radius, size_t count);
+
+private:
+    struct Exclusion{
+        glm::vec2 center;
+        float radius;
+    };
+
+    // Bucket each exclusion into every cell its circle overlaps
+    void BuildExclusionGrid();
+    bool IsExcluded(const glm::vec2& point) const;
+
+    float mMinValue;
+    float mMaxValue;
+    std::mt19937 mGenerator;
+    std::vector<Exclusion> mExclusions;
+    std::vector<uint32_t> mExclusionCellStart;  // as CollisionGrid
+    std::vector<uint32_t> mExclusionCellItems;
+    float mExclusionCellSize = 1.0f;
+    int mExclusionCellsPerSide = 0;
+    bool mExclusionGridDirty = true;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/** @file Random.hpp
+ *  @brief Seeded random numbers of world generation and gameplay.
+ *
+ *  One world seed feeds a separate std::mt19937 stream per use, so
+ *  drawing more numbers in one place (more trees, say) does not move
+ *  what every later use gets. The engine of mt19937 is specified
+ *  exactly by the standard but its distributions are not, so values
+ *  are mapped to ranges here: the same seed gives the same world
+ *  with every compiler and standard library.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cstdint>
+#include <random>
+
+enum RandomStream : uint32_t{
+    RANDOM_STRUCTURES = 0,      // placement of the structures
+    RANDOM_TREES,               // placement of the trees
+    RANDOM_TREE_LOOKS,          // size and mirroring of each tree
+    RANDOM_BATTERIES,           // placement of the batteries
+    RANDOM_GRASS_TILES,         // rotation and tint of the grass tiles
+    RANDOM_GRASS_BLADES,        // the blades of GrassField
+    RANDOM_HEAD_LIGHT,          // flicker of the head light
+    RANDOM_TERRAIN,             // heights of the ground
+    RANDOM_STREAM_COUNT
+};
+
+class Random{
+public:
+    // Reseed every stream from seed
+    void Seed(uint32_t seed);
+    inline uint32_t GetSeed() const { return mSeed; }
+
+    // Seed of stream, for generators owned elsewhere such as PoissonDisk
+    uint32_t StreamSeed(RandomStream stream) const;
+    // Seed of stream for one chunk of a streamed world, see WorldStreamer
+    static uint32_t ChunkSeed(uint32_t streamSeed, int x, int z);
+    inline std::mt19937& Stream(RandomStream stream) { return mStreams[stream]; }
+
+    // Float in [min, max)
+    inline float Uniform(RandomStream stream, float min, float max) { return Uniform(mStreams[stream], min, max); }
+    // Integer in [min, max]
+    inline int Int(RandomStream stream, int min, int max) { return Int(mStreams[stream], min, max); }
+
+    // Same mappings on any generator
+    static float Uniform(std::mt19937& generator, float min, float max);
+    static int Int(std::mt19937& generator, int min, int max);
+
+private:
+    // Finalizer of splitmix64
+    static uint32_t Mix(uint64_t value);
+
+    uint32_t mSeed = 0;
+    std::mt19937 mStreams[RANDOM_STREAM_COUNT];
+};
+
+#endif
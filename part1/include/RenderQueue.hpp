@@ -0,0 +1,93 @@
+/** @file RenderQueue.hpp
+ *  @brief Sorts draw packets and submits them with as few binds as possible.
+ *  
+ *  Every draw of a frame is submitted as a DrawPacket with a
+ *  64-bit sort key:
+ *
+ *      | pass (4) | program (12) | material (16) | VAO (12) | depth (20) |
+ *
+ *  The queue is radix sorted once per frame and drawn in key
+ *  order through the GLState cache, so program, VAO, material and
+ *  texture binds that are already in place are skipped. With the
+ *  depth pre-pass the sorted packets are drawn twice, first with
+ *  their depth program, then shaded.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "FrameStats.hpp"
+#include "GLState.hpp"
+
+// Render passes, lower passes are drawn first
+enum RenderPass : uint8_t {
+    PASS_OPAQUE         = 0,    // solid meshes, sorted front to back
+    PASS_ALPHA_TESTED   = 1,    // billboards using discard
+};
+
+// Number of texture slots a packet can bind
+const int kPacketTextureSlots = 3;
+
+// Everything needed to issue one draw call
+struct DrawPacket{
+    GLuint program = 0;
+    GLint modelMatrixLocation = -1;     // -1 if the program has no model matrix
+    glm::mat4 model = glm::mat4(1.0f);
+    GLuint vao = 0;
+    GLuint textures[kPacketTextureSlots] = {0, 0, 0};  // GL_TEXTURE_2D per slot, 0 = unused
+    GLuint materialUBO = 0;             // bound to MaterialBlock, 0 = none
+    GLenum mode = GL_TRIANGLES;
+    GLint first = 0;
+    GLsizei count = 0;
+    GLsizei instanceCount = 0;          // 0 = not instanced
+    GLuint conditionQuery = 0;          // draw under glBeginConditionalRender with this query, 0 = always draw
+
+    // Depth pre-pass
+    GLuint depthProgram = 0;            // writes the same depth as program, 0 = not drawn in the pre-pass
+    GLint depthModelMatrixLocation = -1;
+    bool depthNeedsTextures = false;    // depth program samples textures (alpha testing)
+};
+
+class RenderQueue{
+public:
+    // Start a new frame, depth in sort keys is measured from eyePosition up to farPlane
+    void Begin(const glm::vec3& eyePosition, float farPlane);
+    // Add a packet, worldCenter is used for front to back ordering
+    void Submit(const DrawPacket& packet, RenderPass pass, const glm::vec3& worldCenter);
+    // Sort the packets of this frame, must be called before drawing them
+    void Sort();
+    // Draw every packet with its depth program, for the depth pre-pass
+    void DrawDepth(GLState& state, FrameStats& stats);
+    // Draw every packet shaded through state, recording binds in stats
+    void Draw(GLState& state, FrameStats& stats);
+    // Number of packets submitted this frame
+    inline size_t GetPacketCount() const { return mPackets.size(); }
+private:
+    uint64_t MakeKey(const DrawPacket& packet, RenderPass pass, const glm::vec3& worldCenter);
+    uint16_t MaterialIndex(const DrawPacket& packet);
+    void RadixSort();
+    void DrawPackets(GLState& state, FrameStats& stats, bool depthOnly);
+
+    glm::vec3 mEyePosition = glm::vec3(0.0f);
+    float mFarPlane = 1.0f;
+
+    std::vector<DrawPacket> mPackets;
+    std::vector<uint64_t> mKeys;
+    // Packet order, sorted by key
+    std::vector<uint32_t> mOrder;
+    std::vector<uint32_t> mScratch;
+
+    // Compact ids of the texture/material sets submitted this frame
+    std::map<std::tuple<GLuint, GLuint, GLuint, GLuint>, uint16_t> mMaterialIndices;
+};
+
+#endif
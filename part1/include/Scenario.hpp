@@ -0,0 +1,48 @@
+/** @file Scenario.hpp
+ *  @brief Text files pinning the world of a run.
+ *
+ *  A scenario sets the world seed, the map size, how many trees,
+ *  batteries and grass blades there are, and which asset files are
+ *  loaded, so a performance run can be repeated on another machine
+ *  or another commit. One "key = value" per line, '#' starts a
+ *  comment, keys left out keep their defaults in globals.hpp:
+ *
+ *      seed = 1234
+ *      map_size = 40
+ *      trees_per_kind = 50
+ *      tree_spacing = 1
+ *      batteries = 10
+ *      grass_spacing = 2
+ *      grass_blades_per_unit = 640
+ *      house = ./../common/objects/house/house_obj.obj
+ *
+ *  "streaming = 1" streams the map in chunks around the player
+ *  (see WorldStreamer) instead of generating all of it at start,
+ *  set with chunk_size, stream_radius, stream_memory_mb,
+ *  stream_threads, tree_density (trees per square unit, in place of
+ *  trees_per_kind) and structure_area (side of the middle square
+ *  holding the structures).
+ *
+ *  "terrain = 0" keeps the flat ground of grass tiles, else the hills
+ *  (see Heightfield) are set with terrain_height (highest point) and
+ *  terrain_feature_size (width of a hill).
+ *
+ *  Asset keys are house, chapel, windmill, chalice, battery, grass
+ *  and tree0 to tree3. See scenarios/ for complete files.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+
+#include <string>
+
+/**
+* Read fileName and apply its settings to g, unknown keys and bad values are
+* reported and stop the load.
+*
+* @return bool false when the file cannot be read or has an error
+*/
+bool LoadScenario(const std::string& fileName);
+
+#endif
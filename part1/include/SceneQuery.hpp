@@ -0,0 +1,115 @@
+/** @file SceneQuery.hpp
+ *  @brief Batched spatial queries against the structures and trees.
+ *
+ *  Items are 3D volumes made of an OrientedBox2D footprint and a
+ *  height range. A structure item also has the MeshBVH of its mesh
+ *  and the origin and rotation of its placement. Build() buckets the
+ *  items into a uniform grid on the xz plane, stored like
+ *  CollisionGrid as one offset per cell into a single index array.
+ *
+ *  Queries take arrays and write arrays:
+ *  - rays walk the grid cell by cell and stop at the first cell that
+ *    ends past the nearest hit; structures are hit on their triangles,
+ *    other items on their box
+ *  - spheres overlap structures on their triangles, other items on
+ *    their box
+ *  - axis aligned boxes overlap the item volumes
+ *
+ *  Queries are const and use no shared scratch, so several threads
+ *  can run batches on the same SceneQuery at once.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SCENEQUERY_HPP
+#define SCENEQUERY_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "OrientedBox.hpp"
+#include "MeshBVH.hpp"
+
+struct SceneRay{
+    glm::vec3 origin;
+    float maxDistance;          // in units of direction
+    glm::vec3 direction;        // does not need to be normalized
+};
+
+struct SceneHit{
+    float distance;             // along the ray, maxDistance when nothing is hit
+    int32_t item;               // -1 when nothing is hit
+    uint32_t triangle;          // of the structure's mesh, 0 for other items
+};
+
+struct SceneSphere{
+    glm::vec3 center;
+    float radius;
+};
+
+struct SceneBox{
+    glm::vec3 boxMin;
+    glm::vec3 boxMax;
+};
+
+// Items overlapping each query, those of query q are items[offsets[q], offsets[q + 1])
+struct SceneOverlaps{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> items;
+};
+
+class SceneQuery{
+public:
+    /**
+    * Structure placed at origin, with footprint the xz bounds of its mesh and
+    * [minY, maxY] its world height. bvh is in the object's frame and must
+    * outlive the SceneQuery.
+    *
+    * @return index of the item
+    */
+    uint32_t AddMesh(const OrientedBox2D& footprint, const glm::vec3& origin, float minY, float maxY, const MeshBVH& bvh);
+    // Solid box of footprint from minY to maxY, e.g. a tree trunk, returns the index of the item
+    uint32_t AddBox(const OrientedBox2D& footprint, float minY, float maxY);
+    // Bucket every item added so far into cells covering [minValue, maxValue]^2, grown to hold every item
+    void Build(float minValue, float maxValue);
+    // Same over the rectangle [minValue, maxValue], e.g. the chunks around the player
+    void Build(glm::vec2 minValue, glm::vec2 maxValue);
+    // Remove every item and cell
+    void Clear();
+
+    // Nearest hit of each ray
+    void Raycast(const SceneRay* rays, size_t count, SceneHit* outHits) const;
+    // Items touching each sphere, in increasing item order
+    void OverlapSpheres(const SceneSphere* spheres, size_t count, SceneOverlaps& outOverlaps) const;
+    // Items touching each box, in increasing item order
+    void OverlapBoxes(const SceneBox* boxes, size_t count, SceneOverlaps& outOverlaps) const;
+
+    inline size_t GetItemCount() const { return mItems.size(); }
+    inline int GetCellsPerSide() const { return mCellsPerSide; }
+
+private:
+    struct Item{
+        OrientedBox2D footprint;
+        float minY;
+        float maxY;
+        glm::vec3 origin;               // placement of the mesh
+        const MeshBVH* bvh;             // null for a box
+    };
+
+    // Entry distance of the ray into the volume of item, false when it misses it before maxDistance
+    bool RayVolume(const Item& item, const SceneRay& ray, float maxDistance, float& outDistance) const;
+    bool SphereTouches(const Item& item, const SceneSphere& sphere) const;
+    bool BoxTouches(const Item& item, const SceneBox& box) const;
+    // Sorted items of the cells overlapping [boundsMin, boundsMax] on the xz plane
+    void GatherItems(const glm::vec2& boundsMin, const glm::vec2& boundsMax, std::vector<uint32_t>& outItems) const;
+
+    std::vector<Item> mItems;
+    std::vector<uint32_t> mCellStart;   // items of cell c are mCellItems[mCellStart[c], mCellStart[c + 1])
+    std::vector<uint32_t> mCellItems;
+    glm::vec2 mMinValue = glm::vec2(0.0f);    // corner of the grid
+    float mCellSize = 1.0f;
+    int mCellsPerSide = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+/** @file ShaderCache.hpp
+ *  @brief Compiles and caches shader permutations.
+ *  
+ *  Shader sources are specialized with feature defines
+ *  (e.g. HAS_NORMAL_MAP) injected after the #version line.
+ *  Each (sources, features) combination is compiled once
+ *  and shared by every object that asks for it.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SHADERCACHE_HPP
+#define SHADERCACHE_HPP
+
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Feature flags, each one is injected as a #define of the same name
+enum ShaderFeature : unsigned int {
+    SHADER_HAS_NORMAL_MAP   = 1u << 0,
+    SHADER_HAS_SPECULAR_MAP = 1u << 1,
+    SHADER_INSTANCED        = 1u << 2,
+    SHADER_NO_DISCARD       = 1u << 3,
+    SHADER_DEPTH_ONLY       = 1u << 4,
+};
+
+/**
+* Inserts one #define per feature bit right after the #version line of source.
+*
+* @param source Shader source code
+* @param features Bitwise OR of ShaderFeature flags
+* @return Shader source with defines
+*/
+std::string InjectShaderDefines(const std::string& source, unsigned int features);
+
+class ShaderCache{
+public:
+    // Return the program for the vertex/fragment shader files and features,
+    // compiling it the first time this variant is requested
+    GLuint GetProgram(const std::string& vertexPath, const std::string& fragmentPath, unsigned int features = 0);
+    // Same as above with a geometry shader stage
+    GLuint GetProgram(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, unsigned int features = 0);
+    // Vertex and geometry shader only, the geometry shader outputs named by varyings
+    // are captured with transform feedback
+    GLuint GetFeedbackProgram(const std::string& vertexPath, const std::string& geometryPath, const std::vector<const char*>& varyings, unsigned int features = 0);
+    // Number of variants compiled so far
+    inline size_t GetProgramCount() const { return mPrograms.size(); }
+    // Delete every program, must be called while the context is alive
+    void Clear();
+private:
+    std::map<std::string, GLuint> mPrograms;
+};
+
+#endif
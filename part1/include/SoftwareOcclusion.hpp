@@ -0,0 +1,93 @@
+/** @file SoftwareOcclusion.hpp
+ *  @brief CPU occlusion culling against a small depth buffer.
+ *
+ *  Occluder triangles (simplified structure hulls and tree trunks)
+ *  are rasterized into a 256x128 depth buffer on a worker thread
+ *  while the main thread prepares the frame. Bounds are then tested
+ *  against the buffer before they are submitted, without any GPU
+ *  round trip. The class does not use OpenGL.
+ *
+ *  Both steps are conservative: occluders only cover pixels they
+ *  cover completely, with the farthest depth inside the pixel (the
+ *  two triangles of a box face or quad count as one), and
+ *  a bound is occluded only if every pixel of its screen rectangle
+ *  is closer than its nearest point.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SOFTWAREOCCLUSION_HPP
+#define SOFTWAREOCCLUSION_HPP
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Frustum.hpp"
+
+class SoftwareOcclusion{
+public:
+    static const int kWidth = 256;
+    static const int kHeight = 128;
+
+    // Start the worker thread
+    SoftwareOcclusion();
+    // Stop the worker thread
+    ~SoftwareOcclusion();
+
+    // Occluders of the next frame, in world space
+    void ClearOccluders();
+    // Box from localMin to localMax placed by model
+    void AddOccluderBox(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model);
+    // Vertical quad standing on base, turned to face eyePosition
+    void AddOccluderQuad(const glm::vec3& base, float width, float height, const glm::vec3& eyePosition);
+
+    // Rasterize the occluders on the worker thread, occluders must not change until Wait() returns
+    void RasterizeAsync(const glm::mat4& viewProjection);
+    // Rasterize the occluders on the calling thread
+    void Rasterize(const glm::mat4& viewProjection);
+    // Block until the worker has finished the depth buffer
+    void Wait();
+
+    // Whether the box is hidden behind the occluders, call after Wait()
+    bool IsOccluded(const glm::vec3& center, const glm::vec3& extents) const;
+    // Remove from indices the occluded spheres/boxes, returns how many were removed
+    size_t FilterSpheres(const SphereList& spheres, std::vector<uint32_t>& indices) const;
+    size_t FilterBoxes(const BoxList& boxes, std::vector<uint32_t>& indices) const;
+
+    // Number of occluder triangles drawn and skipped by the last rasterization
+    inline unsigned int GetTrianglesDrawn() const { return mTrianglesDrawn; }
+    inline unsigned int GetTrianglesSkipped() const { return mTrianglesSkipped; }
+
+    // Depth of pixel (x, y), 0 is the near plane and 1 the far plane or empty
+    inline float GetDepth(int x, int y) const { return mDepth[y * kWidth + x]; }
+
+private:
+    // Edges of a triangle, a-b, b-c and c-a, in sharedEdges
+    static constexpr uint8_t kEdgeAB = 1;
+    static constexpr uint8_t kEdgeBC = 2;
+    static constexpr uint8_t kEdgeCA = 4;
+
+    void AddQuad(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d);
+    void RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, uint8_t sharedEdges);
+    void WorkerLoop();
+
+    std::vector<float> mDepth;
+    std::vector<glm::vec3> mTriangles;     // three world space vertices per triangle
+    std::vector<uint8_t> mSharedEdges;     // per triangle, edges shared with the other half of its quad
+    glm::mat4 mViewProjection = glm::mat4(1.0f);
+    unsigned int mTrianglesDrawn = 0;
+    unsigned int mTrianglesSkipped = 0;
+
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    bool mHasWork = false;
+    bool mQuit = false;
+};
+
+#endif
@@ -0,0 +1,113 @@
+/** @file StaticBatch.hpp
+ *  @brief Static scene drawn with a single glMultiDrawArraysIndirect.
+ *
+ *  The meshes of the structures, batteries and grass are packed
+ *  into one interleaved vertex buffer, and their diffuse, normal
+ *  and specular maps into one texture array. Objects loaded from
+ *  the same file share their mesh. Materials are stored in a
+ *  uniform block table, so one program with one set of bindings
+ *  draws everything.
+ *
+ *  Every frame the culling stage adds the visible placements, and
+ *  Draw() writes one indirect command per mesh (its placements are
+ *  instances, found through baseInstance) and issues them all with
+ *  one call, whatever the number of objects.
+ *
+ *  Needs OpenGL 4.3 (see HasMultiDrawIndirect()), on older
+ *  contexts objects are submitted to the RenderQueue one by one.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef STATICBATCH_HPP
+#define STATICBATCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "OBJ.hpp"
+#include "GLState.hpp"
+#include "GLExtensions.hpp"
+#include "UniformBuffer.hpp"
+#include "FrameStats.hpp"
+#include "generated/ShaderInterface.hpp"
+
+class StaticBatch{
+public:
+    // Size of the material table, must match MaterialTableBlock in static_frag.glsl
+    static const int kMaxMaterials = 16;
+    // Layers are as large as the largest texture up to this size, the others are resampled
+    static constexpr int kMaxLayerSize = 2048;
+
+    ~StaticBatch();
+
+    // Add the mesh and material of object, once per file. Must be called before Build().
+    // Past kMaxMaterials the mesh is not added, AddObject() then returns false
+    void AddMesh(const OBJ& object);
+    // Upload the merged meshes and textures and create the program
+    void Build();
+
+    // Start collecting this frame's placements
+    void Begin();
+    // Draw object once at its placement, false when its mesh is not batched and
+    // the object must be drawn on its own
+    bool AddObject(const OBJ& object);
+    // Draw the visible instances of an instanced object (grass), false as AddObject()
+    bool AddInstances(const OBJ& object, const std::vector<InstanceData>& instances);
+
+    // Upload the commands and instances collected since Begin()
+    void Upload(FrameStats& stats);
+    // Draw the uploaded commands, with the depth only program for the pre-pass
+    void Draw(GLState& state, FrameStats& stats, bool depthOnly);
+
+private:
+    // Interleaved vertex of the merged buffer, attribute locations 0 to 4
+    struct Vertex{
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 textureCoord;
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+    };
+
+    // Per-instance attributes, locations 5 to 9 of static_vert.glsl
+    struct Instance{
+        glm::mat4 model;
+        glm::vec4 tintMaterial;     // tint (r,g,b) and material index
+    };
+
+    struct Mesh{
+        GLuint first = 0;           // first vertex in the merged buffer
+        GLuint count = 0;
+        int material = 0;
+        std::vector<Instance> instances;    // placements of this frame
+    };
+
+    int AddLayer(const Texture* texture);
+    Mesh* FindMesh(const OBJ& object);
+
+    std::map<std::string, size_t> mMeshIndices;    // file name to index in mMeshes
+    std::vector<Mesh> mMeshes;
+    std::vector<Vertex> mVertices;
+    std::vector<const Texture*> mLayers;
+    int mLayerSize = 1;
+    ShaderInterface::MaterialTableBlock mMaterials = {};
+    int mMaterialCount = 0;
+
+    std::vector<DrawArraysIndirectCommand> mCommands;
+    std::vector<Instance> mInstances;
+
+    GLuint mVAO = 0;
+    GLuint mVertexVBO = 0;
+    GLuint mInstanceVBO = 0;
+    GLuint mCommandBuffer = 0;
+    GLuint mTextureArray = 0;
+    GLuint mShaderID = 0;
+    GLuint mDepthShaderID = 0;
+    UniformBuffer<ShaderInterface::MaterialTableBlock> mMaterialUniforms;
+};
+
+#endif
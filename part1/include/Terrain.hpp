@@ -0,0 +1,110 @@
+/** @file Terrain.hpp
+ *  @brief Heightfield ground drawn with continuous level of detail (CDLOD).
+ *
+ *  The map is covered by a quadtree whose leaves are kLeafSize wide,
+ *  each node knowing the lowest and highest height under it. Level l
+ *  is drawn up to a distance of lodDistance * 2^l from the eye, the
+ *  top level without limit. Every frame Select() walks the tree from
+ *  the top: a node inside the frustum is drawn whole when none of its
+ *  children is in range of the level below, else its children are
+ *  selected in turn and the quadrants they left out are drawn with
+ *  the node's level.
+ *
+ *  Every patch is the same grid of kGridQuads x kGridQuads quads,
+ *  stored once and scaled to its node by terrain_vert.glsl, which
+ *  also reads the heights from a float texture of the Heightfield.
+ *  Near the end of its range a patch morphs into the grid of the
+ *  next level, so neighbours of two levels meet without cracks and
+ *  switching level never pops. The grid is stored quadrant after
+ *  quadrant, a quadrant drawn alone is a range of its vertices.
+ *
+ *  Patches are drawn instanced, one draw for the whole nodes and one
+ *  per quadrant. As the ranges double from level to level, the number
+ *  of patches grows with the logarithm of the view distance.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TERRAIN_HPP
+#define TERRAIN_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "Heightfield.hpp"
+#include "Frustum.hpp"
+#include "RenderQueue.hpp"
+#include "FrameStats.hpp"
+#include "Texture.hpp"
+
+// One patch of a frame, a quadtree node or a quadrant of it
+struct TerrainPatch{
+    glm::vec2 corner;           // lowest x and z of the node
+    float size;                 // side of the node
+    int level;                  // 0 for the leaves
+    int part;                   // quadrant 0 to 3 (x, then z), or Terrain::kWholeNode
+};
+
+class Terrain{
+public:
+    // Side of the leaves, in world units
+    static constexpr float kLeafSize = 8.0f;
+    // Quads per side of a patch, must be even
+    static const int kGridQuads = 16;
+    // Levels at most, must match u_MorphRanges in terrain_vert.glsl
+    static const int kMaxLevels = 16;
+    // TerrainPatch::part of a node drawn whole
+    static const int kWholeNode = 4;
+
+    ~Terrain();
+
+    // Build the quadtree over heightfield, level 0 drawn up to lodDistance from the eye.
+    // CPU only, Initialize() needs it first
+    void Build(const Heightfield& heightfield, float lodDistance);
+    // Upload the heights and the shared grid and setup the programs
+    void Initialize(const Heightfield& heightfield, const std::string& textureFileName);
+
+    // Append the patches to draw from eyePosition, inside frustum
+    void Select(const glm::vec3& eyePosition, const Frustum& frustum, std::vector<TerrainPatch>& patches) const;
+    // Select the patches of the frame, upload them and add their draws to the queue
+    void Submit(const glm::vec3& eyePosition, const Frustum& frustum, RenderQueue& queue, FrameStats& stats);
+
+    inline int GetLevelCount() const { return mLevelCount; }
+    // Distance from the eye up to which level is drawn
+    inline float GetLevelRange(int level) const { return mRanges[level]; }
+
+private:
+    // Instances of one part, drawn with one instanced call
+    struct PartBatch{
+        GLuint vao = 0;
+        GLuint instanceVBO = 0;
+        std::vector<glm::vec4> instances;   // corner x, corner z, size, level
+    };
+
+    // Bounds of node (x, z) of level
+    void NodeBounds(int level, int x, int z, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+    // Select node (x, z) of level, false when it is out of range of its level and
+    // its parent has to draw its area
+    bool SelectNode(int level, int x, int z, const glm::vec3& eyePosition, const Frustum& frustum,
+                    std::vector<TerrainPatch>& patches) const;
+
+    float mMinValue = 0.0f;
+    float mMaxValue = 0.0f;
+    int mLevelCount = 0;
+    std::vector<int> mNodesPerSide;                     // per level
+    std::vector<std::vector<glm::vec2>> mNodeHeights;   // per level, lowest and highest height of each node, row major
+    std::vector<float> mRanges;                         // per level
+    std::vector<glm::vec2> mMorphRanges;                // per level, distances where the morph starts and ends
+
+    std::vector<TerrainPatch> mPatches;                 // of the current frame
+    PartBatch mParts[kWholeNode + 1];
+    GLuint mGridVBO = 0;
+    GLuint mHeightmap = 0;
+    Texture* mTexture = nullptr;
+    GLuint mShaderID = 0;
+    GLuint mDepthShaderID = 0;
+};
+
+#endif
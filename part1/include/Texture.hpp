@@ -28,6 +28,10 @@ public:
     void Bind(unsigned int slot=0) const;
     // Be done with our texture
     void Unbind();
+    // Return the OpenGL texture id
+    inline GLuint GetID() const { return m_textureID; }
+    // Return the image the texture was loaded from, kept in memory
+    inline Image* GetImage() const { return m_image; }
 private:
     // Store a unique ID for the texture
     GLuint m_textureID;
@@ -0,0 +1,98 @@
+/** @file TriggerSystem.hpp
+ *  @brief Sensor volumes the player collects or reaches.
+ *
+ *  A trigger is a footprint on the xz plane (see OrientedBox2D) with
+ *  a type and a user value. Triggers are bucketed into a uniform
+ *  grid by the cell of their center, and each cell keeps its
+ *  footprints as an OrientedBoxList so the player is tested against
+ *  a whole cell at once. A query looks at the 3x3 cells around the
+ *  player, triggers wider than a cell go to one extra list that is
+ *  always tested.
+ *
+ *  Update() calls the callback registered for the type of every
+ *  trigger containing the player; a callback returning true removes
+ *  its trigger. Removal swaps the last trigger of the cell into the
+ *  slot, so it is O(1) whatever the number of triggers.
+ *
+ *  Triggers are named by handles that stay valid until removed.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TRIGGERSYSTEM_HPP
+#define TRIGGERSYSTEM_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "OrientedBox.hpp"
+
+enum TriggerType : uint32_t{
+    TRIGGER_BATTERY = 0,
+    TRIGGER_CHALICE,
+    TRIGGER_TYPE_COUNT
+};
+
+class TriggerSystem{
+public:
+    // Called with the user value of a trigger containing the player, returns
+    // whether the trigger is used up and must be removed
+    typedef std::function<bool(uint32_t handle, uint32_t userValue)> Callback;
+
+    static const uint32_t kInvalidHandle = 0xFFFFFFFFu;
+
+    // Grid over [minValue, maxValue]^2 of cells at least cellSize wide, removes every trigger
+    void Initialize(float minValue, float maxValue, float cellSize);
+    // Footprint grown by margin on every side, returns the handle of the trigger
+    uint32_t Add(TriggerType type, const OrientedBox2D& box, float margin, uint32_t userValue);
+    // Remove trigger handle, the handle may be reused by a later Add
+    void Remove(uint32_t handle);
+    void SetUserValue(uint32_t handle, uint32_t userValue);
+    void SetCallback(TriggerType type, Callback callback);
+
+    /**
+    * Dispatch every trigger containing point to the callback of its type.
+    * Callbacks may add and remove triggers.
+    *
+    * @return number of callbacks called
+    */
+    size_t Update(const glm::vec2& point);
+
+    // Footprints an Update at point tests
+    size_t CandidatesAt(const glm::vec2& point) const;
+
+    inline size_t Size() const { return mCount; }
+    inline bool IsValid(uint32_t handle) const { return handle < mSlots.size() && mSlots[handle].cell != kInvalidHandle; }
+
+private:
+    struct Cell{
+        OrientedBoxList boxes;          // margin included in the half extents
+        std::vector<uint32_t> handles;  // per box
+    };
+
+    struct Slot{
+        uint32_t cell;                  // kInvalidHandle when the handle is free
+        uint32_t index;                 // in the cell
+        TriggerType type;
+        uint32_t userValue;
+    };
+
+    // Cell owning a trigger of this footprint, the last cell for wide ones
+    uint32_t CellOf(const OrientedBox2D& box) const;
+    void TestCell(uint32_t cell, const glm::vec2& point);
+
+    std::vector<Cell> mCells;           // mCellsPerSide^2 grid cells, then the wide triggers
+    std::vector<Slot> mSlots;           // per handle
+    std::vector<uint32_t> mFreeHandles;
+    std::vector<Callback> mCallbacks;   // per type
+    std::vector<uint32_t> mMask;        // scratch of OrientedBoxList::ContainsPoint
+    std::vector<uint32_t> mFired;       // handles found by the current Update
+    float mMinValue = 0.0f;
+    float mCellSize = 1.0f;
+    int mCellsPerSide = 0;
+    size_t mCount = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+/** @file UniformBuffer.hpp
+ *  @brief Uniform buffer object holding one std140 block.
+ *  
+ *  Block is one of the generated ShaderInterface structs,
+ *  its layout already matches std140 so updating the buffer
+ *  is a single copy of the struct.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef UNIFORMBUFFER_HPP
+#define UNIFORMBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include "GLState.hpp"
+
+template <typename Block>
+class UniformBuffer{
+public:
+    // Destructor
+    ~UniformBuffer(){
+        if (mUBO != 0) {
+            mState->DeleteBuffers(1, &mUBO);
+        }
+    }
+
+    // Create the buffer, must be called after OpenGL has been setup.
+    // Binds go through state so that rebinding the same buffer is free.
+    void Initialize(GLState& state, GLenum usage = GL_DYNAMIC_DRAW){
+        mState = &state;
+        glGenBuffers(1, &mUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, usage);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Copy the block into the buffer
+    void Update(const Block& data){
+        glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Bind the buffer to the binding index of the block
+    void Bind() const{
+        mState->BindBufferBase(GL_UNIFORM_BUFFER, Block::kBinding, mUBO);
+    }
+
+    inline GLuint GetID() const { return mUBO; }
+private:
+    GLuint mUBO = 0;
+    GLState* mState = nullptr;
+};
+
+#endif
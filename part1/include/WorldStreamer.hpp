@@ -0,0 +1,149 @@
+/** @file WorldStreamer.hpp
+ *  @brief Chunks of an open world generated around the player.
+ *
+ *  A streamed map is cut into square chunks. A chunk holds its trees
+ *  (Poisson-disk samples, see PoissonDisk), its grass tiles and a
+ *  CollisionGrid of its trunks, all drawn from seeds of the chunk
+ *  coordinates (see Random::ChunkSeed): a chunk released and
+ *  generated again comes back the same, whatever the path of the
+ *  player or the number of worker threads.
+ *
+ *  Update() hands the missing chunks within the load radius to the
+ *  worker threads, nearest first, takes the finished ones and
+ *  releases those past the unload radius. Resident chunks are capped
+ *  in memory; when a nearer chunk is wanted at the cap, the furthest
+ *  one goes. Startup time and memory depend on the radii, not on the
+ *  size of the map.
+ *
+ *  Trees stay a margin inside their chunk, so neighbouring chunks
+ *  keep the tree spacing between them and a trunk footprint never
+ *  leaves its chunk: a collision test only looks at one chunk.
+ *
+ *  Workers only touch the chunk they generate. The main thread owns
+ *  the resident chunks and copies them into the instance buffers of
+ *  the renderer (see GatherTrees and GatherGrass) when Update()
+ *  reports a change.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef WORLDSTREAMER_HPP
+#define WORLDSTREAMER_HPP
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "OBJ.hpp"
+#include "CollisionGrid.hpp"
+
+// Kinds of trees, one BillboardList each
+static const int kStreamedTreeKinds = 4;
+
+struct StreamSettings{
+    // Seeds of the RANDOM_TREES, RANDOM_TREE_LOOKS and RANDOM_GRASS_TILES streams
+    uint32_t treeSeed = 0;
+    uint32_t treeLooksSeed = 0;
+    uint32_t grassSeed = 0;
+    // The map, [minValue, maxValue]^2
+    float minValue = -20.0f;
+    float maxValue = 20.0f;
+    float chunkSize = 16.0f;
+    // Chunks closer than loadRadius are generated, further than unloadRadius released
+    float loadRadius = 32.0f;
+    float unloadRadius = 48.0f;
+    size_t memoryBytes = 64u << 20;
+    int threadCount = 2;
+    // Trees per square unit, at least treeSpacing apart
+    float treeDensity = 0.125f;
+    float treeSpacing = 1.0f;
+    // Half size of the collision square of a trunk
+    float trunkMargin = 0.1f;
+    float grassSpacing = 2.0f;
+    bool grassTiles = true;                 // off on the terrain
+    // Discs without trees, e.g. around the structures
+    std::vector<glm::vec3> exclusions;      // center x, center z, radius
+
+    // Settings of the map in g, to be completed with the exclusions
+    static StreamSettings FromGlobals();
+};
+
+struct WorldChunk{
+    glm::ivec2 coord;
+    std::vector<glm::vec2> treeCoords[kStreamedTreeKinds];
+    std::vector<float> treeSizeMirror[kStreamedTreeKinds];  // see BillboardList::DrawLooks
+    std::vector<InstanceData> grassTiles;
+    CollisionGrid collision;                // trunks, relative to the corner of the chunk
+    size_t memoryBytes = 0;
+    bool resident = false;                  // generated and taken by Update()
+};
+
+class WorldStreamer{
+public:
+    ~WorldStreamer();
+
+    // Start the worker threads, no chunk is resident yet
+    void Start(const StreamSettings& settings);
+    // Stop the worker threads and release every chunk
+    void Stop();
+    // Request, take and release chunks for the player at position, returns
+    // whether the resident chunks changed
+    bool Update(const glm::vec2& position);
+    // Update() until every chunk within the load radius of position is resident
+    // or refused by the memory cap, for the start of the game
+    void LoadAround(const glm::vec2& position);
+    // Whether the chunk containing point is resident
+    bool IsResident(const glm::vec2& point) const;
+    // Whether point is inside a trunk of the resident chunk containing it
+    bool Collides(const glm::vec2& point) const;
+
+    // Append the trees of one kind, or the grass tiles, of every resident chunk
+    void GatherTrees(int kind, std::vector<glm::vec2>& coords, std::vector<float>& sizeMirror) const;
+    void GatherGrass(std::vector<InstanceData>& tiles) const;
+
+    inline size_t GetResidentCount() const { return mResidentCount; }
+    inline size_t GetPendingCount() const { return mPendingCount; }
+    inline size_t GetResidentBytes() const { return mResidentBytes; }
+    inline size_t GetGeneratedCount() const { return mGeneratedCount; }
+    inline const StreamSettings& GetSettings() const { return mSettings; }
+
+    // Fill chunk from the settings, touches nothing else
+    static void Generate(const StreamSettings& settings, WorldChunk& chunk);
+
+private:
+    static inline uint64_t Key(const glm::ivec2& coord) { return (uint64_t)(uint32_t)coord.x << 32 | (uint32_t)coord.y; }
+    // Chunk containing point, clamped to the map
+    glm::ivec2 ChunkOf(const glm::vec2& point) const;
+    // Distance from position to the square of the chunk
+    float Distance(const glm::ivec2& coord, const glm::vec2& position) const;
+    // Resident chunk furthest from position, null when there is none
+    WorldChunk* Furthest(const glm::vec2& position) const;
+    void Release(const WorldChunk* chunk);
+    void WorkerLoop();
+
+    StreamSettings mSettings;
+    int mChunksPerSide = 0;
+    std::unordered_map<uint64_t, std::unique_ptr<WorldChunk>> mChunks;     // resident and pending
+    size_t mResidentCount = 0;
+    size_t mResidentBytes = 0;
+    size_t mPendingCount = 0;
+    size_t mGeneratedCount = 0;
+
+    // Shared with the workers
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;          // a request was queued or the workers must stop
+    std::condition_variable mIdle;          // nothing queued or being generated
+    std::deque<WorldChunk*> mQueue;
+    std::vector<WorldChunk*> mFinished;
+    int mGenerating = 0;
+    bool mStop = false;
+};
+
+#endif
@@ -11,6 +11,11 @@
 #include "Camera.hpp"
 #include "Light.hpp"
 #include "Texture.hpp"
+#include "ShaderCache.hpp"
+#include "FrameStats.hpp"
+#include "GLState.hpp"
+#include "Random.hpp"
+#include "Heightfield.hpp"
 
 // Forward Declaration
 struct STLFile;
@@ -26,6 +31,74 @@ struct Global{
 	float gMaxValue 						= 20.f;
 	float gMinValue							= -20.f;
 
+	// distance between grass tiles, grass covers the whole map
+	float gGrassSpacing 					= 2.f;
+
+	// Hilly ground (see Heightfield and Terrain) in place of the flat grass tiles.
+	// Heights within gTerrainHeight of 0, hills gTerrainFeatureSize wide, sampled
+	// every gTerrainSampleSpacing. The finest patches reach gTerrainLodDistance from
+	// the eye, and the player cannot climb slopes steeper than gMaxWalkSlope
+	bool gTerrain							= true;
+	float gTerrainHeight					= 1.5f;
+	float gTerrainFeatureSize				= 24.f;
+	float gTerrainSampleSpacing				= 0.5f;
+	float gTerrainLodDistance				= 24.f;
+	float gMaxWalkSlope						= 1.f;
+	Heightfield gHeightfield;
+
+	// Streamed open world (see WorldStreamer), off for the fixed map. The map is cut
+	// into chunks gChunkSize wide, generated on gStreamThreads workers once within
+	// gStreamRadius of the player and released a chunk further, at most gStreamMemoryMB
+	// of them resident. Trees of the chunks come gTreeDensity per square unit, the
+	// structures stand in the middle square of gStructureAreaSize
+	bool gStreamWorld						= false;
+	float gChunkSize						= 16.f;
+	float gStreamRadius						= 32.f;
+	float gStreamMemoryMB					= 64.f;
+	int gStreamThreads						= 2;
+	float gTreeDensity						= 0.125f;
+	float gStructureAreaSize				= 40.f;
+
+	// Smallest distance between two trees
+	float gTreeSpacing						= 1.f;
+	// Trees of each of the 4 kinds, and batteries to collect
+	int gTreesPerKind						= 50;
+	int gBatteryCount						= 10;
+
+	// World seed, 0 draws a new one at start. Every random number of the
+	// world and of the game comes from gRandom
+	uint32_t gSeed							= 0;
+	Random gRandom;
+
+	// Player body for collisions, a capsule of this radius from gStepHeight to the eye
+	float gPlayerRadius						= 0.1f;
+	float gStepHeight						= 0.05f;
+
+	// Pickups and goal, cell size of the trigger grid and how close the player must get
+	float gTriggerCellSize					= 2.f;
+	float gBatteryPickupMargin				= 0.1f;
+	float gChaliceReachMargin				= 0.2f;
+
+	// Tree trunks in scene queries, a box this wide and high under each billboard,
+	// and occluder quads of the software occlusion, scaled with the size of the tree
+	float gTrunkHalfWidth					= 0.1f;
+	float gTrunkHeight						= 1.2f;
+
+	// The game is simulated in fixed steps of 1 / gSimulationRate seconds, whatever
+	// the frame rate, and the player walks gWalkSpeed units per second
+	float gSimulationRate					= 60.f;
+	float gWalkSpeed						= 1.2f;
+
+	// Frame pacing (see FramePacer). Swap interval 1 is vsync, 0 uncapped and -1
+	// adaptive vsync (F10). Frames start at most gMaxFrameRate times a second (0 for
+	// no cap), and gFrameDelayMs later still so that input is sampled closer to the
+	// next vertical blank. gLogLatency prints the input to present latency of every
+	// frame (F11)
+	int gSwapInterval						= 1;
+	float gMaxFrameRate						= 0.f;
+	float gFrameDelayMs						= 0.f;
+	bool gLogLatency						= false;
+
 	// Main loop flag
 	bool gQuit = false; // If this is quit = 'true' then the program terminates.
 
@@ -41,6 +114,37 @@ struct Global{
 	// Light object
 	Light gLight;
 
+	// Compiled shader variants, shared by all objects
+	ShaderCache gShaderCache;
+
+	// Shadow of the OpenGL state, drops redundant state changes
+	GLState gGLState;
+
+	// Lay down depth before shading, so each pixel is shaded once (F5)
+	bool gDepthPrePass = false;
+
+	// Draw the static scene with one glMultiDrawArraysIndirect, on by default with OpenGL 4.3 (F6)
+	bool gMultiDrawIndirect = false;
+
+	// Structures further than this from the eye are drawn as impostors (F8)
+	bool gUseImpostors = true;
+	float gImpostorDistance = 6.f;
+
+	// Grass blades, culled on the GPU (F9). Every blade is kept up to gGrassDensityNear,
+	// then fewer of them down to gGrassMinDensity at the range of the head light
+	bool gDrawGrassBlades = true;
+	float gGrassBladesPerUnit = 640.f;
+	float gGrassDensityNear = 3.f;
+	float gGrassMinDensity = 0.05f;
+	float gGrassBladeWidth = 0.02f;
+
+	// Expand tree quads in a geometry shader instead of the vertex shader (F7)
+	bool gTreesInGeometryShader = false;
+
+	// Renderer counters of the current frame, printed when gShowStats is on
+	FrameStats gStats;
+	bool gShowStats = false;
+
     std::vector<Light> glights;
 
 	// Tree texture
@@ -1,6 +1,7 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <fstream>
@@ -19,7 +20,9 @@ bool GLCheckErrorStatus(const char* function, int line);
 // ^^^^^^^^^^^^^^^^^^^ Error Handling Routines ^^^^^^^^^^^^^^^
 
 /**
-* LoadShaderAsString takes a filepath as an argument and will read line by line a file and return a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
+* LoadShaderAsString takes a filepath as an argument and returns a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
+* Shaders under ./shaders/ are embedded into the executable at build time (see tools/embed_shaders.py),
+* other files are read from disk.
 * e.g.
 *       LoadShaderAsString("./shaders/filepath");
 *
@@ -51,23 +54,37 @@ GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::str
 
 GLuint Create3ShaderProgram(const std::string& vertexShaderSource, const std::string& geometryShaderSource, const std::string& fragmentShaderSource);
 
+/**
+* Creates a program without fragment shader whose geometry shader outputs are captured
+* with transform feedback, varyings are interleaved into buffer binding 0 in the given order
+*
+* @param vertexShaderSource Vertex source code as a string
+* @param geometryShaderSource Geometry shader source code as a string
+* @param varyings Names of the captured outputs
+* @return id of the program Object
+*/
+GLuint CreateFeedbackProgram(const std::string& vertexShaderSource, const std::string& geometryShaderSource, const std::vector<const char*>& varyings);
+
 
 /**
- * Creates a array of possible (x,z) coordinates to place objects and return an array 
- * with 4 random coordinates that can be used to place 4 objects
+ * Coordinates of the 4 structures, Poisson-disk samples at least 5 units apart
+ * and from the boundary, away from the start of the player
+ * @param seed same seed, same coordinates
+ * @param minValue, maxValue square the structures stand in, usually the whole map
  * 
  * @return array of 4 random coordinates
 */
-std::vector<glm::vec2> RandomObjectsPlacement();
+std::vector<glm::vec2> RandomObjectsPlacement(uint32_t seed, float minValue, float maxValue);
 
 /**
- * Creates a array of possible (x,z) coordinates to place trees and return an array 
- * with random coordinates that can be used to place trees without interfering with structure objects
+ * Coordinates of trees, Poisson-disk samples at least gTreeSpacing apart
+ * and away from the structures and the start of the player
  * @param objectsCoords reserved coords for objects
+ * @param seed same seed, same coordinates
  * @param numOfTrees number of trees to be placed, default to be 40
  * 
- * @return array of random coordinates
+ * @return array of random coordinates, fewer than numOfTrees when they do not fit
 */
-std::vector<glm::vec2> RandomTreesPlacement(std::vector<glm::vec2>& objectsCoords, int numOfTrees=40);
+std::vector<glm::vec2> RandomTreesPlacement(const std::vector<glm::vec2>& objectsCoords, uint32_t seed, int numOfTrees=40);
 
 #endif
@@ -1,4 +1,8 @@
 #version 410 core
+// Permutations (injected by ShaderCache):
+//   NO_DISCARD  main pass after the depth pre-pass, the pre-pass already
+//               discarded the same fragments so depth testing is GL_EQUAL
+//   DEPTH_ONLY  depth pre-pass, only the texture test, no lighting
 
 in vec2 texCoord;
 in vec3 fragNormal;
@@ -6,12 +10,18 @@ in vec3 fragPos;
 out vec4 fragColor;
 
 uniform sampler2D textureSampler;
-uniform vec3 u_ViewDirection;
-uniform vec3 u_EyePosition;
-uniform vec3 u_HeadLightCol;
-uniform float u_HeadLightScope;
-uniform int u_HeadLightOn;
-uniform float u_HeadLightStrength;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
 
 float calculateAngle(vec3 A, vec3 B) {
     float dotProduct = dot(normalize(A), normalize(B));
@@ -67,18 +77,25 @@ vec4 HeadLight(){
     return headLight;
 }
 
+// Black texels are the background around the tree. Every permutation tests
+// the texel, not the lit color, so the pre-pass keeps exactly the fragments
+// the main pass draws
+bool IsBackground(){
+    vec3 texel = texture(textureSampler, texCoord).rgb;
+    return texel.r <= 0.02 && texel.g <= 0.02 && texel.b <= 0.02;
+}
+
 void main()
 {
-    
-    fragColor = vec4(0.1,0.1,0.1,1);
-    fragColor = vec4(fragPos,1);
-    fragColor = vec4(fragNormal,1);
-    
-    fragColor = HeadLight();
-    
+#ifndef NO_DISCARD
     // discard black color in tree
-    if (fragColor.r <= 0.02 && fragColor.g <= 0.02 && fragColor.b <= 0.02) {
+    if (IsBackground()) {
         discard;
     }
+#endif
+
+#ifndef DEPTH_ONLY
+    fragColor = HeadLight();
+#endif
 }
 
@@ -3,49 +3,64 @@
 layout (points) in;
 layout (triangle_strip, max_vertices = 4) out; 
 
-uniform mat4 u_ViewMatrix;
-uniform mat4 u_Projection;
-uniform vec3 u_EyePosition;
+in vec2 v_SizeMirror[];
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
 
 out vec2 texCoord;
 out vec3 fragNormal; // Output normal for the fragment shader
 out vec3 fragPos;
 
+// Same depth in the pre-pass and the GL_EQUAL main pass
+invariant gl_Position;
+
 void main()
 {   
     mat4 viewProjectionMatrix = u_Projection * u_ViewMatrix;
     
     vec3 pos = gl_in[0].gl_Position.xyz;
     vec3 toCamera = normalize(u_EyePosition - pos);
-    vec3 up = vec3(0.0, 4.0, 0.0);
+    vec3 up = vec3(0.0, 4.0 * v_SizeMirror[0].x, 0.0);
     vec3 right = cross(toCamera, up);
     vec3 normal = toCamera;
     float halfSize = 0.5; // Half size of the billboard quad
+    // Left and right edge of the texture
+    float left = v_SizeMirror[0].y < 0.0 ? 1.0 : 0.0;
 
     // Bottom left
     gl_Position = viewProjectionMatrix * vec4(pos - right * halfSize, 1.0);
-    texCoord = vec2(0.0, 0.0);
+    texCoord = vec2(left, 0.0);
     fragNormal = normal;
     fragPos = pos - right * halfSize;
     EmitVertex();
 
     // Top left
     gl_Position = viewProjectionMatrix * vec4(pos - right * halfSize + up, 1.0);
-    texCoord = vec2(0.0, 1.0);
+    texCoord = vec2(left, 1.0);
     fragNormal = normal;
     fragPos = pos - right * halfSize + up;
     EmitVertex();
 
     // Bottom right
     gl_Position = viewProjectionMatrix * vec4(pos + right * halfSize, 1.0);
-    texCoord = vec2(1.0, 0.0);
+    texCoord = vec2(1.0 - left, 0.0);
     fragNormal = normal;
     fragPos = pos + right * halfSize;
     EmitVertex();
 
     // Top right
     gl_Position = viewProjectionMatrix * vec4(pos + right * halfSize + up, 1.0);
-    texCoord = vec2(1.0, 1.0);
+    texCoord = vec2(1.0 - left, 1.0);
     fragNormal = normal;
     fragPos = pos + right * halfSize + up;
     EmitVertex();
@@ -0,0 +1,47 @@
+#version 410 core
+// Vertex shader path of the trees, without a geometry shader.
+// Drawn with glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, trees): every
+// instance is one tree and gl_VertexID picks the corner of its quad, in the
+// same order and with the same math as billboard_geom.glsl.
+
+layout (location = 0) in vec3 instancePos;          // Instance position offset
+layout (location = 1) in vec2 instanceSizeMirror;   // Height scale, texture mirrored when negative
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+out vec2 texCoord;
+out vec3 fragNormal;
+out vec3 fragPos;
+
+// Same depth in the pre-pass and the GL_EQUAL main pass
+invariant gl_Position;
+
+void main()
+{
+    mat4 viewProjectionMatrix = u_Projection * u_ViewMatrix;
+
+    vec3 toCamera = normalize(u_EyePosition - instancePos);
+    vec3 up = vec3(0.0, 4.0 * instanceSizeMirror.x, 0.0);
+    vec3 right = cross(toCamera, up);
+    float halfSize = 0.5; // Half size of the billboard quad
+
+    // Corners 0 to 3: bottom left, top left, bottom right, top right
+    float side = (gl_VertexID & 2) != 0 ? 1.0 : -1.0;
+    float top = float(gl_VertexID & 1);
+    float left = instanceSizeMirror.y < 0.0 ? 1.0 : 0.0;
+
+    fragPos = instancePos + right * (side * halfSize) + up * top;
+    texCoord = vec2(side > 0.0 ? 1.0 - left : left, top);
+    fragNormal = toCamera;
+    gl_Position = viewProjectionMatrix * vec4(fragPos, 1.0);
+}
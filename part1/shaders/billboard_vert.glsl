@@ -1,9 +1,13 @@
 #version 410 core
+// Geometry shader path of the trees, the point is expanded by billboard_geom.glsl
 
-layout (location = 0) in vec3 instancePos;  // Instance position offset
+layout (location = 0) in vec3 instancePos;          // Instance position offset
+layout (location = 1) in vec2 instanceSizeMirror;   // Height scale, texture mirrored when negative
+
+out vec2 v_SizeMirror;
 
 void main()
 {
+    v_SizeMirror = instanceSizeMirror;
     gl_Position = vec4( instancePos, 1.0);
 }
-
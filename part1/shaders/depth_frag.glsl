@@ -0,0 +1,7 @@
+#version 410 core
+// Depth pre-pass of opaque meshes, paired with vert.glsl and the grass blades.
+// Only depth is written, color writes are off during the pre-pass.
+
+void main()
+{
+}
@@ -1,43 +1,50 @@
 #version 410 core
+// Permutations (injected by ShaderCache):
+//   HAS_NORMAL_MAP    sample u_Material.normalTexture, inputs are in tangent space
+//   HAS_SPECULAR_MAP  add specular lighting from u_Material.specularTexture
 
 in vec3 v_vertexNormals;
 in vec3 v_worldSpaceFragment;
 in vec2 v_textureCoords;
 
-in vec3 TangentLightPos;
 in vec3 TangentViewPos;
 in vec3 TangentFragPos;
 in vec3 TangentHeadLightPos;
+in vec3 v_Tint;
 
 out vec4 color;
 
-struct Light{
-    vec3 lightColor;
-    vec3 lightPos;
-    float ambientIntensity;
-    float specularStrength;
-};
-
 struct Material{
 	sampler2D diffuseTexture;
+#ifdef HAS_NORMAL_MAP
 	sampler2D normalTexture;
+#endif
+#ifdef HAS_SPECULAR_MAP
 	sampler2D specularTexture;
+#endif
+};
 
-	float shininess; 	// Material Shininess
+// Material constants, uploaded once per object (see ShaderInterface::MaterialBlock)
+layout(std140) uniform MaterialBlock {
 	vec3 ka; 			// Ambient color
+	float shininess; 	// Material Shininess
 	vec3 kd; 			// Diffuse color
 	vec3 ks; 			// Specular color
+} u_MaterialConstants;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
 };
 
-uniform Light u_Light[1];
 uniform Material u_Material;
-uniform vec3 u_ViewDirection;
-//uniform vec3 u_EyePosition;
-uniform vec3 u_HeadLightCol;
-uniform float u_HeadLightScope;
-uniform bool u_HasSpecularTexture;
-uniform int u_HeadLightOn;
-uniform float u_HeadLightStrength;
 
 float calculateAngle(vec3 A, vec3 B) {
     float dotProduct = dot(normalize(A), normalize(B));
@@ -48,7 +55,6 @@ vec4 HeadLight(){
     //vec3 u_HeadLightCol = vec3(0.96f, 0.85f, 0.65f);
     vec4 headLight = vec4(0.0f, 0.0f, 0.0f, 1.0f);
     if(u_HeadLightOn != 0){
-        vec3 normals = normalize(v_vertexNormals);
         vec3 headLightDirection;
         vec3 ambient;
         vec3 diffuse = vec3(0.0f, 0.0f, 0.0f);
@@ -63,14 +69,18 @@ vec4 HeadLight(){
 
         // Store the texture coordinates
         // Compute the final lighting, Combine ambient, diffuse, and specular
-        // Assume all the objects have normal and diffuse maps
-        vec3 colorDiffuse = texture(u_Material.diffuseTexture, v_textureCoords).rgb;
+        // Assume all the objects have diffuse maps
+        vec3 colorDiffuse = texture(u_Material.diffuseTexture, v_textureCoords).rgb * v_Tint;
+#ifdef HAS_NORMAL_MAP
         vec3 normal = texture(u_Material.normalTexture, v_textureCoords).rgb;
         vec3 normalFromMap = normalize(normal * 2.0 - 1.0);
+#else
+        vec3 normalFromMap = normalize(v_vertexNormals);
+#endif
         headLightDirection = normalize(TangentHeadLightPos - TangentFragPos);
 
         // Ambient lighting
-        ambient = headLightAmbientIntensity * u_HeadLightCol * u_Material.ka * colorDiffuse;
+        ambient = headLightAmbientIntensity * u_HeadLightCol * u_MaterialConstants.ka * colorDiffuse;
         float angle = calculateAngle(-headLightDirection, TangentViewPos);
         // Diffuse lighting
         if(angle < u_HeadLightScope){
@@ -83,23 +93,22 @@ vec4 HeadLight(){
             float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));    
             
             float diff =  max(0.0, dot(headLightDirection, normalFromMap));
-            diffuse = attenuation * headLightStren * u_HeadLightCol * (diff * u_Material.kd) * colorDiffuse;
+            diffuse = attenuation * headLightStren * u_HeadLightCol * (diff * u_MaterialConstants.kd) * colorDiffuse;
         
             // Send fragment to output with only ambient and diffuse
             headLight = vec4(ambient + diffuse, 1.0f);
 
 
-            if (u_HasSpecularTexture) {
-                //Specular lighting
-                vec3 colorSpecular = texture(u_Material.specularTexture, v_textureCoords).rgb;
-                vec3 reflectionDirection = reflect(headLightDirection, normalFromMap);
-                float spec = pow(max(0.0, dot(TangentViewPos, reflectionDirection)), u_Material.shininess);
-                specular = attenuation * headLightStren *  specularStrength * u_HeadLightCol * (spec * u_Material.ks) * colorSpecular;
-                //specular = u_Light[0].specularStrength * u_Light[0].lightColor * (spec) * colorSpecular;
+#ifdef HAS_SPECULAR_MAP
+            //Specular lighting
+            vec3 colorSpecular = texture(u_Material.specularTexture, v_textureCoords).rgb;
+            vec3 reflectionDirection = reflect(headLightDirection, normalFromMap);
+            float spec = pow(max(0.0, dot(TangentViewPos, reflectionDirection)), u_MaterialConstants.shininess);
+            specular = attenuation * headLightStren *  specularStrength * u_HeadLightCol * (spec * u_MaterialConstants.ks) * colorSpecular;
 
-                // Send fragment to output with specular
-                headLight += vec4(specular, 1.0f);
-            }
+            // Send fragment to output with specular
+            headLight += vec4(specular, 1.0f);
+#endif
 
         }    
     }
@@ -0,0 +1,47 @@
+#version 410 core
+// Grass blades, lit by the head light like the rest of the scene
+
+in vec3 fragPos;
+in vec3 fragNormal;
+in float bladeHeight;
+in float bladeShade;
+out vec4 fragColor;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+const vec3 kBaseColor = vec3(0.05, 0.18, 0.04);
+const vec3 kTipColor = vec3(0.35, 0.52, 0.16);
+
+void main()
+{
+    fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+    if (u_HeadLightOn == 0) {
+        return;
+    }
+    float constant = 1.0f;     // Constant attenuation
+    float linear = 0.01f;      // Linear attenuation
+    float quadratic = 0.032f;  // Quadratic attenuation
+
+    vec3 headLightDirection = normalize(u_EyePosition - fragPos);
+    float angle = acos(clamp(dot(-headLightDirection, u_ViewDirection), -1.0, 1.0));
+    if (angle < u_HeadLightScope) {
+        float headLightStren = -1/(u_HeadLightScope * u_HeadLightScope) * (angle*angle) + 1;
+        headLightStren *= u_HeadLightStrength;
+        float distance = length(u_EyePosition - fragPos);
+        float attenuation = 1.0f / (constant + linear * distance + quadratic * (distance * distance));
+        // Blades are thin, light passing through keeps the back side from going black
+        float diff = 0.3 + 0.7 * max(0.0, dot(headLightDirection, normalize(fragNormal)));
+        vec3 color = mix(kBaseColor, kTipColor, bladeHeight) * bladeShade;
+        fragColor = vec4(attenuation * headLightStren * u_HeadLightCol * diff * color, 1.0);
+    }
+}
@@ -0,0 +1,75 @@
+#version 410 core
+// Expands a blade into a tapered strip of kSegments quads and a tip,
+// bent along its facing direction.
+
+layout (points) in;
+layout (triangle_strip, max_vertices = 7) out;
+
+in vec4 v_PositionHeight[];
+in vec4 v_Shape[];
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+out vec3 fragPos;
+out vec3 fragNormal;
+out float bladeHeight;      // 0 at the base, 1 at the tip
+out float bladeShade;
+
+// Same depth in the pre-pass and the GL_EQUAL main pass
+invariant gl_Position;
+
+const int kSegments = 3;
+
+void EmitBladeVertex(mat4 viewProjection, vec3 position, vec3 normal, float t){
+    gl_Position = viewProjection * vec4(position, 1.0);
+    fragPos = position;
+    fragNormal = normal;
+    bladeHeight = t;
+    bladeShade = v_Shape[0].w;
+    EmitVertex();
+}
+
+void main()
+{
+    // Degenerate blades are the ones fading out with the density
+    float height = v_PositionHeight[0].w;
+    if (height <= 0.0) {
+        return;
+    }
+    mat4 viewProjection = u_Projection * u_ViewMatrix;
+    vec3 base = v_PositionHeight[0].xyz;
+    float angle = v_Shape[0].x;
+    float bend = v_Shape[0].y;
+    float width = v_Shape[0].z;
+
+    vec3 facing = vec3(cos(angle), 0.0, sin(angle));
+    vec3 side = vec3(-facing.z, 0.0, facing.x);
+    // Both sides of the blade are lit as the side facing the eye
+    float towardEye = dot(facing, u_EyePosition - base) < 0.0 ? -1.0 : 1.0;
+
+    for (int i = 0; i <= kSegments; ++i) {
+        float t = float(i) / float(kSegments);
+        // Quadratic bend, the tip leans bend * height along facing
+        vec3 position = base + vec3(0.0, height * t, 0.0) + facing * (bend * height * t * t);
+        vec3 tangent = vec3(0.0, height, 0.0) + facing * (2.0 * bend * height * t);
+        vec3 normal = normalize(cross(side, tangent)) * towardEye;
+        if (i == kSegments) {
+            EmitBladeVertex(viewProjection, position, normal, t);
+        } else {
+            float halfWidth = 0.5 * width * (1.0 - t);
+            EmitBladeVertex(viewProjection, position - side * halfWidth, normal, t);
+            EmitBladeVertex(viewProjection, position + side * halfWidth, normal, t);
+        }
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,15 @@
+#version 410 core
+// Visible grass blades captured by grass_cull_geom.glsl, each point is
+// expanded to a bent blade by grass_blade_geom.glsl
+
+layout (location = 0) in vec4 a_PositionHeight;     // base of the blade, height in w
+layout (location = 1) in vec4 a_Shape;              // facing angle, bend, width, shade
+
+out vec4 v_PositionHeight;
+out vec4 v_Shape;
+
+void main()
+{
+    v_PositionHeight = a_PositionHeight;
+    v_Shape = a_Shape;
+}
@@ -0,0 +1,92 @@
+#version 410 core
+// Emits the blades that survive the distance, density, head light and
+// frustum tests. The outputs are captured with transform feedback into
+// the compacted buffer drawn by grass_blade_vert.glsl.
+
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 v_PositionHeight[];
+in vec4 v_Shape[];
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+uniform float u_MaxDistance;        // range of the head light
+uniform float u_DensityNear;        // every blade is kept up to this distance
+uniform float u_MinDensity;         // fraction of the blades kept at u_MaxDistance
+uniform float u_BladeWidth;         // width at full density
+
+// Captured, same layout as the input but with the width in place of the rank
+out vec4 out_PositionHeight;
+out vec4 out_Shape;                 // facing angle, bend, width, shade
+
+// Blades whose rank is within this much of the density grow in instead of popping
+const float kFadeRange = 0.05;
+
+float Density(float distance){
+    float t = clamp((distance - u_DensityNear) / max(u_MaxDistance - u_DensityNear, 0.001), 0.0, 1.0);
+    return mix(1.0, u_MinDensity, t);
+}
+
+// A blade is outside when its base and tip are both beyond the same plane,
+// margin widens the side planes by the blade's horizontal extent
+bool OutsideFrustum(vec4 base, vec4 tip, float margin){
+    return (base.x < -base.w - margin && tip.x < -tip.w - margin)
+        || (base.x >  base.w + margin && tip.x >  tip.w + margin)
+        || (base.y < -base.w - margin && tip.y < -tip.w - margin)
+        || (base.y >  base.w + margin && tip.y >  tip.w + margin)
+        || (base.z < -base.w && tip.z < -tip.w)
+        || (base.z >  base.w && tip.z >  tip.w);
+}
+
+void main()
+{
+    vec3 base = v_PositionHeight[0].xyz;
+    float height = v_PositionHeight[0].w;
+    float bend = v_Shape[0].y;
+    float rank = v_Shape[0].z;
+
+    // Bounding sphere of the blade
+    float radius = 0.5 * height;
+    vec3 toBlade = base + vec3(0.0, radius, 0.0) - u_EyePosition;
+    float distance = length(toBlade);
+    if (distance - radius > u_MaxDistance) {
+        return;
+    }
+
+    float density = Density(distance);
+    if (rank >= density) {
+        return;
+    }
+
+    if (distance > radius) {
+        float angle = acos(clamp(dot(toBlade / distance, u_ViewDirection), -1.0, 1.0));
+        if (angle > u_HeadLightScope + asin(radius / distance)) {
+            return;
+        }
+    }
+
+    mat4 viewProjection = u_Projection * u_ViewMatrix;
+    vec4 baseClip = viewProjection * vec4(base, 1.0);
+    vec4 tipClip = viewProjection * vec4(base + vec3(0.0, height, 0.0), 1.0);
+    float margin = (u_BladeWidth + abs(bend) * height) * max(u_Projection[0][0], u_Projection[1][1]);
+    if (OutsideFrustum(baseClip, tipClip, margin)) {
+        return;
+    }
+
+    // Fewer blades far away, the ones kept are wider to cover the same ground
+    out_PositionHeight = vec4(base, height * smoothstep(0.0, kFadeRange, density - rank));
+    out_Shape = vec4(v_Shape[0].x, bend, u_BladeWidth / sqrt(density), v_Shape[0].w);
+    EmitVertex();
+    EndPrimitive();
+}
@@ -0,0 +1,15 @@
+#version 410 core
+// GPU culling of the grass blades, paired with grass_cull_geom.glsl.
+// Drawn as one point per blade with GL_RASTERIZER_DISCARD on.
+
+layout (location = 0) in vec4 a_PositionHeight;     // base of the blade, height in w
+layout (location = 1) in vec4 a_Shape;              // facing angle, bend, density rank, shade
+
+out vec4 v_PositionHeight;
+out vec4 v_Shape;
+
+void main()
+{
+    v_PositionHeight = a_PositionHeight;
+    v_Shape = a_Shape;
+}
@@ -0,0 +1,37 @@
+#version 410 core
+// Permutations (injected by ShaderCache):
+//   HAS_NORMAL_MAP  the baked normal comes from the normal map
+//
+// Writes the unlit albedo, and the object space normal with the depth
+// inside the bounding sphere, lighting is done when the impostor is drawn.
+
+in vec2 v_textureCoords;
+in vec3 v_normal;
+in vec3 v_tangent;
+in vec3 v_bitangent;
+in float v_viewDepth;
+
+layout(location=0) out vec4 albedo;         // diffuse color, alpha is coverage
+layout(location=1) out vec4 normalDepth;    // normal * 0.5 + 0.5, depth from the front (0) to the back (1) of the sphere
+
+uniform sampler2D u_DiffuseTexture;
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D u_NormalTexture;
+#endif
+uniform vec3 u_Kd;          // diffuse color of the material
+uniform float u_Radius;     // bounding sphere radius, the camera is 2 radii from its center
+
+void main()
+{
+    albedo = vec4(texture(u_DiffuseTexture, v_textureCoords).rgb * u_Kd, 1.0f);
+
+#ifdef HAS_NORMAL_MAP
+    mat3 TBN = mat3(normalize(v_tangent), normalize(v_bitangent), normalize(v_normal));
+    vec3 normal = normalize(TBN * (texture(u_NormalTexture, v_textureCoords).rgb * 2.0 - 1.0));
+#else
+    vec3 normal = normalize(v_normal);
+#endif
+
+    float depth = clamp((v_viewDepth - u_Radius) / (2.0 * u_Radius), 0.0, 1.0);
+    normalDepth = vec4(normal * 0.5 + 0.5, depth);
+}
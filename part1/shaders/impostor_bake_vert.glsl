@@ -0,0 +1,31 @@
+#version 410 core
+// Bakes a structure into one frame of its impostor atlas (see Impostors).
+// Same vertex layout as vert.glsl, drawn with an orthographic camera in
+// object space, no model matrix.
+
+layout(location=0) in vec3 position;
+layout(location=1) in vec3 vertexNormals;
+layout(location=2) in vec2 textureCoords;
+layout(location=3) in vec3 tangents;
+layout(location=4) in vec3 bitangents;
+
+uniform mat4 u_BakeView;
+uniform mat4 u_BakeProjection;
+
+out vec2 v_textureCoords;
+out vec3 v_normal;
+out vec3 v_tangent;
+out vec3 v_bitangent;
+out float v_viewDepth;      // distance from the bake camera
+
+void main()
+{
+  v_textureCoords = textureCoords;
+  v_normal = vertexNormals;
+  v_tangent = tangents;
+  v_bitangent = bitangents;
+
+  vec4 viewPosition = u_BakeView * vec4(position, 1.0f);
+  v_viewDepth = -viewPosition.z;
+  gl_Position = u_BakeProjection * viewPosition;
+}
@@ -0,0 +1,86 @@
+#version 410 core
+// Blends the 4 frames picked by impostor_vert.glsl and lights the result
+// with the head light, like frag.glsl without the specular term.
+// The baked depth moves each fragment to the surface it stands for,
+// so impostors intersect the ground and trees like the mesh would.
+
+in vec3 v_worldPosition;
+flat in vec3 v_toEye;
+in vec2 v_frameLocal[4];
+flat in vec2 v_frameCells[4];
+flat in vec4 v_frameWeights;
+
+out vec4 color;
+
+uniform mat4 u_ModelMatrix;
+uniform sampler2D u_AlbedoAtlas;
+uniform sampler2D u_NormalDepthAtlas;
+
+// Frames per side of the atlas, must match Impostors::kFrames
+const int kFrames = 8;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+float calculateAngle(vec3 A, vec3 B) {
+    float dotProduct = dot(normalize(A), normalize(B));
+    return acos(clamp(dotProduct, -1.0, 1.0)); // Clamping for numerical stability
+}
+
+void main()
+{
+    // Weighted by coverage, so the frames only blend where they both have the object
+    vec3 albedo = vec3(0.0);
+    vec4 normalDepth = vec4(0.0);
+    float coverage = 0.0;
+    for (int k = 0; k < 4; ++k) {
+        vec2 local = v_frameLocal[k];
+        if (any(lessThan(local, vec2(0.0))) || any(greaterThan(local, vec2(1.0)))) {
+            continue;
+        }
+        vec2 uv = (v_frameCells[k] + local) / float(kFrames);
+        vec4 frameAlbedo = texture(u_AlbedoAtlas, uv);
+        float weight = v_frameWeights[k] * frameAlbedo.a;
+        albedo += frameAlbedo.rgb * weight;
+        normalDepth += texture(u_NormalDepthAtlas, uv) * weight;
+        coverage += weight;
+    }
+    if (coverage < 0.5) {
+        discard;
+    }
+    albedo /= coverage;
+    normalDepth /= coverage;
+
+    float radius = length(u_ModelMatrix[0].xyz);
+    vec3 normal = normalize(mat3(u_ModelMatrix) * (normalDepth.rgb * 2.0 - 1.0));
+    vec3 surface = v_worldPosition + v_toEye * (radius * (1.0 - 2.0 * normalDepth.a));
+    vec4 clip = u_Projection * u_ViewMatrix * vec4(surface, 1.0);
+    gl_FragDepth = (clip.z / clip.w) * 0.5 + 0.5;
+
+    color = vec4(0.0, 0.0, 0.0, 1.0);
+    if (u_HeadLightOn != 0) {
+        float constant = 1.0;    // Constant attenuation
+        float linear = 0.01;     // Linear attenuation
+        float quadratic = 0.032; // Quadratic attenuation
+
+        vec3 headLightDirection = normalize(u_EyePosition - surface);
+        float angle = calculateAngle(-headLightDirection, u_ViewDirection);
+        if (angle < u_HeadLightScope) {
+            float headLightStren = -1/(u_HeadLightScope * u_HeadLightScope) * (angle*angle) + 1;
+            headLightStren *= u_HeadLightStrength;
+            float distance = length(u_EyePosition - surface);
+            float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+            float diff = max(0.0, dot(headLightDirection, normal));
+            color = vec4(attenuation * headLightStren * u_HeadLightCol * diff * albedo, 1.0);
+        }
+    }
+}
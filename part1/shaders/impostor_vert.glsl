@@ -0,0 +1,89 @@
+#version 410 core
+// Octahedral impostor of a far structure (see Impostors).
+// One camera facing quad, drawn as a 4 vertex strip picked by gl_VertexID.
+// The view direction in object space selects the 4 nearest baked frames
+// of the hemi-octahedral grid, blended with bilinear weights.
+
+// Translation to the center of the bounding sphere, rotation of the
+// object, and uniform scale by the sphere's radius
+uniform mat4 u_ModelMatrix;
+
+// Frames per side of the atlas, must match Impostors::kFrames
+const int kFrames = 8;
+// The quad is a bit larger than the sphere, frames seen at an angle still fit
+const float kQuadScale = 1.15;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+out vec3 v_worldPosition;
+flat out vec3 v_toEye;
+out vec2 v_frameLocal[4];       // position inside each frame, 0 to 1 inside it
+flat out vec2 v_frameCells[4];  // frame column and row in the atlas
+flat out vec4 v_frameWeights;
+
+invariant gl_Position;
+
+// Direction of the upper hemisphere to the [0,1] square and back
+vec2 EncodeHemiOctahedron(vec3 direction) {
+    direction.y = max(direction.y, 0.0);
+    direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+    return vec2(direction.x + direction.z, direction.x - direction.z) * 0.5 + 0.5;
+}
+
+vec3 DecodeHemiOctahedron(vec2 uv) {
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 direction = vec3((p.x + p.y) * 0.5, 0.0, (p.x - p.y) * 0.5);
+    direction.y = 1.0 - abs(direction.x) - abs(direction.z);
+    return normalize(direction);
+}
+
+// Image axes of a camera looking back along direction, same as glm::lookAt
+void FrameBasis(vec3 direction, out vec3 right, out vec3 up) {
+    vec3 worldUp = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 forward = -direction;
+    right = normalize(cross(forward, worldUp));
+    up = cross(right, forward);
+}
+
+void main()
+{
+    vec3 center = u_ModelMatrix[3].xyz;
+    float radius = length(u_ModelMatrix[0].xyz);
+    mat3 toObject = transpose(mat3(u_ModelMatrix) / radius);
+
+    v_toEye = normalize(u_EyePosition - center);
+    vec3 right, up;
+    FrameBasis(v_toEye, right, up);
+
+    // Corners 0 to 3: bottom left, top left, bottom right, top right, in radii
+    float side = (gl_VertexID & 2) != 0 ? 1.0 : -1.0;
+    float top = (gl_VertexID & 1) != 0 ? 1.0 : -1.0;
+    vec3 corner = (right * side + up * top) * kQuadScale;
+    v_worldPosition = center + corner * radius;
+
+    // Bilinear weights of the 4 frames around the view direction
+    vec3 localCorner = toObject * corner;
+    vec2 grid = EncodeHemiOctahedron(toObject * v_toEye) * float(kFrames - 1);
+    vec2 cell = min(floor(grid), vec2(float(kFrames - 2)));
+    vec2 f = grid - cell;
+    v_frameWeights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    for (int k = 0; k < 4; ++k) {
+        vec2 frame = cell + vec2(float(k & 1), float(k >> 1));
+        vec3 frameRight, frameUp;
+        FrameBasis(DecodeHemiOctahedron(frame / float(kFrames - 1)), frameRight, frameUp);
+        v_frameCells[k] = frame;
+        v_frameLocal[k] = vec2(dot(localCorner, frameRight), dot(localCorner, frameUp)) * 0.5 + 0.5;
+    }
+
+    gl_Position = u_Projection * u_ViewMatrix * vec4(v_worldPosition, 1.0);
+}
@@ -0,0 +1,6 @@
+#version 410 core
+// Occlusion boxes only count samples, color and depth writes are off
+
+void main()
+{
+}
@@ -0,0 +1,26 @@
+#version 410 core
+// Bounding box of an occlusion query, a unit cube moved and
+// stretched to a world space axis aligned box
+
+layout(location=0) in vec3 position;   // corner of the cube, -1 to 1
+
+uniform vec3 u_BoxCenter;
+uniform vec3 u_BoxExtents;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+void main()
+{
+    vec3 worldPosition = u_BoxCenter + position * u_BoxExtents;
+    gl_Position = u_Projection * u_ViewMatrix * vec4(worldPosition, 1.0f);
+}
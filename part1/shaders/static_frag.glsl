@@ -0,0 +1,110 @@
+#version 410 core
+// Shading of the static scene drawn by StaticBatch, paired with static_vert.glsl.
+// Same head light as frag.glsl, but every material is read from the
+// material table and every texture from one texture array, so the whole
+// scene shares this program and its bindings. Lighting is done in world
+// space because meshes with and without normal maps share the program.
+
+in vec3 v_worldSpaceFragment;
+in vec2 v_textureCoords;
+in vec3 v_Tint;
+in mat3 v_TBN;
+flat in int v_Material;
+
+out vec4 color;
+
+// Diffuse, normal and specular maps of every material, one layer each
+uniform sampler2DArray u_MaterialTextures;
+
+// Materials of the static scene (see StaticBatch::kMaxMaterials)
+layout(std140) uniform MaterialTableBlock {
+	vec4 u_MaterialLayers[16];		// diffuse, normal, specular layer (-1 = none), shininess
+	vec4 u_MaterialKa[16];			// Ambient color
+	vec4 u_MaterialKd[16];			// Diffuse color
+	vec4 u_MaterialKs[16];			// Specular color
+};
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+float calculateAngle(vec3 A, vec3 B) {
+    float dotProduct = dot(normalize(A), normalize(B));
+    return acos(clamp(dotProduct, -1.0, 1.0)); // Clamping for numerical stability
+}
+
+vec4 HeadLight(){
+    vec4 headLight = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    if(u_HeadLightOn != 0){
+        vec4 layers = u_MaterialLayers[v_Material];
+        vec3 ka = u_MaterialKa[v_Material].rgb;
+        vec3 kd = u_MaterialKd[v_Material].rgb;
+        vec3 ks = u_MaterialKs[v_Material].rgb;
+        float shininess = layers.w;
+
+        vec3 headLightDirection;
+        vec3 ambient;
+        vec3 diffuse = vec3(0.0f, 0.0f, 0.0f);
+        vec3 specular;
+        float headLightAmbientIntensity = 0.0f;
+        float specularStrength = 0.8f;
+
+        float constant = 1.0;    // Constant attenuation
+        float linear = 0.01;     // Linear attenuation
+        float quadratic = 0.032; // Quadratic attenuation
+
+        vec3 colorDiffuse = v_Tint;
+        if (layers.x >= 0.0) {
+            colorDiffuse *= texture(u_MaterialTextures, vec3(v_textureCoords, layers.x)).rgb;
+        }
+        vec3 normal;
+        if (layers.y >= 0.0) {
+            vec3 normalFromMap = texture(u_MaterialTextures, vec3(v_textureCoords, layers.y)).rgb * 2.0 - 1.0;
+            normal = normalize(v_TBN * normalFromMap);
+        } else {
+            normal = normalize(v_TBN[2]);
+        }
+        headLightDirection = normalize(u_EyePosition - v_worldSpaceFragment);
+
+        // Ambient lighting
+        ambient = headLightAmbientIntensity * u_HeadLightCol * ka * colorDiffuse;
+        float angle = calculateAngle(-headLightDirection, u_ViewDirection);
+        // Diffuse lighting
+        if(angle < u_HeadLightScope){
+            float headLightStren = -1/(u_HeadLightScope * u_HeadLightScope) * (angle*angle) + 1;
+            headLightStren *= u_HeadLightStrength;
+            // Calculate distance from light source to fragment
+            float distance = length(u_EyePosition - v_worldSpaceFragment);
+
+            // Calculate attenuation (decay) based on distance
+            float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+
+            float diff = max(0.0, dot(headLightDirection, normal));
+            diffuse = attenuation * headLightStren * u_HeadLightCol * (diff * kd) * colorDiffuse;
+            headLight = vec4(ambient + diffuse, 1.0f);
+
+            // Specular lighting
+            if (layers.z >= 0.0) {
+                vec3 colorSpecular = texture(u_MaterialTextures, vec3(v_textureCoords, layers.z)).rgb;
+                vec3 reflectionDirection = reflect(headLightDirection, normal);
+                float spec = pow(max(0.0, dot(u_ViewDirection, reflectionDirection)), shininess);
+                specular = attenuation * headLightStren * specularStrength * u_HeadLightCol * (spec * ks) * colorSpecular;
+                headLight += vec4(specular, 1.0f);
+            }
+        }
+    }
+    return headLight;
+}
+
+void main()
+{
+    color = HeadLight();
+}
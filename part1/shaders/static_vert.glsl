@@ -0,0 +1,54 @@
+#version 410 core
+// Static scene drawn with glMultiDrawArraysIndirect (see StaticBatch).
+// Every mesh lives in one vertex buffer, every placement is an instance:
+// the model matrix, tint and material come from the instance buffer,
+// selected per command by its baseInstance.
+
+layout(location=0) in vec3 position;
+layout(location=1) in vec3 vertexNormals;
+layout(location=2) in vec2 textureCoords;
+layout(location=3) in vec3 tangents;
+layout(location=4) in vec3 bitangents;
+// Per-instance attributes
+layout(location=5) in mat4 instanceModel;           // locations 5 to 8
+layout(location=9) in vec4 instanceTintMaterial;    // tint (r,g,b) and material index
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+out vec3 v_worldSpaceFragment;
+out vec2 v_textureCoords;
+out vec3 v_Tint;
+out mat3 v_TBN;             // world space tangent, bitangent and normal
+flat out int v_Material;
+
+// The depth pre-pass (depth_frag.glsl) and the GL_EQUAL main pass must
+// produce bit identical depth from this shader
+invariant gl_Position;
+
+void main()
+{
+  v_textureCoords = textureCoords;
+  v_Tint = instanceTintMaterial.rgb;
+  v_Material = int(instanceTintMaterial.a + 0.5);
+
+  vec4 worldPosition = instanceModel * vec4(position, 1.0f);
+  v_worldSpaceFragment = worldPosition.xyz;
+
+  // Placements only rotate and scale uniformly, no inverse transpose needed
+  mat3 normalMatrix = mat3(instanceModel);
+  v_TBN = mat3(normalize(normalMatrix * tangents),
+               normalize(normalMatrix * bitangents),
+               normalize(normalMatrix * vertexNormals));
+
+  gl_Position = u_Projection * u_ViewMatrix * worldPosition;
+}
@@ -0,0 +1,44 @@
+#version 410 core
+// Terrain, lit by the head light like the rest of the scene
+
+in vec3 fragPos;
+in vec3 fragNormal;
+in vec2 texCoord;
+out vec4 fragColor;
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+uniform sampler2D u_GroundTexture;
+
+void main()
+{
+    fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+    if (u_HeadLightOn == 0) {
+        return;
+    }
+    float constant = 1.0f;     // Constant attenuation
+    float linear = 0.01f;      // Linear attenuation
+    float quadratic = 0.032f;  // Quadratic attenuation
+
+    vec3 headLightDirection = normalize(u_EyePosition - fragPos);
+    float angle = acos(clamp(dot(-headLightDirection, u_ViewDirection), -1.0, 1.0));
+    if (angle < u_HeadLightScope) {
+        float headLightStren = -1/(u_HeadLightScope * u_HeadLightScope) * (angle*angle) + 1;
+        headLightStren *= u_HeadLightStrength;
+        float distance = length(u_EyePosition - fragPos);
+        float attenuation = 1.0f / (constant + linear * distance + quadratic * (distance * distance));
+        float diff = max(0.0, dot(headLightDirection, normalize(fragNormal)));
+        vec3 color = texture(u_GroundTexture, texCoord).rgb;
+        fragColor = vec4(attenuation * headLightStren * u_HeadLightCol * diff * color, 1.0);
+    }
+}
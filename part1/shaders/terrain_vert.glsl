@@ -0,0 +1,69 @@
+#version 410 core
+// Patches of the terrain (see Terrain.hpp), drawn instanced: every instance is
+// one quadtree node, or a quadrant of it, covered by the shared grid. Heights
+// come from u_Heightmap. Near the end of the range of its level, the odd
+// vertices of a patch slide onto their even neighbours until the patch is the
+// grid of the next level.
+
+layout(location=0) in vec2 gridPosition;            // corner of a grid quad, 0 to u_GridQuads
+layout(location=1) in vec4 patchCornerSizeLevel;    // node corner (x, z), node side, level
+
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
+
+uniform sampler2D u_Heightmap;
+uniform vec2 u_TerrainMin;          // corner of the heightmap
+uniform float u_TerrainSize;        // side of the heightmap
+uniform float u_HeightmapSamples;   // samples per side
+uniform float u_GridQuads;          // quads per side of a patch
+uniform vec2 u_MorphRanges[16];     // per level, distances where the morph starts and ends
+
+out vec3 fragPos;
+out vec3 fragNormal;
+out vec2 texCoord;
+
+// Same depth in the pre-pass and the GL_EQUAL main pass
+invariant gl_Position;
+
+// Bilinear height at xz, the samples are at the texel centers
+float Height(vec2 xz)
+{
+    vec2 uv = (xz - u_TerrainMin) / u_TerrainSize;
+    uv = uv * ((u_HeightmapSamples - 1.0) / u_HeightmapSamples) + 0.5 / u_HeightmapSamples;
+    return textureLod(u_Heightmap, uv, 0.0).r;
+}
+
+void main()
+{
+    vec2 corner = patchCornerSizeLevel.xy;
+    float quadSize = patchCornerSizeLevel.z / u_GridQuads;
+    vec2 morphRange = u_MorphRanges[int(patchCornerSizeLevel.w)];
+
+    // The morph follows the distance to the vertex before it moves, the same for
+    // every patch sharing the vertex
+    vec2 xz = corner + gridPosition * quadSize;
+    float distanceToEye = distance(vec3(xz.x, Height(xz), xz.y), u_EyePosition);
+    float morph = clamp((distanceToEye - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+    xz = corner + (gridPosition - mod(gridPosition, 2.0) * morph) * quadSize;
+
+    fragPos = vec3(xz.x, Height(xz), xz.y);
+    float spacing = u_TerrainSize / (u_HeightmapSamples - 1.0);
+    float left = Height(xz - vec2(spacing, 0.0));
+    float right = Height(xz + vec2(spacing, 0.0));
+    float back = Height(xz - vec2(0.0, spacing));
+    float front = Height(xz + vec2(0.0, spacing));
+    fragNormal = normalize(vec3(left - right, 2.0 * spacing, back - front));
+    // One repeat of the ground texture every 2 units
+    texCoord = xz * 0.5;
+
+    gl_Position = u_Projection * u_ViewMatrix * vec4(fragPos, 1.0);
+}
@@ -1,4 +1,8 @@
 #version 410 core
+// Permutations (injected by ShaderCache):
+//   HAS_NORMAL_MAP  lighting is done in tangent space with the normal map
+//   INSTANCED       per-instance offset/scale/rotation/tint (grass)
+
 // From Vertex Buffer Object (VBO)
 // The only thing that can come 'in', that is
 // what our shader reads, the first part of the
@@ -6,70 +10,91 @@
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 vertexNormals;
 layout(location=2) in vec2 textureCoords; // Texture coordinates
-layout(location=3) in vec3 tangents; 
+layout(location=3) in vec3 tangents;
 layout(location=4) in vec3 bitangents;
+#ifdef INSTANCED
+// Per-instance attributes
+layout(location=5) in vec4 instanceOffsetScale;    // offset (x,y,z) and uniform scale
+layout(location=6) in vec4 instanceRotationTint;   // rotation along y-axis and tint (r,g,b)
+#endif
 
 // Uniform variables
 uniform mat4 u_ModelMatrix;
-uniform mat4 u_ViewMatrix;
-uniform mat4 u_Projection; // We'll use a perspective projection
-
-//uniform int u_BumpMapEmpty;
-
-uniform vec3 u_ViewDirection; // camera view direction
-uniform vec3 u_EyePosition;
 
-// Uniform Light Variables
-uniform vec3 u_LightPos;
+// Per-frame uniforms, shared by every program (see ShaderInterface::FrameBlock)
+layout(std140) uniform FrameBlock {
+    mat4 u_ViewMatrix;
+    mat4 u_Projection;
+    vec3 u_ViewDirection;       // camera view direction
+    float u_HeadLightScope;
+    vec3 u_EyePosition;
+    float u_HeadLightStrength;
+    vec3 u_HeadLightCol;
+    int u_HeadLightOn;
+};
 
 // Pass vertex colors into the fragment shader
 out vec3 v_vertexNormals;
 out vec3 v_worldSpaceFragment;
 out vec2 v_textureCoords; // Pass texture coordinates to the fragment shader
-out vec3 TangentLightPos;
 out vec3 TangentViewPos;
 out vec3 TangentFragPos;
 out vec3 TangentHeadLightPos;
+out vec3 v_Tint;
+
+// The depth pre-pass (depth_frag.glsl) and the GL_EQUAL main pass must
+// produce bit identical depth from this shader
+invariant gl_Position;
 
-mat3 calculateTBN() {
-    vec3 T = normalize(vec3(u_ModelMatrix * vec4(tangents, 0.0)));
-    vec3 B = normalize(vec3(u_ModelMatrix * vec4(bitangents, 0.0)));
-    vec3 N = normalize(vec3(u_ModelMatrix * vec4(vertexNormals, 0.0)));
+mat3 calculateTBN(mat3 instanceRotation) {
+    vec3 T = normalize(vec3(u_ModelMatrix * vec4(instanceRotation * tangents, 0.0)));
+    vec3 B = normalize(vec3(u_ModelMatrix * vec4(instanceRotation * bitangents, 0.0)));
+    vec3 N = normalize(vec3(u_ModelMatrix * vec4(instanceRotation * vertexNormals, 0.0)));
     return mat3(T, B, N);
 }
 
-struct Light{
-    vec3 lightColor;
-    vec3 lightPos;
-    float ambientIntensity;
-    float specularStrength;
-};
-
-uniform Light u_Light[1];
-
 void main()
 {
-  // Update the normals based on modelMatrix as we are rotating the model
-  v_vertexNormals = vertexNormals;
+#ifdef INSTANCED
+  // Rotation along y-axis of this instance
+  float c = cos(instanceRotationTint.x);
+  float s = sin(instanceRotationTint.x);
+  mat3 instanceRotation = mat3(c, 0.0, -s,
+                               0.0, 1.0, 0.0,
+                               s, 0.0, c);
+  v_Tint = instanceRotationTint.yzw;
+  vec3 localPosition = instanceOffsetScale.xyz + instanceRotation * (position * instanceOffsetScale.w);
+#else
+  mat3 instanceRotation = mat3(1.0);
+  v_Tint = vec3(1.0f);
+  vec3 localPosition = position;
+#endif
 
   // Pass texture coordinates to the fragment shader
   v_textureCoords = textureCoords;
 
   // Calculate in world space the position of the vertex
-  v_worldSpaceFragment = vec3(u_ModelMatrix * vec4(position, 1.0f));
+  v_worldSpaceFragment = vec3(u_ModelMatrix * vec4(localPosition, 1.0f));
 
-  // calculate TBN
-  mat3 TBN = calculateTBN();
+#ifdef HAS_NORMAL_MAP
+  // Normals come from the normal map, move everything into tangent space
+  v_vertexNormals = vertexNormals;
+
+  mat3 TBN = calculateTBN(instanceRotation);
   mat3 transTBN = transpose(TBN);
-  
-  TangentLightPos = transTBN * (u_Light[0].lightPos);
+
   TangentViewPos = transTBN * u_ViewDirection;
   TangentFragPos = transTBN * v_worldSpaceFragment;
   TangentHeadLightPos = transTBN * u_EyePosition;
-  
-  // Compute the MVP matrix
-  gl_Position = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
-
-}
+#else
+  // No normal map, light in world space with the vertex normals
+  v_vertexNormals = mat3(u_ModelMatrix) * (instanceRotation * vertexNormals);
 
+  TangentViewPos = u_ViewDirection;
+  TangentFragPos = v_worldSpaceFragment;
+  TangentHeadLightPos = u_EyePosition;
+#endif
 
+  // Compute the MVP matrix
+  gl_Position = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(localPosition, 1.0f);
+}
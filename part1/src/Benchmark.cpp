@@ -0,0 +1,1155 @@
+#include "Benchmark.hpp"
+#include "BillboardList.hpp"
+#include "CollisionGrid.hpp"
+#include "MeshBVH.hpp"
+#include "OrientedBox.hpp"
+#include "OBJ.hpp"
+#include "PoissonDisk.hpp"
+#include "RenderQueue.hpp"
+#include "SceneQuery.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "Terrain.hpp"
+#include "TriggerSystem.hpp"
+#include "UniformBuffer.hpp"
+#include "WorldStreamer.hpp"
+#include "FrameStats.hpp"
+#include "globals.hpp"
+#include "generated/ShaderInterface.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Frames drawn before and while measuring each configuration
+static const int kWarmupFrames = 10;
+static const int kMeasuredFrames = 100;
+
+void BenchmarkBillboards(){
+    const int treeCounts[] = {200, 10000, 100000};
+
+    // Camera above the south edge of the map looking over all of it,
+    // with a head light wide enough to shade every tree
+    glm::vec3 eye(0.0f, 6.0f, -26.0f);
+    glm::vec3 target(0.0f, 0.0f, 0.0f);
+    ShaderInterface::FrameBlock frame = {};
+    frame.u_ViewMatrix = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.u_Projection = glm::perspective(glm::radians(45.0f), (float)g.gScreenWidth / (float)g.gScreenHeight, 0.1f, 60.0f);
+    frame.u_ViewDirection = glm::normalize(target - eye);
+    frame.u_EyePosition = eye;
+    frame.u_HeadLightScope = 0.4f * glm::pi<float>();
+    frame.u_HeadLightStrength = 1.0f;
+    frame.u_HeadLightCol = glm::vec3(0.96f, 0.85f, 0.65f);
+    frame.u_HeadLightOn = 1;
+    UniformBuffer<ShaderInterface::FrameBlock> frameUniforms;
+    frameUniforms.Initialize(g.gGLState);
+    frameUniforms.Update(frame);
+
+    GLuint query = 0;
+    glGenQueries(1, &query);
+
+    std::cout << "Billboard benchmark, " << kMeasuredFrames << " frames per configuration, "
+              << g.gScreenWidth << "x" << g.gScreenHeight << std::endl;
+    for (int treeCount : treeCounts) {
+        // Same forest for both paths
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<float> coordinate(g.gMinValue + 0.5f, g.gMaxValue - 0.5f);
+        std::vector<glm::vec2> coords;
+        for (int i = 0; i < treeCount; ++i) {
+            coords.push_back(glm::vec2(coordinate(gen), coordinate(gen)));
+        }
+        BillboardList trees(g.gTreeFileName);
+        trees.SetPos(coords);
+        trees.Initialize();
+        // Setup used raw OpenGL calls
+        g.gGLState.Invalidate();
+
+        for (bool geometryShader : {true, false}) {
+            g.gTreesInGeometryShader = geometryShader;
+            double gpuMs = 0.0;
+            double cpuMs = 0.0;
+            for (int i = 0; i < kWarmupFrames + kMeasuredFrames; ++i) {
+                g.gGLState.Enable(GL_DEPTH_TEST);
+                g.gGLState.Disable(GL_SCISSOR_TEST);
+                g.gGLState.Viewport(0, 0, g.gScreenWidth, g.gScreenHeight);
+                glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+                frameUniforms.Bind();
+
+                auto start = std::chrono::steady_clock::now();
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                RenderQueue queue;
+                FrameStats stats;
+                queue.Begin(eye, 60.0f);
+                trees.Submit(queue);
+                queue.Sort();
+                queue.Draw(g.gGLState, stats);
+                glEndQuery(GL_TIME_ELAPSED);
+                glFinish();
+                auto end = std::chrono::steady_clock::now();
+
+                // The GPU is done after glFinish, reading the result does not wait
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                if (i >= kWarmupFrames) {
+                    gpuMs += elapsed / 1.0e6;
+                    cpuMs += std::chrono::duration<double, std::milli>(end - start).count();
+                }
+            }
+            std::cout << "  trees: " << treeCount
+                      << " | " << (geometryShader ? "geometry shader" : "vertex shader  ")
+                      << " | GPU: " << gpuMs / kMeasuredFrames << " ms"
+                      << " | CPU + wait: " << cpuMs / kMeasuredFrames << " ms" << std::endl;
+        }
+    }
+
+    glDeleteQueries(1, &query);
+    g.gTreesInGeometryShader = false;
+}
+
+bool BenchmarkCollision(){
+    const int treeCounts[] = {200, 10000, 100000, 1000000};
+    const int kQueries = 1000000;
+    const float kMargin = 0.1f;
+    // The game map holds 200 trees, larger forests get a larger map of the same density
+    const int kMapTrees = 200;
+
+    std::cout << "Collision benchmark, " << kQueries << " point queries per configuration, "
+              << kMapTrees << " trees per " << g.gMaxValue - g.gMinValue << "x" << g.gMaxValue - g.gMinValue << " area" << std::endl;
+    bool passed = true;
+    for (int treeCount : treeCounts) {
+        float scale = std::sqrt((float)treeCount / kMapTrees);
+        float minValue = g.gMinValue * scale;
+        float maxValue = g.gMaxValue * scale;
+
+        // Same seed for every configuration, queries spread over the whole map
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<float> coordinate(minValue, maxValue);
+        std::vector<glm::vec2> queries;
+        for (int i = 0; i < kQueries; ++i) {
+            queries.push_back(glm::vec2(coordinate(gen), coordinate(gen)));
+        }
+        std::vector<glm::vec2> trees;
+        for (int i = 0; i < treeCount; ++i) {
+            trees.push_back(glm::vec2(coordinate(gen), coordinate(gen)));
+        }
+
+        CollisionGrid grid;
+        // Four structures of the size of the house at the spots RandomObjectsPlacement uses
+        const glm::vec2 spots[] = {{-15.0f, -10.0f}, {5.0f, 10.0f}, {10.0f, -5.0f}, {-5.0f, 15.0f}};
+        const float rotations[] = {30.0f, 90.0f, 45.0f, 0.0f};
+        std::vector<OrientedBox2D> structures;
+        for (int i = 0; i < 4; ++i) {
+            structures.push_back(OrientedBox2D::FromLocal(spots[i], rotations[i], glm::vec2(-1.5f), glm::vec2(1.5f)));
+            grid.AddBox(structures[i], kMargin);
+        }
+        for (const glm::vec2& tree : trees) {
+            grid.AddSquare(tree, kMargin);
+        }
+        auto buildStart = std::chrono::steady_clock::now();
+        grid.Build(minValue, maxValue);
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+        size_t hits = 0;
+        size_t candidates = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const glm::vec2& query : queries) {
+            hits += grid.Collides(query) ? 1 : 0;
+        }
+        double gridNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kQueries;
+        for (const glm::vec2& query : queries) {
+            candidates += grid.CandidatesAt(query);
+        }
+
+        // Scan of every footprint as HasCollision did before the grid, on fewer
+        // queries so the large forests finish
+        int scanQueries = std::max(100, (int)(100000000LL / treeCount));
+        scanQueries = std::min(scanQueries, kQueries);
+        std::vector<char> scanCollides(scanQueries, 0);
+        size_t scanHits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < scanQueries; ++i) {
+            const glm::vec2& query = queries[i];
+            bool collides = false;
+            for (const OrientedBox2D& structure : structures) {
+                if (structure.Contains(query, kMargin)) {
+                    collides = true;
+                    break;
+                }
+            }
+            for (size_t t = 0; t < trees.size() && !collides; ++t) {
+                collides = std::fabs(query.x - trees[t].x) <= kMargin && std::fabs(query.y - trees[t].y) <= kMargin;
+            }
+            scanCollides[i] = collides ? 1 : 0;
+            scanHits += collides ? 1 : 0;
+        }
+        double scanNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / scanQueries;
+
+        // Both must agree on every scanned query
+        size_t mismatches = 0;
+        for (int i = 0; i < scanQueries; ++i) {
+            if (grid.Collides(queries[i]) != (scanCollides[i] != 0)) {
+                mismatches++;
+            }
+        }
+        passed = passed && mismatches == 0;
+
+        std::cout << "  trees: " << treeCount
+                  << " | map: " << maxValue - minValue << "x" << maxValue - minValue
+                  << " | cells: " << grid.GetCellsPerSide() << "x" << grid.GetCellsPerSide()
+                  << " | build: " << buildMs << " ms"
+                  << " | candidates/query: " << (double)candidates / kQueries
+                  << " | grid: " << gridNs << " ns/query"
+                  << " | scan: " << scanNs << " ns/query"
+                  << " | hits: " << (double)hits / kQueries * 100.0 << "% (scan " << (double)scanHits / scanQueries * 100.0 << "%)"
+                  << " | differing from the scan: " << mismatches << "/" << scanQueries << std::endl;
+    }
+    return passed;
+}
+
+/**
+* Triangle positions of an OBJ file, 9 floats per triangle in the order of
+* OBJ::getVerticesArray(), and their bounds. Reads the v and f lines only,
+* so no texture is loaded and no OpenGL context is needed
+*
+* @return bool false when the file cannot be opened
+*/
+static bool LoadTrianglePositions(const std::string& fileName, std::vector<float>& positions,
+                                  glm::vec3& boundsMin, glm::vec3& boundsMax){
+    std::ifstream inFile(fileName);
+    if (!inFile.is_open()) {
+        std::cout << "Could not open file: " << fileName << std::endl;
+        return false;
+    }
+    std::vector<glm::vec3> vertices;
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    positions.clear();
+    std::string line;
+    while (std::getline(inFile, line)) {
+        std::istringstream iss(line);
+        std::string type;
+        iss >> type;
+        if (type == "v") {
+            glm::vec3 vertex;
+            iss >> vertex.x >> vertex.y >> vertex.z;
+            vertices.push_back(vertex);
+            boundsMin = glm::min(boundsMin, vertex);
+            boundsMax = glm::max(boundsMax, vertex);
+        } else if (type == "f") {
+            std::string part;
+            while (iss >> part) {
+                const glm::vec3& vertex = vertices[std::stoi(part.substr(0, part.find('/'))) - 1];
+                positions.insert(positions.end(), {vertex.x, vertex.y, vertex.z});
+            }
+        }
+    }
+    return true;
+}
+
+/**
+* Distance along direction from origin to triangle v0 v1 v2 in units of
+* direction (Moller-Trumbore), written out apart from MeshBVH so the scans
+* below do not share its code
+*
+* @return float -1 when the ray misses the triangle
+*/
+static float RayTriangleDistance(const glm::vec3& origin, const glm::vec3& direction,
+                                 const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2){
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f) {
+        return -1.0f;
+    }
+    glm::vec3 s = origin - v0;
+    float u = glm::dot(s, p) / determinant;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) / determinant;
+    float distance = glm::dot(edge2, q) / determinant;
+    if (u < 0.0f || v < 0.0f || u + v > 1.0f || distance < 0.0f) {
+        return -1.0f;
+    }
+    return distance;
+}
+
+void BenchmarkBVH(){
+    const int kBuilds = 20;
+    const int kRays = 1000000;
+    const int kScanRays = 2000;
+    // Nearest hits of the BVH and of the scan may differ by rounding only
+    const float kDistanceTolerance = 1e-4f;
+    const int kCapsules = 1000000;
+    const int kScanCapsules = 2000;
+
+    std::cout << "BVH benchmark, " << kBuilds << " builds, " << kRays << " rays and "
+              << kCapsules << " capsules per mesh" << std::endl;
+    for (const std::string& fileName : {g.gHouseFileName, g.gChapelFileName, g.gWindmillFileName, g.gChaliceFileName}) {
+        std::vector<float> positions;
+        glm::vec3 boundsMin, boundsMax;
+        if (!LoadTrianglePositions(fileName, positions, boundsMin, boundsMax)) {
+            continue;
+        }
+
+        MeshBVH bvh;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kBuilds; ++i) {
+            bvh.Build(positions);
+        }
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kBuilds;
+
+        // Rays from around the box of the mesh to points inside it
+        glm::vec3 size = boundsMax - boundsMin;
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<glm::vec3> origins, directions;
+        for (int i = 0; i < kRays; ++i) {
+            glm::vec3 origin = boundsMin - 0.2f * size + 1.4f * size * glm::vec3(unit(gen), unit(gen), unit(gen));
+            glm::vec3 target = boundsMin + size * glm::vec3(unit(gen), unit(gen), unit(gen));
+            origins.push_back(origin);
+            directions.push_back(target - origin);
+        }
+        size_t hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRays; ++i) {
+            float distance = 0.0f;
+            hits += bvh.Raycast(origins[i], directions[i], 1.0f, distance) ? 1 : 0;
+        }
+        double rayNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kRays;
+
+        // The same rays against every triangle, fewer of them
+        size_t scanHits = 0;
+        std::vector<float> scanDistances(kScanRays, -1.0f);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kScanRays; ++i) {
+            const glm::vec3& origin = origins[i];
+            const glm::vec3& direction = directions[i];
+            float closest = 1.0f;
+            bool hit = false;
+            for (size_t t = 0; t + 9 <= positions.size(); t += 9) {
+                float distance = RayTriangleDistance(origin, direction, glm::vec3(positions[t], positions[t + 1], positions[t + 2]),
+                                                     glm::vec3(positions[t + 3], positions[t + 4], positions[t + 5]),
+                                                     glm::vec3(positions[t + 6], positions[t + 7], positions[t + 8]));
+                if (distance >= 0.0f && distance < closest) {
+                    closest = distance;
+                    hit = true;
+                }
+            }
+            scanHits += hit ? 1 : 0;
+            scanDistances[i] = hit ? closest : -1.0f;
+        }
+        double scanNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kScanRays;
+
+        // The BVH must find the nearest hit of the scan
+        size_t mismatches = 0;
+        for (int i = 0; i < kScanRays; ++i) {
+            float distance = 0.0f;
+            bool hit = bvh.Raycast(origins[i], directions[i], 1.0f, distance);
+            if (hit != (scanDistances[i] >= 0.0f) || (hit && std::fabs(distance - scanDistances[i]) > kDistanceTolerance)) {
+                mismatches++;
+            }
+        }
+
+        // Player capsules standing anywhere over the footprint of the mesh
+        std::vector<glm::vec3> bottoms, tops;
+        for (int i = 0; i < kCapsules; ++i) {
+            glm::vec3 feet(boundsMin.x + size.x * unit(gen), boundsMin.y, boundsMin.z + size.z * unit(gen));
+            bottoms.push_back(feet + glm::vec3(0.0f, g.gStepHeight + g.gPlayerRadius, 0.0f));
+            tops.push_back(feet + glm::vec3(0.0f, 0.35f, 0.0f));
+        }
+        size_t touching = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kCapsules; ++i) {
+            touching += bvh.OverlapsCapsule(bottoms[i], tops[i], g.gPlayerRadius) ? 1 : 0;
+        }
+        double capsuleNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kCapsules;
+
+        // The same capsules against every triangle, both must agree on each
+        size_t capsuleMismatches = 0;
+        float radiusSq = g.gPlayerRadius * g.gPlayerRadius;
+        for (int i = 0; i < kScanCapsules; ++i) {
+            bool scanTouching = false;
+            for (size_t t = 0; t + 9 <= positions.size() && !scanTouching; t += 9) {
+                glm::vec3 v0(positions[t], positions[t + 1], positions[t + 2]);
+                glm::vec3 v1(positions[t + 3], positions[t + 4], positions[t + 5]);
+                glm::vec3 v2(positions[t + 6], positions[t + 7], positions[t + 8]);
+                scanTouching = MeshBVH::SegmentTriangleDistanceSq(bottoms[i], tops[i], v0, v1, v2) <= radiusSq;
+            }
+            if (bvh.OverlapsCapsule(bottoms[i], tops[i], g.gPlayerRadius) != scanTouching) {
+                capsuleMismatches++;
+            }
+        }
+
+        std::cout << "  " << fileName.substr(fileName.find_last_of('/') + 1)
+                  << " | triangles: " << bvh.GetTriangleCount()
+                  << " | nodes: " << bvh.GetNodeCount()
+                  << " | build: " << buildMs << " ms"
+                  << " | ray: " << rayNs << " ns (scan " << scanNs << " ns)"
+                  << " | capsule: " << capsuleNs << " ns"
+                  << " | ray hits: " << (double)hits / kRays * 100.0 << "% (scan " << (double)scanHits / kScanRays * 100.0 << "%)"
+                  << " | capsules touching: " << (double)touching / kCapsules * 100.0 << "%"
+                  << " | depth: " << bvh.GetDepth()
+                  << " | rays differing from the scan: " << mismatches << "/" << kScanRays
+                  << " | capsules differing from the scan: " << capsuleMismatches << "/" << kScanCapsules << std::endl;
+    }
+}
+
+bool BenchmarkTriggers(){
+    const int pickupCounts[] = {1000, 10000, 100000};
+    const int kSteps = 1000000;
+    const float kMapSize = 1000.0f;
+    const float kStep = 0.02f;
+
+    // The player walks in straight lines across the map, turning at random
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> coordinate(-kMapSize * 0.5f, kMapSize * 0.5f);
+    std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+    std::vector<glm::vec2> path;
+    glm::vec2 position(0.0f);
+    glm::vec2 direction(1.0f, 0.0f);
+    for (int i = 0; i < kSteps; ++i) {
+        if (i % 500 == 0) {
+            float a = angle(gen);
+            direction = glm::vec2(std::cos(a), std::sin(a));
+        }
+        position = glm::clamp(position + direction * kStep, -kMapSize * 0.5f, kMapSize * 0.5f);
+        path.push_back(position);
+    }
+
+    std::cout << "Trigger benchmark, " << kSteps << " player steps over a "
+              << kMapSize << "x" << kMapSize << " map" << std::endl;
+    bool passed = true;
+    for (int pickupCount : pickupCounts) {
+        std::vector<OrientedBox2D> boxes;
+        for (int i = 0; i < pickupCount; ++i) {
+            // Battery sized footprints at any rotation
+            boxes.push_back(OrientedBox2D::FromLocal(glm::vec2(coordinate(gen), coordinate(gen)), angle(gen) * 57.3f,
+                                                     glm::vec2(-0.15f), glm::vec2(0.15f)));
+        }
+
+        TriggerSystem triggers;
+        triggers.Initialize(-kMapSize * 0.5f, kMapSize * 0.5f, g.gTriggerCellSize);
+        std::vector<uint32_t> collected;
+        triggers.SetCallback(TRIGGER_BATTERY, [&collected](uint32_t, uint32_t userValue){
+            collected.push_back(userValue);
+            return true;
+        });
+        for (int i = 0; i < pickupCount; ++i) {
+            triggers.Add(TRIGGER_BATTERY, boxes[i], g.gBatteryPickupMargin, (uint32_t)i);
+        }
+        size_t candidates = 0;
+        for (int i = 0; i < kSteps; i += 100) {
+            candidates += triggers.CandidatesAt(path[i]);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (const glm::vec2& step : path) {
+            triggers.Update(step);
+        }
+        double triggerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kSteps;
+
+        // Every battery in one list as Input() tested them before, collected
+        // batteries removed from it, on fewer steps
+        OrientedBoxList list;
+        for (const OrientedBox2D& box : boxes) {
+            list.Add(box);
+        }
+        std::vector<uint32_t> mask;
+        int scanSteps = std::min(kSteps, std::max(1000, (int)(1000000000LL / pickupCount / 10)));
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < scanSteps; ++i) {
+            if (list.ContainsPoint(path[i], g.gBatteryPickupMargin, mask) == 0) {
+                continue;
+            }
+            // From the back, so the box swapped into a removed slot was already tested
+            for (size_t b = list.Size(); b-- > 0;) {
+                if (mask[b / 32] & (1u << (b % 32))) {
+                    list.RemoveSwap(b);
+                }
+            }
+        }
+        double scanNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / scanSteps;
+
+        // The whole walk against every battery, a straight stretch at a time: the
+        // batteries whose bounds reach the stretch are copied to a list and tested
+        // at each step, collected ones leave the list and are never copied again
+        std::vector<uint32_t> walkCollected;
+        std::vector<char> taken(pickupCount, 0);
+        for (int first = 0; first < kSteps; first += 500) {
+            int last = std::min(kSteps, first + 500);
+            glm::vec2 stretchMin = path[first];
+            glm::vec2 stretchMax = path[first];
+            for (int i = first; i < last; ++i) {
+                stretchMin = glm::min(stretchMin, path[i]);
+                stretchMax = glm::max(stretchMax, path[i]);
+            }
+            OrientedBoxList stretch;
+            std::vector<uint32_t> stretchIds;
+            for (int b = 0; b < pickupCount; ++b) {
+                glm::vec2 boundsMin, boundsMax;
+                boxes[b].Bounds(g.gBatteryPickupMargin, boundsMin, boundsMax);
+                if (!taken[b] && glm::all(glm::lessThanEqual(boundsMin, stretchMax)) && glm::all(glm::lessThanEqual(stretchMin, boundsMax))) {
+                    stretch.Add(boxes[b]);
+                    stretchIds.push_back((uint32_t)b);
+                }
+            }
+            for (int i = first; i < last && stretch.Size() > 0; ++i) {
+                if (stretch.ContainsPoint(path[i], g.gBatteryPickupMargin, mask) == 0) {
+                    continue;
+                }
+                for (size_t b = stretch.Size(); b-- > 0;) {
+                    if (mask[b / 32] & (1u << (b % 32))) {
+                        walkCollected.push_back(stretchIds[b]);
+                        taken[stretchIds[b]] = 1;
+                        stretch.RemoveSwap(b);
+                        stretchIds[b] = stretchIds.back();
+                        stretchIds.pop_back();
+                    }
+                }
+            }
+        }
+        std::sort(collected.begin(), collected.end());
+        std::sort(walkCollected.begin(), walkCollected.end());
+        std::vector<uint32_t> differing;
+        std::set_symmetric_difference(collected.begin(), collected.end(),
+                                      walkCollected.begin(), walkCollected.end(), std::back_inserter(differing));
+        passed = passed && differing.empty();
+
+        // Removal of every trigger in random order
+        std::vector<uint32_t> handles;
+        triggers.Initialize(-kMapSize * 0.5f, kMapSize * 0.5f, g.gTriggerCellSize);
+        for (int i = 0; i < pickupCount; ++i) {
+            handles.push_back(triggers.Add(TRIGGER_BATTERY, boxes[i], g.gBatteryPickupMargin, (uint32_t)i));
+        }
+        std::shuffle(handles.begin(), handles.end(), gen);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t handle : handles) {
+            triggers.Remove(handle);
+        }
+        double removeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / pickupCount;
+
+        std::cout << "  pickups: " << pickupCount
+                  << " | candidates/step: " << (double)candidates / (kSteps / 100)
+                  << " | triggers: " << triggerNs << " ns/step"
+                  << " | scan: " << scanNs << " ns/step"
+                  << " | remove: " << removeNs << " ns"
+                  << " | collected: " << collected.size() << " (scan " << walkCollected.size() << ")"
+                  << " | batteries differing from the scan: " << differing.size() << std::endl;
+    }
+    return passed;
+}
+
+bool BenchmarkSceneQuery(){
+    const int treeCounts[] = {200, 10000, 100000};
+    const int kQueries = 1000000;
+    const int kScanQueries = 1000;
+    const float kRayLength = 10.0f;
+    // Hits of the grid and of the scan may differ by rounding only
+    const float kDistanceTolerance = 1e-3f;
+    const int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Structures placed as in the game, with their triangles also moved to world space for the scan
+    const std::string fileNames[] = {g.gHouseFileName, g.gChapelFileName, g.gWindmillFileName, g.gChaliceFileName};
+    const glm::vec2 spots[] = {{-15.0f, -10.0f}, {5.0f, 10.0f}, {10.0f, -5.0f}, {-5.0f, 15.0f}};
+    const float rotations[] = {30.0f, 90.0f, 45.0f, 0.0f};
+    std::vector<MeshBVH> bvhs(4);
+    std::vector<std::vector<float>> worldPositions(4);
+    std::vector<OrientedBox2D> footprints(4);
+    std::vector<glm::vec3> origins(4);
+    std::vector<glm::vec2> heights(4);
+    std::vector<std::array<glm::vec2, 4>> corners(4);
+    for (int i = 0; i < 4; ++i) {
+        std::vector<float> positions;
+        glm::vec3 boundsMin, boundsMax;
+        if (!LoadTrianglePositions(fileNames[i], positions, boundsMin, boundsMax)) {
+            return false;
+        }
+        bvhs[i].Build(positions);
+        origins[i] = glm::vec3(spots[i].x, -boundsMin.y, spots[i].y);
+        heights[i] = glm::vec2(origins[i].y + boundsMin.y, origins[i].y + boundsMax.y);
+        footprints[i] = OrientedBox2D::FromLocal(spots[i], rotations[i], glm::vec2(boundsMin.x, boundsMin.z), glm::vec2(boundsMax.x, boundsMax.z));
+
+        // Same model matrix as OBJ::GetModelMatrix()
+        glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), origins[i]), glm::radians(rotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));
+        for (size_t v = 0; v + 3 <= positions.size(); v += 3) {
+            glm::vec3 world = glm::vec3(model * glm::vec4(positions[v], positions[v + 1], positions[v + 2], 1.0f));
+            worldPositions[i].insert(worldPositions[i].end(), {world.x, world.y, world.z});
+        }
+        const float xs[] = {boundsMin.x, boundsMax.x, boundsMax.x, boundsMin.x};
+        const float zs[] = {boundsMin.z, boundsMin.z, boundsMax.z, boundsMax.z};
+        for (int c = 0; c < 4; ++c) {
+            glm::vec3 world = glm::vec3(model * glm::vec4(xs[c], 0.0f, zs[c], 1.0f));
+            corners[i][c] = glm::vec2(world.x, world.z);
+        }
+    }
+
+    // Player height rays in any horizontal direction, tilted a little like the head light
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> coordinate(g.gMinValue, g.gMaxValue);
+    std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+    std::uniform_real_distribution<float> tilt(-0.3f, 0.1f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<SceneRay> rays;
+    std::vector<SceneSphere> spheres;
+    std::vector<SceneBox> boxes;
+    for (int i = 0; i < kQueries; ++i) {
+        glm::vec3 position(coordinate(gen), g.gCamera.GetEyePosition().y, coordinate(gen));
+        float a = angle(gen);
+        rays.push_back({position, kRayLength, glm::normalize(glm::vec3(std::cos(a), tilt(gen), std::sin(a)))});
+        spheres.push_back({position, 0.3f});
+        boxes.push_back({position - glm::vec3(0.5f), position + glm::vec3(0.5f)});
+    }
+    // A few of each right at the structures, random points rarely reach them
+    for (int i = 0; i < kScanQueries / 4; ++i) {
+        int structure = i % 4;
+        glm::vec2 spot = footprints[structure].center;
+        glm::vec3 position(spot.x + 4.0f * (unit(gen) - 0.5f), heights[structure].x + 3.0f * unit(gen), spot.y + 4.0f * (unit(gen) - 0.5f));
+        float a = angle(gen);
+        rays[i] = {position, kRayLength, glm::normalize(glm::vec3(std::cos(a), tilt(gen), std::sin(a)))};
+        spheres[i] = {position, 0.3f};
+        boxes[i] = {position - glm::vec3(0.5f), position + glm::vec3(0.5f)};
+    }
+
+    std::cout << "Scene query benchmark, " << kQueries << " rays, spheres and boxes, "
+              << threadCount << " hardware threads" << std::endl;
+    bool passed = true;
+    for (int treeCount : treeCounts) {
+        SceneQuery query;
+        for (int i = 0; i < 4; ++i) {
+            query.AddMesh(footprints[i], origins[i], heights[i].x, heights[i].y, bvhs[i]);
+        }
+        std::vector<glm::vec2> trunks;
+        for (int i = 0; i < treeCount; ++i) {
+            OrientedBox2D trunk;
+            trunk.center = glm::vec2(coordinate(gen), coordinate(gen));
+            trunk.halfExtents = glm::vec2(g.gTrunkHalfWidth);
+            query.AddBox(trunk, 0.0f, g.gTrunkHeight);
+            trunks.push_back(trunk.center);
+        }
+        query.Build(g.gMinValue, g.gMaxValue);
+
+        std::vector<SceneHit> hits(kQueries);
+        auto start = std::chrono::steady_clock::now();
+        query.Raycast(rays.data(), kQueries, hits.data());
+        double rayNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kQueries;
+        size_t rayHits = std::count_if(hits.begin(), hits.end(), [](const SceneHit& hit){ return hit.item >= 0; });
+
+        // The same batch split in one slice per thread
+        std::vector<SceneHit> threadedHits(kQueries);
+        std::vector<std::thread> workers;
+        size_t slice = (kQueries + threadCount - 1) / threadCount;
+        start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threadCount; ++t) {
+            size_t first = std::min((size_t)kQueries, t * slice);
+            size_t count = std::min((size_t)kQueries - first, slice);
+            workers.push_back(std::thread([&query, &rays, &threadedHits, first, count](){
+                query.Raycast(rays.data() + first, count, threadedHits.data() + first);
+            }));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        double threadedRayNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kQueries;
+        size_t threadMismatches = 0;
+        for (int i = 0; i < kQueries; ++i) {
+            if (hits[i].item != threadedHits[i].item || hits[i].distance != threadedHits[i].distance) {
+                threadMismatches++;
+            }
+        }
+
+        SceneOverlaps sphereOverlaps;
+        start = std::chrono::steady_clock::now();
+        query.OverlapSpheres(spheres.data(), kQueries, sphereOverlaps);
+        double sphereNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kQueries;
+        SceneOverlaps boxOverlaps;
+        start = std::chrono::steady_clock::now();
+        query.OverlapBoxes(boxes.data(), kQueries, boxOverlaps);
+        double boxNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kQueries;
+
+        // The first queries against every item, items are numbered as added: structures, then trunks
+        size_t rayMismatches = 0;
+        size_t sphereMismatches = 0;
+        size_t boxMismatches = 0;
+        for (int q = 0; q < kScanQueries; ++q) {
+            const SceneRay& ray = rays[q];
+            float closest = ray.maxDistance;
+            bool hit = false;
+            std::vector<uint32_t> sphereItems, boxItems;
+            const SceneSphere& sphere = spheres[q];
+            const SceneBox& box = boxes[q];
+            for (int i = 0; i < 4; ++i) {
+                const std::vector<float>& world = worldPositions[i];
+                bool touching = false;
+                for (size_t t = 0; t + 9 <= world.size(); t += 9) {
+                    glm::vec3 v0(world[t], world[t + 1], world[t + 2]);
+                    glm::vec3 v1(world[t + 3], world[t + 4], world[t + 5]);
+                    glm::vec3 v2(world[t + 6], world[t + 7], world[t + 8]);
+                    float distance = RayTriangleDistance(ray.origin, ray.direction, v0, v1, v2);
+                    if (distance >= 0.0f && distance <= closest) {
+                        closest = distance;
+                        hit = true;
+                    }
+                    touching = touching || MeshBVH::SegmentTriangleDistanceSq(sphere.center, sphere.center, v0, v1, v2) <= sphere.radius * sphere.radius;
+                }
+                if (touching) {
+                    sphereItems.push_back(i);
+                }
+                // Boxes overlap the volume of the structure, separated along the axes of either rectangle
+                bool separated = box.boxMax.y < heights[i].x || box.boxMin.y > heights[i].y;
+                const std::array<glm::vec2, 4>& footprint = corners[i];
+                glm::vec2 axes[] = {{1.0f, 0.0f}, {0.0f, 1.0f}, footprint[1] - footprint[0], footprint[3] - footprint[0]};
+                glm::vec2 boxCorners[] = {{box.boxMin.x, box.boxMin.z}, {box.boxMax.x, box.boxMin.z},
+                                          {box.boxMax.x, box.boxMax.z}, {box.boxMin.x, box.boxMax.z}};
+                for (const glm::vec2& axis : axes) {
+                    float minA = FLT_MAX, maxA = -FLT_MAX, minB = FLT_MAX, maxB = -FLT_MAX;
+                    for (int c = 0; c < 4; ++c) {
+                        minA = std::min(minA, glm::dot(axis, footprint[c]));
+                        maxA = std::max(maxA, glm::dot(axis, footprint[c]));
+                        minB = std::min(minB, glm::dot(axis, boxCorners[c]));
+                        maxB = std::max(maxB, glm::dot(axis, boxCorners[c]));
+                    }
+                    separated = separated || maxA < minB || maxB < minA;
+                }
+                if (!separated) {
+                    boxItems.push_back(i);
+                }
+            }
+            glm::vec3 trunkExtent(g.gTrunkHalfWidth, 0.0f, g.gTrunkHalfWidth);
+            for (int i = 0; i < treeCount; ++i) {
+                glm::vec3 trunkMin = glm::vec3(trunks[i].x, 0.0f, trunks[i].y) - trunkExtent;
+                glm::vec3 trunkMax = glm::vec3(trunks[i].x, g.gTrunkHeight, trunks[i].y) + trunkExtent;
+                // Slab test of the ray
+                float tNear = 0.0f;
+                float tFar = closest;
+                for (int axis = 0; axis < 3 && tNear <= tFar; ++axis) {
+                    if (ray.direction[axis] == 0.0f) {
+                        tFar = (ray.origin[axis] < trunkMin[axis] || ray.origin[axis] > trunkMax[axis]) ? -1.0f : tFar;
+                        continue;
+                    }
+                    float t0 = (trunkMin[axis] - ray.origin[axis]) / ray.direction[axis];
+                    float t1 = (trunkMax[axis] - ray.origin[axis]) / ray.direction[axis];
+                    tNear = std::max(tNear, std::min(t0, t1));
+                    tFar = std::min(tFar, std::max(t0, t1));
+                }
+                if (tNear <= tFar) {
+                    closest = tNear;
+                    hit = true;
+                }
+                glm::vec3 offset = sphere.center - glm::clamp(sphere.center, trunkMin, trunkMax);
+                if (glm::dot(offset, offset) <= sphere.radius * sphere.radius) {
+                    sphereItems.push_back(4 + i);
+                }
+                if (glm::all(glm::lessThanEqual(box.boxMin, trunkMax)) && glm::all(glm::lessThanEqual(trunkMin, box.boxMax))) {
+                    boxItems.push_back(4 + i);
+                }
+            }
+
+            if ((hits[q].item >= 0) != hit || (hit && std::fabs(hits[q].distance - closest) > kDistanceTolerance)) {
+                rayMismatches++;
+            }
+            if (!std::equal(sphereItems.begin(), sphereItems.end(), sphereOverlaps.items.begin() + sphereOverlaps.offsets[q],
+                            sphereOverlaps.items.begin() + sphereOverlaps.offsets[q + 1])) {
+                sphereMismatches++;
+            }
+            if (!std::equal(boxItems.begin(), boxItems.end(), boxOverlaps.items.begin() + boxOverlaps.offsets[q],
+                            boxOverlaps.items.begin() + boxOverlaps.offsets[q + 1])) {
+                boxMismatches++;
+            }
+        }
+        passed = passed && threadMismatches == 0 && rayMismatches == 0 && sphereMismatches == 0 && boxMismatches == 0;
+
+        std::cout << "  trees: " << treeCount
+                  << " | cells: " << query.GetCellsPerSide() << "x" << query.GetCellsPerSide()
+                  << " | ray: " << rayNs << " ns (" << threadCount << " threads: " << threadedRayNs << " ns)"
+                  << " | sphere: " << sphereNs << " ns"
+                  << " | box: " << boxNs << " ns"
+                  << " | rays hit: " << (double)rayHits / kQueries * 100.0 << "%"
+                  << " | overlaps/sphere: " << (double)sphereOverlaps.items.size() / kQueries
+                  << " | overlaps/box: " << (double)boxOverlaps.items.size() / kQueries
+                  << " | differing from the scan: rays " << rayMismatches << "/" << kScanQueries
+                  << ", spheres " << sphereMismatches << "/" << kScanQueries
+                  << ", boxes " << boxMismatches << "/" << kScanQueries
+                  << " | threaded rays differing: " << threadMismatches << std::endl;
+    }
+    return passed;
+}
+
+void BenchmarkPoisson(){
+    // Square maps where radius 1 fits about this many trees
+    const float mapSizes[] = {120.0f, 380.0f, 1200.0f};
+    const float kRadius = 1.0f;
+
+    std::cout << "Poisson-disk benchmark, radius " << kRadius << ", one structure every 100 square units" << std::endl;
+    for (float mapSize : mapSizes) {
+        float half = mapSize * 0.5f;
+        auto sample = [&](uint32_t seed){
+            PoissonDisk sampler(-half, half, seed);
+            // Not the seed of the sampler, its first points would fall on the structures
+            std::mt19937 gen(seed + 1);
+            std::uniform_real_distribution<float> coordinate(-half, half);
+            for (int i = 0; i < (int)(mapSize * mapSize / 100.0f); ++i) {
+                sampler.AddExclusion(glm::vec2(coordinate(gen), coordinate(gen)), 2.0f);
+            }
+            return sampler.Sample(kRadius);
+        };
+        auto start = std::chrono::steady_clock::now();
+        std::vector<glm::vec2> points = sample(1234);
+        double sampleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Spacing through a grid of radius wide cells
+        int cellsPerSide = (int)std::ceil(mapSize / kRadius);
+        std::vector<std::vector<uint32_t>> cells((size_t)cellsPerSide * cellsPerSide);
+        auto cellOf = [&](const glm::vec2& point){
+            return glm::clamp(glm::ivec2(glm::floor((point + half) / kRadius)), 0, cellsPerSide - 1);
+        };
+        for (size_t i = 0; i < points.size(); ++i) {
+            glm::ivec2 cell = cellOf(points[i]);
+            cells[cell.y * cellsPerSide + cell.x].push_back((uint32_t)i);
+        }
+        size_t tooClose = 0;
+        for (size_t i = 0; i < points.size(); ++i) {
+            glm::ivec2 cell = cellOf(points[i]);
+            for (int z = std::max(cell.y - 1, 0); z <= std::min(cell.y + 1, cellsPerSide - 1); ++z) {
+                for (int x = std::max(cell.x - 1, 0); x <= std::min(cell.x + 1, cellsPerSide - 1); ++x) {
+                    for (uint32_t other : cells[z * cellsPerSide + x]) {
+                        tooClose += other > i && glm::length(points[other] - points[i]) < kRadius ? 1 : 0;
+                    }
+                }
+            }
+        }
+        bool deterministic = sample(1234) == points;
+
+        std::cout << "  map: " << mapSize << "x" << mapSize
+                  << " | points: " << points.size()
+                  << " | time: " << sampleMs << " ms (" << sampleMs * 1e6 / std::max<size_t>(points.size(), 1) << " ns/point)"
+                  << " | pairs closer than radius: " << tooClose
+                  << " | same seed, same points: " << (deterministic ? "yes" : "no") << std::endl;
+    }
+}
+
+void BenchmarkStreaming(){
+    const float mapSizes[] = {256.0f, 1024.0f, 4096.0f};
+    const int kSteps = 2000;
+
+    StreamSettings base = StreamSettings::FromGlobals();
+    base.minValue = -0.5f * mapSizes[2];
+    base.maxValue = 0.5f * mapSizes[2];
+    base.treeDensity = 0.3f;
+    std::cout << "Streaming benchmark, chunks " << base.chunkSize << " wide, radius " << base.loadRadius
+              << ", " << base.threadCount << " threads, " << base.treeDensity << " trees per square unit" << std::endl;
+
+    // Generation alone, and the same chunk twice
+    const int kChunks = 64;
+    std::vector<WorldChunk> chunks(kChunks);
+    auto generateStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < kChunks; ++i) {
+        chunks[i].coord = glm::ivec2(i % 8, i / 8);
+        WorldStreamer::Generate(base, chunks[i]);
+    }
+    double generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generateStart).count();
+    WorldChunk again;
+    again.coord = chunks[kChunks - 1].coord;
+    WorldStreamer::Generate(base, again);
+    bool deterministic = again.grassTiles.size() == chunks[kChunks - 1].grassTiles.size();
+    for (int kind = 0; kind < kStreamedTreeKinds; ++kind) {
+        deterministic = deterministic && again.treeCoords[kind] == chunks[kChunks - 1].treeCoords[kind]
+                                      && again.treeSizeMirror[kind] == chunks[kChunks - 1].treeSizeMirror[kind];
+    }
+    std::cout << "  generation: " << generateMs / kChunks << " ms/chunk, " << chunks[0].memoryBytes / 1024.0 << " KB/chunk"
+              << " | same seed, same chunk: " << (deterministic ? "yes" : "no") << std::endl;
+
+    for (float capMB : {64.0f, 0.125f}) {
+        for (float mapSize : mapSizes) {
+            StreamSettings settings = base;
+            settings.minValue = -0.5f * mapSize;
+            settings.maxValue = 0.5f * mapSize;
+            settings.memoryBytes = (size_t)(capMB * 1024.0f * 1024.0f);
+            WorldStreamer streamer;
+            streamer.Start(settings);
+
+            auto start = std::chrono::steady_clock::now();
+            streamer.LoadAround(glm::vec2(0.0f));
+            double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            size_t loaded = streamer.GetResidentCount();
+
+            // From the middle towards a corner, a frame of 1 ms per step is much faster than a player walks
+            float walk = std::min(500.0f, 0.4f * mapSize);
+            glm::vec2 direction = glm::normalize(glm::vec2(1.0f, 0.6f));
+            double updateUs = 0.0;
+            double maxUpdateUs = 0.0;
+            size_t missing = 0;
+            size_t peakBytes = 0;
+            for (int step = 0; step < kSteps; ++step) {
+                glm::vec2 position = direction * (walk * step / kSteps);
+                auto updateStart = std::chrono::steady_clock::now();
+                streamer.Update(position);
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - updateStart).count();
+                updateUs += us;
+                maxUpdateUs = std::max(maxUpdateUs, us);
+                peakBytes = std::max(peakBytes, streamer.GetResidentBytes());
+                // The player would walk through the trees of an absent chunk
+                missing += streamer.IsResident(position) ? 0 : 1;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            std::cout << "  map: " << mapSize << "x" << mapSize << " | cap: " << capMB << " MB"
+                      << " | start: " << loaded << " chunks in " << loadMs << " ms"
+                      << " | walk of " << walk << " units: " << streamer.GetGeneratedCount() << " chunks generated"
+                      << ", update " << updateUs / kSteps << " us (max " << maxUpdateUs << " us)"
+                      << ", peak " << peakBytes / 1024.0 << " KB"
+                      << " | steps on a missing chunk: " << missing << std::endl;
+        }
+    }
+}
+
+void BenchmarkTerrain(){
+    const float viewDistances[] = {20.0f, 100.0f, 500.0f, 2000.0f};
+    const float kMapSize = 4096.0f;
+    const int kSelections = 200;
+    const int kPatchVertices = 6 * Terrain::kGridQuads * Terrain::kGridQuads;
+
+    Heightfield heightfield;
+    auto start = std::chrono::steady_clock::now();
+    heightfield.Generate(-0.5f * kMapSize, 0.5f * kMapSize, g.gTerrainSampleSpacing, g.gTerrainHeight,
+                         g.gTerrainFeatureSize, g.gRandom.StreamSeed(RANDOM_TERRAIN));
+    double generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    Terrain terrain;
+    terrain.Build(heightfield, g.gTerrainLodDistance);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Terrain benchmark, map " << kMapSize << "x" << kMapSize << ", " << heightfield.GetSamplesPerSide()
+              << " samples a side generated in " << generateMs << " ms, " << terrain.GetLevelCount()
+              << " levels built in " << buildMs << " ms" << std::endl;
+
+    // Boxes of the leaves, for the single level comparison
+    int leavesPerSide = (int)std::ceil(kMapSize / Terrain::kLeafSize);
+    BoxList leaves;
+    for (int z = 0; z < leavesPerSide; ++z) {
+        for (int x = 0; x < leavesPerSide; ++x) {
+            glm::vec2 corner = glm::vec2(heightfield.GetMinValue()) + glm::vec2(x, z) * Terrain::kLeafSize;
+            float lowest, highest;
+            heightfield.Range(corner, corner + Terrain::kLeafSize, lowest, highest);
+            leaves.Add(glm::vec3(corner.x + 0.5f * Terrain::kLeafSize, 0.5f * (lowest + highest), corner.y + 0.5f * Terrain::kLeafSize),
+                       glm::vec3(0.5f * Terrain::kLeafSize, 0.5f * (highest - lowest), 0.5f * Terrain::kLeafSize));
+        }
+    }
+
+    // Standing in the middle of the map, looking a little down
+    glm::vec3 eye(0.0f, heightfield.HeightAt(glm::vec2(0.0f)) + 0.35f, 0.0f);
+    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(1.0f, -0.1f, 0.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<TerrainPatch> patches;
+    std::vector<uint32_t> visibleLeaves;
+    for (float viewDistance : viewDistances) {
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1200.0f / 720.0f, 0.1f, viewDistance);
+        Frustum frustum;
+        frustum.Extract(projection * view);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kSelections; ++i) {
+            patches.clear();
+            terrain.Select(eye, frustum, patches);
+        }
+        double selectUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kSelections;
+        size_t vertices = 0;
+        int finestLevel = Terrain::kMaxLevels;
+        int coarsestLevel = 0;
+        for (const TerrainPatch& patch : patches) {
+            vertices += patch.part == Terrain::kWholeNode ? kPatchVertices : kPatchVertices / 4;
+            finestLevel = std::min(finestLevel, patch.level);
+            coarsestLevel = std::max(coarsestLevel, patch.level);
+        }
+
+        visibleLeaves.clear();
+        start = std::chrono::steady_clock::now();
+        frustum.CullBoxes(leaves, visibleLeaves);
+        double leavesUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "  view distance: " << viewDistance
+                  << " | patches: " << patches.size() << ", levels " << finestLevel << " to " << coarsestLevel
+                  << ", " << vertices << " vertices, selected in " << selectUs << " us"
+                  << " | single level: " << visibleLeaves.size() << " patches, "
+                  << visibleLeaves.size() * kPatchVertices << " vertices, culled in " << leavesUs << " us" << std::endl;
+    }
+}
+
+bool CheckSoftwareOcclusion(){
+    struct Case{
+        const char* name;
+        glm::vec3 center;
+        glm::vec3 extents;
+        bool occluded;
+    };
+    // Eye at the origin looking down -z, a wall 4 wide and 2 high at z = -5 and a
+    // trunk standing at z = -4 further left
+    const Case cases[] = {
+        {"box behind the wall", glm::vec3(0.0f, 0.0f, -8.0f), glm::vec3(0.3f), true},
+        {"box in front of the wall", glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.3f), false},
+        {"box beside the wall", glm::vec3(5.0f, 0.0f, -8.0f), glm::vec3(0.3f), false},
+        {"box over the edge of the wall", glm::vec3(3.2f, 0.0f, -8.0f), glm::vec3(0.3f), false},
+        {"box through the wall", glm::vec3(0.0f, 0.0f, -5.25f), glm::vec3(0.5f), false},
+        {"box behind the trunk", glm::vec3(-5.25f, -0.5f, -7.0f), glm::vec3(0.03f), true},
+        {"box above the trunk", glm::vec3(-5.25f, 0.5f, -7.0f), glm::vec3(0.03f), false},
+    };
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                            (float)SoftwareOcclusion::kWidth / SoftwareOcclusion::kHeight, 0.1f, 20.0f);
+    glm::mat4 viewProjection = projection * view;
+
+    SoftwareOcclusion occlusion;
+    bool passed = true;
+    std::cout << "Software occlusion check" << std::endl;
+
+    // Nothing is hidden without occluders
+    occlusion.ClearOccluders();
+    occlusion.RasterizeAsync(viewProjection);
+    occlusion.Wait();
+    for (const Case& test : cases) {
+        if (occlusion.IsOccluded(test.center, test.extents)) {
+            std::cout << "  FAIL " << test.name << " occluded without occluders" << std::endl;
+            passed = false;
+        }
+    }
+
+    occlusion.ClearOccluders();
+    occlusion.AddOccluderBox(glm::vec3(-2.0f, -1.0f, -5.5f), glm::vec3(2.0f, 1.0f, -5.0f), glm::mat4(1.0f));
+    occlusion.AddOccluderQuad(glm::vec3(-3.0f, -1.0f, -4.0f), 0.2f, 1.2f, glm::vec3(0.0f));
+    occlusion.RasterizeAsync(viewProjection);
+    occlusion.Wait();
+    for (const Case& test : cases) {
+        bool occluded = occlusion.IsOccluded(test.center, test.extents);
+        bool ok = occluded == test.occluded;
+        passed = passed && ok;
+        std::cout << "  " << (ok ? "ok  " : "FAIL ") << test.name
+                  << " | occluded: " << (occluded ? "yes" : "no")
+                  << " (expected " << (test.occluded ? "yes" : "no") << ")" << std::endl;
+    }
+    std::cout << "  triangles drawn: " << occlusion.GetTrianglesDrawn()
+              << " | skipped: " << occlusion.GetTrianglesSkipped() << std::endl;
+
+    // Structures get an inner box from MeshBVH::FitInnerBox as in the game, the
+    // chalice none. Each stands 6 units ahead with its floor at y = -1, a box of
+    // the size of a battery just behind its middle
+    struct Structure{
+        std::string fileName;
+        bool hasHull;
+        bool hidesBehind;
+    };
+    const Structure structures[] = {
+        {g.gHouseFileName, true, true},
+        {g.gChapelFileName, true, true},
+        {g.gWindmillFileName, true, true},
+        {g.gChaliceFileName, false, false},
+    };
+    for (const Structure& structure : structures) {
+        std::vector<float> positions;
+        glm::vec3 boundsMin, boundsMax;
+        if (!LoadTrianglePositions(structure.fileName, positions, boundsMin, boundsMax)) {
+            passed = false;
+            continue;
+        }
+        MeshBVH bvh;
+        bvh.Build(positions);
+        glm::vec3 hullMin, hullMax;
+        bool hasHull = bvh.FitInnerBox(boundsMin, boundsMax, 0.7f, hullMin, hullMax);
+
+        glm::vec3 position(0.0f, -1.0f - boundsMin.y, -6.0f);
+        occlusion.ClearOccluders();
+        if (hasHull) {
+            occlusion.AddOccluderBox(hullMin, hullMax, glm::translate(glm::mat4(1.0f), position));
+        }
+        occlusion.RasterizeAsync(viewProjection);
+        occlusion.Wait();
+        // Straight behind the middle of the hull, or of the mesh without one
+        glm::vec3 middle = hasHull ? (hullMin + hullMax) * 0.5f : (boundsMin + boundsMax) * 0.5f;
+        glm::vec3 behind = (position + middle) * 2.0f;
+        bool occluded = occlusion.IsOccluded(behind, glm::vec3(0.02f));
+
+        bool ok = hasHull == structure.hasHull && occluded == structure.hidesBehind;
+        passed = passed && ok;
+        std::cout << "  " << (ok ? "ok  " : "FAIL ") << structure.fileName.substr(structure.fileName.find_last_of('/') + 1)
+                  << " | inner box: " << (hasHull ? "yes" : "no") << " (expected " << (structure.hasHull ? "yes" : "no") << ")"
+                  << " | box behind occluded: " << (occluded ? "yes" : "no") << " (expected " << (structure.hidesBehind ? "yes" : "no") << ")";
+        if (hasHull) {
+            std::cout << " | size: " << (hullMax.x - hullMin.x) << " x " << (hullMax.y - hullMin.y) << " x " << (hullMax.z - hullMin.z);
+        }
+        std::cout << std::endl;
+    }
+    return passed;
+}
+
+bool CheckOrientedBoxes(){
+    const size_t boxCounts[] = {1, 3, 4, 7, 32, 33, 71, 100};
+    const int kPoints = 100000;
+    const float kMargin = 0.1f;
+    // Points this close to an edge may fall on either side after rounding
+    const float kTie = 1e-4f;
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> coordinate(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> rotation(0.0f, 360.0f);
+    std::uniform_real_distribution<float> halfExtent(0.2f, 4.0f);
+
+    bool passed = true;
+    std::cout << "Oriented box check, " << kPoints << " points per box count" << std::endl;
+    for (size_t boxCount : boxCounts) {
+        std::vector<OrientedBox2D> boxes;
+        OrientedBoxList list;
+        for (size_t i = 0; i < boxCount; ++i) {
+            glm::vec2 half(halfExtent(gen), halfExtent(gen));
+            boxes.push_back(OrientedBox2D::FromLocal(glm::vec2(coordinate(gen), coordinate(gen)), rotation(gen), -half, half));
+            list.Add(boxes.back());
+        }
+
+        std::vector<uint32_t> mask;
+        size_t hits = 0;
+        size_t mismatches = 0;
+        size_t ties = 0;
+        for (int p = 0; p < kPoints; ++p) {
+            glm::vec2 point(coordinate(gen), coordinate(gen));
+            size_t count = list.ContainsPoint(point, kMargin, mask);
+            size_t maskHits = 0;
+            size_t expectedHits = 0;
+            for (size_t i = 0; i < boxCount; ++i) {
+                bool inMask = (mask[i / 32] >> (i % 32)) & 1u;
+                bool expected = boxes[i].Contains(point, kMargin);
+                maskHits += inMask ? 1 : 0;
+                expectedHits += expected ? 1 : 0;
+                if (inMask != expected) {
+                    if (boxes[i].Contains(point, kMargin + kTie) && !boxes[i].Contains(point, kMargin - kTie)) {
+                        ties++;
+                    } else {
+                        mismatches++;
+                    }
+                }
+            }
+            // The count must agree with the mask, and with the scalar test but for ties
+            if (count != maskHits) {
+                mismatches++;
+            }
+            hits += expectedHits;
+        }
+
+        bool ok = mismatches == 0;
+        passed = passed && ok;
+        std::cout << "  " << (ok ? "ok  " : "FAIL ") << "boxes: " << boxCount
+                  << " | hits: " << hits
+                  << " | mismatches: " << mismatches
+                  << " | edge ties: " << ties << std::endl;
+    }
+    return passed;
+}
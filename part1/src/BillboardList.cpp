@@ -9,6 +9,15 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+
+// The geometry shader (or billboard_quad_vert.glsl) expands each point into
+// a quad 4 units high and at most 4 units wide at size 1, standing on the point
+static const float kTreeHeight = 4.0f;
+static const float kTreeRadius = 2.0f * 1.41421356f;
+// Range of the random size of the trees
+static const float kMinTreeSize = 0.8f;
+static const float kMaxTreeSize = 1.2f;
+
 BillboardList::BillboardList(std::string fileName){
     mTexture = new Texture();
     mTexture->LoadTexture(fileName);
@@ -16,24 +25,88 @@ BillboardList::BillboardList(std::string fileName){
 
 BillboardList::~BillboardList(){
     if(mTexture) delete mTexture;
-    glDeleteBuffers(2, mVBO);
-    glDeleteVertexArrays(1, &mVAO);
+    g.gGLState.DeleteBuffers(2, mVBO);
+    g.gGLState.DeleteVertexArrays(1, &mVAO);
+}
 
-    // Delete our Graphics pipeline
-    glDeleteProgram(mShaderID);
+void BillboardList::SetPos(std::vector<glm::vec2>& vectorList){
+    std::vector<float> sizeMirror;
+    DrawLooks(g.gRandom.Stream(RANDOM_TREE_LOOKS), vectorList.size(), sizeMirror);
+    SetTrees(vectorList, sizeMirror);
+}
 
+/**
+* Random size, and mirrored half of the time, so the same texture looks less repeated.
+* A quad facing the camera cannot turn, mirroring is its only other orientation.
+* Touches nothing but generator, so chunks of a streamed world call it on their threads
+*
+* @return void
+*/
+void BillboardList::DrawLooks(std::mt19937& generator, size_t count, std::vector<float>& sizeMirror){
+    for (size_t i = 0; i < count; ++i) {
+        sizeMirror.push_back(Random::Uniform(generator, kMinTreeSize, kMaxTreeSize));
+        sizeMirror.push_back(Random::Int(generator, 0, 1) == 1 ? -1.0f : 1.0f);
+    }
 }
 
-void BillboardList::SetPos(std::vector<glm::vec2>& vectorList){
+void BillboardList::SetTrees(const std::vector<glm::vec2>& coords, const std::vector<float>& sizeMirror){
     // Combine glm::vec2 vectors into a single std::vector<float> as treePos
-    std::vector<float> combinedVector;
-    for (const auto& vec : vectorList) {
-        combinedVector.push_back(vec.x);    // x
-        combinedVector.push_back(0.f);      // y (always 0)
-        combinedVector.push_back(vec.y);    // z
+    treePos.clear();
+    for (const auto& vec : coords) {
+        treePos.push_back(vec.x);                           // x
+        treePos.push_back(g.gHeightfield.HeightAt(vec));    // y, on the ground
+        treePos.push_back(vec.y);                           // z
+    }
+    mSizeMirror = sizeMirror;
+
+    // The quad turns to face the camera, a sphere around its middle covers every orientation
+    mBounds.Clear();
+    for (size_t i = 0; i < coords.size(); ++i) {
+        float treeSize = mSizeMirror[i*2];
+        mBounds.Add(glm::vec3(coords[i].x, treePos[i*3+1] + kTreeHeight * 0.5f * treeSize, coords[i].y), kTreeRadius * treeSize);
+    }
+    // Initialize() uploads every tree, after it the buffers only change in Cull()
+    mVisibleCount = mVAO == 0 ? coords.size() : 0;
+}
+
+/**
+* Cull the trees against frustum, the head light cone and occluders and stream
+* the visible positions into the instance buffer.
+*
+* @return void
+*/
+void BillboardList::Cull(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders, CullCounts& counts){
+    mVisibleIndices.clear();
+    frustum.CullSpheres(mBounds, mVisibleIndices);
+    size_t inFrustum = mVisibleIndices.size();
+    light.FilterSpheres(mBounds, mVisibleIndices);
+    size_t lit = mVisibleIndices.size();
+    if (occluders != nullptr) {
+        occluders->FilterSpheres(mBounds, mVisibleIndices);
+    }
+    counts.Add(mBounds.Size(), inFrustum, lit, mVisibleIndices.size());
+
+    mVisiblePos.clear();
+    mVisibleSizeMirror.clear();
+    for (uint32_t index : mVisibleIndices) {
+        mVisiblePos.push_back(treePos[index*3]);
+        mVisiblePos.push_back(treePos[index*3+1]);
+        mVisiblePos.push_back(treePos[index*3+2]);
+        mVisibleSizeMirror.push_back(mSizeMirror[index*2]);
+        mVisibleSizeMirror.push_back(mSizeMirror[index*2+1]);
+    }
+    mVisibleCount = mVisibleIndices.size();
+    if (mVisibleCount == 0) {
+        return;
     }
 
-    this->treePos = combinedVector;
+    // Orphan the old storage, then write only the visible trees
+    g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mVBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, treePos.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, mVisiblePos.size() * sizeof(float), mVisiblePos.data());
+    g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mVBO[1]);
+    glBufferData(GL_ARRAY_BUFFER, mSizeMirror.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, mVisibleSizeMirror.size() * sizeof(float), mVisibleSizeMirror.data());
 }
 
 void BillboardList::Initialize(){
@@ -44,11 +117,36 @@ void BillboardList::Initialize(){
 }
 
 void BillboardList::CreateGraphicsPipeline(){
-    std::string vertexShaderSource      = LoadShaderAsString("./shaders/billboard_vert.glsl");
-    std::string geometryShaderSource    = LoadShaderAsString("./shaders/billboard_geom.glsl");
-    std::string fragmentShaderSource    = LoadShaderAsString("./shaders/billboard_frag.glsl");
-
-    mShaderID = Create3ShaderProgram(vertexShaderSource,geometryShaderSource, fragmentShaderSource);
+    // All trees share one program, owned by g.gShaderCache
+    mShaderID = g.gShaderCache.GetProgram("./shaders/billboard_vert.glsl",
+                                          "./shaders/billboard_geom.glsl",
+                                          "./shaders/billboard_frag.glsl");
+    // After the depth pre-pass the discarded fragments already failed the depth test
+    mNoDiscardShaderID = g.gShaderCache.GetProgram("./shaders/billboard_vert.glsl",
+                                                   "./shaders/billboard_geom.glsl",
+                                                   "./shaders/billboard_frag.glsl", SHADER_NO_DISCARD);
+    // The pre-pass discards the same texels and skips the head light
+    mDepthShaderID = g.gShaderCache.GetProgram("./shaders/billboard_vert.glsl",
+                                               "./shaders/billboard_geom.glsl",
+                                               "./shaders/billboard_frag.glsl", SHADER_DEPTH_ONLY);
+    // Same trees without the geometry shader stage
+    mQuadShaderID = g.gShaderCache.GetProgram("./shaders/billboard_quad_vert.glsl", "./shaders/billboard_frag.glsl");
+    mQuadNoDiscardShaderID = g.gShaderCache.GetProgram("./shaders/billboard_quad_vert.glsl",
+                                                       "./shaders/billboard_frag.glsl", SHADER_NO_DISCARD);
+    mQuadDepthShaderID = g.gShaderCache.GetProgram("./shaders/billboard_quad_vert.glsl",
+                                                   "./shaders/billboard_frag.glsl", SHADER_DEPTH_ONLY);
+
+    // The tree texture is always in slot 0
+    for (GLuint program : {mShaderID, mNoDiscardShaderID, mDepthShaderID, mQuadShaderID, mQuadNoDiscardShaderID, mQuadDepthShaderID}) {
+        glUseProgram(program);
+        GLint u_diffuseTextureLocation = glGetUniformLocation(program, "textureSampler");
+        if(u_diffuseTextureLocation>=0){
+            glUniform1i(u_diffuseTextureLocation,0);
+        }else{
+            std::cout << "Could not find textureSampler" << std::endl;
+        }
+    }
+    glUseProgram(0);
 }
 
 void BillboardList::VertexSpecification(){
@@ -63,118 +161,58 @@ void BillboardList::VertexSpecification(){
     // Populate our vertex buffer objects
     // Position information (x,y,z)
     glBindBuffer(GL_ARRAY_BUFFER, mVBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, treePos.size() * sizeof(float), treePos.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, treePos.size() * sizeof(float), treePos.data(), GL_STREAM_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    //glEnableVertexAttribArray(0);
     glVertexAttribDivisor(0, 1);
-    
+
+    // Size and mirroring
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO[1]);
+    glBufferData(GL_ARRAY_BUFFER, mSizeMirror.size() * sizeof(float), mSizeMirror.data(), GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glVertexAttribDivisor(1, 1);
+
     // Unbind our currently bound Vertex Array Object
     glBindVertexArray(0);
     // Disable any attributes we opened in our Vertex Attribute Arrray,
     // as we do not want to leave them open.
     glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
 }
 
-void BillboardList::PreDraw(){
-    // Use our shader
-    glBindVertexArray(mVAO);
-    glUseProgram(mShaderID);
-    
-    // Update the View Matrix
-    GLint u_ViewMatrixLocation = glGetUniformLocation(mShaderID,"u_ViewMatrix");
-    if(u_ViewMatrixLocation>=0){
-        glm::mat4 viewMatrix = g.gCamera.GetViewMatrix();
-        glUniformMatrix4fv(u_ViewMatrixLocation,1,GL_FALSE,&viewMatrix[0][0]);
-    }else{
-        std::cout << "Could not find u_ViewMatrix, maybe a mispelling?\n";
-    }
-
-    // Projection matrix (in perspective) 
-    glm::mat4 perspective = glm::perspective(glm::radians(45.0f),
-                                             (float)g.gScreenWidth/(float)g.gScreenHeight,
-                                             0.1f,
-                                             20.0f);
-
-    // Retrieve our location of our perspective matrix uniform 
-    GLint u_ProjectionLocation= glGetUniformLocation( mShaderID,"u_Projection");
-    if(u_ProjectionLocation>=0){
-        glUniformMatrix4fv(u_ProjectionLocation,1,GL_FALSE,&perspective[0][0]);
-    }else{
-        std::cout << "Could not find u_Perspective, maybe a mispelling?\n";
-    }
-
-    // Setup view direction
-    GLint viewDirectionLocation = glGetUniformLocation(mShaderID, "u_ViewDirection");
-    if(viewDirectionLocation >=0){
-        glUniform3fv(viewDirectionLocation, 1, &g.gCamera.GetViewDirection()[0]);
-    }else{
-        std::cout << "Could not find u_ViewDirection" << std::endl;
-    }
-
-    // Setup eye position
-    GLint eyePositionLocation = glGetUniformLocation(mShaderID, "u_EyePosition");
-    if(eyePositionLocation >=0){
-        glUniform3fv(eyePositionLocation, 1, &g.gCamera.GetEyePosition()[0]);
-    }else{
-        std::cout << "Could not find u_EyePosition in " << mShaderID << std::endl;
-    }
-
-    // Setup head light scope
-    GLint headLightScopeLocation = glGetUniformLocation(mShaderID, "u_HeadLightScope");
-    if(headLightScopeLocation >=0){
-        glUniform1f(headLightScopeLocation, g.gCamera.GetHeadLightScope());
-    }else{
-        std::cout << "Could not find u_headLightScope" << std::endl;
-    }
-
-    // Setup head light on
-    GLint headLightOnLocation = glGetUniformLocation(mShaderID, "u_HeadLightOn");
-    if(headLightOnLocation >=0){
-        glUniform1i(headLightOnLocation, g.gCamera.GetIfLightOn());
-    }else{
-        std::cout << "Could not find u_headLightOn" << std::endl;
-    }
-
-
-    // Setup head light Strength
-    GLint headLightStrengthLocation = glGetUniformLocation(mShaderID, "u_HeadLightStrength");
-    if(headLightStrengthLocation >=0){
-        glUniform1f(headLightStrengthLocation, g.gCamera.GetLightStrength());
-    }else{
-        std::cout << "Could not find u_headLightStrength" << std::endl;
-    }
-
-
-    // Setup head light color
-    GLint headLightColLocation = glGetUniformLocation(mShaderID, "u_HeadLightCol");
-    if(headLightColLocation >=0){
-        glUniform3fv(headLightColLocation, 1, &g.gCamera.GetHeadLightCol()[0]);
-    }else{
-        std::cout << "Could not find u_headLightCol" << std::endl;
-    }
-    
-    mTexture->Bind(0);
-    std::string uniformName = "textureSampler";
-    GLint u_diffuseTextureLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if(u_diffuseTextureLocation>=0){
-        // Setup the slot for the texture
-        glUniform1i(u_diffuseTextureLocation,0);
-    }else{
-        std::cout << "Could not find " << uniformName << std::endl;
-    }
-}
-
-
-
 /**
-* Draw object
+* Submit a draw packet for all trees of this list,
+* view, projection and head light come from the FrameBlock
 *
 * @return void
 */
-void BillboardList::Draw(){
-    // Render data
-    glBindVertexArray(mVAO);
-    glDrawArraysInstanced(GL_POINTS, 0, 1, treePos.size()/3); // every Instance 4 points
-}
+void BillboardList::Submit(RenderQueue& queue){
+    // Every tree was culled
+    if (mVisibleCount == 0) {
+        return;
+    }
 
+    DrawPacket packet;
+    packet.vao = mVAO;
+    packet.textures[0] = mTexture->GetID();
+    packet.depthNeedsTextures = true;
+    packet.instanceCount = mVisibleCount;
+    if (g.gTreesInGeometryShader) {
+        packet.program = g.gDepthPrePass ? mNoDiscardShaderID : mShaderID;
+        // The pre-pass discards the same fragments as the regular program
+        packet.depthProgram = mDepthShaderID;
+        // every instance is one point, expanded to a quad by the geometry shader
+        packet.mode = GL_POINTS;
+        packet.count = 1;
+    } else {
+        packet.program = g.gDepthPrePass ? mQuadNoDiscardShaderID : mQuadShaderID;
+        packet.depthProgram = mQuadDepthShaderID;
+        // every instance is the 4 corners of its quad, picked by gl_VertexID
+        packet.mode = GL_TRIANGLE_STRIP;
+        packet.count = 4;
+    }
+
+    // Trees are spread over the whole map
+    queue.Submit(packet, PASS_ALPHA_TESTED, glm::vec3(0.0f));
+}
@@ -1,4 +1,5 @@
 #include "Camera.hpp"
+#include "globals.hpp"
 
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/rotate_vector.hpp"
@@ -76,9 +77,10 @@ void Camera::MoveRight(float speed){
 
 void Camera::WalkCycle(float speed) {
     // Frequency and amplitude for the walking effect (move up and down)
-    float verticalOffset = m_walkCycleMaxHeight * sin(SDL_GetTicks() * speed * 0.35f); 
-    // Adjust the initial height and add the vertical offset
-    m_eyePosition.y = m_cameraYCoord + verticalOffset; 
+    float verticalOffset = m_walkCycleMaxHeight * sin(Now() * speed * 0.35f); 
+    // Adjust the initial height above the ground and add the vertical offset
+    float ground = g.gHeightfield.HeightAt(glm::vec2(m_eyePosition.x, m_eyePosition.z));
+    m_eyePosition.y = ground + m_cameraYCoord + verticalOffset; 
 }
 
 glm::vec3 Camera::CheckForward(float speed){
@@ -118,6 +120,25 @@ void Camera::SetCameraEyePosition(float x, float y, float z){
     m_eyePosition.x = x;
     m_eyePosition.y = y;
     m_eyePosition.z = z;
+    // A jump, not a move: nothing to interpolate from
+    m_previousEyePosition = m_eyePosition;
+    m_renderEyePosition = m_eyePosition;
+}
+
+void Camera::BeginStep(){
+    m_previousEyePosition = m_eyePosition;
+}
+
+void Camera::AdvanceTime(double seconds){
+    m_simulationTime += seconds;
+}
+
+void Camera::Interpolate(float alpha){
+    m_renderEyePosition = glm::mix(m_previousEyePosition, m_eyePosition, alpha);
+}
+
+Uint32 Camera::Now() const{
+    return (Uint32)(m_simulationTime * 1000.0);
 }
 
 // Set the view direction
@@ -159,6 +180,10 @@ glm::vec3 Camera::GetEyePosition() {
     return m_eyePosition;
 }
 
+glm::vec3 Camera::GetRenderEyePosition() const{
+    return m_renderEyePosition;
+}
+
 glm::vec3 Camera::GetEyeInitialPosition() {
     return m_eyeInitialPosition;
 }
@@ -173,20 +198,20 @@ glm::vec3 Camera::GetHeadLightCol() {
 
 void Camera::CheckBattery(){
     if(HeadLightOn == 1){
-        if(SDL_GetTicks() < ShutDownTime){
-            BatteryTime = (int)(ShutDownTime - SDL_GetTicks())/1000;
+        if(Now() < ShutDownTime){
+            BatteryTime = (int)(ShutDownTime - Now())/1000;
         }
-        if(SDL_GetTicks() > ShutDownTime){
+        if(Now() > ShutDownTime){
             SwitchLight();
             std::cout << "Out of battery!" << std::endl;
         }
-        else if(ShutDownTime - SDL_GetTicks() < 15000 && SDL_GetTicks() > RecoverTime ){
-            int rd = rand() % 100;
+        else if(ShutDownTime - Now() < 15000 && Now() > RecoverTime ){
+            int rd = g.gRandom.Int(RANDOM_HEAD_LIGHT, 0, 99);
             if(rd > 60){ 
                 SwitchLight();
             }
         }
-        else if(ShutDownTime - SDL_GetTicks() > 15000){
+        else if(ShutDownTime - Now() > 15000){
             LightStrength = 1.0f;
         }
     }
@@ -194,10 +219,10 @@ void Camera::CheckBattery(){
         if(BatteryTime < 15){
             int min = 200;
             int max = 1200;
-            int randomNumber = min + rand() % (max - min + 1);
+            int randomNumber = g.gRandom.Int(RANDOM_HEAD_LIGHT, min, max);
             LightStrength = BatteryTime / 15.0f;
             // std::cout << "Flashlight Strength: " << LightStrength << std::endl;
-            RecoverTime = SDL_GetTicks() + randomNumber; // current to recovertime light is on.
+            RecoverTime = Now() + randomNumber; // current to recovertime light is on.
             SwitchLight();
         }
         else{
@@ -207,14 +232,14 @@ void Camera::CheckBattery(){
             CountdownNum = 10;
         }
     }
-    if(SDL_GetTicks() > ShutDownTime){
-        int nowNum = (int)(ShutDownTime + 11000 - SDL_GetTicks()) /1000;
+    if(Now() > ShutDownTime){
+        int nowNum = (int)(ShutDownTime + 11000 - Now()) /1000;
         if(CountdownNum > nowNum) { 
             CountdownNum = nowNum;
             std::cout << "count down: " << CountdownNum<< std::endl;
         }
     }
-    if(SDL_GetTicks() > ShutDownTime + 10000){
+    if(Now() > ShutDownTime + 10000){
         std::cout << "==========Game Over===========" << std::endl;
         GameOver = true;
     }
@@ -222,13 +247,13 @@ void Camera::CheckBattery(){
 
 void Camera::SwitchLight(){
     if(HeadLightOn == 1){
-        BatteryTime = (ShutDownTime - SDL_GetTicks()) / 1000; // ms to s
+        BatteryTime = (ShutDownTime - Now()) / 1000; // ms to s
         HeadLightOn = 0;
         // std::cout << "turn off" << std::endl;
     }
 
     else if(HeadLightOn == 0 && BatteryTime > 0){
-        ShutDownTime = SDL_GetTicks()+BatteryTime * 1000; // s to ms
+        ShutDownTime = Now()+BatteryTime * 1000; // s to ms
         HeadLightOn = 1;
         // std::cout << "turn on" << std::endl;
     }
@@ -249,7 +274,7 @@ void Camera::CollectBattery(){
     }
     else {
         BatteryTime = 30;
-        ShutDownTime = SDL_GetTicks() + 30 * 1000;
+        ShutDownTime = Now() + 30 * 1000;
     }
 }
 
@@ -270,6 +295,8 @@ Camera::Camera(){
 	// Position us at the origin.
     m_eyePosition = glm::vec3(0.0f, m_cameraYCoord, 0.0f);
     m_eyeInitialPosition = m_eyePosition;
+    m_previousEyePosition = m_eyePosition;
+    m_renderEyePosition = m_eyePosition;
 	// Looking down along the z-axis initially.
 	// Remember, this is negative because we are looking 'into' the scene.
     m_viewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -280,7 +307,7 @@ Camera::Camera(){
     //m_headLight = Light(m_eyePosition, headLightCol, m_viewDirection, 0.8f, 0.0f);
     HeadLightOn = 1;
     BatteryTime = 70;
-    ShutDownTime = SDL_GetTicks() + BatteryTime * 1000; // battery time is 70s.
+    ShutDownTime = Now() + BatteryTime * 1000; // battery time is 70s.
     RecoverTime = 0;
     LightStrength = 1.0f;
 
@@ -289,7 +316,18 @@ Camera::Camera(){
 glm::mat4 Camera::GetViewMatrix() const{
     // Think about the second argument and why that is
     // setup as it is.
-    return glm::lookAt( m_eyePosition,
-                        m_eyePosition + m_viewDirection,
+    return glm::lookAt( m_renderEyePosition,
+                        m_renderEyePosition + m_viewDirection,
                         m_upVector);
 }
+
+void Camera::SetProjection(float fovy, float aspect, float nearPlane, float farPlane){
+    m_fovy = fovy;
+    m_aspect = aspect;
+    m_near = nearPlane;
+    m_far = farPlane;
+}
+
+glm::mat4 Camera::GetProjectionMatrix() const{
+    return glm::perspective(m_fovy, m_aspect, m_near, m_far);
+}
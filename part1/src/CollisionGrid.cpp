@@ -0,0 +1,138 @@
+#include "CollisionGrid.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Average footprints per cell the grid is sized for
+static const float kFootprintsPerCell = 2.0f;
+// Cells are never smaller than this, nor more than kMaxCellsPerSide per side
+static const float kMinCellSize = 0.05f;
+static const int kMaxCellsPerSide = 1024;
+
+void CollisionGrid::AddBox(const OrientedBox2D& box, float margin, int32_t owner){
+    OrientedBox2D footprint = box;
+    footprint.halfExtents += margin;
+    mFootprints.push_back(footprint);
+    mOwners.push_back(owner);
+}
+
+void CollisionGrid::AddSquare(const glm::vec2& center, float halfSize){
+    OrientedBox2D footprint;
+    footprint.center = center;
+    footprint.halfExtents = glm::vec2(halfSize);
+    mFootprints.push_back(footprint);
+    mOwners.push_back(-1);
+}
+
+/**
+* Size the cells from the footprint count, then count, offset and fill the
+* footprints of each cell in three passes
+*
+* @return void
+*/
+void CollisionGrid::Build(float minValue, float maxValue){
+    float size = maxValue - minValue;
+    float cellSize = std::sqrt(size * size * kFootprintsPerCell / std::max<size_t>(mFootprints.size(), 1));
+    cellSize = std::max(cellSize, std::max(kMinCellSize, size / kMaxCellsPerSide));
+    mCellsPerSide = std::max(1, (int)std::ceil(size / cellSize));
+    mCellSize = size / mCellsPerSide;
+    mMinValue = minValue;
+
+    // Cell ranges of each footprint, clamped to the grid
+    std::vector<glm::ivec4> ranges(mFootprints.size());
+    for (size_t i = 0; i < mFootprints.size(); ++i) {
+        glm::vec2 boundsMin, boundsMax;
+        mFootprints[i].Bounds(0.0f, boundsMin, boundsMax);
+        glm::vec2 cellMin = glm::floor((boundsMin - minValue) / mCellSize);
+        glm::vec2 cellMax = glm::floor((boundsMax - minValue) / mCellSize);
+        ranges[i] = glm::clamp(glm::ivec4(cellMin.x, cellMin.y, cellMax.x, cellMax.y), 0, mCellsPerSide - 1);
+    }
+
+    size_t cellCount = (size_t)mCellsPerSide * mCellsPerSide;
+    mCellStart.assign(cellCount + 1, 0);
+    for (const glm::ivec4& range : ranges) {
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mCellStart[z * mCellsPerSide + x + 1]++;
+            }
+        }
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+    mCellItems.resize(mCellStart[cellCount]);
+    std::vector<uint32_t> cursor(mCellStart.begin(), mCellStart.end() - 1);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const glm::ivec4& range = ranges[i];
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mCellItems[cursor[z * mCellsPerSide + x]++] = (uint32_t)i;
+            }
+        }
+    }
+}
+
+int CollisionGrid::CellIndex(const glm::vec2& point) const{
+    int x = (int)std::floor((point.x - mMinValue) / mCellSize);
+    int z = (int)std::floor((point.y - mMinValue) / mCellSize);
+    if (x < 0 || z < 0 || x >= mCellsPerSide || z >= mCellsPerSide) {
+        return -1;
+    }
+    return z * mCellsPerSide + x;
+}
+
+/**
+* Test the footprints of the cell of point
+*
+* @return bool
+*/
+bool CollisionGrid::Collides(const glm::vec2& point) const{
+    int cell = CellIndex(point);
+    if (cell < 0) {
+        return false;
+    }
+    for (uint32_t i = mCellStart[cell]; i < mCellStart[cell + 1]; ++i) {
+        if (mFootprints[mCellItems[i]].Contains(point, 0.0f)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CollisionGrid::Collides(const glm::vec2& point, std::vector<int32_t>& owners) const{
+    int cell = CellIndex(point);
+    if (cell < 0) {
+        return false;
+    }
+    for (uint32_t i = mCellStart[cell]; i < mCellStart[cell + 1]; ++i) {
+        uint32_t footprint = mCellItems[i];
+        if (!mFootprints[footprint].Contains(point, 0.0f)) {
+            continue;
+        }
+        if (mOwners[footprint] < 0) {
+            return true;
+        }
+        owners.push_back(mOwners[footprint]);
+    }
+    return false;
+}
+
+size_t CollisionGrid::CandidatesAt(const glm::vec2& point) const{
+    int cell = CellIndex(point);
+    return cell < 0 ? 0 : mCellStart[cell + 1] - mCellStart[cell];
+}
+
+size_t CollisionGrid::GetMemoryBytes() const{
+    return mFootprints.capacity() * sizeof(OrientedBox2D) + mOwners.capacity() * sizeof(int32_t)
+         + (mCellStart.capacity() + mCellItems.capacity()) * sizeof(uint32_t);
+}
+
+void CollisionGrid::Clear(){
+    mFootprints.clear();
+    mOwners.clear();
+    mCellStart.clear();
+    mCellItems.clear();
+    mCellsPerSide = 0;
+}
@@ -0,0 +1,32 @@
+#include "FixedTimestep.hpp"
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+void FixedTimestep::Start(double stepSeconds){
+    mStepSeconds = stepSeconds;
+    mAccumulator = 0.0;
+    mFrameSeconds = 0.0;
+    mLastTime = Now();
+}
+
+int FixedTimestep::Advance(){
+    double now = Now();
+    mFrameSeconds = now - mLastTime;
+    mLastTime = now;
+    mAccumulator += std::min(mFrameSeconds, kMaxFrameSeconds);
+    int steps = (int)std::floor(mAccumulator / mStepSeconds);
+    mAccumulator -= steps * mStepSeconds;
+    return steps;
+}
+
+double FixedTimestep::Now(){
+    static const double kSecondsPerCount = 1.0 / (double)SDL_GetPerformanceFrequency();
+    return (double)SDL_GetPerformanceCounter() * kSecondsPerCount;
+}
@@ -0,0 +1,72 @@
+#include "FramePacer.hpp"
+#include "FixedTimestep.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Sleeps shorter than this are spun, SDL_Delay may oversleep by a millisecond
+static const double kSpinSeconds = 0.002;
+
+FramePacer::~FramePacer(){
+    if (mFence != nullptr) {
+        glDeleteSync(mFence);
+    }
+}
+
+int FramePacer::SetSwapInterval(int interval){
+    if (SDL_GL_SetSwapInterval(interval) == 0) {
+        return interval;
+    }
+    if (interval == -1) {
+        std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+        return SetSwapInterval(1);
+    }
+    std::cout << "Swap interval could not be set: " << SDL_GetError() << std::endl;
+    return SDL_GL_GetSwapInterval();
+}
+
+/**
+* The fence is waited for first so that the cap and the delay count from the
+* moment the previous frame went out, not from when it was submitted
+*
+* @return void
+*/
+void FramePacer::WaitForFrame(float maxFrameRate, float delayMs){
+    double start = FixedTimestep::Now();
+    if (mFence != nullptr) {
+        // Flush in case the swap did not, else the fence may never be reached
+        GLenum result = glClientWaitSync(mFence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            mLatencyMs = (float)((FixedTimestep::Now() - mInputTime) * 1000.0);
+        }
+        glDeleteSync(mFence);
+        mFence = nullptr;
+    }
+
+    double deadline = FixedTimestep::Now();
+    if (maxFrameRate > 0.0f) {
+        deadline = std::max(deadline, mFrameStart + 1.0 / maxFrameRate);
+    }
+    deadline += delayMs / 1000.0;
+    double now = FixedTimestep::Now();
+    if (deadline - now > kSpinSeconds) {
+        SDL_Delay((Uint32)((deadline - now - kSpinSeconds) * 1000.0));
+    }
+    while (FixedTimestep::Now() < deadline) {
+    }
+
+    mFrameStart = FixedTimestep::Now();
+    mWaitMs = (float)((mFrameStart - start) * 1000.0);
+}
+
+void FramePacer::MarkInput(){
+    mInputTime = FixedTimestep::Now();
+}
+
+void FramePacer::Present(SDL_Window* window){
+    SDL_GL_SwapWindow(window);
+    if (mFence != nullptr) {
+        glDeleteSync(mFence);
+    }
+    mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,61 @@
+#include "FrameStats.hpp"
+
+#include <iostream>
+
+void FrameStats::Reset(){
+    *this = FrameStats();
+}
+
+void FrameStats::Print() const{
+    std::cout << "[stats] frame: " << frameMs << " ms"
+              << " | simulation steps: " << simulationSteps
+              << " | wait: " << frameWaitMs << " ms"
+              << " | input to present: " << latencyMs << " ms" << std::endl;
+    // Without sorting and bind elision every packet would switch program,
+    // VAO and material, and bind each of its textures
+    std::cout << "[stats] packets: " << packets
+              << " | program switches: " << programSwitches << "/" << packets
+              << " | VAO switches: " << vaoSwitches << "/" << packets
+              << " | material switches: " << materialSwitches << "/" << packets
+              << " | texture binds: " << textureSwitches << "/" << textureRequests
+              << " | state calls issued: " << stateCallsIssued << ", elided: " << stateCallsElided << std::endl;
+    std::cout << "[stats] visible/culled/unlit/occluded objects: "
+              << objects.visible << "/" << objects.culled << "/" << objects.unlit << "/" << objects.occluded
+              << " | batteries: " << batteries.visible << "/" << batteries.culled << "/" << batteries.unlit << "/" << batteries.occluded
+              << " | trees: " << trees.visible << "/" << trees.culled << "/" << trees.unlit << "/" << trees.occluded
+              << " | grass: " << grass.visible << "/" << grass.culled << "/" << grass.unlit << "/" << grass.occluded
+              << " | impostors: " << impostors
+              << " | lit screen: " << (int)(litScreenFraction * 100.0f) << "%" << std::endl;
+    std::cout << "[stats] depth pre-pass: " << (depthPrePass ? "on" : "off")
+              << " | pre-pass packets: " << depthPackets
+              << " | GPU pre-pass: " << gpuDepthMs << " ms"
+              << " | GPU shading: " << gpuShadeMs << " ms"
+              << " | GPU total: " << (depthPrePass ? gpuDepthMs : 0.0f) + gpuShadeMs << " ms" << std::endl;
+    std::cout << "[stats] occlusion queries: " << occlusionQueries
+              << " | results: " << occlusionResults
+              << " | occluded: " << occludedObjects
+              << " | conditional draws: " << conditionalDraws
+              << " | software occluder triangles: " << occluderTriangles
+              << ", wait: " << occlusionRasterMs << " ms" << std::endl;
+    std::cout << "[stats] multi-draw indirect: " << (multiDrawIndirect ? "on" : "off")
+              << " | draw calls: " << indirectDraws
+              << " | commands: " << indirectCommands
+              << " | instances: " << indirectInstances
+              << " | tree quads: " << (treesInGeometryShader ? "geometry shader" : "vertex shader") << std::endl;
+    std::cout << "[stats] grass blades drawn/tested/total: " << grassBladesDrawn << "/" << grassBladesTested << "/" << grassBlades
+              << " | chunks visible/culled/unlit/occluded: "
+              << grassChunks.visible << "/" << grassChunks.culled << "/" << grassChunks.unlit << "/" << grassChunks.occluded
+              << " | draw calls: " << grassDraws << std::endl;
+    std::cout << "[stats] head light rays blocked: " << headLightRaysBlocked << "/" << headLightRays
+              << " | sight: " << headLightSight
+              << " | query: " << headLightQueryUs << " us" << std::endl;
+    if (streamedChunks > 0) {
+        std::cout << "[stats] streamed chunks: " << streamedChunks << " (" << streamPending << " pending)"
+                  << " | memory: " << streamedMB << " MB"
+                  << " | upload: " << streamUploadMs << " ms" << std::endl;
+    }
+    if (terrainPatches > 0) {
+        std::cout << "[stats] terrain patches: " << terrainPatches
+                  << " | selection: " << terrainSelectUs << " us" << std::endl;
+    }
+}
@@ -0,0 +1,184 @@
+#include "Frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+    #define FRUSTUM_SSE
+    #include <xmmintrin.h>
+#endif
+
+void SphereList::Add(const glm::vec3& center, float r){
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(r);
+}
+
+void SphereList::Clear(){
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+void BoxList::Add(const glm::vec3& center, const glm::vec3& extents){
+    cx.push_back(center.x);
+    cy.push_back(center.y);
+    cz.push_back(center.z);
+    ex.push_back(extents.x);
+    ey.push_back(extents.y);
+    ez.push_back(extents.z);
+}
+
+void BoxList::Clear(){
+    cx.clear();
+    cy.clear();
+    cz.clear();
+    ex.clear();
+    ey.clear();
+    ez.clear();
+}
+
+/**
+* Gribb/Hartmann plane extraction, each plane is a row of the
+* matrix added to or subtracted from the w row.
+*
+* @return void
+*/
+void Frustum::Extract(const glm::mat4& viewProjection){
+    // glm is column major, m[column][row]
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    mPlanes[0] = row3 + row0;   // left
+    mPlanes[1] = row3 - row0;   // right
+    mPlanes[2] = row3 + row1;   // bottom
+    mPlanes[3] = row3 - row1;   // top
+    mPlanes[4] = row3 + row2;   // near
+    mPlanes[5] = row3 - row2;   // far
+
+    // Normalize so that plane distances are in world units
+    for (int i = 0; i < 6; ++i) {
+        float length = glm::length(glm::vec3(mPlanes[i]));
+        mPlanes[i] /= length;
+    }
+}
+
+bool Frustum::ContainsSphere(const glm::vec3& center, float radius) const{
+    for (int i = 0; i < 6; ++i) {
+        if (glm::dot(glm::vec3(mPlanes[i]), center) + mPlanes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::ContainsBox(const glm::vec3& center, const glm::vec3& extents) const{
+    for (int i = 0; i < 6; ++i) {
+        glm::vec3 normal(mPlanes[i]);
+        // Distance of the box corner furthest along the plane normal
+        float distance = glm::dot(normal, center) + glm::dot(glm::abs(normal), extents) + mPlanes[i].w;
+        if (distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Frustum::CullSpheres(const SphereList& spheres, std::vector<uint32_t>& visible) const{
+    size_t count = spheres.Size();
+    size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+    // Four spheres per iteration, a lane survives while it is in front of every plane
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+        int mask = 0xF;
+        for (int p = 0; p < 6 && mask != 0; ++p) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(mPlanes[p].x)), _mm_mul_ps(y, _mm_set1_ps(mPlanes[p].y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(mPlanes[p].z)), _mm_set1_ps(mPlanes[p].w)));
+            mask &= _mm_movemask_ps(_mm_cmpge_ps(distance, negRadius));
+        }
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                visible.push_back((uint32_t)(i + lane));
+            }
+        }
+    }
+#endif
+
+    // Remainder, or every sphere without SSE
+    for (; i < count; ++i) {
+        if (ContainsSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i])) {
+            visible.push_back((uint32_t)i);
+        }
+    }
+}
+
+void Frustum::CullBoxes(const BoxList& boxes, std::vector<uint32_t>& visible) const{
+    size_t count = boxes.Size();
+    size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.cx[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.cy[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.cz[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.ex[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.ey[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.ez[i]);
+
+        int mask = 0xF;
+        for (int p = 0; p < 6 && mask != 0; ++p) {
+            __m128 center = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(mPlanes[p].x)), _mm_mul_ps(cy, _mm_set1_ps(mPlanes[p].y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(mPlanes[p].z)), _mm_set1_ps(mPlanes[p].w)));
+            __m128 reach = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(mPlanes[p].x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(mPlanes[p].y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(std::fabs(mPlanes[p].z))));
+            mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(center, reach), _mm_setzero_ps()));
+        }
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                visible.push_back((uint32_t)(i + lane));
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (ContainsBox(glm::vec3(boxes.cx[i], boxes.cy[i], boxes.cz[i]),
+                        glm::vec3(boxes.ex[i], boxes.ey[i], boxes.ez[i]))) {
+            visible.push_back((uint32_t)i);
+        }
+    }
+}
+
+/**
+* Arvo's method, the extents of the transformed box are the
+* local extents multiplied by the absolute rotation matrix.
+*
+* @return void
+*/
+void TransformBox(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model,
+                  glm::vec3& center, glm::vec3& extents){
+    glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+    glm::vec3 localExtents = (localMax - localMin) * 0.5f;
+
+    center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+    glm::mat3 rotation(model);
+    extents = glm::vec3(0.0f);
+    for (int column = 0; column < 3; ++column) {
+        extents += glm::abs(rotation[column]) * localExtents[column];
+    }
+}
@@ -0,0 +1,46 @@
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include "GLExtensions.hpp"
+
+#include <glad/glad.h>
+
+PFNGLMULTIDRAWARRAYSINDIRECTPROC glMultiDrawArraysIndirectPtr = nullptr;
+PFNGLGENTRANSFORMFEEDBACKSPROC glGenTransformFeedbacksPtr = nullptr;
+PFNGLDELETETRANSFORMFEEDBACKSPROC glDeleteTransformFeedbacksPtr = nullptr;
+PFNGLBINDTRANSFORMFEEDBACKPROC glBindTransformFeedbackPtr = nullptr;
+PFNGLDRAWTRANSFORMFEEDBACKPROC glDrawTransformFeedbackPtr = nullptr;
+
+void LoadGLExtensions(){
+    glMultiDrawArraysIndirectPtr = nullptr;
+    glGenTransformFeedbacksPtr = nullptr;
+    glDeleteTransformFeedbacksPtr = nullptr;
+    glBindTransformFeedbackPtr = nullptr;
+    glDrawTransformFeedbackPtr = nullptr;
+    // Drivers may return a stub for functions of versions they do not provide
+    if (HasGLVersion(4, 3)) {
+        glMultiDrawArraysIndirectPtr = (PFNGLMULTIDRAWARRAYSINDIRECTPROC)SDL_GL_GetProcAddress("glMultiDrawArraysIndirect");
+    }
+    if (HasGLVersion(4, 0)) {
+        glGenTransformFeedbacksPtr = (PFNGLGENTRANSFORMFEEDBACKSPROC)SDL_GL_GetProcAddress("glGenTransformFeedbacks");
+        glDeleteTransformFeedbacksPtr = (PFNGLDELETETRANSFORMFEEDBACKSPROC)SDL_GL_GetProcAddress("glDeleteTransformFeedbacks");
+        glBindTransformFeedbackPtr = (PFNGLBINDTRANSFORMFEEDBACKPROC)SDL_GL_GetProcAddress("glBindTransformFeedback");
+        glDrawTransformFeedbackPtr = (PFNGLDRAWTRANSFORMFEEDBACKPROC)SDL_GL_GetProcAddress("glDrawTransformFeedback");
+    }
+}
+
+bool HasGLVersion(int major, int minor){
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool HasMultiDrawIndirect(){
+    return glMultiDrawArraysIndirectPtr != nullptr;
+}
+
+bool HasTransformFeedbackObjects(){
+    return glGenTransformFeedbacksPtr != nullptr && glDeleteTransformFeedbacksPtr != nullptr
+        && glBindTransformFeedbackPtr != nullptr && glDrawTransformFeedbackPtr != nullptr;
+}
@@ -0,0 +1,248 @@
+#include "GLState.hpp"
+
+#include <glad/glad.h>
+
+GLState::GLState(){
+    Invalidate();
+}
+
+bool GLState::Count(bool issued){
+    if (issued) {
+        mIssued++;
+    } else {
+        mElided++;
+    }
+    return issued;
+}
+
+void GLState::ResetCounters(){
+    mIssued = 0;
+    mElided = 0;
+}
+
+void GLState::Invalidate(){
+    mProgram = kUnknown;
+    mVAO = kUnknown;
+    mActiveUnit = kUnknown;
+    for (int i = 0; i < kMaxTextureUnits; ++i) {
+        mTexture2D[i] = kUnknown;
+        mTexture2DArray[i] = kUnknown;
+    }
+    mArrayBuffer = kUnknown;
+    mIndexedBuffers.clear();
+    mCapabilities.clear();
+    for (int i = 0; i < 4; ++i) {
+        mViewport[i] = -1;
+        mScissor[i] = -1;
+        mClearColor[i] = -1.f;
+    }
+    mPolygonMode = kUnknown;
+    mDepthFunc = kUnknown;
+    mDepthMask = -1;
+    mColorMask = -1;
+}
+
+bool GLState::UseProgram(GLuint program){
+    if (mProgram == program) {
+        return Count(false);
+    }
+    glUseProgram(program);
+    mProgram = program;
+    return Count(true);
+}
+
+bool GLState::BindVertexArray(GLuint vao){
+    if (mVAO == vao) {
+        return Count(false);
+    }
+    glBindVertexArray(vao);
+    mVAO = vao;
+    return Count(true);
+}
+
+bool GLState::BindTexture(unsigned int unit, GLenum target, GLuint texture){
+    GLuint* bound = nullptr;
+    if (unit < (unsigned int)kMaxTextureUnits) {
+        if (target == GL_TEXTURE_2D) {
+            bound = &mTexture2D[unit];
+        } else if (target == GL_TEXTURE_2D_ARRAY) {
+            bound = &mTexture2DArray[unit];
+        }
+    }
+    if (bound != nullptr && *bound == texture) {
+        return Count(false);
+    }
+
+    if (mActiveUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        mActiveUnit = unit;
+        Count(true);
+    }
+    glBindTexture(target, texture);
+    if (bound != nullptr) {
+        *bound = texture;
+    }
+    return Count(true);
+}
+
+bool GLState::BindBuffer(GLenum target, GLuint buffer){
+    GLuint* bound = (target == GL_ARRAY_BUFFER) ? &mArrayBuffer : nullptr;
+    if (bound != nullptr && *bound == buffer) {
+        return Count(false);
+    }
+    glBindBuffer(target, buffer);
+    if (bound != nullptr) {
+        *bound = buffer;
+    }
+    return Count(true);
+}
+
+bool GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer){
+    auto key = std::make_pair(target, index);
+    auto it = mIndexedBuffers.find(key);
+    if (it != mIndexedBuffers.end() && it->second == buffer) {
+        return Count(false);
+    }
+    glBindBufferBase(target, index, buffer);
+    mIndexedBuffers[key] = buffer;
+    return Count(true);
+}
+
+bool GLState::SetEnabled(GLenum cap, bool enabled){
+    auto it = mCapabilities.find(cap);
+    if (it != mCapabilities.end() && it->second == enabled) {
+        return Count(false);
+    }
+    if (enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+    mCapabilities[cap] = enabled;
+    return Count(true);
+}
+
+bool GLState::Enable(GLenum cap){
+    return SetEnabled(cap, true);
+}
+
+bool GLState::Disable(GLenum cap){
+    return SetEnabled(cap, false);
+}
+
+bool GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height){
+    if (mViewport[0] == x && mViewport[1] == y && mViewport[2] == width && mViewport[3] == height) {
+        return Count(false);
+    }
+    glViewport(x, y, width, height);
+    mViewport[0] = x;
+    mViewport[1] = y;
+    mViewport[2] = width;
+    mViewport[3] = height;
+    return Count(true);
+}
+
+bool GLState::Scissor(GLint x, GLint y, GLsizei width, GLsizei height){
+    if (mScissor[0] == x && mScissor[1] == y && mScissor[2] == width && mScissor[3] == height) {
+        return Count(false);
+    }
+    glScissor(x, y, width, height);
+    mScissor[0] = x;
+    mScissor[1] = y;
+    mScissor[2] = width;
+    mScissor[3] = height;
+    return Count(true);
+}
+
+bool GLState::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a){
+    if (mClearColor[0] == r && mClearColor[1] == g && mClearColor[2] == b && mClearColor[3] == a) {
+        return Count(false);
+    }
+    glClearColor(r, g, b, a);
+    mClearColor[0] = r;
+    mClearColor[1] = g;
+    mClearColor[2] = b;
+    mClearColor[3] = a;
+    return Count(true);
+}
+
+bool GLState::PolygonMode(GLenum mode){
+    if (mPolygonMode == mode) {
+        return Count(false);
+    }
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    mPolygonMode = mode;
+    return Count(true);
+}
+
+bool GLState::DepthFunc(GLenum func){
+    if (mDepthFunc == func) {
+        return Count(false);
+    }
+    glDepthFunc(func);
+    mDepthFunc = func;
+    return Count(true);
+}
+
+bool GLState::DepthMask(GLboolean flag){
+    if (mDepthMask == (GLint)flag) {
+        return Count(false);
+    }
+    glDepthMask(flag);
+    mDepthMask = flag;
+    return Count(true);
+}
+
+bool GLState::ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a){
+    GLint mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+    if (mColorMask == mask) {
+        return Count(false);
+    }
+    glColorMask(r, g, b, a);
+    mColorMask = mask;
+    return Count(true);
+}
+
+void GLState::DeleteProgram(GLuint program){
+    if (mProgram == program) {
+        mProgram = kUnknown;
+    }
+    glDeleteProgram(program);
+}
+
+void GLState::DeleteVertexArrays(GLsizei n, const GLuint* vaos){
+    for (GLsizei i = 0; i < n; ++i) {
+        if (mVAO == vaos[i]) {
+            mVAO = kUnknown;
+        }
+    }
+    glDeleteVertexArrays(n, vaos);
+}
+
+void GLState::DeleteTextures(GLsizei n, const GLuint* textures){
+    for (GLsizei i = 0; i < n; ++i) {
+        for (int unit = 0; unit < kMaxTextureUnits; ++unit) {
+            if (mTexture2D[unit] == textures[i]) {
+                mTexture2D[unit] = kUnknown;
+            }
+            if (mTexture2DArray[unit] == textures[i]) {
+                mTexture2DArray[unit] = kUnknown;
+            }
+        }
+    }
+    glDeleteTextures(n, textures);
+}
+
+void GLState::DeleteBuffers(GLsizei n, const GLuint* buffers){
+    for (GLsizei i = 0; i < n; ++i) {
+        if (mArrayBuffer == buffers[i]) {
+            mArrayBuffer = kUnknown;
+        }
+        for (auto& binding : mIndexedBuffers) {
+            if (binding.second == buffers[i]) {
+                binding.second = kUnknown;
+            }
+        }
+    }
+    glDeleteBuffers(n, buffers);
+}
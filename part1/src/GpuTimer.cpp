@@ -0,0 +1,46 @@
+#include "GpuTimer.hpp"
+
+#include <glad/glad.h>
+
+GpuTimer::~GpuTimer(){
+    if (mQueries[0] != 0) {
+        glDeleteQueries(kQueryCount, mQueries);
+    }
+}
+
+void GpuTimer::Initialize(){
+    glGenQueries(kQueryCount, mQueries);
+}
+
+void GpuTimer::Begin(){
+    mRunning = false;
+    if (mQueries[0] == 0) {
+        return;
+    }
+
+    // Collect the oldest range first, its slot is reused now
+    if (mPending[mCurrent]) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(mQueries[mCurrent], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(mQueries[mCurrent], GL_QUERY_RESULT, &elapsed);
+        mLastMs = elapsed / 1.0e6f;
+        mPending[mCurrent] = false;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[mCurrent]);
+    mRunning = true;
+}
+
+void GpuTimer::End(){
+    if (!mRunning) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    mPending[mCurrent] = true;
+    mCurrent = (mCurrent + 1) % kQueryCount;
+    mRunning = false;
+}
@@ -0,0 +1,221 @@
+#include "GrassField.hpp"
+#include "GLExtensions.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// Blade dimensions
+static const float kMinHeight = 0.08f;
+static const float kMaxHeight = 0.22f;
+static const float kMaxBend = 0.4f;
+
+/**
+* Setup the two attributes of Blade for the bound VAO and vbo
+*
+* @return void
+*/
+static void BladeAttributes(GLState& state, GLuint vbo){
+    state.BindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * 2, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * 2, (void*)sizeof(glm::vec4));
+}
+
+GrassField::~GrassField(){
+    for (Chunk& chunk : mChunks) {
+        g.gGLState.DeleteVertexArrays(1, &chunk.vao);
+        g.gGLState.DeleteBuffers(1, &chunk.vbo);
+    }
+    if (mFeedback != 0) {
+        glDeleteTransformFeedbacksPtr(1, &mFeedback);
+        g.gGLState.DeleteVertexArrays(1, &mVisibleVAO);
+        g.gGLState.DeleteBuffers(1, &mVisibleBuffer);
+        glDeleteQueries(1, &mWrittenQuery);
+    }
+}
+
+/**
+* Scatter the blades chunk by chunk, then create the compacted buffer with
+* room for every blade and the transform feedback object capturing into it
+*
+* @return bool
+*/
+bool GrassField::Initialize(float minValue, float maxValue, float bladesPerUnit){
+    if (!HasTransformFeedbackObjects()) {
+        std::cout << "Transform feedback objects are not available, no grass blades" << std::endl;
+        return false;
+    }
+
+    mCullShaderID = g.gShaderCache.GetFeedbackProgram("./shaders/grass_cull_vert.glsl", "./shaders/grass_cull_geom.glsl",
+                                                      {"out_PositionHeight", "out_Shape"});
+    mShaderID = g.gShaderCache.GetProgram("./shaders/grass_blade_vert.glsl", "./shaders/grass_blade_geom.glsl",
+                                          "./shaders/grass_blade_frag.glsl");
+    mDepthShaderID = g.gShaderCache.GetProgram("./shaders/grass_blade_vert.glsl", "./shaders/grass_blade_geom.glsl",
+                                               "./shaders/depth_frag.glsl");
+    mMaxDistanceLocation = glGetUniformLocation(mCullShaderID, "u_MaxDistance");
+    mDensityNearLocation = glGetUniformLocation(mCullShaderID, "u_DensityNear");
+    mMinDensityLocation = glGetUniformLocation(mCullShaderID, "u_MinDensity");
+    mBladeWidthLocation = glGetUniformLocation(mCullShaderID, "u_BladeWidth");
+
+    float chunkSize = (maxValue - minValue) / kChunksPerSide;
+    GLsizei bladesPerChunk = (GLsizei)(bladesPerUnit * chunkSize * chunkSize);
+    std::mt19937& gen = g.gRandom.Stream(RANDOM_GRASS_BLADES);
+
+    std::vector<Blade> blades(bladesPerChunk);
+    mChunks.resize(kChunksPerSide * kChunksPerSide);
+    for (int j = 0; j < kChunksPerSide; ++j) {
+        for (int i = 0; i < kChunksPerSide; ++i) {
+            glm::vec2 corner(minValue + i * chunkSize, minValue + j * chunkSize);
+            // Blades are random, so ranks in storage order are as good as random ranks
+            for (GLsizei b = 0; b < bladesPerChunk; ++b) {
+                float rank = (b + 0.5f) / bladesPerChunk;
+                // One draw per statement, the order of arguments is up to the compiler
+                float x = Random::Uniform(gen, 0.0f, chunkSize);
+                float z = Random::Uniform(gen, 0.0f, chunkSize);
+                float height = Random::Uniform(gen, kMinHeight, kMaxHeight);
+                float angle = Random::Uniform(gen, 0.0f, glm::two_pi<float>());
+                float bend = Random::Uniform(gen, 0.1f, kMaxBend);
+                float shade = Random::Uniform(gen, 0.7f, 1.1f);
+                glm::vec2 base(corner.x + x, corner.y + z);
+                blades[b].positionHeight = glm::vec4(base.x, g.gHeightfield.HeightAt(base), base.y, height);
+                blades[b].shape = glm::vec4(angle, bend, rank, shade);
+            }
+
+            Chunk& chunk = mChunks[j * kChunksPerSide + i];
+            chunk.count = bladesPerChunk;
+            glGenVertexArrays(1, &chunk.vao);
+            g.gGLState.BindVertexArray(chunk.vao);
+            glGenBuffers(1, &chunk.vbo);
+            g.gGLState.BindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+            glBufferData(GL_ARRAY_BUFFER, blades.size() * sizeof(Blade), blades.data(), GL_STATIC_DRAW);
+            BladeAttributes(g.gGLState, chunk.vbo);
+
+            // Bent blades lean out of their chunk by up to kMaxBend * kMaxHeight
+            float halfSize = 0.5f * chunkSize + kMaxBend * kMaxHeight;
+            float lowest, highest;
+            g.gHeightfield.Range(corner, corner + chunkSize, lowest, highest);
+            float halfHeight = 0.5f * (highest - lowest + kMaxHeight);
+            mChunkBounds.Add(glm::vec3(corner.x + 0.5f * chunkSize, lowest + halfHeight, corner.y + 0.5f * chunkSize),
+                             glm::vec3(halfSize, halfHeight, halfSize));
+        }
+    }
+    mBladeCount = mChunks.size() * (size_t)bladesPerChunk;
+
+    // Every blade can be visible at once
+    glGenBuffers(1, &mVisibleBuffer);
+    g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mVisibleBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mBladeCount * sizeof(Blade), nullptr, GL_DYNAMIC_COPY);
+    glGenVertexArrays(1, &mVisibleVAO);
+    g.gGLState.BindVertexArray(mVisibleVAO);
+    BladeAttributes(g.gGLState, mVisibleBuffer);
+    g.gGLState.BindVertexArray(0);
+
+    // The buffer binding belongs to the transform feedback object, so it is set
+    // once here and not through the state cache
+    glGenTransformFeedbacksPtr(1, &mFeedback);
+    glBindTransformFeedbackPtr(GL_TRANSFORM_FEEDBACK, mFeedback);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mVisibleBuffer);
+    glBindTransformFeedbackPtr(GL_TRANSFORM_FEEDBACK, 0);
+
+    glGenQueries(1, &mWrittenQuery);
+
+    std::cout << "Grass: " << mBladeCount << " blades in " << mChunks.size() << " chunks, "
+              << (2 * mBladeCount * sizeof(Blade)) / (1024 * 1024) << " MB" << std::endl;
+    return true;
+}
+
+float GrassField::Density(float distance, float maxDistance) const{
+    float t = glm::clamp((distance - g.gGrassDensityNear) / std::max(maxDistance - g.gGrassDensityNear, 0.001f), 0.0f, 1.0f);
+    return glm::mix(1.0f, g.gGrassMinDensity, t);
+}
+
+/**
+* Cull the chunks, then run the visible ones through grass_cull_geom.glsl with the
+* rasterizer off, capturing the blades it emits into mVisibleBuffer
+*
+* @return void
+*/
+void GrassField::Cull(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders,
+                      const glm::vec3& eyePosition, GLState& state, FrameStats& stats){
+    // Count of an earlier frame, only once the GPU has it
+    if (mQueryPending) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(mWrittenQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            glGetQueryObjectuiv(mWrittenQuery, GL_QUERY_RESULT, &mLastWritten);
+            mQueryPending = false;
+        }
+    }
+    stats.grassBlades = (unsigned int)mBladeCount;
+    stats.grassBladesDrawn = mLastWritten;
+
+    mVisibleChunks.clear();
+    frustum.CullBoxes(mChunkBounds, mVisibleChunks);
+    size_t inFrustum = mVisibleChunks.size();
+    light.FilterBoxes(mChunkBounds, mVisibleChunks);
+    size_t lit = mVisibleChunks.size();
+    if (occluders != nullptr) {
+        occluders->FilterBoxes(mChunkBounds, mVisibleChunks);
+    }
+    stats.grassChunks.Add(mChunkBounds.Size(), inFrustum, lit, mVisibleChunks.size());
+
+    mHasVisible = !mVisibleChunks.empty();
+    if (!mHasVisible) {
+        return;
+    }
+
+    state.UseProgram(mCullShaderID);
+    glUniform1f(mMaxDistanceLocation, light.GetRange());
+    glUniform1f(mDensityNearLocation, g.gGrassDensityNear);
+    glUniform1f(mMinDensityLocation, g.gGrassMinDensity);
+    glUniform1f(mBladeWidthLocation, g.gGrassBladeWidth);
+
+    state.Enable(GL_RASTERIZER_DISCARD);
+    glBindTransformFeedbackPtr(GL_TRANSFORM_FEEDBACK, mFeedback);
+    bool query = !mQueryPending;
+    if (query) {
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, mWrittenQuery);
+    }
+    glBeginTransformFeedback(GL_POINTS);
+    for (uint32_t index : mVisibleChunks) {
+        const Chunk& chunk = mChunks[index];
+        // The nearest point of the chunk has the highest density, blades past
+        // its rank would fail the shader's density test anyway
+        glm::vec3 center(mChunkBounds.cx[index], mChunkBounds.cy[index], mChunkBounds.cz[index]);
+        glm::vec3 extents(mChunkBounds.ex[index], mChunkBounds.ey[index], mChunkBounds.ez[index]);
+        glm::vec3 nearest = glm::clamp(eyePosition, center - extents, center + extents);
+        float density = Density(glm::length(nearest - eyePosition), light.GetRange());
+        GLsizei count = std::min(chunk.count, (GLsizei)std::ceil(density * chunk.count));
+        state.BindVertexArray(chunk.vao);
+        glDrawArrays(GL_POINTS, 0, count);
+        stats.grassBladesTested += count;
+    }
+    glEndTransformFeedback();
+    if (query) {
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        mQueryPending = true;
+    }
+    glBindTransformFeedbackPtr(GL_TRANSFORM_FEEDBACK, 0);
+    state.Disable(GL_RASTERIZER_DISCARD);
+}
+
+void GrassField::Draw(GLState& state, FrameStats& stats, bool depthOnly) const{
+    if (!mHasVisible) {
+        return;
+    }
+    state.UseProgram(depthOnly ? mDepthShaderID : mShaderID);
+    state.BindVertexArray(mVisibleVAO);
+    // As many points as grass_cull_geom.glsl emitted, without asking the CPU
+    glDrawTransformFeedbackPtr(GL_POINTS, mFeedback);
+    if (!depthOnly) {
+        stats.grassDraws++;
+    }
+}
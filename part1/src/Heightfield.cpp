@@ -0,0 +1,186 @@
+#include "Heightfield.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Steps of the bisection once a ray went below the ground
+static const int kRaycastRefinements = 8;
+
+/**
+* Value noise: every octave is a lattice of random values, featureSize wide at
+* the first octave and half as wide at each next one, interpolated with a
+* smoothstep. The lattice values come from the seed and their coordinates only
+*
+* @return void
+*/
+void Heightfield::Generate(float minValue, float maxValue, float spacing, float amplitude, float featureSize, uint32_t seed){
+    mMinValue = minValue;
+    mMaxValue = maxValue;
+    float size = maxValue - minValue;
+    mSamplesPerSide = glm::clamp((int)std::ceil(size / spacing) + 1, 2, kMaxSamplesPerSide);
+    mSpacing = size / (mSamplesPerSide - 1);
+    mHeights.assign((size_t)mSamplesPerSide * mSamplesPerSide, 0.0f);
+
+    std::vector<int> cellX(mSamplesPerSide);
+    std::vector<float> blendX(mSamplesPerSide);
+    std::vector<float> lattice;
+    float octaveHeight = 1.0f;
+    float totalHeight = 0.0f;
+    float width = featureSize;
+    for (int octave = 0; octave < kOctaves; ++octave) {
+        // One lattice point past the map on the far side
+        int latticeSide = (int)std::ceil(size / width) + 2;
+        lattice.resize((size_t)latticeSide * latticeSide);
+        uint32_t octaveSeed = Random::ChunkSeed(seed, octave, 0);
+        for (int z = 0; z < latticeSide; ++z) {
+            for (int x = 0; x < latticeSide; ++x) {
+                // 24 bits to [-1, 1), as Random::Uniform
+                uint32_t bits = Random::ChunkSeed(octaveSeed, x, z) >> 8;
+                lattice[(size_t)z * latticeSide + x] = (float)bits * (2.0f / 16777216.0f) - 1.0f;
+            }
+        }
+
+        // Same columns on every row
+        for (int x = 0; x < mSamplesPerSide; ++x) {
+            float position = x * mSpacing / width;
+            cellX[x] = std::min((int)position, latticeSide - 2);
+            float t = position - cellX[x];
+            blendX[x] = t * t * (3.0f - 2.0f * t);
+        }
+        for (int z = 0; z < mSamplesPerSide; ++z) {
+            float position = z * mSpacing / width;
+            int cellZ = std::min((int)position, latticeSide - 2);
+            float t = position - cellZ;
+            float blendZ = t * t * (3.0f - 2.0f * t);
+            const float* row0 = &lattice[(size_t)cellZ * latticeSide];
+            const float* row1 = row0 + latticeSide;
+            float* heights = &mHeights[(size_t)z * mSamplesPerSide];
+            for (int x = 0; x < mSamplesPerSide; ++x) {
+                int c = cellX[x];
+                float bottom = row0[c] + (row0[c + 1] - row0[c]) * blendX[x];
+                float top = row1[c] + (row1[c + 1] - row1[c]) * blendX[x];
+                heights[x] += octaveHeight * (bottom + (top - bottom) * blendZ);
+            }
+        }
+        totalHeight += octaveHeight;
+        octaveHeight *= 0.5f;
+        width *= 0.5f;
+    }
+
+    float scale = amplitude / totalHeight;
+    for (float& height : mHeights) {
+        height *= scale;
+    }
+}
+
+void Heightfield::Flatten(const glm::vec2& center, float radius, float blend){
+    if (IsFlat()) {
+        return;
+    }
+    float target = HeightAt(center);
+    float reach = radius + blend;
+    int x0 = std::max(0, (int)std::floor((center.x - reach - mMinValue) / mSpacing));
+    int x1 = std::min(mSamplesPerSide - 1, (int)std::ceil((center.x + reach - mMinValue) / mSpacing));
+    int z0 = std::max(0, (int)std::floor((center.y - reach - mMinValue) / mSpacing));
+    int z1 = std::min(mSamplesPerSide - 1, (int)std::ceil((center.y + reach - mMinValue) / mSpacing));
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            float distance = glm::length(glm::vec2(mMinValue + x * mSpacing, mMinValue + z * mSpacing) - center);
+            if (distance >= reach) {
+                continue;
+            }
+            float& height = mHeights[(size_t)z * mSamplesPerSide + x];
+            float t = blend > 0.0f ? glm::clamp((distance - radius) / blend, 0.0f, 1.0f) : 0.0f;
+            height = target + (height - target) * t * t * (3.0f - 2.0f * t);
+        }
+    }
+}
+
+void Heightfield::Clear(){
+    mHeights.clear();
+    mSamplesPerSide = 0;
+}
+
+float Heightfield::HeightAt(const glm::vec2& point) const{
+    if (IsFlat()) {
+        return 0.0f;
+    }
+    float last = (float)(mSamplesPerSide - 1);
+    float fx = glm::clamp((point.x - mMinValue) / mSpacing, 0.0f, last);
+    float fz = glm::clamp((point.y - mMinValue) / mSpacing, 0.0f, last);
+    int x = std::min((int)fx, mSamplesPerSide - 2);
+    int z = std::min((int)fz, mSamplesPerSide - 2);
+    float tx = fx - x;
+    float tz = fz - z;
+    float bottom = Sample(x, z) + (Sample(x + 1, z) - Sample(x, z)) * tx;
+    float top = Sample(x, z + 1) + (Sample(x + 1, z + 1) - Sample(x, z + 1)) * tx;
+    return bottom + (top - bottom) * tz;
+}
+
+glm::vec3 Heightfield::NormalAt(const glm::vec2& point) const{
+    if (IsFlat()) {
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    float left = HeightAt(point - glm::vec2(mSpacing, 0.0f));
+    float right = HeightAt(point + glm::vec2(mSpacing, 0.0f));
+    float back = HeightAt(point - glm::vec2(0.0f, mSpacing));
+    float front = HeightAt(point + glm::vec2(0.0f, mSpacing));
+    return glm::normalize(glm::vec3(left - right, 2.0f * mSpacing, back - front));
+}
+
+void Heightfield::Range(const glm::vec2& boundsMin, const glm::vec2& boundsMax, float& lowest, float& highest) const{
+    if (IsFlat()) {
+        lowest = highest = 0.0f;
+        return;
+    }
+    int x0 = glm::clamp((int)std::floor((boundsMin.x - mMinValue) / mSpacing), 0, mSamplesPerSide - 1);
+    int x1 = glm::clamp((int)std::ceil((boundsMax.x - mMinValue) / mSpacing), 0, mSamplesPerSide - 1);
+    int z0 = glm::clamp((int)std::floor((boundsMin.y - mMinValue) / mSpacing), 0, mSamplesPerSide - 1);
+    int z1 = glm::clamp((int)std::ceil((boundsMax.y - mMinValue) / mSpacing), 0, mSamplesPerSide - 1);
+    lowest = highest = Sample(x0, z0);
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            lowest = std::min(lowest, Sample(x, z));
+            highest = std::max(highest, Sample(x, z));
+        }
+    }
+}
+
+/**
+* March one sample spacing at a time until the ray is below the ground, then
+* bisect the last step. A ridge thinner than a step may be missed
+*
+* @return float
+*/
+float Heightfield::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const{
+    auto above = [&](float distance){
+        glm::vec3 point = origin + distance * direction;
+        return point.y - HeightAt(glm::vec2(point.x, point.z));
+    };
+    if (above(0.0f) <= 0.0f) {
+        return 0.0f;
+    }
+    float previous = 0.0f;
+    while (previous < maxDistance) {
+        float next = std::min(previous + mSpacing, maxDistance);
+        if (above(next) <= 0.0f) {
+            for (int i = 0; i < kRaycastRefinements; ++i) {
+                float middle = 0.5f * (previous + next);
+                if (above(middle) <= 0.0f) {
+                    next = middle;
+                } else {
+                    previous = middle;
+                }
+            }
+            return next;
+        }
+        previous = next;
+    }
+    return maxDistance;
+}
+
+bool Heightfield::Walkable(const glm::vec2& from, const glm::vec2& to, float maxSlope) const{
+    float rise = HeightAt(to) - HeightAt(from);
+    return rise <= maxSlope * glm::length(to - from);
+}
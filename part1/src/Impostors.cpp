@@ -0,0 +1,186 @@
+#include "Impostors.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+/**
+* Same mapping as DecodeHemiOctahedron in impostor_vert.glsl, from the
+* [0,1] square to a direction of the upper hemisphere
+*
+* @return glm::vec3
+*/
+static glm::vec3 DecodeHemiOctahedron(const glm::vec2& uv){
+    glm::vec2 p = uv * 2.0f - 1.0f;
+    glm::vec3 direction((p.x + p.y) * 0.5f, 0.0f, (p.x - p.y) * 0.5f);
+    direction.y = 1.0f - std::fabs(direction.x) - std::fabs(direction.z);
+    return glm::normalize(direction);
+}
+
+Impostors::~Impostors(){
+    for (Atlas& atlas : mAtlases) {
+        g.gGLState.DeleteTextures(1, &atlas.albedo);
+        g.gGLState.DeleteTextures(1, &atlas.normalDepth);
+    }
+    if (mFramebuffer != 0) {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        glDeleteRenderbuffers(1, &mDepthBuffer);
+        g.gGLState.DeleteVertexArrays(1, &mVAO);
+    }
+}
+
+/**
+* Setup the impostor program and bake one atlas per object
+*
+* @return void
+*/
+void Impostors::Bake(const std::vector<OBJ*>& objects){
+    mShaderID = g.gShaderCache.GetProgram("./shaders/impostor_vert.glsl", "./shaders/impostor_frag.glsl");
+    mModelMatrixLocation = glGetUniformLocation(mShaderID, "u_ModelMatrix");
+    if (mModelMatrixLocation < 0) {
+        std::cout << "Could not find u_ModelMatrix, maybe a mispelling?\n";
+        exit(EXIT_FAILURE);
+    }
+    glUseProgram(mShaderID);
+    glUniform1i(glGetUniformLocation(mShaderID, "u_AlbedoAtlas"), 0);
+    glUniform1i(glGetUniformLocation(mShaderID, "u_NormalDepthAtlas"), 1);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &mVAO);
+
+    int atlasSize = kFrames * kFrameSize;
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glGenRenderbuffers(1, &mDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+    GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    mAtlases.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        BakeAtlas(*objects[i], mAtlases[i]);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, g.gScreenWidth, g.gScreenHeight);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+/**
+* Render object into kFrames x kFrames frames of a new atlas, frame (i, j)
+* seen from the direction at (i, j) / (kFrames - 1) of the hemi-octahedral square
+*
+* @return void
+*/
+void Impostors::BakeAtlas(const OBJ& object, Atlas& atlas){
+    int atlasSize = kFrames * kFrameSize;
+    for (GLuint* texture : {&atlas.albedo, &atlas.normalDepth}) {
+        glGenTextures(1, texture);
+        g.gGLState.BindTexture(0, GL_TEXTURE_2D, *texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normalDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Impostor framebuffer is incomplete, " << object.getFileName() << " has no impostor" << std::endl;
+        return;
+    }
+
+    glViewport(0, 0, atlasSize, atlasSize);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    atlas.localCenter = (object.getMinCoord() + object.getMaxCoord()) * 0.5f;
+    atlas.radius = glm::length(object.getMaxCoord() - object.getMinCoord()) * 0.5f;
+    float radius = atlas.radius;
+
+    unsigned int features = object.getNormalTexture() != nullptr ? static_cast<unsigned int>(SHADER_HAS_NORMAL_MAP) : 0u;
+    GLuint program = g.gShaderCache.GetProgram("./shaders/impostor_bake_vert.glsl", "./shaders/impostor_bake_frag.glsl", features);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "u_DiffuseTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "u_NormalTexture"), 1);
+    glUniform3fv(glGetUniformLocation(program, "u_Kd"), 1, &object.GetMaterialConstants().kd[0]);
+    glUniform1f(glGetUniformLocation(program, "u_Radius"), radius);
+    // The camera is 2 radii from the center, the sphere fits between 1 and 3 radii
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.5f * radius, 3.5f * radius);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_BakeProjection"), 1, GL_FALSE, &projection[0][0]);
+    GLint viewLocation = glGetUniformLocation(program, "u_BakeView");
+
+    if (object.getDiffuseTexture() != nullptr) {
+        object.getDiffuseTexture()->Bind(0);
+    }
+    if (object.getNormalTexture() != nullptr) {
+        object.getNormalTexture()->Bind(1);
+    }
+    glBindVertexArray(object.getVAO());
+    GLsizei vertexCount = (GLsizei)(object.getVerticesArray().size() / 3);
+
+    for (int j = 0; j < kFrames; ++j) {
+        for (int i = 0; i < kFrames; ++i) {
+            glm::vec3 direction = DecodeHemiOctahedron(glm::vec2(i, j) / (float)(kFrames - 1));
+            // Same up vector as FrameBasis in impostor_vert.glsl
+            glm::vec3 up = std::fabs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::mat4 view = glm::lookAt(atlas.localCenter + direction * (2.0f * radius), atlas.localCenter, up);
+            glUniformMatrix4fv(viewLocation, 1, GL_FALSE, &view[0][0]);
+            glViewport(i * kFrameSize, j * kFrameSize, kFrameSize, kFrameSize);
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        }
+    }
+}
+
+glm::vec3 Impostors::WorldCenter(const Atlas& atlas, const OBJ& object) const{
+    return glm::vec3(object.GetModelMatrix() * glm::vec4(atlas.localCenter, 1.0f));
+}
+
+bool Impostors::IsFar(size_t index, const OBJ& object, const glm::vec3& eyePosition) const{
+    const Atlas& atlas = mAtlases[index];
+    if (atlas.albedo == 0) {
+        return false;
+    }
+    return glm::length(WorldCenter(atlas, object) - eyePosition) - atlas.radius > g.gImpostorDistance;
+}
+
+/**
+* Submit the quad of the impostor, its model matrix carries the sphere's center,
+* the object's rotation and the sphere's radius as scale (see impostor_vert.glsl)
+*
+* @return void
+*/
+void Impostors::Submit(size_t index, const OBJ& object, RenderQueue& queue) const{
+    const Atlas& atlas = mAtlases[index];
+    glm::vec3 center = WorldCenter(atlas, object);
+
+    DrawPacket packet;
+    packet.program = mShaderID;
+    packet.modelMatrixLocation = mModelMatrixLocation;
+    packet.model = glm::translate(glm::mat4(1.0f), center);
+    packet.model = glm::rotate(packet.model, glm::radians(object.getRot()), glm::vec3(0.0f, 1.0f, 0.0f));
+    packet.model = glm::scale(packet.model, glm::vec3(atlas.radius));
+    packet.vao = mVAO;
+    packet.textures[0] = atlas.albedo;
+    packet.textures[1] = atlas.normalDepth;
+    packet.mode = GL_TRIANGLE_STRIP;
+    packet.count = 4;
+    // Discard and the baked depth are the same in both passes
+    packet.depthProgram = mShaderID;
+    packet.depthModelMatrixLocation = mModelMatrixLocation;
+    packet.depthNeedsTextures = true;
+    queue.Submit(packet, PASS_ALPHA_TESTED, center);
+}
@@ -0,0 +1,82 @@
+#include "LightCone.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Attenuation of the head light, must match frag.glsl and billboard_frag.glsl
+static const float kConstant  = 1.0f;
+static const float kLinear    = 0.01f;
+static const float kQuadratic = 0.032f;
+
+void LightCone::Set(const glm::vec3& apex, const glm::vec3& axis, float halfAngle, float range){
+    mApex = apex;
+    mAxis = glm::normalize(axis);
+    mSin = std::sin(halfAngle);
+    mCos = std::cos(halfAngle);
+    mRange = range;
+}
+
+/**
+* Sphere against cone: the sphere is outside when it is beyond the range,
+* behind the apex, or further than its radius from the cone's surface.
+*
+* @return bool whether any part of the sphere can be lit
+*/
+bool LightCone::TouchesSphere(const glm::vec3& center, float radius) const{
+    glm::vec3 toCenter = center - mApex;
+    float distanceSquared = glm::dot(toCenter, toCenter);
+    float reach = mRange + radius;
+    if (distanceSquared > reach * reach) {
+        return false;
+    }
+
+    // Distance along the axis and away from it
+    float along = glm::dot(toCenter, mAxis);
+    if (along < -radius) {
+        return false;
+    }
+    float across = std::sqrt(std::max(0.0f, distanceSquared - along * along));
+    // Signed distance to the cone's surface, positive outside
+    float outside = mCos * across - mSin * along;
+    return outside <= radius;
+}
+
+size_t LightCone::FilterSpheres(const SphereList& spheres, std::vector<uint32_t>& indices) const{
+    size_t kept = 0;
+    for (uint32_t index : indices) {
+        glm::vec3 center(spheres.x[index], spheres.y[index], spheres.z[index]);
+        if (TouchesSphere(center, spheres.radius[index])) {
+            indices[kept++] = index;
+        }
+    }
+    size_t removed = indices.size() - kept;
+    indices.resize(kept);
+    return removed;
+}
+
+size_t LightCone::FilterBoxes(const BoxList& boxes, std::vector<uint32_t>& indices) const{
+    size_t kept = 0;
+    for (uint32_t index : indices) {
+        // The sphere around the box is good enough for a few boxes
+        glm::vec3 center(boxes.cx[index], boxes.cy[index], boxes.cz[index]);
+        glm::vec3 extents(boxes.ex[index], boxes.ey[index], boxes.ez[index]);
+        if (TouchesSphere(center, glm::length(extents))) {
+            indices[kept++] = index;
+        }
+    }
+    size_t removed = indices.size() - kept;
+    indices.resize(kept);
+    return removed;
+}
+
+float LightCone::AttenuationRange(float strength, float threshold){
+    // strength / (kConstant + kLinear * d + kQuadratic * d^2) = threshold, solved for d
+    float c = kConstant - strength / threshold;
+    if (c >= 0.0f) {
+        return 0.0f;
+    }
+    float discriminant = kLinear * kLinear - 4.0f * kQuadratic * c;
+    return (-kLinear + std::sqrt(discriminant)) / (2.0f * kQuadratic);
+}
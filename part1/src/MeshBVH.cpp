@@ -0,0 +1,503 @@
+#include "MeshBVH.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+// Depth first traversal pops a node before pushing its two children, so it never
+// holds more than one entry per level plus the root
+static const int kStackSize = MeshBVH::kMaxDepth + 1;
+
+static float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax){
+    glm::vec3 e = boundsMax - boundsMin;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+/**
+* Entry distance of the ray into the box, FLT_MAX when it misses or enters past maxDistance
+*
+* @return float
+*/
+static float IntersectBounds(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                             const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance){
+    glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+    glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+/**
+* Moller-Trumbore, distance along direction to the triangle or -1 when it is missed
+*
+* @return float
+*/
+static float IntersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+                               const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2){
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f) {
+        return -1.0f;
+    }
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = origin - v0;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f) {
+        return -1.0f;
+    }
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f) {
+        return -1.0f;
+    }
+    return glm::dot(edge2, q) * inverse;
+}
+
+/**
+* Closest point of triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+*
+* @return glm::vec3
+*/
+static glm::vec3 ClosestPointTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = p - a;
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return a;
+    }
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        return b;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        return c;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+/**
+* Squared distance between segments [p1, q1] and [p2, q2] (Ericson 5.1.9)
+*
+* @return float
+*/
+static float SegmentSegmentDistanceSq(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2){
+    glm::vec3 d1 = q1 - p1;
+    glm::vec3 d2 = q2 - p2;
+    glm::vec3 r = p1 - p2;
+    float a = glm::dot(d1, d1);
+    float e = glm::dot(d2, d2);
+    float f = glm::dot(d2, r);
+    float s = 0.0f;
+    float t = 0.0f;
+    if (a <= FLT_EPSILON && e <= FLT_EPSILON) {
+        return glm::dot(r, r);
+    }
+    if (a <= FLT_EPSILON) {
+        t = glm::clamp(f / e, 0.0f, 1.0f);
+    } else {
+        float c = glm::dot(d1, r);
+        if (e <= FLT_EPSILON) {
+            s = glm::clamp(-c / a, 0.0f, 1.0f);
+        } else {
+            float b = glm::dot(d1, d2);
+            float denominator = a * e - b * b;
+            s = denominator != 0.0f ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = glm::clamp(-c / a, 0.0f, 1.0f);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+    glm::vec3 difference = (p1 + d1 * s) - (p2 + d2 * t);
+    return glm::dot(difference, difference);
+}
+
+/**
+* Squared distance between segment [p, q] and triangle abc, 0 when the segment crosses it
+*
+* @return float
+*/
+float MeshBVH::SegmentTriangleDistanceSq(const glm::vec3& p, const glm::vec3& q, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){
+    float t = IntersectTriangle(p, q - p, a, b, c);
+    if (t >= 0.0f && t <= 1.0f) {
+        return 0.0f;
+    }
+    // Otherwise the closest pair has an end of the segment or lies on an edge
+    glm::vec3 closestP = ClosestPointTriangle(p, a, b, c) - p;
+    glm::vec3 closestQ = ClosestPointTriangle(q, a, b, c) - q;
+    float distance = std::min(glm::dot(closestP, closestP), glm::dot(closestQ, closestQ));
+    distance = std::min(distance, SegmentSegmentDistanceSq(p, q, a, b));
+    distance = std::min(distance, SegmentSegmentDistanceSq(p, q, b, c));
+    distance = std::min(distance, SegmentSegmentDistanceSq(p, q, c, a));
+    return distance;
+}
+
+/**
+* Copy the triangles, then split the root until every leaf is small or
+* not worth splitting
+*
+* @return void
+*/
+void MeshBVH::Build(const std::vector<float>& positions){
+    size_t triangleCount = positions.size() / 9;
+    mTriangles.resize(triangleCount);
+    mCentroids.resize(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i) {
+        const float* v = &positions[i * 9];
+        mTriangles[i].v0 = glm::vec3(v[0], v[1], v[2]);
+        mTriangles[i].v1 = glm::vec3(v[3], v[4], v[5]);
+        mTriangles[i].v2 = glm::vec3(v[6], v[7], v[8]);
+        mCentroids[i] = (mTriangles[i].v0 + mTriangles[i].v1 + mTriangles[i].v2) / 3.0f;
+    }
+
+    // A binary tree with at least one triangle per leaf has fewer than 2n nodes
+    mNodes.clear();
+    mNodes.reserve(std::max<size_t>(2 * triangleCount, 1));
+    Node root;
+    root.leftFirst = 0;
+    root.count = (uint32_t)triangleCount;
+    mNodes.push_back(root);
+    UpdateBounds(0);
+    mDepth = 0;
+    if (triangleCount > 0) {
+        Subdivide(0, 0);
+    }
+    assert(mDepth < kStackSize);
+    mNodes.shrink_to_fit();
+    mCentroids.clear();
+    mCentroids.shrink_to_fit();
+}
+
+void MeshBVH::UpdateBounds(uint32_t nodeIndex){
+    Node& node = mNodes[nodeIndex];
+    node.boundsMin = glm::vec3(FLT_MAX);
+    node.boundsMax = glm::vec3(-FLT_MAX);
+    for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+        const Triangle& triangle = mTriangles[i];
+        node.boundsMin = glm::min(node.boundsMin, glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2)));
+        node.boundsMax = glm::max(node.boundsMax, glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2)));
+    }
+}
+
+bool MeshBVH::FindSplit(const Node& node, int& outAxis, float& outPosition) const{
+    glm::vec3 centroidMin(FLT_MAX);
+    glm::vec3 centroidMax(-FLT_MAX);
+    for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+        centroidMin = glm::min(centroidMin, mCentroids[i]);
+        centroidMax = glm::max(centroidMax, mCentroids[i]);
+    }
+
+    float bestCost = node.count * SurfaceArea(node.boundsMin, node.boundsMax);
+    bool found = false;
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0.0f) {
+            continue;
+        }
+        struct Bin{
+            glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+            glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+            uint32_t count = 0;
+        } bins[kBins];
+        float scale = kBins / extent;
+        for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+            int b = std::min(kBins - 1, (int)((mCentroids[i][axis] - centroidMin[axis]) * scale));
+            const Triangle& triangle = mTriangles[i];
+            bins[b].boundsMin = glm::min(bins[b].boundsMin, glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2)));
+            bins[b].boundsMax = glm::max(bins[b].boundsMax, glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2)));
+            bins[b].count++;
+        }
+
+        // Area and count left of each plane, then sweep from the right
+        float leftArea[kBins - 1];
+        uint32_t leftCount[kBins - 1];
+        glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+        uint32_t sweepCount = 0;
+        for (int i = 0; i < kBins - 1; ++i) {
+            sweepCount += bins[i].count;
+            sweepMin = glm::min(sweepMin, bins[i].boundsMin);
+            sweepMax = glm::max(sweepMax, bins[i].boundsMax);
+            leftCount[i] = sweepCount;
+            leftArea[i] = sweepCount > 0 ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+        }
+        sweepMin = glm::vec3(FLT_MAX);
+        sweepMax = glm::vec3(-FLT_MAX);
+        sweepCount = 0;
+        for (int i = kBins - 1; i > 0; --i) {
+            sweepCount += bins[i].count;
+            sweepMin = glm::min(sweepMin, bins[i].boundsMin);
+            sweepMax = glm::max(sweepMax, bins[i].boundsMax);
+            if (leftCount[i - 1] == 0 || sweepCount == 0) {
+                continue;
+            }
+            float cost = leftCount[i - 1] * leftArea[i - 1] + sweepCount * SurfaceArea(sweepMin, sweepMax);
+            if (cost < bestCost) {
+                bestCost = cost;
+                outAxis = axis;
+                outPosition = centroidMin[axis] + i / scale;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+void MeshBVH::Subdivide(uint32_t nodeIndex, int depth){
+    Node node = mNodes[nodeIndex];
+    mDepth = std::max(mDepth, depth);
+    if (node.count <= (uint32_t)kMaxLeafTriangles || depth >= kMaxDepth) {
+        return;
+    }
+    int axis = 0;
+    float position = 0.0f;
+    if (!FindSplit(node, axis, position)) {
+        return;
+    }
+
+    // Partition the triangles of the node around the plane
+    uint32_t i = node.leftFirst;
+    uint32_t j = node.leftFirst + node.count - 1;
+    while (i <= j && j != UINT32_MAX) {
+        if (mCentroids[i][axis] < position) {
+            ++i;
+        } else {
+            std::swap(mTriangles[i], mTriangles[j]);
+            std::swap(mCentroids[i], mCentroids[j]);
+            --j;
+        }
+    }
+    uint32_t leftCount = i - node.leftFirst;
+    if (leftCount == 0 || leftCount == node.count) {
+        return;
+    }
+
+    // Children are next to each other, they are usually both visited
+    uint32_t leftChild = (uint32_t)mNodes.size();
+    Node left;
+    left.leftFirst = node.leftFirst;
+    left.count = leftCount;
+    Node right;
+    right.leftFirst = i;
+    right.count = node.count - leftCount;
+    mNodes.push_back(left);
+    mNodes.push_back(right);
+    mNodes[nodeIndex].leftFirst = leftChild;
+    mNodes[nodeIndex].count = 0;
+    UpdateBounds(leftChild);
+    UpdateBounds(leftChild + 1);
+    Subdivide(leftChild, depth + 1);
+    Subdivide(leftChild + 1, depth + 1);
+}
+
+/**
+* Front to back traversal, the nearer child first, skipping nodes entered
+* past the closest hit so far
+*
+* @return bool
+*/
+bool MeshBVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                      float& outDistance, uint32_t* outTriangle) const{
+    if (mTriangles.empty()) {
+        return false;
+    }
+    glm::vec3 inverseDirection = 1.0f / direction;
+    float closest = maxDistance;
+    uint32_t closestTriangle = UINT32_MAX;
+
+    uint32_t stack[kStackSize];
+    int stackSize = 0;
+    if (IntersectBounds(origin, inverseDirection, mNodes[0].boundsMin, mNodes[0].boundsMax, closest) == FLT_MAX) {
+        return false;
+    }
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        if (node.count > 0) {
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                const Triangle& triangle = mTriangles[i];
+                float t = IntersectTriangle(origin, direction, triangle.v0, triangle.v1, triangle.v2);
+                if (t >= 0.0f && t < closest) {
+                    closest = t;
+                    closestTriangle = i;
+                }
+            }
+            continue;
+        }
+        uint32_t nearChild = node.leftFirst;
+        uint32_t farChild = node.leftFirst + 1;
+        float nearDistance = IntersectBounds(origin, inverseDirection, mNodes[nearChild].boundsMin, mNodes[nearChild].boundsMax, closest);
+        float farDistance = IntersectBounds(origin, inverseDirection, mNodes[farChild].boundsMin, mNodes[farChild].boundsMax, closest);
+        if (farDistance < nearDistance) {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        // Pushed last, popped first
+        if (farDistance != FLT_MAX) {
+            stack[stackSize++] = farChild;
+        }
+        if (nearDistance != FLT_MAX) {
+            stack[stackSize++] = nearChild;
+        }
+    }
+
+    if (closestTriangle == UINT32_MAX) {
+        return false;
+    }
+    outDistance = closest;
+    if (outTriangle != nullptr) {
+        *outTriangle = closestTriangle;
+    }
+    return true;
+}
+
+/**
+* Visit the nodes overlapping the bounds of the capsule, stopping at the first
+* triangle within radius of the segment
+*
+* @return bool
+*/
+bool MeshBVH::OverlapsCapsule(const glm::vec3& a, const glm::vec3& b, float radius) const{
+    if (mTriangles.empty()) {
+        return false;
+    }
+    glm::vec3 capsuleMin = glm::min(a, b) - radius;
+    glm::vec3 capsuleMax = glm::max(a, b) + radius;
+    float radiusSq = radius * radius;
+
+    uint32_t stack[kStackSize];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        if (glm::any(glm::lessThan(node.boundsMax, capsuleMin)) || glm::any(glm::greaterThan(node.boundsMin, capsuleMax))) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                const Triangle& triangle = mTriangles[i];
+                if (SegmentTriangleDistanceSq(a, b, triangle.v0, triangle.v1, triangle.v2) <= radiusSq) {
+                    return true;
+                }
+            }
+        } else {
+            stack[stackSize++] = node.leftFirst;
+            stack[stackSize++] = node.leftFirst + 1;
+        }
+    }
+    return false;
+}
+
+/**
+* Whether rays from every sampled direction, from level with the floor to
+* straight down, toward a grid of points on the faces of the box they see all
+* hit the mesh first. Parallel rays stand in for the eye, which is always
+* outside the mesh
+*
+* @return bool
+*/
+bool MeshBVH::HidesBox(const glm::vec3& boxMin, const glm::vec3& boxMax, float reach) const{
+    const int kAzimuths = 16;
+    const float kElevations[] = {0.0f, 15.0f, 30.0f, 60.0f, 90.0f};
+    const int kFaceSamples = 6;
+
+    for (float elevation : kElevations) {
+        // Straight down is one direction whatever the azimuth
+        int azimuths = elevation < 90.0f ? kAzimuths : 1;
+        for (int a = 0; a < azimuths; ++a) {
+            float azimuth = glm::two_pi<float>() * a / kAzimuths;
+            float up = glm::radians(elevation);
+            // From the eye toward the mesh
+            glm::vec3 direction = -glm::vec3(std::cos(up) * std::cos(azimuth), std::sin(up), std::cos(up) * std::sin(azimuth));
+            for (int axis = 0; axis < 3; ++axis) {
+                // Only the faces turned to the eye
+                if (std::fabs(direction[axis]) < 1e-4f) {
+                    continue;
+                }
+                int u = (axis + 1) % 3;
+                int v = (axis + 2) % 3;
+                for (int i = 0; i < kFaceSamples; ++i) {
+                    for (int j = 0; j < kFaceSamples; ++j) {
+                        glm::vec3 point;
+                        point[axis] = direction[axis] > 0.0f ? boxMin[axis] : boxMax[axis];
+                        point[u] = glm::mix(boxMin[u], boxMax[u], (i + 0.5f) / kFaceSamples);
+                        point[v] = glm::mix(boxMin[v], boxMax[v], (j + 0.5f) / kFaceSamples);
+                        glm::vec3 origin = point - reach * direction;
+                        float distance = 0.0f;
+                        if (!Raycast(origin, point - origin, 1.0f, distance)) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+* Widths and heights are tried separately in steps of kScaleStep, the box of
+* the largest volume the mesh hides is kept
+*
+* @return bool
+*/
+bool MeshBVH::FitInnerBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxScale,
+                          glm::vec3& outMin, glm::vec3& outMax) const{
+    const float kScaleStep = 0.1f;
+    const float kMinScale = 0.1f;
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 size = boundsMax - boundsMin;
+    float reach = 2.0f * glm::length(size);
+    float bestVolume = 0.0f;
+    for (float width = maxScale; width >= kMinScale - 1e-4f; width -= kScaleStep) {
+        // Heights from the top, the first one hidden is the tallest at this width.
+        // Stop once the volume cannot beat the best box
+        for (float height = maxScale; height >= kMinScale - 1e-4f; height -= kScaleStep) {
+            float volume = width * width * height;
+            if (volume <= bestVolume) {
+                break;
+            }
+            glm::vec3 boxMin(center.x - 0.5f * width * size.x, boundsMin.y, center.z - 0.5f * width * size.z);
+            glm::vec3 boxMax(center.x + 0.5f * width * size.x, boundsMin.y + height * size.y, center.z + 0.5f * width * size.z);
+            if (HidesBox(boxMin, boxMax, reach)) {
+                bestVolume = volume;
+                outMin = boxMin;
+                outMax = boxMax;
+                break;
+            }
+        }
+    }
+    return bestVolume > 0.0f;
+}
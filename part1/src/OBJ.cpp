@@ -8,7 +8,10 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
+#include <glm/gtc/constants.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -16,10 +19,8 @@
 #include <vector>
 #include <filesystem>
 
-bool hasMTLFile = false;
-
 // Constructor loads a filename with the .ppm extension
-OBJ::OBJ(std::string fileName) {
+OBJ::OBJ(std::string fileName) : mFileName(fileName) {
     // open the file 
     std::ifstream inFile;
     inFile.open(fileName);
@@ -46,7 +47,7 @@ OBJ::OBJ(std::string fileName) {
             iss >> mtlFileName;
             std::string mtlFilePath = filePath.parent_path().string() + "/" + mtlFileName;
             // load and parse mtl file
-            hasMTLFile = LoadMTLFile(mtlFilePath);
+            mHasMTLFile = LoadMTLFile(mtlFilePath);
             // load diffuse texture file if exist 
             if (!mMaterial.diffuseTexture.empty()) {
                 std::string diffuseTextureFile = filePath.parent_path().string() + "/" + mMaterial.diffuseTexture;
@@ -133,11 +134,9 @@ OBJ::OBJ(std::string fileName) {
 // Destructor 
 OBJ::~OBJ(){
     // Delete our OpenGL Objects
-    glDeleteBuffers(5, mVBO);
-    glDeleteVertexArrays(1, &mVAO);
-
-    // Delete our Graphics pipeline
-    glDeleteProgram(mShaderID);
+    g.gGLState.DeleteBuffers(5, mVBO);
+    g.gGLState.DeleteBuffers(1, &mInstanceVBO);
+    g.gGLState.DeleteVertexArrays(1, &mVAO);
 
     if (mTextureDiffuse != nullptr) {
         delete mTextureDiffuse;
@@ -167,326 +166,213 @@ void OBJ::Initialize() {
 }
 
 /**
-* PreDraw
-* Typically we will use this for setting some sort of 'state'
-* Note: some of the calls may take place at different stages (post-processing) of the
-* 		 pipeline.
+* Place object in the world
+*
+* @param objectCoord origin of object in world space
+* @param rot angle rotated along y-axis in degrees
 * @return void
 */
-void OBJ::PreDraw(glm::vec3 objectCoord, float rot){
+void OBJ::Place(glm::vec3 objectCoord, float rot){
     // update object coord and rot
     mObjectCoord = objectCoord;
     mRot = rot;
-
-    // Use our shader
-	glUseProgram(mShaderID);
-
-    // Model transformation by translating our object into world space
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), objectCoord);
-    model = glm::rotate(model,glm::radians(rot),glm::vec3(0.0f,1.0f,0.0f)); 
-
-    // Retrieve our location of our Model Matrix
-    GLint u_ModelMatrixLocation = glGetUniformLocation( mShaderID,"u_ModelMatrix");
-    if(u_ModelMatrixLocation >=0){
-        glUniformMatrix4fv(u_ModelMatrixLocation,1,GL_FALSE,&model[0][0]);
-    }else{
-        std::cout << "Could not find u_ModelMatrix, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
-    }
-
-
-    // Update the View Matrix
-    GLint u_ViewMatrixLocation = glGetUniformLocation(mShaderID,"u_ViewMatrix");
-    if(u_ViewMatrixLocation>=0){
-        glm::mat4 viewMatrix = g.gCamera.GetViewMatrix();
-        glUniformMatrix4fv(u_ViewMatrixLocation,1,GL_FALSE,&viewMatrix[0][0]);
-    }else{
-        std::cout << "Could not find u_ViewMatrix, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
+    UpdateFootprint();
+    if (mDrawGrass) {
+        UpdateInstanceBounds();
     }
+}
 
+/**
+* Footprint of the bounding box at the current placement, so that point tests
+* do not rebuild the model matrix
+*
+* @return void
+*/
+void OBJ::UpdateFootprint(){
+    mFootprint = OrientedBox2D::FromLocal(glm::vec2(mObjectCoord.x, mObjectCoord.z), mRot,
+                                          glm::vec2(mMin.x, mMin.z), glm::vec2(mMax.x, mMax.z));
+}
 
-    // Projection matrix (in perspective) 
-    glm::mat4 perspective = glm::perspective(glm::radians(45.0f),
-                                             (float)g.gScreenWidth/(float)g.gScreenHeight,
-                                             0.1f,
-                                             20.0f);
-
-    // Retrieve our location of our perspective matrix uniform 
-    GLint u_ProjectionLocation= glGetUniformLocation( mShaderID,"u_Projection");
-    if(u_ProjectionLocation>=0){
-        glUniformMatrix4fv(u_ProjectionLocation,1,GL_FALSE,&perspective[0][0]);
-    }else{
-        std::cout << "Could not find u_Perspective, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
-    }
-
-    // Setup light position
-    std::string uniformName = "u_Light[0].lightPos";
-    // Get the location of the uniform
-    GLint lightPosLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (lightPosLocation >= 0) {
-        glUniform3fv(lightPosLocation, 1, &g.gLight.mPosition[0]);
-    } else {
-        //std::cout << "Could not find " << uniformName << std::endl;
-    }
+/**
+* Model matrix of the placement, translation then rotation along y-axis
+*
+* @return glm::mat4
+*/
+glm::mat4 OBJ::GetModelMatrix() const{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), mObjectCoord);
+    return glm::rotate(model, glm::radians(mRot), glm::vec3(0.0f,1.0f,0.0f));
+}
 
-    // Setup light color
-    uniformName = "u_Light[0].lightColor";
-    GLint lightColorLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (lightColorLocation >= 0) {
-        glUniform3fv(lightColorLocation, 1, &g.gLight.mLightColor[0]);
-    } else {
-        //std::cout << "Could not find " << uniformName << std::endl;
-    }
+/**
+* World space bounding box of the placed object, used for culling
+*
+* @return void
+*/
+void OBJ::GetWorldBounds(glm::vec3& center, glm::vec3& extents) const{
+    TransformBox(mMin, mMax, GetModelMatrix(), center, extents);
+}
 
-    // Setup specular strength    
-    uniformName = "u_Light[0].specularStrength";
-    GLint specularStrengthLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (specularStrengthLocation >= 0) {
-        glUniform1f(specularStrengthLocation, g.gLight.mSpecularStrength);
-    } else {
-        //std::cout << "Could not find " << uniformName << std::endl;
-    }
-    
-    // Setup ambient intensity
-    uniformName = "u_Light[0].ambientIntensity";
-    GLint ambientIntensityLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (ambientIntensityLocation >= 0) {
-        glUniform1f(ambientIntensityLocation, g.gLight.mAmbientIntensity);
-    } else {
-        //std::cout << "Could not find " << uniformName << std::endl;
-    }
+/**
+* Recompute the bounding sphere of every instance after a placement change.
+* Instances only rotate along y-axis, so the sphere around the mesh origin
+* holds for any rotation.
+*
+* @return void
+*/
+void OBJ::UpdateInstanceBounds(){
+    glm::mat4 model = GetModelMatrix();
+    float meshRadius = std::max(glm::length(mMin), glm::length(mMax));
 
-    // Setup view direction
-    GLint viewDirectionLocation = glGetUniformLocation(mShaderID, "u_ViewDirection");
-    if(viewDirectionLocation >=0){
-        glUniform3fv(viewDirectionLocation, 1, &g.gCamera.GetViewDirection()[0]);
-    }else{
-        std::cout << "Could not find u_ViewDirection" << std::endl;
-        exit(EXIT_FAILURE);
+    mInstanceBounds.Clear();
+    for (const InstanceData& instance : mInstances) {
+        glm::vec3 center = glm::vec3(model * glm::vec4(instance.offset, 1.0f));
+        mInstanceBounds.Add(center, meshRadius * instance.scale);
     }
+}
 
-    // Setup eye position
-    GLint eyePositionLocation = glGetUniformLocation(mShaderID, "u_EyePosition");
-    if(eyePositionLocation >=0){
-        glUniform3fv(eyePositionLocation, 1, &g.gCamera.GetEyePosition()[0]);
-    }else{
-        std::cout << "Could not find u_EyePosition in " << mShaderID << std::endl;
-    }
-    
-    // Setup head light scope
-    GLint headLightScopeLocation = glGetUniformLocation(mShaderID, "u_HeadLightScope");
-    if(headLightScopeLocation >=0){
-        glUniform1f(headLightScopeLocation, g.gCamera.GetHeadLightScope());
-    }else{
-        std::cout << "Could not find u_headLightScope" << std::endl;
-    }
+void OBJ::SetInstances(const std::vector<InstanceData>& instances){
+    mInstances = instances;
+    UpdateInstanceBounds();
+    // Stale until the next CullInstances
+    mVisibleIndices.clear();
+    mVisibleInstances.clear();
+}
 
-    // Setup head light on
-    GLint headLightOnLocation = glGetUniformLocation(mShaderID, "u_HeadLightOn");
-    if(headLightOnLocation >=0){
-        //std::cout << "u_HeadLightOn" << g.gCamera.GetIfLightOn() << std::endl;
-        glUniform1i(headLightOnLocation, g.gCamera.GetIfLightOn());
-    }else{
-        std::cout << "Could not find u_headLightOn" << std::endl;
+/**
+* Cull the instances against frustum, the head light cone and occluders.
+* Submit() streams the visible ones into the instance buffer, so the instanced
+* draw only covers them.
+*
+* @return void
+*/
+void OBJ::CullInstances(const Frustum& frustum, const LightCone& light, const SoftwareOcclusion* occluders, CullCounts& counts){
+    mVisibleIndices.clear();
+    frustum.CullSpheres(mInstanceBounds, mVisibleIndices);
+    size_t inFrustum = mVisibleIndices.size();
+    light.FilterSpheres(mInstanceBounds, mVisibleIndices);
+    size_t lit = mVisibleIndices.size();
+    if (occluders != nullptr) {
+        occluders->FilterSpheres(mInstanceBounds, mVisibleIndices);
     }
+    counts.Add(mInstances.size(), inFrustum, lit, mVisibleIndices.size());
 
-    // Setup head light Strength
-    GLint headLightStrengthLocation = glGetUniformLocation(mShaderID, "u_HeadLightStrength");
-    if(headLightStrengthLocation >=0){
-        //std::cout << "u_HeadLightStrength" << g.gCamera.GetLightStrength() << std::endl;
-        glUniform1f(headLightStrengthLocation, g.gCamera.GetLightStrength());
-    }else{
-        std::cout << "Could not find u_headLightStrength" << std::endl;
+    mVisibleInstances.clear();
+    for (uint32_t index : mVisibleIndices) {
+        mVisibleInstances.push_back(mInstances[index]);
     }
+}
 
-
-    // Setup head light col
-    //glm::vec3 l = g.gCamera.GetHeadLightCol();
-    // std::cout << l.x << ", " << l.y << ", " << l.z << std::endl;
-    GLint headLightColLocation = glGetUniformLocation(mShaderID, "u_HeadLightCol");
-    if(headLightColLocation >=0){
-        glUniform3fv(headLightColLocation, 1, &g.gCamera.GetHeadLightCol()[0]);
-    }else{
-        std::cout << "Could not find u_headLightCol" << std::endl;
+/**
+* Submit a draw packet of this object at its placement.
+* View, projection and head light come from the FrameBlock bound once per frame,
+* material constants from this object's MaterialBlock.
+*
+* @return void
+*/
+void OBJ::Submit(RenderQueue& queue, GLuint conditionQuery){
+    if (mDrawGrass) {
+        mVisibleInstanceCount = mVisibleInstances.size();
+        // Every instance was culled
+        if (mVisibleInstanceCount == 0) {
+            return;
+        }
+        // Orphan the old storage so the driver does not wait for last frame's draw
+        g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, mInstances.size() * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mVisibleInstanceCount * sizeof(InstanceData), mVisibleInstances.data());
     }
 
+    DrawPacket packet;
+    packet.program = mShaderID;
+    packet.vao = mVAO;
+    packet.materialUBO = mMaterialUniforms.GetID();
 
+    // Model transformation by translating our object into world space
+    packet.modelMatrixLocation = mModelMatrixLocation;
+    packet.model = GetModelMatrix();
+
+    // Texture slots match the samplers set in CreateGraphicsPipeline
+    packet.textures[0] = mTextureDiffuse != nullptr ? mTextureDiffuse->GetID() : 0;
+    packet.textures[1] = mTextureNormal != nullptr ? mTextureNormal->GetID() : 0;
+    packet.textures[2] = mTextureSpecular != nullptr ? mTextureSpecular->GetID() : 0;
+
+    packet.mode = GL_TRIANGLES;
+    packet.count = mVerticesArray.size()/3;
+    packet.instanceCount = mDrawGrass ? mVisibleInstanceCount : 0;
+    packet.conditionQuery = conditionQuery;
+    packet.depthProgram = mDepthShaderID;
+    packet.depthModelMatrixLocation = mDepthModelMatrixLocation;
+
+    glm::vec3 center = mObjectCoord + (mMin + mMax) * 0.5f;
+    queue.Submit(packet, PASS_OPAQUE, center);
+}
 
-    // Setup shininess
-    uniformName = "u_Material.shininess";
-    GLint shininessLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (shininessLocation >= 0) {
-        // if material shininess exist and not equal to 0.0, we use material texture's shininess
-        if (mMaterial.shininess != -1.0 && mMaterial.shininess != 0.0) {
-            glUniform1f(shininessLocation, mMaterial.shininess);
-        } else {
-            // else set a default 32 shininess 
-            glUniform1f(shininessLocation, 32);
-        }
-    } else {
-        std::cout << "Could not find " << uniformName << std::endl;
-        exit(EXIT_FAILURE);
+/**
+* Create the graphics pipeline, programs are owned by g.gShaderCache
+*
+* @return void
+*/
+void OBJ::CreateGraphicsPipeline() {
+    // Pick the shader variant from the material, so the shaders
+    // only do the work this object actually needs
+    unsigned int features = 0;
+    if (!mMaterial.normalTexture.empty()) {
+        features |= SHADER_HAS_NORMAL_MAP;
     }
-
-    // Setup object ambient color
-    uniformName = "u_Material.ka";
-    GLint ambientColorLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (ambientColorLocation >= 0) {
-        // if material ambient color exist and is not too dark
-        if (hasMTLFile && mMaterial.ambient.r >= 0.5f && mMaterial.ambient.g >= 0.5f && mMaterial.ambient.b >= 0.5f) {
-            glUniform3fv(ambientColorLocation, 1, &mMaterial.ambient[0]);
-        } else {
-            // else set a default u_Ka
-            glUniform3fv(ambientColorLocation, 1, &glm::vec3(1.f, 1.f, 1.f)[0]);
-        }
-    } else {
-        std::cout << "Could not find " << uniformName << std::endl;
-        exit(EXIT_FAILURE);
+    if (!mMaterial.specularTexture.empty()) {
+        features |= SHADER_HAS_SPECULAR_MAP;
     }
-
-    // Setup object diffuse color
-    uniformName = "u_Material.kd";
-    GLint diffuseColorLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (diffuseColorLocation >= 0) {
-        // if material diffuse color exist and is not too dark
-        if (hasMTLFile && mMaterial.diffuse.r >= 0.5f && mMaterial.diffuse.g >= 0.5f && mMaterial.diffuse.b >= 0.5f) {
-            glUniform3fv(diffuseColorLocation, 1, &mMaterial.diffuse[0]);
-        } else {
-            // else set a default u_Ka
-            glUniform3fv(diffuseColorLocation, 1, &glm::vec3(1.f, 1.f, 1.f)[0]);
-        }
-    } else {
-        std::cout << "Could not find " << uniformName << std::endl;
-        exit(EXIT_FAILURE);
+    if (mDrawGrass) {
+        features |= SHADER_INSTANCED;
     }
 
-    // Setup object specular color
-    uniformName = "u_Material.ks";
-    GLint specularColorLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (specularColorLocation >= 0) {
-        // if material specular color exist and is not too dark
-        if (hasMTLFile && mMaterial.specular.r >= 0.5f && mMaterial.specular.g >= 0.5f && mMaterial.specular.b >= 0.5f) {
-            glUniform3fv(specularColorLocation, 1, &mMaterial.specular[0]);
-        } else {
-            // else set a default u_Ka
-            glUniform3fv(specularColorLocation, 1, &glm::vec3(1.f, 1.f, 1.f)[0]);
-        }
-    } else {
-        std::cout << "Could not find " << uniformName << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    mShaderID = g.gShaderCache.GetProgram("./shaders/vert.glsl", "./shaders/frag.glsl", features);
 
-    // Setup boolean uniform if object has specular texture
-    uniformName = "u_HasSpecularTexture";
-    GLint hasSpecularLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-    if (hasSpecularLocation >= 0) {
-        // if TextureCoords exist
-        if (!mMaterial.specularTexture.empty()) {
-            glUniform1i(hasSpecularLocation, true);
-        } else {
-            // else set to false
-            glUniform1i(hasSpecularLocation, false);
-        }
-    } else {
-        std::cout << "Could not find " << uniformName << std::endl;
+    // Retrieve our location of our Model Matrix, the only per draw uniform
+    mModelMatrixLocation = glGetUniformLocation(mShaderID, "u_ModelMatrix");
+    if (mModelMatrixLocation < 0) {
+        std::cout << "Could not find u_ModelMatrix, maybe a mispelling?\n";
         exit(EXIT_FAILURE);
     }
 
-    // Bind diffuse texture
-    if (!mMaterial.diffuseTexture.empty()) {
-        // Bind our diffuse texture to slot number 0
-        mTextureDiffuse->Bind(0);
-
-        // Setup diffuse texture uniform 
-        uniformName = "u_Material.diffuseTexture";
-        GLint u_diffuseTextureLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-        if(u_diffuseTextureLocation>=0){
-            // Setup the slot for the texture
-            glUniform1i(u_diffuseTextureLocation,0);
-        }else{
-            std::cout << "Could not find" << uniformName << std::endl;
-        exit(EXIT_FAILURE);
-        }
+    // Texture slots never change, so set the samplers once
+    glUseProgram(mShaderID);
+    glUniform1i(glGetUniformLocation(mShaderID, "u_Material.diffuseTexture"), 0);
+    if (features & SHADER_HAS_NORMAL_MAP) {
+        glUniform1i(glGetUniformLocation(mShaderID, "u_Material.normalTexture"), 1);
     }
-
-    // Bind normal texture
-    if (!mMaterial.normalTexture.empty()) {
-        // Bind our normal texture to slot number 1
-        mTextureNormal->Bind(1);
-
-        // Setup normal texture uniform 
-        uniformName = "u_Material.normalTexture";
-        GLint u_normalTextureLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-        if(u_normalTextureLocation>=0){
-            // Setup the slot for the texture
-            glUniform1i(u_normalTextureLocation,1);
-        }else{
-            std::cout << "Could not find" << uniformName << std::endl;
-        exit(EXIT_FAILURE);
-        }
+    if (features & SHADER_HAS_SPECULAR_MAP) {
+        glUniform1i(glGetUniformLocation(mShaderID, "u_Material.specularTexture"), 2);
     }
+    glUseProgram(0);
 
-    // Bind specular texture
-    if (!mMaterial.specularTexture.empty()) {
-        // Bind our specular texture to slot number 1
-        mTextureSpecular->Bind(2);
-
-        // Setup specular texture uniform 
-        uniformName = "u_Material.specularTexture";
-        GLint u_specularTextureLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-        if(u_specularTextureLocation>=0){
-            // Setup the slot for the texture
-            glUniform1i(u_specularTextureLocation,2);
-        }else{
-            std::cout << "Could not find" << uniformName << std::endl;
-        exit(EXIT_FAILURE);
-        }
-    }
+    // The depth pre-pass only needs the position, which does not depend on the material
+    mDepthShaderID = g.gShaderCache.GetProgram("./shaders/vert.glsl", "./shaders/depth_frag.glsl", features & SHADER_INSTANCED);
+    mDepthModelMatrixLocation = glGetUniformLocation(mDepthShaderID, "u_ModelMatrix");
 
-    // Grass offset uniform
-    if (mDrawGrass) {
-        // shader.use();
-        for(unsigned int i = 0; i < 400; i++) {
-            // shader.setVec2(("offsets[" + std::to_string(i) + "]")), translations[i]);
-            uniformName = "offsets[" + std::to_string(i) + "]";
-            GLint u_offsetsLocation = glGetUniformLocation(mShaderID, uniformName.c_str());
-            if(u_offsetsLocation>=0){
-                // Setup the slot for the texture
-                glUniform3fv(u_offsetsLocation, 1, &mTranslations[i][0]);
-            }else{
-                std::cout << "Could not find " << uniformName << std::endl;
-            }
-        } 
-    } 
+    // Material constants are uploaded once
+    mMaterialUniforms.Initialize(g.gGLState, GL_STATIC_DRAW);
+    mMaterialUniforms.Update(GetMaterialConstants());
 }
 
 /**
-* Draw object
+* Material constants of the object, with defaults for what the mtl file does not set
 *
-* @return void
+* @return ShaderInterface::MaterialBlock
 */
-void OBJ::Draw(){
-    // Render data
-	glBindVertexArray(mVAO);
-    if (mDrawGrass) {
-        glDrawArraysInstanced(GL_TRIANGLES, 0, mVerticesArray.size()/3, 400);  
-    } else {
-        glDrawArrays(GL_TRIANGLES, 0, mVerticesArray.size()/3);
-    }
-}
-
-/**
-* Create the graphics pipeline
-*
-* @return void
-*/
-void OBJ::CreateGraphicsPipeline() {
-    std::string vertexShaderSource      = mDrawGrass ? LoadShaderAsString("./shaders/grass_vert.glsl") : LoadShaderAsString("./shaders/vert.glsl");
-    std::string fragmentShaderSource    = LoadShaderAsString("./shaders/frag.glsl");
-
-    mShaderID = CreateShaderProgram(vertexShaderSource,fragmentShaderSource);
+ShaderInterface::MaterialBlock OBJ::GetMaterialConstants() const{
+    ShaderInterface::MaterialBlock material = {};
+    // if material shininess exist and not equal to 0.0, we use material texture's shininess,
+    // else set a default 32 shininess
+    material.shininess = (mMaterial.shininess != -1.0 && mMaterial.shininess != 0.0) ? mMaterial.shininess : 32.0f;
+    // if material colors exist and are not too dark use them, else default to white
+    material.ka = (mHasMTLFile && mMaterial.ambient.r >= 0.5f && mMaterial.ambient.g >= 0.5f && mMaterial.ambient.b >= 0.5f)
+                    ? mMaterial.ambient : glm::vec3(1.f, 1.f, 1.f);
+    material.kd = (mHasMTLFile && mMaterial.diffuse.r >= 0.5f && mMaterial.diffuse.g >= 0.5f && mMaterial.diffuse.b >= 0.5f)
+                    ? mMaterial.diffuse : glm::vec3(1.f, 1.f, 1.f);
+    material.ks = (mHasMTLFile && mMaterial.specular.r >= 0.5f && mMaterial.specular.g >= 0.5f && mMaterial.specular.b >= 0.5f)
+                    ? mMaterial.specular : glm::vec3(1.f, 1.f, 1.f);
+    return material;
 }
 
 /**
@@ -540,19 +426,23 @@ void OBJ::VertexSpecification() {
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
     }
 
-    // grass
+    // grass instances, read per instance, refilled with the visible ones every frame
     if (mDrawGrass) {
-        int index = 0;
-        float offset = 0.f;
-        for(int z = -19; z <= 19; z += 2) {
-            for(int x = -19; x <= 19; x += 2) {
-                glm::vec3 translation;
-                translation.x = (float)x + offset;
-                translation.y = 0.0f;
-                translation.z = (float)z + offset;
-                mTranslations[index++] = translation;
-            }
-        }  
+        GenerateGrassInstances();
+        UpdateInstanceBounds();
+        mVisibleInstanceCount = mInstances.size();
+
+        glGenBuffers(1, &mInstanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, mInstances.size() * sizeof(InstanceData), mInstances.data(), GL_STREAM_DRAW);
+        // offset (x,y,z) and scale
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, offset));
+        glVertexAttribDivisor(5, 1);
+        // rotation and tint (r,g,b)
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, rotation));
+        glVertexAttribDivisor(6, 1);
     }
 
     // Unbind our currently bound Vertex Array Object
@@ -564,6 +454,41 @@ void OBJ::VertexSpecification() {
     glDisableVertexAttribArray(2);
     glDisableVertexAttribArray(3);
     glDisableVertexAttribArray(4);
+    glDisableVertexAttribArray(5);
+    glDisableVertexAttribArray(6);
+}
+
+/**
+* Generate grass tiles covering the map, spaced by g.gGrassSpacing.
+* Each tile gets a random quarter-turn rotation and a slight tint so that
+* the repeated texture is less visible.
+*
+* @return void
+*/
+void OBJ::GenerateGrassInstances() {
+    mInstances.clear();
+    // Chunks of a streamed world bring their own tiles, see SetInstances, and the
+    // terrain draws its own ground
+    if (g.gStreamWorld || g.gTerrain) {
+        return;
+    }
+
+    // grass.obj is a 2 by 2 tile, scale it so that neighbouring tiles touch
+    float spacing = g.gGrassSpacing;
+    float scale = spacing / 2.0f;
+    float first = g.gMinValue + spacing / 2.0f;
+
+    for (float z = first; z < g.gMaxValue; z += spacing) {
+        for (float x = first; x < g.gMaxValue; x += spacing) {
+            InstanceData instance;
+            instance.offset = glm::vec3(x, 0.0f, z);
+            instance.scale = scale;
+            instance.rotation = g.gRandom.Int(RANDOM_GRASS_TILES, 0, 3) * glm::half_pi<float>();
+            float s = g.gRandom.Uniform(RANDOM_GRASS_TILES, 0.85f, 1.0f);
+            instance.tint = glm::vec3(s, 1.0f, s);
+            mInstances.push_back(instance);
+        }
+    }
 }
 
 /**
@@ -683,8 +608,9 @@ void OBJ::clear() {
 
 
 void OBJ::randomXZCoord(int min, int max){
-    mObjectCoord.x = float(min + rand() % (max - min + 1));
-    mObjectCoord.z = float(min + rand() % (max - min + 1));
-    mObjectCoord.y = -mMin.y;
+    mObjectCoord.x = float(g.gRandom.Int(RANDOM_BATTERIES, min, max));
+    mObjectCoord.z = float(g.gRandom.Int(RANDOM_BATTERIES, min, max));
+    mObjectCoord.y = g.gHeightfield.HeightAt(glm::vec2(mObjectCoord.x, mObjectCoord.z)) - mMin.y;
+    UpdateFootprint();
  }
 
@@ -0,0 +1,154 @@
+#include "OcclusionCuller.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+
+// Two triangles per face of the cube from -1 to 1
+static const GLfloat kCubeVertices[] = {
+    -1,-1, 1,   1,-1, 1,   1, 1, 1,   -1,-1, 1,   1, 1, 1,  -1, 1, 1,  // +z
+     1,-1,-1,  -1,-1,-1,  -1, 1,-1,    1,-1,-1,  -1, 1,-1,   1, 1,-1,  // -z
+     1,-1, 1,   1,-1,-1,   1, 1,-1,    1,-1, 1,   1, 1,-1,   1, 1, 1,  // +x
+    -1,-1,-1,  -1,-1, 1,  -1, 1, 1,   -1,-1,-1,  -1, 1, 1,  -1, 1,-1,  // -x
+    -1, 1, 1,   1, 1, 1,   1, 1,-1,   -1, 1, 1,   1, 1,-1,  -1, 1,-1,  // +y
+    -1,-1,-1,   1,-1,-1,   1,-1, 1,   -1,-1,-1,   1,-1, 1,  -1,-1, 1,  // -y
+};
+
+OcclusionCuller::~OcclusionCuller(){
+    for (Entry& entry : mEntries) {
+        glDeleteQueries(1, &entry.query);
+    }
+    if (mVAO != 0) {
+        g.gGLState.DeleteBuffers(1, &mVBO);
+        g.gGLState.DeleteVertexArrays(1, &mVAO);
+    }
+}
+
+/**
+* Setup the box program and geometry and one query per tracked object
+*
+* @return void
+*/
+void OcclusionCuller::Initialize(size_t objectCount){
+    mProgram = g.gShaderCache.GetProgram("./shaders/occlusion_vert.glsl", "./shaders/occlusion_frag.glsl");
+    mCenterLocation = glGetUniformLocation(mProgram, "u_BoxCenter");
+    mExtentsLocation = glGetUniformLocation(mProgram, "u_BoxExtents");
+    if (mCenterLocation < 0 || mExtentsLocation < 0) {
+        std::cout << "Could not find u_BoxCenter or u_BoxExtents, maybe a mispelling?\n";
+        exit(EXIT_FAILURE);
+    }
+
+    glGenVertexArrays(1, &mVAO);
+    glBindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(kCubeVertices), kCubeVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glBindVertexArray(0);
+    glDisableVertexAttribArray(0);
+
+    mEntries.resize(objectCount);
+    for (Entry& entry : mEntries) {
+        glGenQueries(1, &entry.query);
+    }
+}
+
+void OcclusionCuller::BeginFrame(FrameStats& stats){
+    for (Entry& entry : mEntries) {
+        entry.tested = false;
+        if (!entry.pending) {
+            continue;
+        }
+        // Results usually arrive one or two frames later, never stall for them
+        GLuint available = 0;
+        glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint anySamples = 0;
+        glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &anySamples);
+        entry.pending = false;
+        entry.hiddenResults = anySamples ? 0 : entry.hiddenResults + 1;
+        stats.occlusionResults++;
+    }
+}
+
+bool OcclusionCuller::IsOccluded(size_t object) const{
+    return mMode == OCCLUSION_READBACK && mEntries[object].hiddenResults >= kHideAfter;
+}
+
+GLuint OcclusionCuller::GetConditionQuery(size_t object) const{
+    const Entry& entry = mEntries[object];
+    if (mMode != OCCLUSION_CONDITIONAL || !entry.queried || entry.hiddenResults < kHideAfter) {
+        return 0;
+    }
+    return entry.query;
+}
+
+void OcclusionCuller::MarkCulled(size_t object){
+    // It may come back into view anywhere, start over as visible
+    mEntries[object].hiddenResults = 0;
+}
+
+void OcclusionCuller::MarkTested(size_t object, const glm::vec3& center, const glm::vec3& extents){
+    Entry& entry = mEntries[object];
+    entry.tested = true;
+    entry.center = center;
+    entry.extents = extents;
+}
+
+/**
+* Render the box of every tested object inside its query. Must be called
+* after the scene so that everything drawn this frame can occlude the boxes.
+*
+* @return void
+*/
+void OcclusionCuller::IssueQueries(GLState& state, const glm::vec3& eyePosition, float nearPlane, FrameStats& stats){
+    if (mMode == OCCLUSION_OFF) {
+        return;
+    }
+
+    state.UseProgram(mProgram);
+    state.BindVertexArray(mVAO);
+    state.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    state.DepthMask(GL_FALSE);
+    state.Disable(GL_CULL_FACE);
+
+    for (Entry& entry : mEntries) {
+        if (!entry.tested || entry.pending) {
+            continue;
+        }
+        // The near plane would clip the box around the eye, the object counts as visible
+        glm::vec3 distance = glm::abs(eyePosition - entry.center) - entry.extents;
+        if (distance.x < nearPlane && distance.y < nearPlane && distance.z < nearPlane) {
+            entry.hiddenResults = 0;
+            continue;
+        }
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.query);
+        glUniform3fv(mCenterLocation, 1, &entry.center[0]);
+        glUniform3fv(mExtentsLocation, 1, &entry.extents[0]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        entry.pending = true;
+        entry.queried = true;
+        stats.occlusionQueries++;
+    }
+
+    state.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    state.DepthMask(GL_TRUE);
+}
+
+void OcclusionCuller::CycleMode(){
+    mMode = (OcclusionMode)((mMode + 1) % 3);
+    // No queries run while off, so the history may be stale
+    for (Entry& entry : mEntries) {
+        entry.hiddenResults = 0;
+    }
+    const char* names[] = {"off", "readback", "conditional render"};
+    std::cout << "Occlusion culling: " << names[mMode] << std::endl;
+}
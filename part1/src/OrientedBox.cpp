@@ -0,0 +1,107 @@
+#include "OrientedBox.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+    #define ORIENTEDBOX_SSE
+    #include <xmmintrin.h>
+#endif
+
+OrientedBox2D OrientedBox2D::FromLocal(const glm::vec2& origin, float rotation, const glm::vec2& localMin, const glm::vec2& localMax){
+    OrientedBox2D box;
+    box.cosRot = std::cos(glm::radians(rotation));
+    box.sinRot = std::sin(glm::radians(rotation));
+    // Local center rotated like the model matrix, x' = c x + s z, z' = -s x + c z
+    glm::vec2 localCenter = (localMin + localMax) * 0.5f;
+    box.center = origin + glm::vec2(box.cosRot * localCenter.x + box.sinRot * localCenter.y,
+                                    -box.sinRot * localCenter.x + box.cosRot * localCenter.y);
+    box.halfExtents = (localMax - localMin) * 0.5f;
+    return box;
+}
+
+bool OrientedBox2D::Contains(const glm::vec2& point, float margin) const{
+    glm::vec2 d = point - center;
+    // Inverse rotation into the box
+    float localX = cosRot * d.x - sinRot * d.y;
+    float localZ = sinRot * d.x + cosRot * d.y;
+    return std::fabs(localX) <= halfExtents.x + margin && std::fabs(localZ) <= halfExtents.y + margin;
+}
+
+void OrientedBox2D::Bounds(float margin, glm::vec2& outMin, glm::vec2& outMax) const{
+    glm::vec2 half = halfExtents + margin;
+    glm::vec2 reach(std::fabs(cosRot) * half.x + std::fabs(sinRot) * half.y,
+                    std::fabs(sinRot) * half.x + std::fabs(cosRot) * half.y);
+    outMin = center - reach;
+    outMax = center + reach;
+}
+
+void OrientedBoxList::Add(const OrientedBox2D& box){
+    cx.push_back(box.center.x);
+    cz.push_back(box.center.y);
+    cosRot.push_back(box.cosRot);
+    sinRot.push_back(box.sinRot);
+    hx.push_back(box.halfExtents.x);
+    hz.push_back(box.halfExtents.y);
+}
+
+void OrientedBoxList::Remove(size_t index){
+    for (std::vector<float>* component : {&cx, &cz, &cosRot, &sinRot, &hx, &hz}) {
+        component->erase(component->begin() + index);
+    }
+}
+
+void OrientedBoxList::RemoveSwap(size_t index){
+    for (std::vector<float>* component : {&cx, &cz, &cosRot, &sinRot, &hx, &hz}) {
+        (*component)[index] = component->back();
+        component->pop_back();
+    }
+}
+
+void OrientedBoxList::Clear(){
+    for (std::vector<float>* component : {&cx, &cz, &cosRot, &sinRot, &hx, &hz}) {
+        component->clear();
+    }
+}
+
+size_t OrientedBoxList::ContainsPoint(const glm::vec2& point, float margin, std::vector<uint32_t>& mask) const{
+    size_t count = Size();
+    mask.assign((count + 31) / 32, 0u);
+    size_t hits = 0;
+    size_t i = 0;
+#ifdef ORIENTEDBOX_SSE
+    __m128 px = _mm_set1_ps(point.x);
+    __m128 pz = _mm_set1_ps(point.y);
+    __m128 m = _mm_set1_ps(margin);
+    __m128 signBit = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&cx[i]));
+        __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&cz[i]));
+        __m128 c = _mm_loadu_ps(&cosRot[i]);
+        __m128 s = _mm_loadu_ps(&sinRot[i]);
+        __m128 localX = _mm_sub_ps(_mm_mul_ps(c, dx), _mm_mul_ps(s, dz));
+        __m128 localZ = _mm_add_ps(_mm_mul_ps(s, dx), _mm_mul_ps(c, dz));
+        __m128 insideX = _mm_cmple_ps(_mm_andnot_ps(signBit, localX), _mm_add_ps(_mm_loadu_ps(&hx[i]), m));
+        __m128 insideZ = _mm_cmple_ps(_mm_andnot_ps(signBit, localZ), _mm_add_ps(_mm_loadu_ps(&hz[i]), m));
+        uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_and_ps(insideX, insideZ));
+        if (bits != 0) {
+            // i is a multiple of 4, the 4 bits never straddle two words
+            mask[i / 32] |= bits << (i % 32);
+            hits += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+        }
+    }
+#endif
+    // Remainder, or every box without SSE
+    for (; i < count; ++i) {
+        float dx = point.x - cx[i];
+        float dz = point.y - cz[i];
+        float localX = cosRot[i] * dx - sinRot[i] * dz;
+        float localZ = sinRot[i] * dx + cosRot[i] * dz;
+        if (std::fabs(localX) <= hx[i] + margin && std::fabs(localZ) <= hz[i] + margin) {
+            mask[i / 32] |= 1u << (i % 32);
+            hits++;
+        }
+    }
+    return hits;
+}
@@ -0,0 +1,190 @@
+#include "PoissonDisk.hpp"
+#include "Random.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Random points tried for a new start once the active list is empty, reset
+// every time one of them fits
+static const int kRestartDarts = 4 * PoissonDisk::kAttempts;
+static const int kMaxExclusionCellsPerSide = 1024;
+
+PoissonDisk::PoissonDisk(float minValue, float maxValue, uint32_t seed)
+    : mMinValue(minValue), mMaxValue(maxValue), mGenerator(seed){
+}
+
+void PoissonDisk::AddExclusion(const glm::vec2& center, float radius){
+    mExclusions.push_back({center, radius});
+    mExclusionGridDirty = true;
+}
+
+/**
+* Cells as wide as the largest exclusion, filled in three passes like
+* CollisionGrid::Build
+*
+* @return void
+*/
+void PoissonDisk::BuildExclusionGrid(){
+    mExclusionGridDirty = false;
+    // IsExcluded() does not look at the grid then
+    if (mExclusions.empty()) {
+        return;
+    }
+    float size = mMaxValue - mMinValue;
+    float largest = 0.0f;
+    for (const Exclusion& exclusion : mExclusions) {
+        largest = std::max(largest, 2.0f * exclusion.radius);
+    }
+    mExclusionCellSize = std::max(largest, size / kMaxExclusionCellsPerSide);
+    mExclusionCellsPerSide = std::max(1, (int)std::ceil(size / mExclusionCellSize));
+
+    std::vector<glm::ivec4> ranges(mExclusions.size());
+    for (size_t i = 0; i < mExclusions.size(); ++i) {
+        glm::vec2 cellMin = glm::floor((mExclusions[i].center - mExclusions[i].radius - mMinValue) / mExclusionCellSize);
+        glm::vec2 cellMax = glm::floor((mExclusions[i].center + mExclusions[i].radius - mMinValue) / mExclusionCellSize);
+        ranges[i] = glm::clamp(glm::ivec4(cellMin.x, cellMin.y, cellMax.x, cellMax.y), 0, mExclusionCellsPerSide - 1);
+    }
+    size_t cellCount = (size_t)mExclusionCellsPerSide * mExclusionCellsPerSide;
+    mExclusionCellStart.assign(cellCount + 1, 0);
+    for (const glm::ivec4& range : ranges) {
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mExclusionCellStart[z * mExclusionCellsPerSide + x + 1]++;
+            }
+        }
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        mExclusionCellStart[c + 1] += mExclusionCellStart[c];
+    }
+    mExclusionCellItems.resize(mExclusionCellStart[cellCount]);
+    std::vector<uint32_t> cursor(mExclusionCellStart.begin(), mExclusionCellStart.end() - 1);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const glm::ivec4& range = ranges[i];
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mExclusionCellItems[cursor[z * mExclusionCellsPerSide + x]++] = (uint32_t)i;
+            }
+        }
+    }
+}
+
+bool PoissonDisk::IsExcluded(const glm::vec2& point) const{
+    if (mExclusions.empty()) {
+        return false;
+    }
+    int x = glm::clamp((int)std::floor((point.x - mMinValue) / mExclusionCellSize), 0, mExclusionCellsPerSide - 1);
+    int z = glm::clamp((int)std::floor((point.y - mMinValue) / mExclusionCellSize), 0, mExclusionCellsPerSide - 1);
+    int cell = z * mExclusionCellsPerSide + x;
+    for (uint32_t i = mExclusionCellStart[cell]; i < mExclusionCellStart[cell + 1]; ++i) {
+        const Exclusion& exclusion = mExclusions[mExclusionCellItems[i]];
+        glm::vec2 offset = point - exclusion.center;
+        if (glm::dot(offset, offset) < exclusion.radius * exclusion.radius) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* Bridson's algorithm over a grid of cells radius / sqrt(2) wide, so that a
+* cell holds at most one point and every neighbour closer than radius is in
+* the 5x5 cells around a candidate
+*
+* @return std::vector<glm::vec2>
+*/
+std::vector<glm::vec2> PoissonDisk::Sample(float radius){
+    if (mExclusionGridDirty) {
+        BuildExclusionGrid();
+    }
+    float size = mMaxValue - mMinValue;
+    float cellSize = radius / glm::root_two<float>();
+    int cellsPerSide = std::max(1, (int)std::ceil(size / cellSize));
+    std::vector<int32_t> grid((size_t)cellsPerSide * cellsPerSide, -1);
+
+    std::vector<glm::vec2> points;
+    std::vector<uint32_t> active;
+
+    // Point fits when inside the square, outside the exclusions and radius away from the other points
+    auto fits = [&](const glm::vec2& point, glm::ivec2& outCell){
+        if (point.x < mMinValue || point.y < mMinValue || point.x >= mMaxValue || point.y >= mMaxValue) {
+            return false;
+        }
+        outCell = glm::min(glm::ivec2(glm::floor((point - mMinValue) / cellSize)), cellsPerSide - 1);
+        // Most candidates land in a taken cell
+        if (grid[outCell.y * cellsPerSide + outCell.x] >= 0) {
+            return false;
+        }
+        for (int z = std::max(outCell.y - 2, 0); z <= std::min(outCell.y + 2, cellsPerSide - 1); ++z) {
+            for (int x = std::max(outCell.x - 2, 0); x <= std::min(outCell.x + 2, cellsPerSide - 1); ++x) {
+                int32_t other = grid[z * cellsPerSide + x];
+                if (other >= 0) {
+                    glm::vec2 offset = point - points[other];
+                    if (glm::dot(offset, offset) < radius * radius) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return !IsExcluded(point);
+    };
+    auto accept = [&](const glm::vec2& point, const glm::ivec2& cell){
+        grid[cell.y * cellsPerSide + cell.x] = (int32_t)points.size();
+        active.push_back((uint32_t)points.size());
+        points.push_back(point);
+    };
+
+    int darts = 0;
+    while (darts < kRestartDarts) {
+        // New start anywhere on the square
+        float startX = Random::Uniform(mGenerator, mMinValue, mMaxValue);
+        glm::vec2 start(startX, Random::Uniform(mGenerator, mMinValue, mMaxValue));
+        glm::ivec2 cell;
+        if (!fits(start, cell)) {
+            darts++;
+            continue;
+        }
+        darts = 0;
+        accept(start, cell);
+
+        while (!active.empty()) {
+            size_t slot = (size_t)Random::Int(mGenerator, 0, (int)active.size() - 1);
+            glm::vec2 center = points[active[slot]];
+            bool found = false;
+            for (int attempt = 0; attempt < kAttempts && !found; ++attempt) {
+                // Uniform over the area of the ring [radius, 2 radius]
+                float distance = radius * std::sqrt(Random::Uniform(mGenerator, 1.0f, 4.0f));
+                float angle = Random::Uniform(mGenerator, 0.0f, glm::two_pi<float>());
+                glm::vec2 candidate = center + distance * glm::vec2(std::cos(angle), std::sin(angle));
+                if (fits(candidate, cell)) {
+                    accept(candidate, cell);
+                    found = true;
+                }
+            }
+            if (!found) {
+                active[slot] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+    return points;
+}
+
+std::vector<glm::vec2> PoissonDisk::Sample(float radius, size_t count){
+    std::vector<glm::vec2> points = Sample(radius);
+    if (points.size() < count) {
+        std::cout << "Poisson-disk sampling: only " << points.size() << " of " << count
+                  << " points fit at radius " << radius << std::endl;
+        return points;
+    }
+    // Partial Fisher-Yates, the first count points are a uniform pick
+    for (size_t i = 0; i < count; ++i) {
+        size_t j = (size_t)Random::Int(mGenerator, (int)i, (int)points.size() - 1);
+        std::swap(points[i], points[j]);
+    }
+    points.resize(count);
+    return points;
+}
@@ -0,0 +1,53 @@
+#include "Random.hpp"
+
+void Random::Seed(uint32_t seed){
+    mSeed = seed;
+    for (uint32_t stream = 0; stream < RANDOM_STREAM_COUNT; ++stream) {
+        mStreams[stream].seed(StreamSeed((RandomStream)stream));
+    }
+}
+
+/**
+* Mix the world seed with the stream index (the finalizer of splitmix64), so
+* that nearby seeds and streams start far apart
+*
+* @return uint32_t
+*/
+uint32_t Random::StreamSeed(RandomStream stream) const{
+    return Mix((uint64_t)mSeed << 32 | stream);
+}
+
+/**
+* Chunk coordinates mixed first, then with the seed of the stream, so a chunk
+* gets the same numbers whenever and on whichever thread it is generated
+*
+* @return uint32_t
+*/
+uint32_t Random::ChunkSeed(uint32_t streamSeed, int x, int z){
+    uint32_t coord = Mix((uint64_t)(uint32_t)x << 32 | (uint32_t)z);
+    return Mix((uint64_t)streamSeed << 32 | coord);
+}
+
+uint32_t Random::Mix(uint64_t value){
+    uint64_t z = value + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (uint32_t)(z ^ (z >> 31));
+}
+
+float Random::Uniform(std::mt19937& generator, float min, float max){
+    // 24 bits, every value exactly representable in a float
+    float unit = (float)(generator() >> 8) * (1.0f / 16777216.0f);
+    return min + (max - min) * unit;
+}
+
+/**
+* Multiply-shift of a 32 bit draw into the range, no value is more likely
+* than another by more than range / 2^32
+*
+* @return int
+*/
+int Random::Int(std::mt19937& generator, int min, int max){
+    uint64_t range = (uint64_t)((int64_t)max - (int64_t)min + 1);
+    return min + (int)(((uint64_t)generator() * range) >> 32);
+}
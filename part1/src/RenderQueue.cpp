@@ -0,0 +1,182 @@
+#include "RenderQueue.hpp"
+#include "generated/ShaderInterface.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+// Bit layout of the sort key, from most to least significant
+static const int kDepthBits     = 20;
+static const int kVAOBits       = 12;
+static const int kMaterialBits  = 16;
+static const int kProgramBits   = 12;
+
+static const int kDepthShift    = 0;
+static const int kVAOShift      = kDepthShift + kDepthBits;
+static const int kMaterialShift = kVAOShift + kVAOBits;
+static const int kProgramShift  = kMaterialShift + kMaterialBits;
+static const int kPassShift     = kProgramShift + kProgramBits;
+
+void RenderQueue::Begin(const glm::vec3& eyePosition, float farPlane){
+    mEyePosition = eyePosition;
+    mFarPlane = farPlane;
+    mPackets.clear();
+    mKeys.clear();
+    // Ids only need to be distinct within a frame, so deleted textures and
+    // buffers never pile up and ids stay within kMaterialBits
+    mMaterialIndices.clear();
+}
+
+void RenderQueue::Submit(const DrawPacket& packet, RenderPass pass, const glm::vec3& worldCenter){
+    mKeys.push_back(MakeKey(packet, pass, worldCenter));
+    mPackets.push_back(packet);
+}
+
+/**
+* Give every distinct (textures, material buffer) combination a small id,
+* so that packets sharing a material end up next to each other. Past the
+* last id every new set shares it, which only costs batching, not order
+* between passes or programs.
+*
+* @return id of the material set
+*/
+uint16_t RenderQueue::MaterialIndex(const DrawPacket& packet){
+    auto materialSet = std::make_tuple(packet.textures[0], packet.textures[1], packet.textures[2], packet.materialUBO);
+    auto it = mMaterialIndices.find(materialSet);
+    if (it != mMaterialIndices.end()) {
+        return it->second;
+    }
+    const size_t kLastIndex = (1u << kMaterialBits) - 1;
+    if (mMaterialIndices.size() >= kLastIndex) {
+        return (uint16_t)kLastIndex;
+    }
+    uint16_t index = (uint16_t)mMaterialIndices.size();
+    mMaterialIndices[materialSet] = index;
+    return index;
+}
+
+uint64_t RenderQueue::MakeKey(const DrawPacket& packet, RenderPass pass, const glm::vec3& worldCenter){
+    // Quantize distance to the eye, near objects first
+    float depth = glm::clamp(glm::length(worldCenter - mEyePosition) / mFarPlane, 0.0f, 1.0f);
+    uint64_t depthBits = (uint64_t)(depth * ((1u << kDepthBits) - 1));
+
+    return ((uint64_t)pass << kPassShift)
+         | (((uint64_t)packet.program & ((1u << kProgramBits) - 1)) << kProgramShift)
+         | (((uint64_t)MaterialIndex(packet) & ((1u << kMaterialBits) - 1)) << kMaterialShift)
+         | (((uint64_t)packet.vao & ((1u << kVAOBits) - 1)) << kVAOShift)
+         | (depthBits << kDepthShift);
+}
+
+/**
+* LSD radix sort of the packet order by key, one byte per pass.
+* Passes where every key has the same byte are skipped.
+*
+* @return void
+*/
+void RenderQueue::RadixSort(){
+    size_t count = mKeys.size();
+    mOrder.resize(count);
+    mScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        mOrder[i] = (uint32_t)i;
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256];
+        std::memset(histogram, 0, sizeof(histogram));
+        for (size_t i = 0; i < count; ++i) {
+            histogram[(mKeys[i] >> shift) & 0xFF]++;
+        }
+        // Every key shares this byte, order does not change
+        if (count == 0 || histogram[(mKeys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            size_t bucketSize = histogram[b];
+            histogram[b] = offset;
+            offset += bucketSize;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t index = mOrder[i];
+            mScratch[histogram[(mKeys[index] >> shift) & 0xFF]++] = index;
+        }
+        mOrder.swap(mScratch);
+    }
+}
+
+void RenderQueue::Sort(){
+    RadixSort();
+}
+
+void RenderQueue::DrawDepth(GLState& state, FrameStats& stats){
+    DrawPackets(state, stats, true);
+}
+
+void RenderQueue::Draw(GLState& state, FrameStats& stats){
+    DrawPackets(state, stats, false);
+}
+
+/**
+* Draw the packets in sorted order. The depth only version uses each packet's
+* depth program and skips the material, and textures unless the depth program
+* alpha tests.
+*
+* @return void
+*/
+void RenderQueue::DrawPackets(GLState& state, FrameStats& stats, bool depthOnly){
+    for (uint32_t index : mOrder) {
+        const DrawPacket& packet = mPackets[index];
+        GLuint program = depthOnly ? packet.depthProgram : packet.program;
+        GLint modelMatrixLocation = depthOnly ? packet.depthModelMatrixLocation : packet.modelMatrixLocation;
+        if (program == 0) {
+            continue;
+        }
+        if (depthOnly) {
+            stats.depthPackets++;
+        } else {
+            stats.packets++;
+        }
+
+        // The state cache drops binds of what is already bound
+        if (state.UseProgram(program)) {
+            stats.programSwitches++;
+        }
+        if (state.BindVertexArray(packet.vao)) {
+            stats.vaoSwitches++;
+        }
+        if (!depthOnly && packet.materialUBO != 0
+            && state.BindBufferBase(GL_UNIFORM_BUFFER, ShaderInterface::MaterialBlock::kBinding, packet.materialUBO)) {
+            stats.materialSwitches++;
+        }
+        if (!depthOnly || packet.depthNeedsTextures) {
+            for (int slot = 0; slot < kPacketTextureSlots; ++slot) {
+                if (packet.textures[slot] == 0) {
+                    continue;
+                }
+                stats.textureRequests++;
+                if (state.BindTexture(slot, GL_TEXTURE_2D, packet.textures[slot])) {
+                    stats.textureSwitches++;
+                }
+            }
+        }
+        if (modelMatrixLocation >= 0) {
+            glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &packet.model[0][0]);
+        }
+
+        // The GPU skips the draw if the query saw no samples, without waiting for it
+        if (packet.conditionQuery != 0) {
+            glBeginConditionalRender(packet.conditionQuery, GL_QUERY_NO_WAIT);
+        }
+        if (packet.instanceCount > 0) {
+            glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instanceCount);
+        } else {
+            glDrawArrays(packet.mode, packet.first, packet.count);
+        }
+        if (packet.conditionQuery != 0) {
+            glEndConditionalRender();
+        }
+    }
+}
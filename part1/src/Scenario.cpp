@@ -0,0 +1,117 @@
+#include "Scenario.hpp"
+#include "globals.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Whitespace removed from both ends
+static std::string Trim(const std::string& text){
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Parse the whole of value into result
+template <typename T>
+static bool ParseValue(const std::string& value, T& result){
+    std::istringstream stream(value);
+    stream >> result;
+    return !stream.fail() && stream.eof();
+}
+
+/**
+* Numbers are parsed whole ("40x" is an error), paths are taken as written
+*
+* @return bool
+*/
+static bool ApplySetting(const std::string& key, const std::string& value){
+    if (key == "seed") {
+        return ParseValue(value, g.gSeed);
+    } else if (key == "map_size") {
+        float mapSize = 0.0f;
+        if (!ParseValue(value, mapSize) || mapSize <= 10.0f) {
+            return false;
+        }
+        g.gMinValue = -0.5f * mapSize;
+        g.gMaxValue = 0.5f * mapSize;
+        return true;
+    } else if (key == "trees_per_kind") {
+        return ParseValue(value, g.gTreesPerKind) && g.gTreesPerKind >= 0;
+    } else if (key == "tree_spacing") {
+        return ParseValue(value, g.gTreeSpacing) && g.gTreeSpacing > 0.0f;
+    } else if (key == "batteries") {
+        return ParseValue(value, g.gBatteryCount) && g.gBatteryCount >= 0;
+    } else if (key == "grass_spacing") {
+        return ParseValue(value, g.gGrassSpacing) && g.gGrassSpacing > 0.0f;
+    } else if (key == "grass_blades_per_unit") {
+        return ParseValue(value, g.gGrassBladesPerUnit) && g.gGrassBladesPerUnit >= 0.0f;
+    } else if (key == "streaming") {
+        return ParseValue(value, g.gStreamWorld);
+    } else if (key == "chunk_size") {
+        return ParseValue(value, g.gChunkSize) && g.gChunkSize >= 4.0f;
+    } else if (key == "stream_radius") {
+        return ParseValue(value, g.gStreamRadius) && g.gStreamRadius > 0.0f;
+    } else if (key == "stream_memory_mb") {
+        return ParseValue(value, g.gStreamMemoryMB) && g.gStreamMemoryMB > 0.0f;
+    } else if (key == "stream_threads") {
+        return ParseValue(value, g.gStreamThreads) && g.gStreamThreads > 0;
+    } else if (key == "tree_density") {
+        return ParseValue(value, g.gTreeDensity) && g.gTreeDensity >= 0.0f;
+    } else if (key == "structure_area") {
+        return ParseValue(value, g.gStructureAreaSize) && g.gStructureAreaSize > 10.0f;
+    } else if (key == "terrain") {
+        return ParseValue(value, g.gTerrain);
+    } else if (key == "terrain_height") {
+        return ParseValue(value, g.gTerrainHeight) && g.gTerrainHeight >= 0.0f;
+    } else if (key == "terrain_feature_size") {
+        return ParseValue(value, g.gTerrainFeatureSize) && g.gTerrainFeatureSize > 0.0f;
+    }
+
+    std::string* asset = nullptr;
+    if (key == "house") { asset = &g.gHouseFileName; }
+    else if (key == "chapel") { asset = &g.gChapelFileName; }
+    else if (key == "windmill") { asset = &g.gWindmillFileName; }
+    else if (key == "chalice") { asset = &g.gChaliceFileName; }
+    else if (key == "battery") { asset = &g.gBatteryFileName; }
+    else if (key == "grass") { asset = &g.gGrassFileName; }
+    else if (key == "tree0") { asset = &g.gTreeFileName; }
+    else if (key == "tree1") { asset = &g.gTreeFileName1; }
+    else if (key == "tree2") { asset = &g.gTreeFileName2; }
+    else if (key == "tree3") { asset = &g.gTreeFileName3; }
+    if (asset == nullptr || value.empty()) {
+        return false;
+    }
+    *asset = value;
+    return true;
+}
+
+bool LoadScenario(const std::string& fileName){
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        std::cout << "Could not open scenario " << fileName << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t equals = line.find('=');
+        std::string key = equals == std::string::npos ? line : Trim(line.substr(0, equals));
+        std::string value = equals == std::string::npos ? "" : Trim(line.substr(equals + 1));
+        if (equals == std::string::npos || !ApplySetting(key, value)) {
+            std::cout << fileName << ":" << lineNumber << ": bad setting \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Loaded scenario " << fileName << std::endl;
+    return true;
+}
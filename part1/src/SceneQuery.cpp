@@ -0,0 +1,336 @@
+#include "SceneQuery.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Average items per cell the grid is sized for
+static const float kItemsPerCell = 2.0f;
+// Cells are never smaller than this, nor more than kMaxCellsPerSide per side
+static const float kMinCellSize = 0.05f;
+static const int kMaxCellsPerSide = 1024;
+// Items a ray remembers having tested, an item spanning several cells is
+// usually met in consecutive cells
+static const int kRecentItems = 8;
+
+uint32_t SceneQuery::AddMesh(const OrientedBox2D& footprint, const glm::vec3& origin, float minY, float maxY, const MeshBVH& bvh){
+    mItems.push_back({footprint, minY, maxY, origin, &bvh});
+    return (uint32_t)mItems.size() - 1;
+}
+
+uint32_t SceneQuery::AddBox(const OrientedBox2D& footprint, float minY, float maxY){
+    mItems.push_back({footprint, minY, maxY, glm::vec3(0.0f), nullptr});
+    return (uint32_t)mItems.size() - 1;
+}
+
+/**
+* Size the cells from the item count, then count, offset and fill the items
+* of each cell in three passes, as CollisionGrid::Build
+*
+* @return void
+*/
+void SceneQuery::Build(float minValue, float maxValue){
+    Build(glm::vec2(minValue), glm::vec2(maxValue));
+}
+
+void SceneQuery::Build(glm::vec2 minValue, glm::vec2 maxValue){
+    // Grown over items reaching past the map, so rays starting there find them
+    for (const Item& item : mItems) {
+        glm::vec2 boundsMin, boundsMax;
+        item.footprint.Bounds(0.0f, boundsMin, boundsMax);
+        minValue = glm::min(minValue, boundsMin);
+        maxValue = glm::max(maxValue, boundsMax);
+    }
+    // Square cells over a square grid, as wide as the longer side
+    float size = std::max(maxValue.x - minValue.x, maxValue.y - minValue.y);
+    float cellSize = std::sqrt(size * size * kItemsPerCell / std::max<size_t>(mItems.size(), 1));
+    cellSize = std::max(cellSize, std::max(kMinCellSize, size / kMaxCellsPerSide));
+    mCellsPerSide = std::max(1, (int)std::ceil(size / cellSize));
+    mCellSize = size / mCellsPerSide;
+    mMinValue = minValue;
+
+    std::vector<glm::ivec4> ranges(mItems.size());
+    for (size_t i = 0; i < mItems.size(); ++i) {
+        glm::vec2 boundsMin, boundsMax;
+        mItems[i].footprint.Bounds(0.0f, boundsMin, boundsMax);
+        glm::vec2 cellMin = glm::floor((boundsMin - minValue) / mCellSize);
+        glm::vec2 cellMax = glm::floor((boundsMax - minValue) / mCellSize);
+        ranges[i] = glm::clamp(glm::ivec4(cellMin.x, cellMin.y, cellMax.x, cellMax.y), 0, mCellsPerSide - 1);
+    }
+
+    size_t cellCount = (size_t)mCellsPerSide * mCellsPerSide;
+    mCellStart.assign(cellCount + 1, 0);
+    for (const glm::ivec4& range : ranges) {
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mCellStart[z * mCellsPerSide + x + 1]++;
+            }
+        }
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+    mCellItems.resize(mCellStart[cellCount]);
+    std::vector<uint32_t> cursor(mCellStart.begin(), mCellStart.end() - 1);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const glm::ivec4& range = ranges[i];
+        for (int z = range.y; z <= range.w; ++z) {
+            for (int x = range.x; x <= range.z; ++x) {
+                mCellItems[cursor[z * mCellsPerSide + x]++] = (uint32_t)i;
+            }
+        }
+    }
+}
+
+void SceneQuery::Clear(){
+    mItems.clear();
+    mCellStart.clear();
+    mCellItems.clear();
+    mCellsPerSide = 0;
+}
+
+/**
+* Slab test in the frame of the footprint, y is not rotated
+*
+* @return bool
+*/
+bool SceneQuery::RayVolume(const Item& item, const SceneRay& ray, float maxDistance, float& outDistance) const{
+    const OrientedBox2D& box = item.footprint;
+    glm::vec2 d(ray.origin.x - box.center.x, ray.origin.z - box.center.y);
+    glm::vec3 origin(box.cosRot * d.x - box.sinRot * d.y, ray.origin.y, box.sinRot * d.x + box.cosRot * d.y);
+    glm::vec3 direction(box.cosRot * ray.direction.x - box.sinRot * ray.direction.z, ray.direction.y,
+                        box.sinRot * ray.direction.x + box.cosRot * ray.direction.z);
+    glm::vec3 boundsMin(-box.halfExtents.x, item.minY, -box.halfExtents.y);
+    glm::vec3 boundsMax(box.halfExtents.x, item.maxY, box.halfExtents.y);
+
+    float tNear = 0.0f;
+    float tFar = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::fabs(direction[axis]) < FLT_EPSILON) {
+            if (origin[axis] < boundsMin[axis] || origin[axis] > boundsMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float inverse = 1.0f / direction[axis];
+        float t0 = (boundsMin[axis] - origin[axis]) * inverse;
+        float t1 = (boundsMax[axis] - origin[axis]) * inverse;
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+        if (tNear > tFar) {
+            return false;
+        }
+    }
+    outDistance = tNear;
+    return true;
+}
+
+bool SceneQuery::SphereTouches(const Item& item, const SceneSphere& sphere) const{
+    const OrientedBox2D& box = item.footprint;
+    glm::vec2 d(sphere.center.x - box.center.x, sphere.center.z - box.center.y);
+    glm::vec3 center(box.cosRot * d.x - box.sinRot * d.y, sphere.center.y, box.sinRot * d.x + box.cosRot * d.y);
+    glm::vec3 closest = glm::clamp(center, glm::vec3(-box.halfExtents.x, item.minY, -box.halfExtents.y),
+                                   glm::vec3(box.halfExtents.x, item.maxY, box.halfExtents.y));
+    glm::vec3 offset = center - closest;
+    if (glm::dot(offset, offset) > sphere.radius * sphere.radius) {
+        return false;
+    }
+    if (item.bvh == nullptr) {
+        return true;
+    }
+    // Sphere in the frame of the mesh, a capsule of length 0
+    glm::vec3 fromOrigin = sphere.center - item.origin;
+    glm::vec3 local(box.cosRot * fromOrigin.x - box.sinRot * fromOrigin.z, fromOrigin.y,
+                    box.sinRot * fromOrigin.x + box.cosRot * fromOrigin.z);
+    return item.bvh->OverlapsCapsule(local, local, sphere.radius);
+}
+
+/**
+* Height ranges, then separating axes of the two rectangles on the xz plane:
+* the world axes of the query box and the two axes of the footprint
+*
+* @return bool
+*/
+bool SceneQuery::BoxTouches(const Item& item, const SceneBox& box) const{
+    if (box.boxMax.y < item.minY || box.boxMin.y > item.maxY) {
+        return false;
+    }
+    const OrientedBox2D& footprint = item.footprint;
+    glm::vec2 half(box.boxMax.x - box.boxMin.x, box.boxMax.z - box.boxMin.z);
+    half *= 0.5f;
+    glm::vec2 d(footprint.center.x - (box.boxMin.x + box.boxMax.x) * 0.5f,
+                footprint.center.y - (box.boxMin.z + box.boxMax.z) * 0.5f);
+    float c = std::fabs(footprint.cosRot);
+    float s = std::fabs(footprint.sinRot);
+    const glm::vec2& extents = footprint.halfExtents;
+    if (std::fabs(d.x) > half.x + c * extents.x + s * extents.y ||
+        std::fabs(d.y) > half.y + s * extents.x + c * extents.y) {
+        return false;
+    }
+    // Footprint axes in world space are (cos, -sin) and (sin, cos)
+    float alongX = footprint.cosRot * d.x - footprint.sinRot * d.y;
+    float alongZ = footprint.sinRot * d.x + footprint.cosRot * d.y;
+    return std::fabs(alongX) <= extents.x + c * half.x + s * half.y &&
+           std::fabs(alongZ) <= extents.y + s * half.x + c * half.y;
+}
+
+void SceneQuery::GatherItems(const glm::vec2& boundsMin, const glm::vec2& boundsMax, std::vector<uint32_t>& outItems) const{
+    outItems.clear();
+    if (mCellsPerSide == 0) {
+        return;
+    }
+    glm::vec2 cellMin = glm::floor((boundsMin - mMinValue) / mCellSize);
+    glm::vec2 cellMax = glm::floor((boundsMax - mMinValue) / mCellSize);
+    glm::ivec4 range = glm::clamp(glm::ivec4(cellMin.x, cellMin.y, cellMax.x, cellMax.y), 0, mCellsPerSide - 1);
+    for (int z = range.y; z <= range.w; ++z) {
+        for (int x = range.x; x <= range.z; ++x) {
+            int cell = z * mCellsPerSide + x;
+            outItems.insert(outItems.end(), mCellItems.begin() + mCellStart[cell], mCellItems.begin() + mCellStart[cell + 1]);
+        }
+    }
+    std::sort(outItems.begin(), outItems.end());
+    outItems.erase(std::unique(outItems.begin(), outItems.end()), outItems.end());
+}
+
+/**
+* Walk the cells under each ray in order (Amanatides and Woo) from where it
+* enters the grid, testing the items of each cell, until the nearest hit is
+* before the end of the current cell
+*
+* @return void
+*/
+void SceneQuery::Raycast(const SceneRay* rays, size_t count, SceneHit* outHits) const{
+    glm::vec2 gridMax = mMinValue + mCellSize * mCellsPerSide;
+    for (size_t r = 0; r < count; ++r) {
+        const SceneRay& ray = rays[r];
+        SceneHit& hit = outHits[r];
+        hit.distance = ray.maxDistance;
+        hit.item = -1;
+        hit.triangle = 0;
+        if (mCellsPerSide == 0) {
+            continue;
+        }
+
+        // Part of the ray over the grid
+        glm::vec2 origin(ray.origin.x, ray.origin.z);
+        glm::vec2 direction(ray.direction.x, ray.direction.z);
+        float tEnter = 0.0f;
+        float tExit = ray.maxDistance;
+        bool missesGrid = false;
+        for (int axis = 0; axis < 2 && !missesGrid; ++axis) {
+            if (std::fabs(direction[axis]) < FLT_EPSILON) {
+                missesGrid = origin[axis] < mMinValue[axis] || origin[axis] > gridMax[axis];
+                continue;
+            }
+            float t0 = (mMinValue[axis] - origin[axis]) / direction[axis];
+            float t1 = (gridMax[axis] - origin[axis]) / direction[axis];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+            missesGrid = tEnter > tExit;
+        }
+        if (missesGrid) {
+            continue;
+        }
+
+        glm::vec2 start = (origin + direction * tEnter - mMinValue) / mCellSize;
+        glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor(start)), 0, mCellsPerSide - 1);
+        glm::ivec2 step(direction.x > 0.0f ? 1 : -1, direction.y > 0.0f ? 1 : -1);
+        glm::vec2 tNext, tDelta;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (std::fabs(direction[axis]) < FLT_EPSILON) {
+                tNext[axis] = FLT_MAX;
+                tDelta[axis] = FLT_MAX;
+                continue;
+            }
+            float boundary = mMinValue[axis] + (cell[axis] + (step[axis] > 0 ? 1 : 0)) * mCellSize;
+            tNext[axis] = (boundary - origin[axis]) / direction[axis];
+            tDelta[axis] = mCellSize / std::fabs(direction[axis]);
+        }
+
+        uint32_t recent[kRecentItems];
+        int recentCount = 0;
+        while (true) {
+            int cellIndex = cell.y * mCellsPerSide + cell.x;
+            for (uint32_t i = mCellStart[cellIndex]; i < mCellStart[cellIndex + 1]; ++i) {
+                uint32_t itemIndex = mCellItems[i];
+                uint32_t* recentEnd = recent + std::min(recentCount, kRecentItems);
+                if (std::find(recent, recentEnd, itemIndex) != recentEnd) {
+                    continue;
+                }
+                recent[recentCount++ % kRecentItems] = itemIndex;
+
+                const Item& item = mItems[itemIndex];
+                float distance;
+                if (!RayVolume(item, ray, hit.distance, distance)) {
+                    continue;
+                }
+                if (item.bvh == nullptr) {
+                    hit.distance = distance;
+                    hit.item = (int32_t)itemIndex;
+                    hit.triangle = 0;
+                    continue;
+                }
+                // Ray in the frame of the mesh, rotation keeps the units of t
+                const OrientedBox2D& box = item.footprint;
+                glm::vec3 d = ray.origin - item.origin;
+                glm::vec3 localOrigin(box.cosRot * d.x - box.sinRot * d.z, d.y, box.sinRot * d.x + box.cosRot * d.z);
+                glm::vec3 localDirection(box.cosRot * ray.direction.x - box.sinRot * ray.direction.z, ray.direction.y,
+                                         box.sinRot * ray.direction.x + box.cosRot * ray.direction.z);
+                uint32_t triangle;
+                if (item.bvh->Raycast(localOrigin, localDirection, hit.distance, distance, &triangle)) {
+                    hit.distance = distance;
+                    hit.item = (int32_t)itemIndex;
+                    hit.triangle = triangle;
+                }
+            }
+
+            float cellEnd = std::min(tNext.x, tNext.y);
+            if (hit.distance <= cellEnd || cellEnd >= tExit) {
+                break;
+            }
+            int axis = tNext.x < tNext.y ? 0 : 1;
+            cell[axis] += step[axis];
+            tNext[axis] += tDelta[axis];
+            if (cell[axis] < 0 || cell[axis] >= mCellsPerSide) {
+                break;
+            }
+        }
+    }
+}
+
+void SceneQuery::OverlapSpheres(const SceneSphere* spheres, size_t count, SceneOverlaps& outOverlaps) const{
+    outOverlaps.offsets.resize(count + 1);
+    outOverlaps.items.clear();
+    std::vector<uint32_t> candidates;
+    for (size_t q = 0; q < count; ++q) {
+        const SceneSphere& sphere = spheres[q];
+        outOverlaps.offsets[q] = (uint32_t)outOverlaps.items.size();
+        glm::vec2 center(sphere.center.x, sphere.center.z);
+        GatherItems(center - sphere.radius, center + sphere.radius, candidates);
+        for (uint32_t itemIndex : candidates) {
+            if (SphereTouches(mItems[itemIndex], sphere)) {
+                outOverlaps.items.push_back(itemIndex);
+            }
+        }
+    }
+    outOverlaps.offsets[count] = (uint32_t)outOverlaps.items.size();
+}
+
+void SceneQuery::OverlapBoxes(const SceneBox* boxes, size_t count, SceneOverlaps& outOverlaps) const{
+    outOverlaps.offsets.resize(count + 1);
+    outOverlaps.items.clear();
+    std::vector<uint32_t> candidates;
+    for (size_t q = 0; q < count; ++q) {
+        const SceneBox& box = boxes[q];
+        outOverlaps.offsets[q] = (uint32_t)outOverlaps.items.size();
+        GatherItems(glm::vec2(box.boxMin.x, box.boxMin.z), glm::vec2(box.boxMax.x, box.boxMax.z), candidates);
+        for (uint32_t itemIndex : candidates) {
+            if (BoxTouches(mItems[itemIndex], box)) {
+                outOverlaps.items.push_back(itemIndex);
+            }
+        }
+    }
+    outOverlaps.offsets[count] = (uint32_t)outOverlaps.items.size();
+}
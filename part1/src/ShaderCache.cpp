@@ -0,0 +1,100 @@
+#include "ShaderCache.hpp"
+#include "util.hpp"
+#include "globals.hpp"
+#include "generated/ShaderInterface.hpp"
+
+#include <glad/glad.h>
+#include <iostream>
+#include <string>
+
+// Names of the defines, in the same order as the ShaderFeature bits
+static const char* sFeatureDefines[] = {
+    "HAS_NORMAL_MAP",
+    "HAS_SPECULAR_MAP",
+    "INSTANCED",
+    "NO_DISCARD",
+    "DEPTH_ONLY",
+};
+
+std::string InjectShaderDefines(const std::string& source, unsigned int features){
+    std::string defines;
+    for (unsigned int i = 0; i < sizeof(sFeatureDefines) / sizeof(sFeatureDefines[0]); ++i) {
+        if (features & (1u << i)) {
+            defines += std::string("#define ") + sFeatureDefines[i] + "\n";
+        }
+    }
+    if (defines.empty()) {
+        return source;
+    }
+
+    // #version must stay the first statement, so insert right after that line
+    size_t versionPos = source.find("#version");
+    if (versionPos == std::string::npos) {
+        return defines + source;
+    }
+    size_t lineEnd = source.find('\n', versionPos);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + defines;
+    }
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+GLuint ShaderCache::GetProgram(const std::string& vertexPath, const std::string& fragmentPath, unsigned int features){
+    std::string key = vertexPath + "|" + fragmentPath + "|" + std::to_string(features);
+    auto it = mPrograms.find(key);
+    if (it != mPrograms.end()) {
+        return it->second;
+    }
+
+    std::string vertexShaderSource      = InjectShaderDefines(LoadShaderAsString(vertexPath), features);
+    std::string fragmentShaderSource    = InjectShaderDefines(LoadShaderAsString(fragmentPath), features);
+
+    GLuint program = CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+    ShaderInterface::BindUniformBlocks(program);
+    mPrograms[key] = program;
+    return program;
+}
+
+GLuint ShaderCache::GetProgram(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, unsigned int features){
+    std::string key = vertexPath + "|" + geometryPath + "|" + fragmentPath + "|" + std::to_string(features);
+    auto it = mPrograms.find(key);
+    if (it != mPrograms.end()) {
+        return it->second;
+    }
+
+    std::string vertexShaderSource      = InjectShaderDefines(LoadShaderAsString(vertexPath), features);
+    std::string geometryShaderSource    = InjectShaderDefines(LoadShaderAsString(geometryPath), features);
+    std::string fragmentShaderSource    = InjectShaderDefines(LoadShaderAsString(fragmentPath), features);
+
+    GLuint program = Create3ShaderProgram(vertexShaderSource, geometryShaderSource, fragmentShaderSource);
+    ShaderInterface::BindUniformBlocks(program);
+    mPrograms[key] = program;
+    return program;
+}
+
+GLuint ShaderCache::GetFeedbackProgram(const std::string& vertexPath, const std::string& geometryPath, const std::vector<const char*>& varyings, unsigned int features){
+    std::string key = vertexPath + "|" + geometryPath + "|feedback";
+    for (const char* varying : varyings) {
+        key += std::string("|") + varying;
+    }
+    key += "|" + std::to_string(features);
+    auto it = mPrograms.find(key);
+    if (it != mPrograms.end()) {
+        return it->second;
+    }
+
+    std::string vertexShaderSource      = InjectShaderDefines(LoadShaderAsString(vertexPath), features);
+    std::string geometryShaderSource    = InjectShaderDefines(LoadShaderAsString(geometryPath), features);
+
+    GLuint program = CreateFeedbackProgram(vertexShaderSource, geometryShaderSource, varyings);
+    ShaderInterface::BindUniformBlocks(program);
+    mPrograms[key] = program;
+    return program;
+}
+
+void ShaderCache::Clear(){
+    for (auto& entry : mPrograms) {
+        g.gGLState.DeleteProgram(entry.second);
+    }
+    mPrograms.clear();
+}
@@ -0,0 +1,304 @@
+#include "SoftwareOcclusion.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+    #define SOFTWARE_OCCLUSION_SSE
+    #include <xmmintrin.h>
+#endif
+
+SoftwareOcclusion::SoftwareOcclusion()
+    : mDepth(kWidth * kHeight, 1.0f){
+    mWorker = std::thread(&SoftwareOcclusion::WorkerLoop, this);
+}
+
+SoftwareOcclusion::~SoftwareOcclusion(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_one();
+    mWorker.join();
+}
+
+void SoftwareOcclusion::ClearOccluders(){
+    mTriangles.clear();
+    mSharedEdges.clear();
+}
+
+void SoftwareOcclusion::AddOccluderBox(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model){
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 local((i & 1) ? localMax.x : localMin.x,
+                        (i & 2) ? localMax.y : localMin.y,
+                        (i & 4) ? localMax.z : localMin.z);
+        corners[i] = glm::vec3(model * glm::vec4(local, 1.0f));
+    }
+    // Two triangles per face, corner index bits are (z, y, x)
+    static const int kFaces[6][4] = {
+        {0, 1, 3, 2}, {4, 6, 7, 5},     // -z, +z
+        {0, 2, 6, 4}, {1, 5, 7, 3},     // -x, +x
+        {0, 4, 5, 1}, {2, 3, 7, 6},     // -y, +y
+    };
+    for (const auto& face : kFaces) {
+        AddQuad(corners[face[0]], corners[face[1]], corners[face[2]], corners[face[3]]);
+    }
+}
+
+void SoftwareOcclusion::AddOccluderQuad(const glm::vec3& base, float width, float height, const glm::vec3& eyePosition){
+    glm::vec3 toEye = eyePosition - base;
+    toEye.y = 0.0f;
+    if (glm::dot(toEye, toEye) < 1e-6f) {
+        return;
+    }
+    glm::vec3 right = glm::normalize(glm::vec3(-toEye.z, 0.0f, toEye.x)) * (width * 0.5f);
+    glm::vec3 up(0.0f, height, 0.0f);
+
+    AddQuad(base - right, base + right, base + right + up, base - right + up);
+}
+
+/**
+* Planar quad a, b, c, d as the triangles (a, b, c) and (a, c, d). The diagonal
+* a-c is marked shared: a pixel across it is covered by the quad even though
+* neither triangle covers it alone
+*
+* @return void
+*/
+void SoftwareOcclusion::AddQuad(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d){
+    mTriangles.push_back(a);
+    mTriangles.push_back(b);
+    mTriangles.push_back(c);
+    mSharedEdges.push_back(kEdgeCA);
+    mTriangles.push_back(a);
+    mTriangles.push_back(c);
+    mTriangles.push_back(d);
+    mSharedEdges.push_back(kEdgeAB);
+}
+
+void SoftwareOcclusion::RasterizeAsync(const glm::mat4& viewProjection){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mViewProjection = viewProjection;
+        mHasWork = true;
+    }
+    mWake.notify_one();
+}
+
+void SoftwareOcclusion::Wait(){
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this]{ return !mHasWork; });
+}
+
+void SoftwareOcclusion::WorkerLoop(){
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this]{ return mHasWork || mQuit; });
+        if (mQuit) {
+            return;
+        }
+        glm::mat4 viewProjection = mViewProjection;
+        lock.unlock();
+        Rasterize(viewProjection);
+        lock.lock();
+        mHasWork = false;
+        mDone.notify_all();
+    }
+}
+
+void SoftwareOcclusion::Rasterize(const glm::mat4& viewProjection){
+    mViewProjection = viewProjection;
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+    mTrianglesDrawn = 0;
+    mTrianglesSkipped = 0;
+
+    for (size_t i = 0; i + 2 < mTriangles.size(); i += 3) {
+        glm::vec4 a = viewProjection * glm::vec4(mTriangles[i], 1.0f);
+        glm::vec4 b = viewProjection * glm::vec4(mTriangles[i + 1], 1.0f);
+        glm::vec4 c = viewProjection * glm::vec4(mTriangles[i + 2], 1.0f);
+        // Triangles crossing the near plane are dropped, fewer occluders is still conservative
+        if (a.z < -a.w || b.z < -b.w || c.z < -c.w) {
+            mTrianglesSkipped++;
+            continue;
+        }
+        RasterizeTriangle(a, b, c, mSharedEdges[i / 3]);
+    }
+}
+
+/**
+* Rasterize one clip space triangle. A pixel is written only if the whole
+* pixel is inside the triangle, with the largest depth the triangle has in it.
+*
+* @return void
+*/
+void SoftwareOcclusion::RasterizeTriangle(const glm::vec4& clipA, const glm::vec4& clipB, const glm::vec4& clipC, uint8_t sharedEdges){
+    auto toScreen = [](const glm::vec4& clip){
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * kWidth, (ndc.y * 0.5f + 0.5f) * kHeight, ndc.z * 0.5f + 0.5f);
+    };
+    glm::vec3 a = toScreen(clipA);
+    glm::vec3 b = toScreen(clipB);
+    glm::vec3 c = toScreen(clipC);
+
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::fabs(area) < 1e-6f) {
+        mTrianglesSkipped++;
+        return;
+    }
+    // Both windings are occluders, make it counter clockwise
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+        // a-b and c-a trade places, b-c stays
+        sharedEdges = (uint8_t)((sharedEdges & kEdgeBC) | ((sharedEdges & kEdgeAB) ? kEdgeCA : 0) | ((sharedEdges & kEdgeCA) ? kEdgeAB : 0));
+    }
+
+    int minX = std::max(0, (int)std::floor(std::min(a.x, std::min(b.x, c.x))));
+    int maxX = std::min(kWidth - 1, (int)std::ceil(std::max(a.x, std::max(b.x, c.x))));
+    int minY = std::max(0, (int)std::floor(std::min(a.y, std::min(b.y, c.y))));
+    int maxY = std::min(kHeight - 1, (int)std::ceil(std::max(a.y, std::max(b.y, c.y))));
+    if (minX > maxX || minY > maxY) {
+        mTrianglesSkipped++;
+        return;
+    }
+    mTrianglesDrawn++;
+    // Start on a multiple of 4 so that groups of 4 pixels never cross the row end
+    minX &= ~3;
+
+    // Edge functions E(x, y) = A*x + B*y + C, positive inside
+    const glm::vec3* from[3] = {&a, &b, &c};
+    const glm::vec3* to[3] = {&b, &c, &a};
+    float edgeA[3], edgeB[3], edgeC[3], threshold[3];
+    for (int e = 0; e < 3; ++e) {
+        edgeA[e] = -(to[e]->y - from[e]->y);
+        edgeB[e] = to[e]->x - from[e]->x;
+        edgeC[e] = -(edgeA[e] * from[e]->x + edgeB[e] * from[e]->y);
+        // The pixel center must be this far inside for the whole pixel to be covered,
+        // past a shared edge the other triangle of the quad covers the rest of it
+        threshold[e] = (sharedEdges & (1 << e)) ? 0.0f : 0.5f * (std::fabs(edgeA[e]) + std::fabs(edgeB[e]));
+    }
+
+    // Depth plane, plus the most it can grow from the center to a corner of a pixel
+    float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    float depthC = a.z - dzdx * a.x - dzdy * a.y + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+    for (int y = minY; y <= maxY; ++y) {
+        float py = y + 0.5f;
+        float* row = &mDepth[y * kWidth];
+        int x = minX;
+
+#ifdef SOFTWARE_OCCLUSION_SSE
+        __m128 laneOffset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 allLanes = _mm_cmpeq_ps(one, one);
+        for (; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+            __m128 inside = allLanes;
+            for (int e = 0; e < 3; ++e) {
+                __m128 value = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[e])), _mm_set1_ps(edgeB[e] * py + edgeC[e]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(value, _mm_set1_ps(threshold[e])));
+            }
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+            __m128 depth = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(dzdx)), _mm_set1_ps(dzdy * py + depthC));
+            depth = _mm_min_ps(depth, one);
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 closer = _mm_min_ps(old, depth);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+        }
+#endif
+
+        for (; x <= maxX; ++x) {
+            float px = x + 0.5f;
+            bool inside = true;
+            for (int e = 0; e < 3; ++e) {
+                inside = inside && (edgeA[e] * px + edgeB[e] * py + edgeC[e] >= threshold[e]);
+            }
+            if (inside) {
+                float depth = std::min(1.0f, dzdx * px + dzdy * py + depthC);
+                row[x] = std::min(row[x], depth);
+            }
+        }
+    }
+}
+
+bool SoftwareOcclusion::IsOccluded(const glm::vec3& center, const glm::vec3& extents) const{
+    float minX = (float)kWidth, maxX = 0.0f, minY = (float)kHeight, maxY = 0.0f, nearest = 1.0f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner = center + glm::vec3((i & 1) ? extents.x : -extents.x,
+                                              (i & 2) ? extents.y : -extents.y,
+                                              (i & 4) ? extents.z : -extents.z);
+        glm::vec4 clip = mViewProjection * glm::vec4(corner, 1.0f);
+        // Crossing the near plane, its screen bounds are unknown
+        if (clip.z < -clip.w) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        float x = (ndc.x * 0.5f + 0.5f) * kWidth;
+        float y = (ndc.y * 0.5f + 0.5f) * kHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Every pixel the box touches
+    int x0 = std::max(0, (int)std::floor(minX));
+    int x1 = std::min(kWidth - 1, (int)std::floor(maxX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int y1 = std::min(kHeight - 1, (int)std::floor(maxY));
+    if (x0 > x1 || y0 > y1) {
+        return false;
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = &mDepth[y * kWidth];
+        int x = x0;
+#ifdef SOFTWARE_OCCLUSION_SSE
+        __m128 nearestDepth = _mm_set1_ps(nearest);
+        for (; x + 3 <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearestDepth)) != 0) {
+                return false;
+            }
+        }
+#endif
+        for (; x <= x1; ++x) {
+            if (row[x] >= nearest) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t SoftwareOcclusion::FilterSpheres(const SphereList& spheres, std::vector<uint32_t>& indices) const{
+    size_t kept = 0;
+    for (uint32_t index : indices) {
+        glm::vec3 center(spheres.x[index], spheres.y[index], spheres.z[index]);
+        if (!IsOccluded(center, glm::vec3(spheres.radius[index]))) {
+            indices[kept++] = index;
+        }
+    }
+    size_t removed = indices.size() - kept;
+    indices.resize(kept);
+    return removed;
+}
+
+size_t SoftwareOcclusion::FilterBoxes(const BoxList& boxes, std::vector<uint32_t>& indices) const{
+    size_t kept = 0;
+    for (uint32_t index : indices) {
+        glm::vec3 center(boxes.cx[index], boxes.cy[index], boxes.cz[index]);
+        glm::vec3 extents(boxes.ex[index], boxes.ey[index], boxes.ez[index]);
+        if (!IsOccluded(center, extents)) {
+            indices[kept++] = index;
+        }
+    }
+    size_t removed = indices.size() - kept;
+    indices.resize(kept);
+    return removed;
+}
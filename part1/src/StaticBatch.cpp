@@ -0,0 +1,335 @@
+#include "StaticBatch.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+StaticBatch::~StaticBatch(){
+    if (mVAO != 0) {
+        g.gGLState.DeleteBuffers(1, &mVertexVBO);
+        g.gGLState.DeleteBuffers(1, &mInstanceVBO);
+        g.gGLState.DeleteBuffers(1, &mCommandBuffer);
+        g.gGLState.DeleteTextures(1, &mTextureArray);
+        g.gGLState.DeleteVertexArrays(1, &mVAO);
+    }
+}
+
+/**
+* Give texture a layer of the texture array, textures shared by several
+* materials get a single layer.
+*
+* @return layer index, -1 if there is no texture or its image did not load
+*/
+int StaticBatch::AddLayer(const Texture* texture){
+    if (texture == nullptr || texture->GetImage() == nullptr || texture->GetImage()->GetWidth() <= 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < mLayers.size(); ++i) {
+        if (mLayers[i] == texture) {
+            return (int)i;
+        }
+    }
+    mLayers.push_back(texture);
+    return (int)mLayers.size() - 1;
+}
+
+/**
+* Source texels and weights of each of outSize texels resampled from inSize:
+* the average of the texels it covers when shrinking (box filter), linear
+* between the two nearest when growing
+*
+* @return void
+*/
+static void ResampleTaps(int inSize, int outSize, std::vector<std::vector<std::pair<int, float>>>& outTaps){
+    outTaps.assign(outSize, {});
+    float scale = (float)inSize / outSize;
+    for (int i = 0; i < outSize; ++i) {
+        if (scale > 1.0f) {
+            float begin = i * scale;
+            float end = (i + 1) * scale;
+            for (int texel = (int)begin; texel < std::min(inSize, (int)std::ceil(end)); ++texel) {
+                float coverage = std::min(end, texel + 1.0f) - std::max(begin, (float)texel);
+                outTaps[i].push_back({texel, coverage / scale});
+            }
+        } else {
+            float center = std::max(0.0f, (i + 0.5f) * scale - 0.5f);
+            int texel = std::min((int)center, inSize - 1);
+            float t = center - texel;
+            outTaps[i].push_back({texel, 1.0f - t});
+            outTaps[i].push_back({std::min(texel + 1, inSize - 1), t});
+        }
+    }
+}
+
+/**
+* Resample an RGB image of width x height texels to size x size
+*
+* @return void
+*/
+static void ResampleLayer(const uint8_t* pixels, int width, int height, int size, std::vector<uint8_t>& outPixels){
+    std::vector<std::vector<std::pair<int, float>>> tapsX, tapsY;
+    ResampleTaps(width, size, tapsX);
+    ResampleTaps(height, size, tapsY);
+    outPixels.resize((size_t)size * size * 3);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            glm::vec3 sum(0.0f);
+            for (const std::pair<int, float>& tapY : tapsY[y]) {
+                const uint8_t* row = pixels + (size_t)tapY.first * width * 3;
+                for (const std::pair<int, float>& tapX : tapsX[x]) {
+                    const uint8_t* texel = row + (size_t)tapX.first * 3;
+                    sum += glm::vec3(texel[0], texel[1], texel[2]) * (tapY.second * tapX.second);
+                }
+            }
+            glm::vec3 color = glm::clamp(glm::round(sum), 0.0f, 255.0f);
+            uint8_t* out = &outPixels[((size_t)y * size + x) * 3];
+            out[0] = (uint8_t)color.r;
+            out[1] = (uint8_t)color.g;
+            out[2] = (uint8_t)color.b;
+        }
+    }
+}
+
+StaticBatch::Mesh* StaticBatch::FindMesh(const OBJ& object){
+    auto it = mMeshIndices.find(object.getFileName());
+    if (it == mMeshIndices.end()) {
+        return nullptr;
+    }
+    return &mMeshes[it->second];
+}
+
+/**
+* Append the vertices of object to the merged buffer and its material to the
+* table. Objects loaded from a file already added reuse that mesh.
+*
+* @return void
+*/
+void StaticBatch::AddMesh(const OBJ& object){
+    if (FindMesh(object) != nullptr) {
+        return;
+    }
+    if (mMaterialCount == kMaxMaterials) {
+        std::cout << "StaticBatch: more than " << kMaxMaterials << " materials, " << object.getFileName() << " is not batched" << std::endl;
+        return;
+    }
+
+    const std::vector<GLfloat>& positions = object.getVerticesArray();
+    const std::vector<GLfloat>& normals = object.getNormalsArray();
+    const std::vector<GLfloat>& textureCoords = object.getTextureArray();
+    const std::vector<GLfloat>& tangents = object.getTangentArray();
+    const std::vector<GLfloat>& bitangents = object.getBitangentArray();
+
+    Mesh mesh;
+    mesh.first = (GLuint)mVertices.size();
+    mesh.count = (GLuint)(positions.size() / 3);
+    for (size_t i = 0; i < mesh.count; ++i) {
+        Vertex vertex;
+        vertex.position = glm::vec3(positions[i*3], positions[i*3+1], positions[i*3+2]);
+        vertex.normal = (i*3+2 < normals.size()) ? glm::vec3(normals[i*3], normals[i*3+1], normals[i*3+2]) : glm::vec3(0.0f, 1.0f, 0.0f);
+        vertex.textureCoord = (i*2+1 < textureCoords.size()) ? glm::vec2(textureCoords[i*2], textureCoords[i*2+1]) : glm::vec2(0.0f);
+        // Meshes without a normal map have no tangents, any axis keeps the shader's normalize() defined
+        vertex.tangent = (i*3+2 < tangents.size()) ? glm::vec3(tangents[i*3], tangents[i*3+1], tangents[i*3+2]) : glm::vec3(1.0f, 0.0f, 0.0f);
+        vertex.bitangent = (i*3+2 < bitangents.size()) ? glm::vec3(bitangents[i*3], bitangents[i*3+1], bitangents[i*3+2]) : glm::vec3(0.0f, 0.0f, 1.0f);
+        mVertices.push_back(vertex);
+    }
+
+    // Same constants as the object's MaterialBlock, the layers replace its samplers
+    ShaderInterface::MaterialBlock constants = object.GetMaterialConstants();
+    mesh.material = mMaterialCount++;
+    mMaterials.u_MaterialLayers[mesh.material] = glm::vec4((float)AddLayer(object.getDiffuseTexture()),
+                                                           (float)AddLayer(object.getNormalTexture()),
+                                                           (float)AddLayer(object.getSpecularTexture()),
+                                                           constants.shininess);
+    mMaterials.u_MaterialKa[mesh.material] = glm::vec4(constants.ka, 1.0f);
+    mMaterials.u_MaterialKd[mesh.material] = glm::vec4(constants.kd, 1.0f);
+    mMaterials.u_MaterialKs[mesh.material] = glm::vec4(constants.ks, 1.0f);
+
+    mMeshIndices[object.getFileName()] = mMeshes.size();
+    mMeshes.push_back(mesh);
+}
+
+/**
+* Upload the merged vertex buffer, the material table and the texture array,
+* and setup the vertex array with the per-instance attributes.
+*
+* @return void
+*/
+void StaticBatch::Build(){
+    mShaderID = g.gShaderCache.GetProgram("./shaders/static_vert.glsl", "./shaders/static_frag.glsl");
+    mDepthShaderID = g.gShaderCache.GetProgram("./shaders/static_vert.glsl", "./shaders/depth_frag.glsl");
+    glUseProgram(mShaderID);
+    glUniform1i(glGetUniformLocation(mShaderID, "u_MaterialTextures"), 0);
+    glUseProgram(0);
+
+    mMaterialUniforms.Initialize(g.gGLState, GL_STATIC_DRAW);
+    mMaterialUniforms.Update(mMaterials);
+
+    // Layers must all have the same size, the largest texture keeps its texels
+    mLayerSize = 1;
+    for (const Texture* texture : mLayers) {
+        mLayerSize = std::max(mLayerSize, std::max(texture->GetImage()->GetWidth(), texture->GetImage()->GetHeight()));
+    }
+    mLayerSize = std::min(mLayerSize, kMaxLayerSize);
+    glGenTextures(1, &mTextureArray);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLsizei layerCount = std::max<GLsizei>(1, (GLsizei)mLayers.size());
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, mLayerSize, mLayerSize, layerCount, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    std::vector<uint8_t> resized;
+    for (size_t layer = 0; layer < mLayers.size(); ++layer) {
+        Image* image = mLayers[layer]->GetImage();
+        const uint8_t* pixels = image->GetPixelDataPtr();
+        if (image->GetWidth() != mLayerSize || image->GetHeight() != mLayerSize) {
+            ResampleLayer(pixels, image->GetWidth(), image->GetHeight(), mLayerSize, resized);
+            pixels = resized.data();
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, mLayerSize, mLayerSize, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenVertexArrays(1, &mVAO);
+    glBindVertexArray(mVAO);
+
+    glGenBuffers(1, &mVertexVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexVBO);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), mVertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoord));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+
+    // Instances are refilled every frame, a mat4 attribute takes four locations
+    glGenBuffers(1, &mInstanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+    for (int column = 0; column < 4; ++column) {
+        glEnableVertexAttribArray(5 + column);
+        glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(offsetof(Instance, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(5 + column, 1);
+    }
+    glEnableVertexAttribArray(9);
+    glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, tintMaterial));
+    glVertexAttribDivisor(9, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &mCommandBuffer);
+
+    std::cout << "Batched " << mMeshes.size() << " meshes (" << mVertices.size() << " vertices) and "
+              << mLayers.size() << " texture layers for multi-draw indirect" << std::endl;
+}
+
+void StaticBatch::Begin(){
+    for (Mesh& mesh : mMeshes) {
+        mesh.instances.clear();
+    }
+}
+
+bool StaticBatch::AddObject(const OBJ& object){
+    Mesh* mesh = FindMesh(object);
+    if (mesh == nullptr) {
+        return false;
+    }
+    Instance instance;
+    instance.model = object.GetModelMatrix();
+    instance.tintMaterial = glm::vec4(1.0f, 1.0f, 1.0f, (float)mesh->material);
+    mesh->instances.push_back(instance);
+    return true;
+}
+
+/**
+* Add the instances of an instanced object, their offset, rotation and scale
+* are folded into the model matrix (same transform as INSTANCED vert.glsl).
+*
+* @return bool false when the mesh of object is not batched
+*/
+bool StaticBatch::AddInstances(const OBJ& object, const std::vector<InstanceData>& instances){
+    Mesh* mesh = FindMesh(object);
+    if (mesh == nullptr) {
+        return false;
+    }
+    glm::mat4 model = object.GetModelMatrix();
+    for (const InstanceData& data : instances) {
+        Instance instance;
+        instance.model = glm::translate(model, data.offset);
+        instance.model = glm::rotate(instance.model, data.rotation, glm::vec3(0.0f, 1.0f, 0.0f));
+        instance.model = glm::scale(instance.model, glm::vec3(data.scale));
+        instance.tintMaterial = glm::vec4(data.tint, (float)mesh->material);
+        mesh->instances.push_back(instance);
+    }
+    return true;
+}
+
+/**
+* Write one command per mesh with visible placements, each command reads its
+* own range of the instance buffer through baseInstance.
+*
+* @return void
+*/
+void StaticBatch::Upload(FrameStats& stats){
+    mCommands.clear();
+    mInstances.clear();
+    for (const Mesh& mesh : mMeshes) {
+        if (mesh.instances.empty()) {
+            continue;
+        }
+        DrawArraysIndirectCommand command;
+        command.count = mesh.count;
+        command.instanceCount = (GLuint)mesh.instances.size();
+        command.first = mesh.first;
+        command.baseInstance = (GLuint)mInstances.size();
+        mCommands.push_back(command);
+        mInstances.insert(mInstances.end(), mesh.instances.begin(), mesh.instances.end());
+    }
+    stats.indirectCommands += (unsigned int)mCommands.size();
+    stats.indirectInstances += (unsigned int)mInstances.size();
+    if (mCommands.empty()) {
+        return;
+    }
+
+    // Orphan the old storage so the driver does not wait for last frame's draw
+    g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, mInstances.size() * sizeof(Instance), mInstances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(DrawArraysIndirectCommand), mCommands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void StaticBatch::Draw(GLState& state, FrameStats& stats, bool depthOnly){
+    if (mCommands.empty()) {
+        return;
+    }
+    if (state.UseProgram(depthOnly ? mDepthShaderID : mShaderID)) {
+        stats.programSwitches++;
+    }
+    if (state.BindVertexArray(mVAO)) {
+        stats.vaoSwitches++;
+    }
+    if (!depthOnly) {
+        mMaterialUniforms.Bind();
+        state.BindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+    glMultiDrawArraysIndirectPtr(GL_TRIANGLES, nullptr, (GLsizei)mCommands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    stats.indirectDraws++;
+}
@@ -0,0 +1,278 @@
+#include "Terrain.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// Vertices of one quadrant of the grid, two triangles per quad
+static const int kQuadrantVertices = 6 * (Terrain::kGridQuads / 2) * (Terrain::kGridQuads / 2);
+// A patch morphs over the last third of its range
+static const float kMorphStart = 0.66f;
+// Morph range of the top level, never reached
+static const float kNoMorph = 1e9f;
+// Level 0 must reach this many leaves for a patch to be within the range of the
+// level above it, see Build()
+static const float kMinLodDistanceInLeaves = 2.2f;
+
+// Whether the sphere of radius around center touches the box
+static bool SphereTouchesBox(const glm::vec3& center, float radius, const glm::vec3& boundsMin, const glm::vec3& boundsMax){
+    glm::vec3 offset = center - glm::clamp(center, boundsMin, boundsMax);
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+Terrain::~Terrain(){
+    // Built only, as in the benchmark
+    if (mGridVBO == 0) {
+        return;
+    }
+    for (PartBatch& part : mParts) {
+        g.gGLState.DeleteVertexArrays(1, &part.vao);
+        g.gGLState.DeleteBuffers(1, &part.instanceVBO);
+    }
+    g.gGLState.DeleteBuffers(1, &mGridVBO);
+    g.gGLState.DeleteTextures(1, &mHeightmap);
+    delete mTexture;
+}
+
+/**
+* Heights of the leaves come from the heightfield, those of a parent from its
+* children. A patch selected at level l touches the range of l, so it lies within
+* range + diagonal of the eye; the diagonal must stay under the start of the morph
+* of l + 1, or the patch would end next to a neighbour of l + 1 already morphing
+*
+* @return void
+*/
+void Terrain::Build(const Heightfield& heightfield, float lodDistance){
+    mMinValue = heightfield.GetMinValue();
+    mMaxValue = heightfield.GetMaxValue();
+    float size = mMaxValue - mMinValue;
+    lodDistance = std::max(lodDistance, kMinLodDistanceInLeaves * kLeafSize);
+
+    // Levels until one node covers the map
+    mLevelCount = 1;
+    while (mLevelCount < kMaxLevels && kLeafSize * (float)(1 << (mLevelCount - 1)) < size) {
+        mLevelCount++;
+    }
+
+    mNodesPerSide.resize(mLevelCount);
+    mNodeHeights.resize(mLevelCount);
+    mRanges.resize(mLevelCount);
+    mMorphRanges.resize(mLevelCount);
+    for (int level = 0; level < mLevelCount; ++level) {
+        float nodeSize = kLeafSize * (float)(1 << level);
+        int side = std::max(1, (int)std::ceil(size / nodeSize));
+        mNodesPerSide[level] = side;
+        std::vector<glm::vec2>& heights = mNodeHeights[level];
+        heights.resize((size_t)side * side);
+        for (int z = 0; z < side; ++z) {
+            for (int x = 0; x < side; ++x) {
+                glm::vec2& range = heights[(size_t)z * side + x];
+                if (level == 0) {
+                    glm::vec2 corner = glm::vec2(mMinValue) + glm::vec2(x, z) * nodeSize;
+                    heightfield.Range(corner, corner + nodeSize, range.x, range.y);
+                    continue;
+                }
+                const std::vector<glm::vec2>& children = mNodeHeights[level - 1];
+                int childSide = mNodesPerSide[level - 1];
+                range = glm::vec2(1e30f, -1e30f);
+                for (int child = 0; child < 4; ++child) {
+                    int childX = 2 * x + (child & 1);
+                    int childZ = 2 * z + (child >> 1);
+                    if (childX < childSide && childZ < childSide) {
+                        const glm::vec2& childRange = children[(size_t)childZ * childSide + childX];
+                        range = glm::vec2(std::min(range.x, childRange.x), std::max(range.y, childRange.y));
+                    }
+                }
+            }
+        }
+
+        float previous = level == 0 ? 0.0f : mRanges[level - 1];
+        if (level == mLevelCount - 1) {
+            mRanges[level] = kNoMorph;
+            mMorphRanges[level] = glm::vec2(kNoMorph, 2.0f * kNoMorph);
+        } else {
+            mRanges[level] = lodDistance * (float)(1 << level);
+            mMorphRanges[level] = glm::vec2(previous + kMorphStart * (mRanges[level] - previous), mRanges[level]);
+        }
+    }
+}
+
+void Terrain::NodeBounds(int level, int x, int z, glm::vec3& boundsMin, glm::vec3& boundsMax) const{
+    float nodeSize = kLeafSize * (float)(1 << level);
+    const glm::vec2& heights = mNodeHeights[level][(size_t)z * mNodesPerSide[level] + x];
+    boundsMin = glm::vec3(mMinValue + x * nodeSize, heights.x, mMinValue + z * nodeSize);
+    boundsMax = glm::vec3(boundsMin.x + nodeSize, heights.y, boundsMin.z + nodeSize);
+}
+
+bool Terrain::SelectNode(int level, int x, int z, const glm::vec3& eyePosition, const Frustum& frustum,
+                         std::vector<TerrainPatch>& patches) const{
+    glm::vec3 boundsMin, boundsMax;
+    NodeBounds(level, x, z, boundsMin, boundsMax);
+    // Out of sight, nothing of it is drawn at any level
+    if (!frustum.ContainsBox((boundsMin + boundsMax) * 0.5f, (boundsMax - boundsMin) * 0.5f)) {
+        return true;
+    }
+    if (!SphereTouchesBox(eyePosition, mRanges[level], boundsMin, boundsMax)) {
+        return false;
+    }
+    TerrainPatch patch = {glm::vec2(boundsMin.x, boundsMin.z), boundsMax.x - boundsMin.x, level, kWholeNode};
+    if (level == 0 || !SphereTouchesBox(eyePosition, mRanges[level - 1], boundsMin, boundsMax)) {
+        patches.push_back(patch);
+        return true;
+    }
+
+    // Children in range draw themselves, this level fills in the others
+    int childSide = mNodesPerSide[level - 1];
+    int leftOut = 0;
+    for (int child = 0; child < 4; ++child) {
+        int childX = 2 * x + (child & 1);
+        int childZ = 2 * z + (child >> 1);
+        if (childX < childSide && childZ < childSide &&
+            !SelectNode(level - 1, childX, childZ, eyePosition, frustum, patches)) {
+            leftOut |= 1 << child;
+        }
+    }
+    if (leftOut == 15) {
+        patches.push_back(patch);
+        return true;
+    }
+    for (int child = 0; child < 4; ++child) {
+        if (leftOut & (1 << child)) {
+            patch.part = child;
+            patches.push_back(patch);
+        }
+    }
+    return true;
+}
+
+void Terrain::Select(const glm::vec3& eyePosition, const Frustum& frustum, std::vector<TerrainPatch>& patches) const{
+    int top = mLevelCount - 1;
+    for (int z = 0; z < mNodesPerSide[top]; ++z) {
+        for (int x = 0; x < mNodesPerSide[top]; ++x) {
+            SelectNode(top, x, z, eyePosition, frustum, patches);
+        }
+    }
+}
+
+/**
+* Heights go to a float texture sampled with linear filtering, the grid to one
+* buffer of quad corners shared by every part
+*
+* @return void
+*/
+void Terrain::Initialize(const Heightfield& heightfield, const std::string& textureFileName){
+    int samples = heightfield.GetSamplesPerSide();
+    glGenTextures(1, &mHeightmap);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D, mHeightmap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, samples, samples, 0, GL_RED, GL_FLOAT, heightfield.GetHeights().data());
+
+    // The ground texture repeats every 2 units, as the grass tiles did
+    mTexture = new Texture();
+    mTexture->LoadTexture(textureFileName);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D, mTexture->GetID());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D, 0);
+
+    // Quadrant after quadrant, the diagonals as in the grid of the next level
+    std::vector<glm::vec2> grid;
+    const int half = kGridQuads / 2;
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        for (int z = 0; z < half; ++z) {
+            for (int x = 0; x < half; ++x) {
+                glm::vec2 corner((quadrant & 1) * half + x, (quadrant >> 1) * half + z);
+                grid.push_back(corner);
+                grid.push_back(corner + glm::vec2(0.0f, 1.0f));
+                grid.push_back(corner + glm::vec2(1.0f, 0.0f));
+                grid.push_back(corner + glm::vec2(1.0f, 0.0f));
+                grid.push_back(corner + glm::vec2(0.0f, 1.0f));
+                grid.push_back(corner + glm::vec2(1.0f, 1.0f));
+            }
+        }
+    }
+    glGenBuffers(1, &mGridVBO);
+    g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mGridVBO);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(glm::vec2), grid.data(), GL_STATIC_DRAW);
+
+    for (PartBatch& part : mParts) {
+        glGenVertexArrays(1, &part.vao);
+        g.gGLState.BindVertexArray(part.vao);
+        g.gGLState.BindBuffer(GL_ARRAY_BUFFER, mGridVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glGenBuffers(1, &part.instanceVBO);
+        g.gGLState.BindBuffer(GL_ARRAY_BUFFER, part.instanceVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribDivisor(1, 1);
+    }
+    g.gGLState.BindVertexArray(0);
+
+    mShaderID = g.gShaderCache.GetProgram("./shaders/terrain_vert.glsl", "./shaders/terrain_frag.glsl");
+    mDepthShaderID = g.gShaderCache.GetProgram("./shaders/terrain_vert.glsl", "./shaders/depth_frag.glsl");
+    for (GLuint program : {mShaderID, mDepthShaderID}) {
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "u_Heightmap"), 0);
+        glUniform1i(glGetUniformLocation(program, "u_GroundTexture"), 1);
+        glUniform2f(glGetUniformLocation(program, "u_TerrainMin"), mMinValue, mMinValue);
+        glUniform1f(glGetUniformLocation(program, "u_TerrainSize"), mMaxValue - mMinValue);
+        glUniform1f(glGetUniformLocation(program, "u_HeightmapSamples"), (float)samples);
+        glUniform1f(glGetUniformLocation(program, "u_GridQuads"), (float)kGridQuads);
+        glUniform2fv(glGetUniformLocation(program, "u_MorphRanges"), mLevelCount, &mMorphRanges[0].x);
+    }
+    glUseProgram(0);
+}
+
+/**
+* One instanced packet per part that has patches, the instance buffers are
+* orphaned and refilled every frame
+*
+* @return void
+*/
+void Terrain::Submit(const glm::vec3& eyePosition, const Frustum& frustum, RenderQueue& queue, FrameStats& stats){
+    auto start = std::chrono::steady_clock::now();
+    mPatches.clear();
+    Select(eyePosition, frustum, mPatches);
+    for (PartBatch& part : mParts) {
+        part.instances.clear();
+    }
+    for (const TerrainPatch& patch : mPatches) {
+        mParts[patch.part].instances.push_back(glm::vec4(patch.corner, patch.size, (float)patch.level));
+    }
+    stats.terrainPatches = (unsigned int)mPatches.size();
+    stats.terrainSelectUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    for (int i = 0; i <= kWholeNode; ++i) {
+        PartBatch& part = mParts[i];
+        if (part.instances.empty()) {
+            continue;
+        }
+        g.gGLState.BindBuffer(GL_ARRAY_BUFFER, part.instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, part.instances.size() * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, part.instances.size() * sizeof(glm::vec4), part.instances.data());
+
+        DrawPacket packet;
+        packet.program = mShaderID;
+        packet.vao = part.vao;
+        packet.textures[0] = mHeightmap;
+        packet.textures[1] = mTexture->GetID();
+        packet.first = i == kWholeNode ? 0 : i * kQuadrantVertices;
+        packet.count = i == kWholeNode ? 4 * kQuadrantVertices : kQuadrantVertices;
+        packet.instanceCount = (GLsizei)part.instances.size();
+        packet.depthProgram = mDepthShaderID;
+        // The heights are read in the vertex shader
+        packet.depthNeedsTextures = true;
+        // The ground is all around the eye
+        queue.Submit(packet, PASS_OPAQUE, eyePosition);
+    }
+}
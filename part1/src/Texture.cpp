@@ -6,6 +6,7 @@
 
 
 #include "Texture.hpp"
+#include "globals.hpp"
 
 #include <stdio.h>
 #include <string.h>
@@ -24,7 +25,7 @@ Texture::Texture(){
 // Default Destructor
 Texture::~Texture(){
 	// Delete our texture from the GPU
-	glDeleteTextures(1,&m_textureID);
+	g.gGLState.DeleteTextures(1,&m_textureID);
 
     // Delete our image
     if(m_image != nullptr){
@@ -41,13 +42,12 @@ void Texture::LoadTexture(const std::string filepath){
     m_image = new Image(filepath);
     m_image->LoadPPM(true);
 
-    glEnable(GL_TEXTURE_2D); 
 		// Generate a buffer for our texture
     glGenTextures(1,&m_textureID);
     // Similar to our vertex buffers, we now 'select'
     // a texture we want to bind to.
     // Note the type of data is 'GL_TEXTURE_2D'
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    g.gGLState.BindTexture(0, GL_TEXTURE_2D, m_textureID);
 	// Now we are going to setup some information about
 	// our textures.
 	// There are four parameters that must be set.
@@ -72,7 +72,7 @@ void Texture::LoadTexture(const std::string filepath){
     // Generate a mipmap
     glGenerateMipmap(GL_TEXTURE_2D);                        
 	// We are done with our texture data so we can unbind.    
-	glBindTexture(GL_TEXTURE_2D, 0);
+	g.gGLState.BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 
@@ -85,13 +85,12 @@ void Texture::Bind(unsigned int slot) const{
 	// be multiple at once.
 	// At the time of writing, OpenGL supports 8-32 depending
 	// on your hardware.
-  	glEnable(GL_TEXTURE_2D);
-	glActiveTexture(GL_TEXTURE0+slot);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	// The state cache only switches the active slot when the binding changes.
+	g.gGLState.BindTexture(slot, GL_TEXTURE_2D, m_textureID);
 }
 
 void Texture::Unbind(){
-	glBindTexture(GL_TEXTURE_2D, 0);
+	g.gGLState.BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 
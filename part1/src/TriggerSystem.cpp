@@ -0,0 +1,172 @@
+#include "TriggerSystem.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Cells grow past the requested size on large maps, every cell holds a list
+static const int kMaxCellsPerSide = 256;
+
+void TriggerSystem::Initialize(float minValue, float maxValue, float cellSize){
+    float size = maxValue - minValue;
+    mCellsPerSide = glm::clamp((int)std::ceil(size / cellSize), 1, kMaxCellsPerSide);
+    mCellSize = size / mCellsPerSide;
+    mMinValue = minValue;
+    mCells.clear();
+    mCells.resize((size_t)mCellsPerSide * mCellsPerSide + 1);
+    mSlots.clear();
+    mFreeHandles.clear();
+    mCallbacks.resize(TRIGGER_TYPE_COUNT);
+    mCount = 0;
+}
+
+/**
+* A trigger belongs to the cell of its center when no point of it is further
+* than one cell away, so the 3x3 cells around a point hold every trigger that
+* can contain it
+*
+* @return uint32_t
+*/
+uint32_t TriggerSystem::CellOf(const OrientedBox2D& box) const{
+    uint32_t wideCell = (uint32_t)mCells.size() - 1;
+    glm::vec2 boundsMin, boundsMax;
+    box.Bounds(0.0f, boundsMin, boundsMax);
+    if (boundsMax.x - box.center.x > mCellSize || boundsMax.y - box.center.y > mCellSize) {
+        return wideCell;
+    }
+    int x = (int)std::floor((box.center.x - mMinValue) / mCellSize);
+    int z = (int)std::floor((box.center.y - mMinValue) / mCellSize);
+    if (x < 0 || z < 0 || x >= mCellsPerSide || z >= mCellsPerSide) {
+        return wideCell;
+    }
+    return (uint32_t)(z * mCellsPerSide + x);
+}
+
+uint32_t TriggerSystem::Add(TriggerType type, const OrientedBox2D& box, float margin, uint32_t userValue){
+    OrientedBox2D footprint = box;
+    footprint.halfExtents += margin;
+
+    uint32_t handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    } else {
+        handle = (uint32_t)mSlots.size();
+        mSlots.push_back(Slot());
+    }
+
+    uint32_t cellIndex = CellOf(footprint);
+    Cell& cell = mCells[cellIndex];
+    mSlots[handle] = {cellIndex, (uint32_t)cell.handles.size(), type, userValue};
+    cell.boxes.Add(footprint);
+    cell.handles.push_back(handle);
+    mCount++;
+    return handle;
+}
+
+/**
+* Swap and pop within the cell of the trigger, the trigger moved into the
+* freed slot has its index updated
+*
+* @return void
+*/
+void TriggerSystem::Remove(uint32_t handle){
+    if (!IsValid(handle)) {
+        return;
+    }
+    Slot& slot = mSlots[handle];
+    Cell& cell = mCells[slot.cell];
+    uint32_t last = (uint32_t)cell.handles.size() - 1;
+    if (slot.index != last) {
+        uint32_t moved = cell.handles[last];
+        cell.handles[slot.index] = moved;
+        mSlots[moved].index = slot.index;
+    }
+    cell.handles.pop_back();
+    cell.boxes.RemoveSwap(slot.index);
+
+    slot.cell = kInvalidHandle;
+    mFreeHandles.push_back(handle);
+    mCount--;
+}
+
+void TriggerSystem::SetUserValue(uint32_t handle, uint32_t userValue){
+    if (IsValid(handle)) {
+        mSlots[handle].userValue = userValue;
+    }
+}
+
+void TriggerSystem::SetCallback(TriggerType type, Callback callback){
+    mCallbacks[type] = callback;
+}
+
+void TriggerSystem::TestCell(uint32_t cellIndex, const glm::vec2& point){
+    const Cell& cell = mCells[cellIndex];
+    if (cell.handles.empty() || cell.boxes.ContainsPoint(point, 0.0f, mMask) == 0) {
+        return;
+    }
+    for (size_t i = 0; i < cell.handles.size(); ++i) {
+        if (mMask[i / 32] & (1u << (i % 32))) {
+            mFired.push_back(cell.handles[i]);
+        }
+    }
+}
+
+/**
+* Collect the triggers containing point first, then call the callbacks, so
+* that callbacks removing triggers do not disturb the cells being tested
+*
+* @return size_t
+*/
+size_t TriggerSystem::Update(const glm::vec2& point){
+    if (mCount == 0) {
+        return 0;
+    }
+    mFired.clear();
+    int x = (int)std::floor((point.x - mMinValue) / mCellSize);
+    int z = (int)std::floor((point.y - mMinValue) / mCellSize);
+    for (int cz = std::max(z - 1, 0); cz <= std::min(z + 1, mCellsPerSide - 1); ++cz) {
+        for (int cx = std::max(x - 1, 0); cx <= std::min(x + 1, mCellsPerSide - 1); ++cx) {
+            TestCell((uint32_t)(cz * mCellsPerSide + cx), point);
+        }
+    }
+    TestCell((uint32_t)mCells.size() - 1, point);
+
+    size_t called = 0;
+    // Fired is swapped out so a callback may call Update without losing the list
+    std::vector<uint32_t> fired;
+    fired.swap(mFired);
+    for (uint32_t handle : fired) {
+        // An earlier callback may have removed this trigger
+        if (!IsValid(handle)) {
+            continue;
+        }
+        const Slot& slot = mSlots[handle];
+        const Callback& callback = mCallbacks[slot.type];
+        if (!callback) {
+            continue;
+        }
+        called++;
+        if (callback(handle, slot.userValue)) {
+            Remove(handle);
+        }
+    }
+    fired.swap(mFired);
+    return called;
+}
+
+size_t TriggerSystem::CandidatesAt(const glm::vec2& point) const{
+    if (mCells.empty()) {
+        return 0;
+    }
+    size_t candidates = mCells.back().handles.size();
+    int x = (int)std::floor((point.x - mMinValue) / mCellSize);
+    int z = (int)std::floor((point.y - mMinValue) / mCellSize);
+    for (int cz = std::max(z - 1, 0); cz <= std::min(z + 1, mCellsPerSide - 1); ++cz) {
+        for (int cx = std::max(x - 1, 0); cx <= std::min(x + 1, mCellsPerSide - 1); ++cx) {
+            candidates += mCells[cz * mCellsPerSide + cx].handles.size();
+        }
+    }
+    return candidates;
+}
@@ -0,0 +1,347 @@
+#include "WorldStreamer.hpp"
+#include "BillboardList.hpp"
+#include "PoissonDisk.hpp"
+#include "Random.hpp"
+#include "globals.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Chunks queued or being generated per worker, more would follow the player late
+static const size_t kRequestsPerThread = 2;
+
+StreamSettings StreamSettings::FromGlobals(){
+    StreamSettings settings;
+    settings.treeSeed = g.gRandom.StreamSeed(RANDOM_TREES);
+    settings.treeLooksSeed = g.gRandom.StreamSeed(RANDOM_TREE_LOOKS);
+    settings.grassSeed = g.gRandom.StreamSeed(RANDOM_GRASS_TILES);
+    settings.minValue = g.gMinValue;
+    settings.maxValue = g.gMaxValue;
+    settings.chunkSize = g.gChunkSize;
+    settings.loadRadius = g.gStreamRadius;
+    settings.unloadRadius = g.gStreamRadius + g.gChunkSize;
+    settings.memoryBytes = (size_t)(g.gStreamMemoryMB * 1024.0f * 1024.0f);
+    settings.threadCount = g.gStreamThreads;
+    settings.treeDensity = g.gTreeDensity;
+    settings.treeSpacing = g.gTreeSpacing;
+    settings.trunkMargin = g.gPlayerRadius;
+    settings.grassSpacing = g.gGrassSpacing;
+    settings.grassTiles = !g.gTerrain;
+    return settings;
+}
+
+WorldStreamer::~WorldStreamer(){
+    Stop();
+}
+
+void WorldStreamer::Start(const StreamSettings& settings){
+    Stop();
+    mSettings = settings;
+    mChunksPerSide = std::max(1, (int)std::ceil((settings.maxValue - settings.minValue) / settings.chunkSize));
+    mStop = false;
+    for (int i = 0; i < std::max(1, settings.threadCount); ++i) {
+        mWorkers.push_back(std::thread(&WorldStreamer::WorkerLoop, this));
+    }
+}
+
+void WorldStreamer::Stop(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mQueue.clear();
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+    mWorkers.clear();
+    mFinished.clear();
+    mChunks.clear();
+    mResidentCount = 0;
+    mResidentBytes = 0;
+    mPendingCount = 0;
+}
+
+void WorldStreamer::WorkerLoop(){
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this]{ return mStop || !mQueue.empty(); });
+        if (mStop) {
+            return;
+        }
+        WorldChunk* chunk = mQueue.front();
+        mQueue.pop_front();
+        mGenerating++;
+
+        lock.unlock();
+        Generate(mSettings, *chunk);
+        lock.lock();
+
+        mGenerating--;
+        mFinished.push_back(chunk);
+        if (mQueue.empty() && mGenerating == 0) {
+            mIdle.notify_all();
+        }
+    }
+}
+
+glm::ivec2 WorldStreamer::ChunkOf(const glm::vec2& point) const{
+    glm::ivec2 coord = glm::ivec2(glm::floor((point - mSettings.minValue) / mSettings.chunkSize));
+    return glm::clamp(coord, 0, mChunksPerSide - 1);
+}
+
+float WorldStreamer::Distance(const glm::ivec2& coord, const glm::vec2& position) const{
+    glm::vec2 corner = mSettings.minValue + glm::vec2(coord) * mSettings.chunkSize;
+    glm::vec2 outside = glm::max(glm::max(corner - position, position - corner - mSettings.chunkSize), 0.0f);
+    return glm::length(outside);
+}
+
+WorldChunk* WorldStreamer::Furthest(const glm::vec2& position) const{
+    WorldChunk* furthest = nullptr;
+    float furthestDistance = -1.0f;
+    for (const auto& entry : mChunks) {
+        float distance = Distance(entry.second->coord, position);
+        if (entry.second->resident && distance > furthestDistance) {
+            furthest = entry.second.get();
+            furthestDistance = distance;
+        }
+    }
+    return furthest;
+}
+
+void WorldStreamer::Release(const WorldChunk* chunk){
+    if (chunk->resident) {
+        mResidentCount--;
+        mResidentBytes -= chunk->memoryBytes;
+    } else {
+        mPendingCount--;
+    }
+    mChunks.erase(Key(chunk->coord));
+}
+
+/**
+* Finished chunks are taken first, then chunks past the unload radius or over
+* the memory cap are released, and the missing chunks within the load radius
+* are queued nearest first. A chunk is only queued when the memory cap leaves
+* room for it and for those already on their way, estimated at the average
+* size of a resident chunk; otherwise the furthest chunk makes room if it is
+* clearly further than the missing one
+*
+* @return bool
+*/
+bool WorldStreamer::Update(const glm::vec2& position){
+    bool changed = false;
+    std::vector<WorldChunk*> finished;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        finished.swap(mFinished);
+        // Requests the player walked away from are dropped before they start
+        for (auto it = mQueue.begin(); it != mQueue.end();) {
+            if (Distance((*it)->coord, position) > mSettings.unloadRadius) {
+                Release(*it);
+                it = mQueue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (WorldChunk* chunk : finished) {
+        mGeneratedCount++;
+        if (Distance(chunk->coord, position) > mSettings.unloadRadius) {
+            Release(chunk);
+            continue;
+        }
+        chunk->resident = true;
+        mPendingCount--;
+        mResidentCount++;
+        mResidentBytes += chunk->memoryBytes;
+        changed = true;
+    }
+
+    for (auto it = mChunks.begin(); it != mChunks.end();) {
+        const WorldChunk& chunk = *it->second;
+        if (chunk.resident && Distance(chunk.coord, position) > mSettings.unloadRadius) {
+            mResidentCount--;
+            mResidentBytes -= chunk.memoryBytes;
+            it = mChunks.erase(it);
+            changed = true;
+        } else {
+            ++it;
+        }
+    }
+    while (mResidentBytes > mSettings.memoryBytes && mResidentCount > 1) {
+        Release(Furthest(position));
+        changed = true;
+    }
+
+    // Missing chunks within the load radius, nearest first
+    std::vector<std::pair<float, glm::ivec2>> missing;
+    glm::ivec2 first = ChunkOf(position - mSettings.loadRadius);
+    glm::ivec2 last = ChunkOf(position + mSettings.loadRadius);
+    for (int z = first.y; z <= last.y; ++z) {
+        for (int x = first.x; x <= last.x; ++x) {
+            glm::ivec2 coord(x, z);
+            float distance = Distance(coord, position);
+            if (distance <= mSettings.loadRadius && mChunks.find(Key(coord)) == mChunks.end()) {
+                missing.push_back({distance, coord});
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [](const std::pair<float, glm::ivec2>& a, const std::pair<float, glm::ivec2>& b){
+        return a.first < b.first;
+    });
+
+    std::vector<WorldChunk*> requests;
+    size_t maxPending = kRequestsPerThread * mWorkers.size();
+    bool full = false;
+    for (size_t i = 0; i < missing.size() && mPendingCount < maxPending && !full; ++i) {
+        size_t averageBytes = mResidentCount > 0 ? mResidentBytes / mResidentCount : 0;
+        while (mResidentBytes + (mPendingCount + 1) * averageBytes > mSettings.memoryBytes) {
+            WorldChunk* furthest = Furthest(position);
+            if (furthest == nullptr || Distance(furthest->coord, position) < missing[i].first + 0.5f * mSettings.chunkSize) {
+                full = true;
+                break;
+            }
+            Release(furthest);
+            changed = true;
+        }
+        if (full) {
+            break;
+        }
+        std::unique_ptr<WorldChunk> chunk(new WorldChunk());
+        chunk->coord = missing[i].second;
+        requests.push_back(chunk.get());
+        mChunks[Key(chunk->coord)] = std::move(chunk);
+        mPendingCount++;
+    }
+
+    if (!requests.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.insert(mQueue.end(), requests.begin(), requests.end());
+        }
+        mWake.notify_all();
+    }
+    return changed;
+}
+
+void WorldStreamer::LoadAround(const glm::vec2& position){
+    Update(position);
+    while (mPendingCount > 0) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mIdle.wait(lock, [this]{ return mQueue.empty() && mGenerating == 0; });
+        }
+        Update(position);
+    }
+}
+
+bool WorldStreamer::IsResident(const glm::vec2& point) const{
+    auto found = mChunks.find(Key(ChunkOf(point)));
+    return found != mChunks.end() && found->second->resident;
+}
+
+bool WorldStreamer::Collides(const glm::vec2& point) const{
+    auto found = mChunks.find(Key(ChunkOf(point)));
+    if (found == mChunks.end() || !found->second->resident) {
+        return false;
+    }
+    glm::vec2 corner = mSettings.minValue + glm::vec2(found->second->coord) * mSettings.chunkSize;
+    return found->second->collision.Collides(point - corner);
+}
+
+void WorldStreamer::GatherTrees(int kind, std::vector<glm::vec2>& coords, std::vector<float>& sizeMirror) const{
+    for (const auto& entry : mChunks) {
+        if (entry.second->resident) {
+            const WorldChunk& chunk = *entry.second;
+            coords.insert(coords.end(), chunk.treeCoords[kind].begin(), chunk.treeCoords[kind].end());
+            sizeMirror.insert(sizeMirror.end(), chunk.treeSizeMirror[kind].begin(), chunk.treeSizeMirror[kind].end());
+        }
+    }
+}
+
+void WorldStreamer::GatherGrass(std::vector<InstanceData>& tiles) const{
+    for (const auto& entry : mChunks) {
+        if (entry.second->resident) {
+            tiles.insert(tiles.end(), entry.second->grassTiles.begin(), entry.second->grassTiles.end());
+        }
+    }
+}
+
+/**
+* Trees are sampled in the chunk less a margin of half the spacing (or of the
+* trunk footprint if wider), then cut down to the density. Grass tiles sit on
+* the lattice of OBJ::GenerateGrassInstances over the whole map
+*
+* @return void
+*/
+void WorldStreamer::Generate(const StreamSettings& settings, WorldChunk& chunk){
+    glm::vec2 corner = settings.minValue + glm::vec2(chunk.coord) * settings.chunkSize;
+    glm::vec2 extent = glm::min(glm::vec2(settings.chunkSize), settings.maxValue - corner);
+    float inset = std::max(0.5f * settings.treeSpacing, settings.trunkMargin);
+    glm::vec2 inner = extent - 2.0f * inset;
+    std::mt19937 looks(Random::ChunkSeed(settings.treeLooksSeed, chunk.coord.x, chunk.coord.y));
+
+    std::vector<glm::vec2> points;
+    if (inner.x > 0.0f && inner.y > 0.0f) {
+        glm::vec2 origin = corner + inset;
+        PoissonDisk sampler(0.0f, std::max(inner.x, inner.y), Random::ChunkSeed(settings.treeSeed, chunk.coord.x, chunk.coord.y));
+        for (const glm::vec3& exclusion : settings.exclusions) {
+            glm::vec2 center(exclusion.x, exclusion.y);
+            glm::vec2 nearest = glm::clamp(center, corner, corner + extent);
+            if (glm::length(center - nearest) < exclusion.z) {
+                sampler.AddExclusion(center - origin, exclusion.z);
+            }
+        }
+        for (const glm::vec2& point : sampler.Sample(settings.treeSpacing)) {
+            if (point.x < inner.x && point.y < inner.y) {
+                points.push_back(origin + point);
+            }
+        }
+        // Partial Fisher-Yates down to the density, a full chunk is no error here
+        size_t count = (size_t)std::round(settings.treeDensity * extent.x * extent.y);
+        if (points.size() > count) {
+            for (size_t i = 0; i < count; ++i) {
+                std::swap(points[i], points[(size_t)Random::Int(looks, (int)i, (int)points.size() - 1)]);
+            }
+            points.resize(count);
+        }
+    }
+
+    for (const glm::vec2& point : points) {
+        int kind = Random::Int(looks, 0, kStreamedTreeKinds - 1);
+        chunk.treeCoords[kind].push_back(point);
+        chunk.collision.AddSquare(point - corner, settings.trunkMargin);
+    }
+    for (int kind = 0; kind < kStreamedTreeKinds; ++kind) {
+        BillboardList::DrawLooks(looks, chunk.treeCoords[kind].size(), chunk.treeSizeMirror[kind]);
+    }
+    chunk.collision.Build(0.0f, settings.chunkSize);
+
+    // grass.obj is a 2 by 2 tile, scaled so that neighbouring tiles touch. The terrain is its own ground
+    if (settings.grassTiles) {
+        std::mt19937 grass(Random::ChunkSeed(settings.grassSeed, chunk.coord.x, chunk.coord.y));
+        float spacing = settings.grassSpacing;
+        glm::ivec2 firstTile = glm::ivec2(glm::ceil((corner - settings.minValue) / spacing - 0.5f));
+        for (int j = firstTile.y; settings.minValue + (j + 0.5f) * spacing < corner.y + extent.y; ++j) {
+            for (int i = firstTile.x; settings.minValue + (i + 0.5f) * spacing < corner.x + extent.x; ++i) {
+                InstanceData instance;
+                instance.offset = glm::vec3(settings.minValue + (i + 0.5f) * spacing, 0.0f, settings.minValue + (j + 0.5f) * spacing);
+                instance.scale = spacing / 2.0f;
+                instance.rotation = Random::Int(grass, 0, 3) * glm::half_pi<float>();
+                float s = Random::Uniform(grass, 0.85f, 1.0f);
+                instance.tint = glm::vec3(s, 1.0f, s);
+                chunk.grassTiles.push_back(instance);
+            }
+        }
+    }
+
+    chunk.memoryBytes = sizeof(WorldChunk) + chunk.grassTiles.capacity() * sizeof(InstanceData)
+                      + chunk.collision.GetMemoryBytes();
+    for (int kind = 0; kind < kStreamedTreeKinds; ++kind) {
+        chunk.memoryBytes += chunk.treeCoords[kind].capacity() * sizeof(glm::vec2)
+                           + chunk.treeSizeMirror[kind].capacity() * sizeof(float);
+    }
+}
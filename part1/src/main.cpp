@@ -1,6 +1,7 @@
 /* Compilation on Linux: 
+ python3 tools/embed_shaders.py
  g++ -std=c++17 ./src/*.cpp -o prog -I ./include/ -I./../common/thirdparty/ -lSDL2 -ldl
- Or use Python build script `python build.py`
+ Or use Python build script `python build.py` (which also embeds the shaders)
 */
 
 // Third Party Libraries
@@ -10,11 +11,17 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
+#include <glm/gtc/constants.hpp>
 
 // C++ Standard Template Library (STL)
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
 #include <vector>
 #include <string>
+#include <cstdlib>
 #include <fstream>
 
 // Our libraries
@@ -23,6 +30,28 @@
 #include "Light.hpp"
 #include "util.hpp"
 #include "BillboardList.hpp"
+#include "UniformBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "Frustum.hpp"
+#include "LightCone.hpp"
+#include "OcclusionCuller.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "GpuTimer.hpp"
+#include "GLExtensions.hpp"
+#include "StaticBatch.hpp"
+#include "Benchmark.hpp"
+#include "Impostors.hpp"
+#include "GrassField.hpp"
+#include "CollisionGrid.hpp"
+#include "MeshBVH.hpp"
+#include "TriggerSystem.hpp"
+#include "SceneQuery.hpp"
+#include "Scenario.hpp"
+#include "WorldStreamer.hpp"
+#include "Terrain.hpp"
+#include "FixedTimestep.hpp"
+#include "FramePacer.hpp"
+#include "generated/ShaderInterface.hpp"
 // vvvvvvvvvvvvvvvvvvvvvvvvvv Globals vvvvvvvvvvvvvvvvvvvvvvvvvv
 // Globals generally are prefixed with 'g' in this application.
 #include "globals.hpp"
@@ -33,14 +62,43 @@ OBJ* grass;
 std::vector<glm::vec2> gSelectedVecs;
 std::vector<glm::vec2> gTreesCoords;
 std::vector<BillboardList*> gTrees;
+UniformBuffer<ShaderInterface::FrameBlock>* gFrameUniforms;
+OcclusionCuller* gOcclusion;
+SoftwareOcclusion* gSoftwareOcclusion;
+bool gUseSoftwareOcclusion = true;
+GpuTimer* gDepthTimer;
+GpuTimer* gShadeTimer;
+StaticBatch* gStaticBatch = nullptr;
+Impostors* gImpostors;
+GrassField* gGrassField = nullptr;
+CollisionGrid gCollisionGrid;
+std::vector<MeshBVH> gObjBVHs;
+// Inner box of each structure for the software occlusion, none for thin or open meshes
+struct OccluderHull{
+	bool valid = false;
+	glm::vec3 boxMin, boxMax;
+};
+std::vector<OccluderHull> gOccluderHulls;
+std::vector<int32_t> gCollisionOwners;
+SceneQuery gSceneQuery;
+std::vector<SceneRay> gHeadLightRays;
+std::vector<SceneHit> gHeadLightHits;
+TriggerSystem gTriggers;
+WorldStreamer gWorld;
+Terrain* gGround = nullptr;
+std::vector<uint32_t> gBatteryTriggers;
+RenderQueue gRenderQueue;
+Frustum gFrustum;
+LightCone gLightCone;
+BoxList gCullBoxes;
+std::vector<uint32_t> gVisibleObjects;
 
 /**
-* Initialization of the graphics application. Typically this will involve setting up a window
-* and the OpenGL Context (with the appropriate version)
+* Setting up a window and the OpenGL Context (with the appropriate version)
 *
 * @return void
 */
-void InitializeProgram(){
+void InitializeContext(){
 	// Initialize SDL
 	if(SDL_Init(SDL_INIT_VIDEO)< 0){
 		std::cout << "SDL could not initialize! SDL Error: " << SDL_GetError() << "\n";
@@ -48,9 +106,9 @@ void InitializeProgram(){
 	}
 	
 	// Setup the OpenGL Context
-	// Use OpenGL 4.1 core or greater
+	// Ask for OpenGL 4.3 core for multi-draw indirect, 4.1 core is enough otherwise
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 4 );
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
 	// We want to request a double buffer for smooth updating.
 	SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
@@ -72,6 +130,11 @@ void InitializeProgram(){
 
 	// Create an OpenGL Graphics Context
 	g.gOpenGLContext = SDL_GL_CreateContext( g.gGraphicsApplicationWindow );
+	if( g.gOpenGLContext == nullptr){
+		// macOS stops at 4.1
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
+		g.gOpenGLContext = SDL_GL_CreateContext( g.gGraphicsApplicationWindow );
+	}
 	if( g.gOpenGLContext == nullptr){
 		std::cout << "OpenGL context could not be created! SDL Error: " << SDL_GetError() << "\n";
 		exit(1);
@@ -82,15 +145,130 @@ void InitializeProgram(){
 		std::cout << "glad did not initialize" << std::endl;
 		exit(1);
 	}
+	LoadGLExtensions();
 
-    for(int i = 0; i < 10; ++i){
-        gBatteryOBJs.push_back(new OBJ(g.gBatteryFileName));
-    }
-	for (auto& object : gBatteryOBJs) {
-		object->Initialize();
-        object->randomXZCoord(-20, 20);
+	// Wait for the vertical blank, or draw as fast as we can
+	g.gSwapInterval = FramePacer::SetSwapInterval(g.gSwapInterval);
+}
+
+/**
+ * Battery trigger callback, the battery at userValue in gBatteryOBJs is
+ * collected and the last battery takes its place
+ *
+ * @return bool always true, the trigger is used up
+*/
+bool CollectBatteryTrigger(uint32_t /*handle*/, uint32_t userValue) {
+	g.gCamera.CollectBattery();
+	std::cout << "Collected Battery!" << std::endl;
+	delete gBatteryOBJs[userValue];
+	gBatteryOBJs[userValue] = gBatteryOBJs.back();
+	gBatteryOBJs.pop_back();
+	gBatteryTriggers[userValue] = gBatteryTriggers.back();
+	gBatteryTriggers.pop_back();
+	if (userValue < gBatteryTriggers.size()) {
+		gTriggers.SetUserValue(gBatteryTriggers[userValue], userValue);
+	}
+	g.gCamera.GetBatteryInfo();
+	return true;
+}
+
+/**
+ * Chalice trigger callback, reaching it wins the game
+ *
+ * @return bool false, the chalice stays
+*/
+bool ReachChaliceTrigger(uint32_t /*handle*/, uint32_t /*userValue*/) {
+	g.gWin = true;
+	return false;
+}
+
+/**
+* Rebuild gSceneQuery over [minValue, maxValue] from the structures inside it,
+* on their triangles, and the trunks of gTreesCoords
+*
+* @return void
+*/
+void BuildSceneQuery(const glm::vec2& minValue, const glm::vec2& maxValue){
+	gSceneQuery.Clear();
+	for (size_t i = 0; i < gObjVector.size(); ++i) {
+		glm::vec2 boundsMin, boundsMax;
+		gObjVector[i]->getFootprint().Bounds(0.0f, boundsMin, boundsMax);
+		if (glm::any(glm::lessThan(boundsMax, minValue)) || glm::any(glm::greaterThan(boundsMin, maxValue))) {
+			continue;
+		}
+		glm::vec3 coord = gObjVector[i]->getObjectCoord();
+		gSceneQuery.AddMesh(gObjVector[i]->getFootprint(), coord,
+							coord.y + gObjVector[i]->getMinCoord().y, coord.y + gObjVector[i]->getMaxCoord().y, gObjBVHs[i]);
+	}
+	for (auto& treeCoord : gTreesCoords) {
+		OrientedBox2D trunk;
+		trunk.center = treeCoord;
+		trunk.halfExtents = glm::vec2(g.gTrunkHalfWidth);
+		float ground = g.gHeightfield.HeightAt(treeCoord);
+		gSceneQuery.AddBox(trunk, ground, ground + g.gTrunkHeight);
+	}
+	gSceneQuery.Build(minValue, maxValue);
+}
+
+/**
+* Copy the resident chunks of gWorld into the tree lists, the grass tiles,
+* gTreesCoords and gSceneQuery, after gWorld.Update() reported a change
+*
+* @return void
+*/
+void RefreshStreamedWorld(){
+	auto start = std::chrono::steady_clock::now();
+	std::vector<glm::vec2> coords;
+	std::vector<float> sizeMirror;
+	gTreesCoords.clear();
+	for (size_t kind = 0; kind < gTrees.size(); ++kind) {
+		coords.clear();
+		sizeMirror.clear();
+		gWorld.GatherTrees((int)kind % kStreamedTreeKinds, coords, sizeMirror);
+		gTrees[kind]->SetTrees(coords, sizeMirror);
+		gTreesCoords.insert(gTreesCoords.end(), coords.begin(), coords.end());
 	}
 
+	std::vector<InstanceData> tiles;
+	gWorld.GatherGrass(tiles);
+	grass->SetInstances(tiles);
+
+	// Rays never leave the resident chunks, the grid only needs to cover them
+	glm::vec3 eye = g.gCamera.GetEyePosition();
+	float reach = gWorld.GetSettings().unloadRadius + gWorld.GetSettings().chunkSize;
+	BuildSceneQuery(glm::vec2(eye.x, eye.z) - reach, glm::vec2(eye.x, eye.z) + reach);
+	g.gStats.streamUploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+* Put the eye at point, at its initial height above the ground
+*
+* @return void
+*/
+void PlaceEye(const glm::vec2& point){
+	float ground = g.gHeightfield.HeightAt(point);
+	g.gCamera.SetCameraEyePosition(point.x, ground + g.gCamera.GetEyeInitialPosition().y, point.y);
+}
+
+/**
+* Initialization of the graphics application. Typically this will involve setting up a window
+* and the OpenGL Context (with the appropriate version)
+*
+* @return void
+*/
+void InitializeProgram(){
+	InitializeContext();
+
+	// Per-frame uniforms shared by every shader
+	g.gCamera.SetProjection(glm::radians(45.0f), (float)g.gScreenWidth/(float)g.gScreenHeight, 0.1f, 20.0f);
+	gFrameUniforms = new UniformBuffer<ShaderInterface::FrameBlock>();
+	gFrameUniforms->Initialize(g.gGLState);
+
+	// Pickups and the goal fire callbacks when the player walks into them
+	gTriggers.Initialize(g.gMinValue, g.gMaxValue, g.gTriggerCellSize);
+	gTriggers.SetCallback(TRIGGER_BATTERY, CollectBatteryTrigger);
+	gTriggers.SetCallback(TRIGGER_CHALICE, ReachChaliceTrigger);
+
 	// Initialize objects
 	gObjVector.push_back(new OBJ(g.gHouseFileName));
 	gObjVector.push_back(new OBJ(g.gChapelFileName));
@@ -101,10 +279,70 @@ void InitializeProgram(){
 		object->Initialize();
 	}
 
+	// House, chapel and windmill are heavy and often hidden behind trees
+	gOcclusion = new OcclusionCuller();
+	gOcclusion->Initialize(gObjVector.size());
+	gSoftwareOcclusion = new SoftwareOcclusion();
+
+	// Far structures are drawn as a single quad
+	gImpostors = new Impostors();
+	gImpostors->Bake(gObjVector);
+
+	// GPU time of the depth pre-pass and of shading
+	gDepthTimer = new GpuTimer();
+	gDepthTimer->Initialize();
+	gShadeTimer = new GpuTimer();
+	gShadeTimer->Initialize();
+
 	std::cout << "Generating forest, please wait..." << std::endl;
+	// Run with a scenario setting this seed to get the same world again
+	std::cout << "World seed: " << g.gSeed << std::endl;
+
+	// Initialize coordinates to place objects, in the middle of a streamed map
+	float structureMin = g.gMinValue;
+	float structureMax = g.gMaxValue;
+	if (g.gStreamWorld) {
+		structureMin = std::max(g.gMinValue, -0.5f * g.gStructureAreaSize);
+		structureMax = std::min(g.gMaxValue, 0.5f * g.gStructureAreaSize);
+	}
+	gSelectedVecs = RandomObjectsPlacement(g.gRandom.StreamSeed(RANDOM_STRUCTURES), structureMin, structureMax);
+
+	// Hills, levelled under the structures and at the start. Everything placed
+	// from here on stands on them
+	if (g.gTerrain) {
+		auto terrainStart = std::chrono::steady_clock::now();
+		g.gHeightfield.Generate(g.gMinValue, g.gMaxValue, g.gTerrainSampleSpacing, g.gTerrainHeight,
+								g.gTerrainFeatureSize, g.gRandom.StreamSeed(RANDOM_TERRAIN));
+		for (size_t i = 0; i < gObjVector.size(); ++i) {
+			glm::vec3 extents = gObjVector[i]->getMaxCoord() - gObjVector[i]->getMinCoord();
+			g.gHeightfield.Flatten(gSelectedVecs[i], 0.5f * glm::length(glm::vec2(extents.x, extents.z)), 2.0f);
+		}
+		glm::vec3 eye = g.gCamera.GetEyeInitialPosition();
+		g.gHeightfield.Flatten(glm::vec2(eye.x, eye.z), 1.0f, 2.0f);
+		gGround = new Terrain();
+		gGround->Build(g.gHeightfield, g.gTerrainLodDistance);
+		gGround->Initialize(g.gHeightfield, "./../common/textures/grass.ppm");
+		std::cout << g.gHeightfield.GetSamplesPerSide() << "x" << g.gHeightfield.GetSamplesPerSide() << " terrain with "
+				  << gGround->GetLevelCount() << " levels of detail generated in "
+				  << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - terrainStart).count() << " ms" << std::endl;
+	}
+
+	// House, chapel, windmill and chalice stand on the ground at their coordinates
+	const float objectRotations[] = {30.f, 90.f, 45.f, 0.f};
+	for (size_t i = 0; i < gObjVector.size(); ++i) {
+		float ground = g.gHeightfield.HeightAt(gSelectedVecs[i]);
+		gObjVector[i]->Place(glm::vec3(gSelectedVecs[i].x, ground - gObjVector[i]->getMinCoord().y, gSelectedVecs[i].y), objectRotations[i]);
+	}
+	gTriggers.Add(TRIGGER_CHALICE, gObjVector[3]->getFootprint(), g.gChaliceReachMargin, 3);
 
-	// Initialize coordinates to place objects
-	gSelectedVecs = RandomObjectsPlacement();
+    for(int i = 0; i < g.gBatteryCount; ++i){
+        gBatteryOBJs.push_back(new OBJ(g.gBatteryFileName));
+    }
+	for (size_t i = 0; i < gBatteryOBJs.size(); ++i) {
+		gBatteryOBJs[i]->Initialize();
+        gBatteryOBJs[i]->randomXZCoord((int)g.gMinValue, (int)g.gMaxValue);
+		gBatteryTriggers.push_back(gTriggers.Add(TRIGGER_BATTERY, gBatteryOBJs[i]->getFootprint(), g.gBatteryPickupMargin, (uint32_t)i));
+	}
 
 	// Initialize 4 kinds of Trees 
 	gTrees.push_back(new BillboardList(g.gTreeFileName));
@@ -112,16 +350,90 @@ void InitializeProgram(){
 	gTrees.push_back(new BillboardList(g.gTreeFileName2));
 	gTrees.push_back(new BillboardList(g.gTreeFileName3));
 
-	for (auto& tree : gTrees) {
-		std::vector<glm::vec2> treeCoords = RandomTreesPlacement(gSelectedVecs, 50);
-    	gTreesCoords.insert(gTreesCoords.end(), treeCoords.begin(), treeCoords.end());
-		tree->SetPos(treeCoords);
-    	tree->Initialize();
+	// Every kind sampled together so that no two trees overlap, streamed chunks bring their own
+	if (!g.gStreamWorld) {
+		gTreesCoords = RandomTreesPlacement(gSelectedVecs, g.gRandom.StreamSeed(RANDOM_TREES), g.gTreesPerKind * (int)gTrees.size());
+	}
+	for (size_t i = 0; i < gTrees.size(); ++i) {
+		size_t first = gTreesCoords.size() * i / gTrees.size();
+		size_t last = gTreesCoords.size() * (i + 1) / gTrees.size();
+		std::vector<glm::vec2> treeCoords(gTreesCoords.begin() + first, gTreesCoords.begin() + last);
+		gTrees[i]->SetPos(treeCoords);
+    	gTrees[i]->Initialize();
+	}
+
+	// Footprints the player cannot walk into, the structures then decide with their triangles
+	auto bvhStart = std::chrono::steady_clock::now();
+	gObjBVHs.resize(gObjVector.size());
+	gOccluderHulls.resize(gObjVector.size());
+	for (size_t i = 0; i < gObjVector.size(); ++i) {
+		gObjBVHs[i].Build(gObjVector[i]->getVerticesArray());
+		gCollisionGrid.AddBox(gObjVector[i]->getFootprint(), g.gPlayerRadius, (int32_t)i);
+		// Walls without the roof at most, whatever the mesh hides from every side
+		OccluderHull& hull = gOccluderHulls[i];
+		hull.valid = gObjBVHs[i].FitInnerBox(gObjVector[i]->getMinCoord(), gObjVector[i]->getMaxCoord(), 0.7f, hull.boxMin, hull.boxMax);
 	}
+	std::cout << "Collision BVHs built in "
+			  << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bvhStart).count() << " ms" << std::endl;
+	for (auto& treeCoord : gTreesCoords) {
+		gCollisionGrid.AddSquare(treeCoord, g.gPlayerRadius);
+	}
+	gCollisionGrid.Build(g.gMinValue, g.gMaxValue);
+
+	// Rays and overlaps of gameplay and rendering, structures on their triangles
+	BuildSceneQuery(glm::vec2(g.gMinValue), glm::vec2(g.gMaxValue));
    
 	// Initialize Grass
 	grass = new OBJ(g.gGrassFileName);
 	grass->Initialize();
+	grass->Place(glm::vec3(0.0f, 0.0f, 0.0f));
+	if (g.gStreamWorld) {
+		// The blade buffers cover the whole map
+		std::cout << "Grass blades are not drawn on a streamed map" << std::endl;
+	} else {
+		gGrassField = new GrassField();
+		if (!gGrassField->Initialize(g.gMinValue, g.gMaxValue, g.gGrassBladesPerUnit)) {
+			delete gGrassField;
+			gGrassField = nullptr;
+		}
+	}
+
+	// Trees, grass tiles and trunks of the chunks around the start
+	if (g.gStreamWorld) {
+		StreamSettings settings = StreamSettings::FromGlobals();
+		settings.exclusions.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
+		for (const auto& objCoord : gSelectedVecs) {
+			settings.exclusions.push_back(glm::vec3(objCoord, 2.0f));
+		}
+		gWorld.Start(settings);
+		auto streamStart = std::chrono::steady_clock::now();
+		glm::vec3 eye = g.gCamera.GetEyePosition();
+		gWorld.LoadAround(glm::vec2(eye.x, eye.z));
+		RefreshStreamedWorld();
+		std::cout << gWorld.GetResidentCount() << " chunks around the start generated in "
+				  << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - streamStart).count() << " ms" << std::endl;
+	}
+
+	// Structures, batteries and grass share one buffer and one draw call when the driver allows it
+	if (HasMultiDrawIndirect()) {
+		gStaticBatch = new StaticBatch();
+		for (auto& object : gObjVector) {
+			gStaticBatch->AddMesh(*object);
+		}
+		for (auto& battery : gBatteryOBJs) {
+			gStaticBatch->AddMesh(*battery);
+		}
+		gStaticBatch->AddMesh(*grass);
+		gStaticBatch->Build();
+		g.gMultiDrawIndirect = true;
+	} else {
+		std::cout << "OpenGL 4.3 is not available, static objects are drawn one by one" << std::endl;
+	}
+
+	// Start standing on the ground
+	PlaceEye(glm::vec2(g.gCamera.GetEyeInitialPosition().x, g.gCamera.GetEyeInitialPosition().z));
+
+	std::cout << "Compiled " << g.gShaderCache.GetProgramCount() << " shader variants" << std::endl;
 
 	std::cout << "Only " << gBatteryOBJs.size() << " Batteries out there.\n Good Luck!" << std::endl;
 }
@@ -135,22 +447,206 @@ void InitializeProgram(){
 */
 void PreDraw(){
 	// Disable depth test and face culling.
-    glEnable(GL_DEPTH_TEST);                    // NOTE: Need to enable DEPTH Test
-    glDisable(GL_CULL_FACE);
+	// State goes through the cache, only changes reach the driver.
+    g.gGLState.Enable(GL_DEPTH_TEST);                    // NOTE: Need to enable DEPTH Test
+    g.gGLState.Disable(GL_CULL_FACE);
 
     // Set the polygon fill mode     
-    glPolygonMode(GL_FRONT_AND_BACK,g.gPolygonMode);
+    g.gGLState.PolygonMode(g.gPolygonMode);
 
     // Initialize clear color
     // This is the background of the screen.
-    glViewport(0, 0, g.gScreenWidth, g.gScreenHeight);
-    glClearColor( 0.0f, 0.0f, 0.0f, 1.f );
+    g.gGLState.Viewport(0, 0, g.gScreenWidth, g.gScreenHeight);
+    g.gGLState.ClearColor( 0.0f, 0.0f, 0.0f, 1.f );
 
-    // Clear color buffer and Depth Buffer
+    // Clear color buffer and Depth Buffer, the whole screen
+    g.gGLState.Disable(GL_SCISSOR_TEST);
   	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+	// Upload this frame's camera and head light, every shader reads them from FrameBlock
+	ShaderInterface::FrameBlock frame = {};
+	frame.u_ViewMatrix = g.gCamera.GetViewMatrix();
+	frame.u_Projection = g.gCamera.GetProjectionMatrix();
+	frame.u_ViewDirection = g.gCamera.GetViewDirection();
+	frame.u_EyePosition = g.gCamera.GetRenderEyePosition();
+	frame.u_HeadLightCol = g.gCamera.GetHeadLightCol();
+	frame.u_HeadLightScope = g.gCamera.GetHeadLightScope();
+	frame.u_HeadLightOn = g.gCamera.GetIfLightOn();
+	frame.u_HeadLightStrength = g.gCamera.GetLightStrength();
+	gFrameUniforms->Update(frame);
+	gFrameUniforms->Bind();
 }
 
 
+/**
+* Draw object index of list this frame, as its impostor when it has one and is far,
+* else in the multi-draw batch or as its own packet
+*
+* @return void
+*/
+void SubmitObject(const std::vector<OBJ*>& list, size_t index, const Impostors* impostors, GLuint conditionQuery = 0){
+	OBJ* object = list[index];
+	if (impostors != nullptr && impostors->IsFar(index, *object, g.gCamera.GetRenderEyePosition())) {
+		impostors->Submit(index, *object, gRenderQueue);
+		g.gStats.impostors++;
+	} else if (!g.gMultiDrawIndirect || !gStaticBatch->AddObject(*object)) {
+		// Meshes past the material table of the batch are drawn on their own
+		object->Submit(gRenderQueue, conditionQuery);
+	}
+}
+
+/**
+* Submit the objects of list whose bounding box is inside the frustum
+* and touches the head light cone. With occlusion, objects whose box was
+* hidden in the last frames are skipped or drawn conditionally. Objects of
+* list may have impostors, baked in the same order.
+*
+* @return void
+*/
+void SubmitVisible(const std::vector<OBJ*>& list, CullCounts& counts, const SoftwareOcclusion* occluders,
+				   OcclusionCuller* occlusion = nullptr, const Impostors* impostors = nullptr){
+	gCullBoxes.Clear();
+	for (auto& object : list) {
+		glm::vec3 center, extents;
+		object->GetWorldBounds(center, extents);
+		gCullBoxes.Add(center, extents);
+	}
+	gVisibleObjects.clear();
+	gFrustum.CullBoxes(gCullBoxes, gVisibleObjects);
+	size_t inFrustum = gVisibleObjects.size();
+	gLightCone.FilterBoxes(gCullBoxes, gVisibleObjects);
+	size_t lit = gVisibleObjects.size();
+	if (occluders != nullptr) {
+		occluders->FilterBoxes(gCullBoxes, gVisibleObjects);
+	}
+	counts.Add(list.size(), inFrustum, lit, gVisibleObjects.size());
+
+	if (occlusion == nullptr) {
+		for (uint32_t index : gVisibleObjects) {
+			SubmitObject(list, index, impostors);
+		}
+		return;
+	}
+
+	// Visible indices are in increasing order
+	size_t next = 0;
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (next == gVisibleObjects.size() || gVisibleObjects[next] != i) {
+			occlusion->MarkCulled(i);
+			continue;
+		}
+		next++;
+		occlusion->MarkTested(i, glm::vec3(gCullBoxes.cx[i], gCullBoxes.cy[i], gCullBoxes.cz[i]),
+								 glm::vec3(gCullBoxes.ex[i], gCullBoxes.ey[i], gCullBoxes.ez[i]));
+		if (occlusion->IsOccluded(i)) {
+			g.gStats.occludedObjects++;
+			continue;
+		}
+		// A batched object cannot have its own condition, it is drawn
+		GLuint conditionQuery = g.gMultiDrawIndirect ? 0 : occlusion->GetConditionQuery(i);
+		if (conditionQuery != 0) {
+			g.gStats.conditionalDraws++;
+		}
+		SubmitObject(list, i, impostors, conditionQuery);
+	}
+}
+
+/**
+* Scissor rendering to the screen rectangle around the head light.
+* The cone opens along the view direction, so it projects to an ellipse
+* centered on the screen whose radius in NDC is tan(scope)/tan(fovy/2).
+*
+* @return void
+*/
+void ScissorToHeadLight(){
+	float radiusY = std::tan(g.gCamera.GetHeadLightScope()) / std::tan(g.gCamera.GetFieldOfView() * 0.5f);
+	float radiusX = radiusY / g.gCamera.GetAspectRatio();
+	radiusX = std::min(radiusX, 1.0f);
+	radiusY = std::min(radiusY, 1.0f);
+
+	// One pixel of margin for the rasterizer's rounding
+	int halfWidth = std::min(g.gScreenWidth / 2, (int)std::ceil(radiusX * g.gScreenWidth * 0.5f) + 1);
+	int halfHeight = std::min(g.gScreenHeight / 2, (int)std::ceil(radiusY * g.gScreenHeight * 0.5f) + 1);
+	g.gGLState.Scissor(g.gScreenWidth / 2 - halfWidth, g.gScreenHeight / 2 - halfHeight, 2 * halfWidth, 2 * halfHeight);
+	g.gGLState.Enable(GL_SCISSOR_TEST);
+
+	g.gStats.litScreenFraction = (float)(4 * halfWidth * halfHeight) / (float)(g.gScreenWidth * g.gScreenHeight);
+}
+
+/**
+* Start rasterizing this frame's occluders on the worker thread:
+* a shrunk box inside each structure and the trunks of nearby trees.
+*
+* @return void
+*/
+void RasterizeOccluders(const glm::mat4& viewProjection){
+	// Trunks further than this cover less than a pixel of the depth buffer
+	const float kTrunkDistance = 8.0f;
+
+	gSoftwareOcclusion->ClearOccluders();
+	// Inner boxes of the structures, checked against their triangles so they never
+	// cover more than the mesh. The chalice is too thin to have one
+	for (size_t i = 0; i < gObjVector.size(); ++i) {
+		if (gOccluderHulls[i].valid) {
+			gSoftwareOcclusion->AddOccluderBox(gOccluderHulls[i].boxMin, gOccluderHulls[i].boxMax, gObjVector[i]->GetModelMatrix());
+		}
+	}
+
+	glm::vec3 eye = g.gCamera.GetRenderEyePosition();
+	// Trunks scaled with their tree, as drawn
+	for (auto& trees : gTrees) {
+		for (size_t i = 0; i < trees->GetTreeCount(); ++i) {
+			glm::vec3 base = trees->GetTreeBase(i);
+			if (glm::length(glm::vec2(base.x - eye.x, base.z - eye.z)) < kTrunkDistance) {
+				float size = trees->GetTreeSize(i);
+				gSoftwareOcclusion->AddOccluderQuad(base, 2.0f * g.gTrunkHalfWidth * size, g.gTrunkHeight * size, eye);
+			}
+		}
+	}
+	gSoftwareOcclusion->RasterizeAsync(viewProjection);
+}
+
+/**
+* Line of sight of the head light: one batch of rays from the eye, along the
+* view direction and around the edge of the cone, against gSceneQuery
+*
+* @return void
+*/
+void TraceHeadLight(float range){
+	const int kEdgeRays = 8;
+	glm::vec3 eye = g.gCamera.GetRenderEyePosition();
+	glm::vec3 axis = glm::normalize(g.gCamera.GetViewDirection());
+	glm::vec3 side = glm::normalize(glm::cross(axis, std::fabs(axis.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f)));
+	glm::vec3 up = glm::cross(side, axis);
+	float spread = std::tan(g.gCamera.GetHeadLightScope());
+
+	gHeadLightRays.clear();
+	gHeadLightRays.push_back({eye, range, axis});
+	for (int i = 0; i < kEdgeRays; ++i) {
+		float angle = glm::two_pi<float>() * i / kEdgeRays;
+		glm::vec3 direction = glm::normalize(axis + spread * (std::cos(angle) * side + std::sin(angle) * up));
+		gHeadLightRays.push_back({eye, range, direction});
+	}
+	gHeadLightHits.resize(gHeadLightRays.size());
+
+	auto start = std::chrono::steady_clock::now();
+	gSceneQuery.Raycast(gHeadLightRays.data(), gHeadLightRays.size(), gHeadLightHits.data());
+	// Hills stop the light as well
+	for (size_t i = 0; i < gHeadLightRays.size(); ++i) {
+		float ground = g.gHeightfield.Raycast(gHeadLightRays[i].origin, gHeadLightRays[i].direction, gHeadLightHits[i].distance);
+		if (ground < gHeadLightHits[i].distance) {
+			gHeadLightHits[i] = {ground, -1, 0};
+		}
+	}
+	g.gStats.headLightQueryUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	g.gStats.headLightRays = (unsigned int)gHeadLightHits.size();
+	for (const SceneHit& hit : gHeadLightHits) {
+		g.gStats.headLightRaysBlocked += hit.distance < range ? 1 : 0;
+	}
+	g.gStats.headLightSight = gHeadLightHits[0].distance;
+}
+
 /**
 * Draw
 * The render function gets called once per loop.
@@ -160,42 +656,113 @@ void PreDraw(){
 * @return void
 */
 void Draw(){
-    // Draw objects
-    g.gCamera.CheckBattery();
+	// The head light is the only light, without it the frame stays black
+	// (smallest visible contribution is half a step of an 8 bit channel)
+	glm::vec3 lightColor = g.gCamera.GetHeadLightCol();
+	float lightStrength = g.gCamera.GetLightStrength() * std::max(lightColor.r, std::max(lightColor.g, lightColor.b));
+	float lightRange = LightCone::AttenuationRange(lightStrength, 0.5f / 255.0f);
+	if (g.gCamera.GetIfLightOn() == 0 || lightRange <= 0.0f) {
+		return;
+	}
+	gLightCone.Set(g.gCamera.GetRenderEyePosition(), g.gCamera.GetViewDirection(), g.gCamera.GetHeadLightScope(),
+				   std::min(lightRange, g.gCamera.GetFarPlane()));
+	TraceHeadLight(gLightCone.GetRange());
+	ScissorToHeadLight();
+
+	// Occluders are rasterized while the rest of the frame is set up
+	glm::mat4 viewProjection = g.gCamera.GetProjectionMatrix() * g.gCamera.GetViewMatrix();
+	if (gUseSoftwareOcclusion) {
+		RasterizeOccluders(viewProjection);
+	}
 
-    //std::cout << "(OBJ) start Draw" << std::endl;
-	// House
-	gObjVector[0]->PreDraw(glm::vec3(gSelectedVecs[0].x, -gObjVector[0]->getMinCoord().y, gSelectedVecs[0].y), 30.f);
-	gObjVector[0]->Draw();
+	// Occlusion query results of earlier frames that have arrived
+	gOcclusion->BeginFrame(g.gStats);
 
-	// Chapel
-	gObjVector[1]->PreDraw(glm::vec3(gSelectedVecs[1].x, -gObjVector[1]->getMinCoord().y, gSelectedVecs[1].y), 90.f);
-    gObjVector[1]->Draw();
+    // Collect every draw of the frame, the queue decides the order
+    gRenderQueue.Begin(g.gCamera.GetRenderEyePosition(), g.gCamera.GetFarPlane());
+    if (g.gMultiDrawIndirect) {
+        gStaticBatch->Begin();
+    }
+    // Only what intersects the view frustum and the head light is submitted
+    gFrustum.Extract(viewProjection);
+
+	const SoftwareOcclusion* occluders = nullptr;
+	if (gUseSoftwareOcclusion) {
+		auto waitStart = std::chrono::steady_clock::now();
+		gSoftwareOcclusion->Wait();
+		g.gStats.occlusionRasterMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+		g.gStats.occluderTriangles = gSoftwareOcclusion->GetTrianglesDrawn();
+		occluders = gSoftwareOcclusion;
+	}
 
-	// Windmill
-	gObjVector[2]->PreDraw(glm::vec3(gSelectedVecs[2].x, -gObjVector[2]->getMinCoord().y, gSelectedVecs[2].y), 45.f);
-    gObjVector[2]->Draw();
+    // Ground
+    if (gGround != nullptr) {
+        gGround->Submit(g.gCamera.GetRenderEyePosition(), gFrustum, gRenderQueue, g.gStats);
+    }
 
-	// Chalice
-	gObjVector[3]->PreDraw(glm::vec3(gSelectedVecs[3].x, -gObjVector[3]->getMinCoord().y, gSelectedVecs[3].y));
-    gObjVector[3]->Draw();
+    // House, chapel, windmill and chalice
+    SubmitVisible(gObjVector, g.gStats.objects, occluders, gOcclusion, g.gUseImpostors ? gImpostors : nullptr);
 
 	// Grass
-	grass->PreDraw(glm::vec3(0.0f, 0.0f, 0.0f));
-	grass->Draw();
+	grass->CullInstances(gFrustum, gLightCone, occluders, g.gStats.grass);
+	if (!g.gMultiDrawIndirect || !gStaticBatch->AddInstances(*grass, grass->getVisibleInstances())) {
+		grass->Submit(gRenderQueue);
+	}
+	bool drawBlades = g.gDrawGrassBlades && gGrassField != nullptr;
+	if (drawBlades) {
+		gGrassField->Cull(gFrustum, gLightCone, occluders, g.gCamera.GetRenderEyePosition(), g.gGLState, g.gStats);
+	}
 
-    // Draw trees
+    // Trees
 	for (auto& tree : gTrees) {
-		tree->PreDraw();
-    	tree->Draw();
+		tree->Cull(gFrustum, gLightCone, occluders, g.gStats.trees);
+		tree->Submit(gRenderQueue);
 	}
 
-    for(int i = 0; i < gBatteryOBJs.size(); ++i){
-        if(gBatteryOBJs[i]->getObjectCoord().y != 0) gBatteryOBJs[i]->PreDraw(gBatteryOBJs[i]->getObjectCoord());
-        else gBatteryOBJs[i]->PreDraw(glm::vec3(gBatteryOBJs[i]->getObjectCoord().x, -gBatteryOBJs[i]->getMinCoord().y, gBatteryOBJs[i]->getObjectCoord().z));
-        gBatteryOBJs[i]->Draw();
-    }
+    // Batteries
+    SubmitVisible(gBatteryOBJs, g.gStats.batteries, occluders);
 
+    gRenderQueue.Sort();
+    if (g.gMultiDrawIndirect) {
+        gStaticBatch->Upload(g.gStats);
+    }
+    if (g.gDepthPrePass) {
+        // Depth only, alpha tested billboards still discard here
+        g.gGLState.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        gDepthTimer->Begin();
+        if (g.gMultiDrawIndirect) {
+            gStaticBatch->Draw(g.gGLState, g.gStats, true);
+        }
+        if (drawBlades) {
+            gGrassField->Draw(g.gGLState, g.gStats, true);
+        }
+        gRenderQueue.DrawDepth(g.gGLState, g.gStats);
+        gDepthTimer->End();
+        // Shade only the fragments that won the pre-pass
+        g.gGLState.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        g.gGLState.DepthMask(GL_FALSE);
+        g.gGLState.DepthFunc(GL_EQUAL);
+    }
+    gShadeTimer->Begin();
+    if (g.gMultiDrawIndirect) {
+        gStaticBatch->Draw(g.gGLState, g.gStats, false);
+    }
+    if (drawBlades) {
+        gGrassField->Draw(g.gGLState, g.gStats, false);
+    }
+    gRenderQueue.Draw(g.gGLState, g.gStats);
+    gShadeTimer->End();
+    g.gGLState.DepthMask(GL_TRUE);
+    g.gGLState.DepthFunc(GL_LESS);
+
+    g.gStats.depthPrePass = g.gDepthPrePass;
+    g.gStats.multiDrawIndirect = g.gMultiDrawIndirect;
+    g.gStats.treesInGeometryShader = g.gTreesInGeometryShader;
+    g.gStats.gpuDepthMs = gDepthTimer->GetLastMs();
+    g.gStats.gpuShadeMs = gShadeTimer->GetLastMs();
+
+    // Test the boxes of the structures against everything drawn, used next frames
+    gOcclusion->IssueQueries(g.gGLState, g.gCamera.GetRenderEyePosition(), g.gCamera.GetNearPlane(), g.gStats);
 }
 
 /**
@@ -216,58 +783,54 @@ void getOpenGLVersionInfo(){
  * 
  * @return bool whether camera in obj
 */
-bool InOBJ(glm::vec3 cameraEyePosition, OBJ* object, float margin=0.1f){
-	// 1. Translate the cameraEyePosition so that the center of rotation is at the origin.
-	// 2. Rotate the translated cameraEyePosition using a rotation matrix.
-	// 3. Compare with the object's original max and min coord
-    glm::mat4 translationMatrix1 = glm::translate(glm::mat4(1.0f), -object->getObjectCoord());
-    glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), -glm::radians(object->getRot()), glm::vec3(0.0f, 1.0f, 0.0f));
-
-    glm::mat4 updatePointMatrix = rotationMatrix * translationMatrix1;
-    glm::vec3 rotatedCameraEyePosition = glm::vec3(updatePointMatrix * glm::vec4(cameraEyePosition, 1.0f));
-    return rotatedCameraEyePosition.x <= object->getMaxCoord().x + margin
-		&& rotatedCameraEyePosition.z <= object->getMaxCoord().z + margin
-		&& rotatedCameraEyePosition.x >= object->getMinCoord().x - margin
-		&& rotatedCameraEyePosition.z >= object->getMinCoord().z - margin;
-}
-
-/**
- * Function to check collision with tress
- * 
- * @return bool whether camera collide in tree
-*/
-bool CollideTree(glm::vec3 cameraEyePosition, glm::vec2 treeCoord, float margin=0.1f){
-    return cameraEyePosition.x <= treeCoord.x + margin
-		&& cameraEyePosition.z <= treeCoord.y + margin
-		&& cameraEyePosition.x >= treeCoord.x - margin
-		&& cameraEyePosition.z >= treeCoord.y - margin;
+bool InOBJ(const glm::vec3& cameraEyePosition, const OBJ* object, float margin=0.1f){
+	// The footprint already holds the rotation and extents of the placement
+	return object->getFootprint().Contains(glm::vec2(cameraEyePosition.x, cameraEyePosition.z), margin);
 }
 
 /**
- * Function to check if found Chalice (reached goal), it has a larger margin than InOBJ check
+ * Narrow phase of the collision with a structure, the player capsule is moved
+ * into the object's frame and tested against its triangles
  * 
- * @return bool whether we have reached goal
+ * @return bool whether the capsule touches the mesh
 */
-bool FoundChalice(glm::vec3 cameraEyePosition, OBJ* chalice) {
-	return InOBJ(cameraEyePosition, chalice, 0.2f);
+bool PlayerHitsMesh(const glm::vec3& cameraEyePosition, const OBJ& object, const MeshBVH& bvh) {
+	const OrientedBox2D& footprint = object.getFootprint();
+	glm::vec3 coord = object.getObjectCoord();
+	glm::vec2 d(cameraEyePosition.x - coord.x, cameraEyePosition.z - coord.z);
+	// Inverse of the placement rotation, as in OrientedBox2D::Contains
+	glm::vec2 local(footprint.cosRot * d.x - footprint.sinRot * d.y, footprint.sinRot * d.x + footprint.cosRot * d.y);
+	// Feet on the ground under the eye
+	float ground = g.gHeightfield.HeightAt(glm::vec2(cameraEyePosition.x, cameraEyePosition.z));
+	glm::vec3 top(local.x, cameraEyePosition.y - coord.y, local.y);
+	glm::vec3 bottom(local.x, ground + g.gStepHeight + g.gPlayerRadius - coord.y, local.y);
+	return bvh.OverlapsCapsule(bottom, top, g.gPlayerRadius);
 }
 
 /**
- * Function to check collision between objects and camera
+ * Function to check collision between objects and camera, structures and trees
+ * are looked up in gCollisionGrid
  * 
  * @return bool whether we have a collision
 */
-bool HasCollision(glm::vec3 cameraEyePosition, std::vector<OBJ*> gObjVector) {
-	// collision with object
-	for (auto& object : gObjVector) {
-		if (InOBJ(cameraEyePosition, object)) {
-			return true;
-		}
+bool HasCollision(const glm::vec3& cameraEyePosition) {
+	// collision with tree, or inside the footprint of a structure
+	gCollisionOwners.clear();
+	if (gCollisionGrid.Collides(glm::vec2(cameraEyePosition.x, cameraEyePosition.z), gCollisionOwners)) {
+		return true;
 	}
-
-	// collision with tree
-	for (auto& tree : gTreesCoords) {
-		if (CollideTree(cameraEyePosition, tree)) {
+	// collision with a tree of a streamed chunk
+	if (g.gStreamWorld && gWorld.Collides(glm::vec2(cameraEyePosition.x, cameraEyePosition.z))) {
+		return true;
+	}
+	// slope too steep to climb
+	glm::vec3 eye = g.gCamera.GetEyePosition();
+	if (!g.gHeightfield.Walkable(glm::vec2(eye.x, eye.z), glm::vec2(cameraEyePosition.x, cameraEyePosition.z), g.gMaxWalkSlope)) {
+		return true;
+	}
+	// collision with the geometry of the structure
+	for (int32_t owner : gCollisionOwners) {
+		if (PlayerHitsMesh(cameraEyePosition, *gObjVector[owner], gObjBVHs[owner])) {
 			return true;
 		}
 	}
@@ -316,6 +879,80 @@ void Input(){
 			std::cout << "Q: Goodbye! (Leaving MainApplicationLoop())" << std::endl;
             g.gQuit = true;
         }
+		// Press F1 to toggle printing renderer stats
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F1){
+			g.gShowStats = !g.gShowStats;
+		}
+		// Press F3 to switch occlusion culling between off, readback and conditional render
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3){
+			gOcclusion->CycleMode();
+		}
+		// Press F4 to toggle software occlusion culling
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4){
+			gUseSoftwareOcclusion = !gUseSoftwareOcclusion;
+			std::cout << "Software occlusion culling: " << (gUseSoftwareOcclusion ? "on" : "off") << std::endl;
+		}
+		// Press F5 to toggle the depth pre-pass
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F5){
+			g.gDepthPrePass = !g.gDepthPrePass;
+			std::cout << "Depth pre-pass: " << (g.gDepthPrePass ? "on" : "off") << std::endl;
+		}
+		// Press F6 to switch the static scene between multi-draw indirect and one draw per object
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F6){
+			if (gStaticBatch != nullptr) {
+				g.gMultiDrawIndirect = !g.gMultiDrawIndirect;
+				std::cout << "Multi-draw indirect: " << (g.gMultiDrawIndirect ? "on" : "off") << std::endl;
+			} else {
+				std::cout << "Multi-draw indirect needs OpenGL 4.3" << std::endl;
+			}
+		}
+		// Press F7 to expand the tree quads in the geometry shader or the vertex shader
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F7){
+			g.gTreesInGeometryShader = !g.gTreesInGeometryShader;
+			std::cout << "Tree quads: " << (g.gTreesInGeometryShader ? "geometry shader" : "vertex shader") << std::endl;
+		}
+		// Press F8 to toggle impostors of far structures
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F8){
+			g.gUseImpostors = !g.gUseImpostors;
+			std::cout << "Impostors: " << (g.gUseImpostors ? "on" : "off") << std::endl;
+		}
+		// Press F9 to toggle the grass blades
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F9){
+			if (gGrassField != nullptr) {
+				g.gDrawGrassBlades = !g.gDrawGrassBlades;
+				std::cout << "Grass blades: " << (g.gDrawGrassBlades ? "on" : "off") << std::endl;
+			} else if (g.gStreamWorld) {
+				std::cout << "Grass blades are not drawn on a streamed map" << std::endl;
+			} else {
+				std::cout << "Grass blades need transform feedback objects (OpenGL 4.0)" << std::endl;
+			}
+		}
+		// Press F10 to switch the swap interval between vsync, adaptive vsync and off
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F10){
+			int next = g.gSwapInterval == 1 ? -1 : (g.gSwapInterval == -1 ? 0 : 1);
+			g.gSwapInterval = FramePacer::SetSwapInterval(next);
+			std::cout << "Swap interval: " << (g.gSwapInterval == 1 ? "vsync" : (g.gSwapInterval == -1 ? "adaptive vsync" : "off")) << std::endl;
+		}
+		// Press F11 to toggle logging the latency of every frame
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F11){
+			g.gLogLatency = !g.gLogLatency;
+		}
+		// Press R to reset position
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_r){
+			PlaceEye(glm::vec2(g.gCamera.GetEyeInitialPosition().x, g.gCamera.GetEyeInitialPosition().z));
+		}
+		// Press G to teleport player near Chalice
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_g){
+			PlaceEye(gSelectedVecs[3] + 1.5f);
+		}
+		// Press TAB to switch between fill and line mode
+		if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_TAB){
+			if(g.gPolygonMode == GL_FILL){
+				g.gPolygonMode = GL_LINE;
+			}else{
+				g.gPolygonMode = GL_FILL;
+			}
+		}
         if(e.type==SDL_MOUSEMOTION){
             // Capture the change in the mouse position
             mouseX+=e.motion.xrel;
@@ -323,97 +960,62 @@ void Input(){
             g.gCamera.MouseLook(mouseX,mouseY);
         }
 	}
+}
+
+
+/**
+* One fixed step of the game: walk with WASD, run the battery and check
+* the triggers at the new position. dt is the same every step, so the
+* game runs at the same speed whatever the frame rate
+*
+* @return void
+*/
+void Simulate(float dt){
+    g.gCamera.BeginStep();
 
     // Retrieve keyboard state
     const Uint8 *state = SDL_GetKeyboardState(NULL);
 
     // Camera
     // Update our position of the camera, move character with WASD
-    float cameraSpeed = 0.02f;
+    float cameraSpeed = g.gWalkSpeed * dt;
     if (state[SDL_SCANCODE_W]) {
-		if (HasCollision(g.gCamera.CheckForward(cameraSpeed), gObjVector)) {
+		if (HasCollision(g.gCamera.CheckForward(cameraSpeed))) {
 			// move on the opposite direction when in collision and was moving forward
 			g.gCamera.MoveBackward(cameraSpeed);
 		} else {
 			g.gCamera.MoveForward(cameraSpeed);
-			if (FoundChalice(g.gCamera.GetEyePosition(), gObjVector[3])) {
-				g.gWin = true;
-			}
 		}
     }
     if (state[SDL_SCANCODE_S]) {
-        if (HasCollision(g.gCamera.CheckBackward(cameraSpeed), gObjVector)) {
+        if (HasCollision(g.gCamera.CheckBackward(cameraSpeed))) {
 			g.gCamera.MoveForward(cameraSpeed);
 		} else {
 			g.gCamera.MoveBackward(cameraSpeed);
-			if (FoundChalice(g.gCamera.GetEyePosition(), gObjVector[3])) {
-				g.gWin = true;
-			}
 		}
     }
     if (state[SDL_SCANCODE_A]) {
-		if (HasCollision(g.gCamera.CheckLeft(cameraSpeed), gObjVector)) {
+		if (HasCollision(g.gCamera.CheckLeft(cameraSpeed))) {
 			// g.gCamera.MoveRight(cameraSpeed);
 		} else {
 			g.gCamera.MoveLeft(cameraSpeed);
-			if (FoundChalice(g.gCamera.GetEyePosition(), gObjVector[3])) {
-				g.gWin = true;
-			}
 		}
     }
     if (state[SDL_SCANCODE_D]) {
-		if (HasCollision(g.gCamera.CheckRight(cameraSpeed), gObjVector)) {
+		if (HasCollision(g.gCamera.CheckRight(cameraSpeed))) {
 			// g.gCamera.MoveLeft(cameraSpeed);
 		} else {
 			g.gCamera.MoveRight(cameraSpeed);
-			if (FoundChalice(g.gCamera.GetEyePosition(), gObjVector[3])) {
-				g.gWin = true;
-			}
 		}
     } 
 
-	// Press R to reset position
-	if (state[SDL_SCANCODE_R]) {
-		SDL_Delay(250); 
-		g.gCamera.SetCameraEyePosition(g.gCamera.GetEyeInitialPosition().x,
-		 								g.gCamera.GetEyeInitialPosition().y,
-		  								g.gCamera.GetEyeInitialPosition().z);
-	}
-
-	// Press G to teleport player near Chalice
-	if (state[SDL_SCANCODE_G]) {
-		SDL_Delay(250); 
-		g.gCamera.SetCameraEyePosition(gSelectedVecs[3].x+1.5f,
-		 								g.gCamera.GetEyeInitialPosition().y,
-		  								gSelectedVecs[3].y+1.5f);
-		// g.gCamera.SetViewDirection(-1.0f, -0.5f, -1.0f);
-	}
-
-	// Press TAB to switch between fill and line mode
-    if (state[SDL_SCANCODE_TAB]) {
-        SDL_Delay(250); // This is hacky in the name of simplicity,
-                       // but we just delay the
-                       // system by a few milli-seconds to process the 
-                       // keyboard input once at a time.
-        if(g.gPolygonMode == GL_FILL){
-            g.gPolygonMode = GL_LINE;
-        }else{
-            g.gPolygonMode = GL_FILL;
-        }
-    }
-    
-    // check whether get the battery
+    // Battery timers run on simulation time
+    g.gCamera.AdvanceTime(dt);
+    g.gCamera.CheckBattery();
+
+    // Collect the batteries and reach the chalice at the new position
     glm::vec3 curPos = g.gCamera.GetEyePosition();
-    for(int i = 0; i < gBatteryOBJs.size(); ++i){
-        if(InOBJ(curPos, gBatteryOBJs[i])){
-            g.gCamera.CollectBattery();
-            std::cout << "Collected Battery!" << std::endl;
-            delete gBatteryOBJs[i];
-            gBatteryOBJs.erase(gBatteryOBJs.begin() + i);
-            g.gCamera.GetBatteryInfo();
-            break;
-        }
-    }
+    gTriggers.Update(glm::vec2(curPos.x, curPos.z));
     // camera out of battery for 10 sec, Game Over
     if(g.gCamera.GetGameOver())
         g.gQuit = true;
@@ -436,10 +1038,41 @@ void MainLoop(){
     SDL_SetRelativeMouseMode(SDL_TRUE);
 
 
+	// Last time renderer stats were printed
+	double lastStatsPrint = FixedTimestep::Now();
+
+	// Fixed steps of the game, however long the frames take
+	FixedTimestep clock;
+	clock.Start(1.0 / g.gSimulationRate);
+	// Waits before input, so the input drawn is as recent as possible
+	FramePacer pacer;
+
 	// While application is running
 	while(!g.gQuit){
-        // Type of start of frame
-		Uint32 start = SDL_GetTicks();
+		g.gStats.Reset();
+		g.gGLState.ResetCounters();
+
+		// Wait for the previous frame to be presented, and for the frame cap
+		pacer.WaitForFrame(g.gMaxFrameRate, g.gFrameDelayMs);
+		g.gStats.frameWaitMs = pacer.GetWaitMs();
+		g.gStats.latencyMs = pacer.GetLatencyMs();
+		if (g.gLogLatency) {
+			std::cout << "[latency] input to present: " << pacer.GetLatencyMs() << " ms"
+					  << " | wait: " << pacer.GetWaitMs() << " ms" << std::endl;
+		}
+
+		// Handle Input, as late as possible before drawing
+        Input();
+		pacer.MarkInput();
+
+		// Run the steps due since the last frame, then draw the eye between the last two
+		int steps = clock.Advance();
+		for (int i = 0; i < steps && !g.gQuit; ++i) {
+			Simulate((float)clock.GetStepSeconds());
+		}
+		g.gCamera.Interpolate(clock.GetAlpha());
+		g.gStats.simulationSteps = (unsigned int)steps;
+		g.gStats.frameMs = (float)(clock.GetFrameSeconds() * 1000.0);
 		
 		// Setup anything (i.e. OpenGL State) that needs to take
 		// place before draw calls
@@ -450,6 +1083,17 @@ void MainLoop(){
 			g.gQuit = true;
 		}
 
+		// Chunks the player walked into, released when left behind
+		if (g.gStreamWorld) {
+			glm::vec3 eye = g.gCamera.GetEyePosition();
+			if (gWorld.Update(glm::vec2(eye.x, eye.z))) {
+				RefreshStreamedWorld();
+			}
+			g.gStats.streamedChunks = (unsigned int)gWorld.GetResidentCount();
+			g.gStats.streamPending = (unsigned int)gWorld.GetPendingCount();
+			g.gStats.streamedMB = gWorld.GetResidentBytes() / (1024.0f * 1024.0f);
+		}
+
 		PreDraw();
 		// Draw Calls in OpenGL
         // When we 'draw' in OpenGL, this activates the graphics pipeline.
@@ -458,19 +1102,17 @@ void MainLoop(){
         //      currently binded.
 		Draw();
 
-		// Handle Input
-        Input();
-        // Calculate how much time has elapsed
-		// since the start of the frame, and delay
-		// for the difference in milliseconds to attempt
-		// to get 60 fps for systems that run too fast
-		Uint32 elapsedTime = SDL_GetTicks() - start;
-		if(elapsedTime < 16){
-			SDL_Delay(16-elapsedTime);
+		// Print the stats of this frame once per second
+		if (g.gShowStats && FixedTimestep::Now() - lastStatsPrint >= 1.0) {
+			g.gStats.stateCallsIssued = g.gGLState.GetIssuedCount();
+			g.gStats.stateCallsElided = g.gGLState.GetElidedCount();
+			g.gStats.Print();
+			lastStatsPrint = FixedTimestep::Now();
 		}
 
+		// The fixed steps keep the game speed whatever the frame rate
 		//Update screen of our specified window
-		SDL_GL_SwapWindow(g.gGraphicsApplicationWindow);
+		pacer.Present(g.gGraphicsApplicationWindow);
 	}
 }
 
@@ -503,10 +1145,30 @@ void CleanUp(){
 		delete battery;
 	}
 	gBatteryOBJs.clear();
+	gWorld.Stop();
 	gSelectedVecs.clear();
 	gTreesCoords.clear();
+	gCollisionGrid.Clear();
+	gSceneQuery.Clear();
+	gObjBVHs.clear();
+	gOccluderHulls.clear();
+	gBatteryTriggers.clear();
+	gTriggers.Initialize(g.gMinValue, g.gMaxValue, g.gTriggerCellSize);
 	
 	delete grass;
+	delete gFrameUniforms;
+	delete gOcclusion;
+	delete gSoftwareOcclusion;
+	delete gDepthTimer;
+	delete gShadeTimer;
+	delete gStaticBatch;
+	delete gImpostors;
+	delete gGrassField;
+	delete gGround;
+	g.gHeightfield.Clear();
+
+	// Delete all shader programs
+	g.gShaderCache.Clear();
 
 	//Quit SDL subsystems
 	SDL_Quit();
@@ -519,17 +1181,109 @@ void CleanUp(){
 * @return program status
 */
 int main( int argc, char* args[] ){
+	// A scenario pins the world, it may come before a benchmark
+	int arg = 1;
+	if (argc > arg + 1 && std::string(args[arg]) == "--scenario") {
+		if (!LoadScenario(args[arg + 1])) {
+			return 1;
+		}
+		arg += 2;
+	}
+	// Frame pacing, for the game
+	while (argc > arg) {
+		std::string option = args[arg];
+		if (option == "--log-latency") {
+			g.gLogLatency = true;
+			arg += 1;
+		} else if (argc > arg + 1 && option == "--swap-interval") {
+			g.gSwapInterval = std::atoi(args[arg + 1]);
+			arg += 2;
+		} else if (argc > arg + 1 && option == "--max-fps") {
+			g.gMaxFrameRate = (float)std::atof(args[arg + 1]);
+			arg += 2;
+		} else if (argc > arg + 1 && option == "--frame-delay") {
+			g.gFrameDelayMs = (float)std::atof(args[arg + 1]);
+			arg += 2;
+		} else {
+			break;
+		}
+	}
+	if (g.gSeed == 0) {
+		g.gSeed = std::random_device()();
+	}
+	g.gRandom.Seed(g.gSeed);
+
+	// Benchmarks replace the game
+	std::string mode = argc > arg ? args[arg] : "";
+	if (mode == "--check-occlusion") {
+		// Runs on the CPU only, no window
+		return CheckSoftwareOcclusion() ? 0 : 1;
+	}
+	if (mode == "--check-boxes") {
+		return CheckOrientedBoxes() ? 0 : 1;
+	}
+	if (mode == "--bench-collision") {
+		// Runs on the CPU only, no window
+		return BenchmarkCollision() ? 0 : 1;
+	}
+	if (mode == "--bench-poisson") {
+		BenchmarkPoisson();
+		return 0;
+	}
+	if (mode == "--bench-streaming") {
+		BenchmarkStreaming();
+		return 0;
+	}
+	if (mode == "--bench-terrain") {
+		BenchmarkTerrain();
+		return 0;
+	}
+	if (mode == "--bench-triggers") {
+		return BenchmarkTriggers() ? 0 : 1;
+	}
+	if (mode == "--bench-bvh") {
+		// Reads the meshes without their textures, no window
+		BenchmarkBVH();
+		return 0;
+	}
+	if (mode == "--bench-scene-query") {
+		// Reads the meshes without their textures, no window
+		return BenchmarkSceneQuery() ? 0 : 1;
+	}
+	if (mode == "--bench-billboards") {
+		InitializeContext();
+		BenchmarkBillboards();
+		g.gShaderCache.Clear();
+		SDL_DestroyWindow(g.gGraphicsApplicationWindow);
+		SDL_Quit();
+		return 0;
+	}
+
 	std::cout << "Your goal is to find the Chalice!\n";
     std::cout << "Use WASD keys to move\n";
 	std::cout << "Use mouse to look around\n";
     std::cout << "Use TAB to toggle wireframe\n";
+    std::cout << "Press F1 to toggle renderer stats\n";
+    std::cout << "Press F3 to switch occlusion culling (off, readback, conditional render)\n";
+    std::cout << "Press F4 to toggle software occlusion culling\n";
+    std::cout << "Press F5 to toggle the depth pre-pass\n";
+    std::cout << "Press F6 to toggle multi-draw indirect (OpenGL 4.3)\n";
+    std::cout << "Press F7 to switch tree quads between vertex and geometry shader\n";
+    std::cout << "Press F8 to toggle impostors of far structures\n";
+    std::cout << "Press F9 to toggle the grass blades\n";
+    std::cout << "Press F10 to switch the swap interval (vsync, adaptive vsync, off)\n";
+    std::cout << "Press F11 to toggle logging the input to present latency of every frame\n";
 	std::cout << "Press R to reset player position\n";
 	std::cout << "(Cheat)Press G to teleport to Chalice\n";
     std::cout << "Press ESC to quit\n";
+	std::cout << "Start with --scenario <file> to replay a world (see scenarios/)\n";
+	std::cout << "Frame pacing: --swap-interval <1|0|-1> --max-fps <rate> --frame-delay <ms> --log-latency\n";
 
 	// 1. Setup the graphics program
 	std::cout << "Generating environment..." << std::endl;
 	InitializeProgram();
+	// Setup used raw OpenGL calls, forget whatever the cache assumed
+	g.gGLState.Invalidate();
 
 	// 2. Call the main application loop
 	MainLoop();	
@@ -7,6 +7,11 @@
 #include <random>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include <sstream>
+
+#include "generated/EmbeddedShaders.hpp"
+#include "PoissonDisk.hpp"
+#include "globals.hpp"
 
 // vvvvvvvvvvvvvvvvvvv Error Handling Routines vvvvvvvvvvvvvvv
 void GLClearAllErrors(){
@@ -31,7 +36,9 @@ bool GLCheckErrorStatus(const char* function, int line){
 
 
 /**
-* LoadShaderAsString takes a filepath as an argument and will read line by line a file and return a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
+* LoadShaderAsString takes a filepath as an argument and returns a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
+* Shaders under ./shaders/ are embedded into the executable at build time (see tools/embed_shaders.py),
+* other files are read from disk.
 * e.g.
 *       LoadShaderAsString("./shaders/filepath");
 *
@@ -39,21 +46,23 @@ bool GLCheckErrorStatus(const char* function, int line){
 * @return Entire file stored as a single string 
 */
 std::string LoadShaderAsString(const std::string& filename){
-    // Resulting shader program loaded as a single string
-    std::string result = "";
-
-    std::string line = "";
-    std::ifstream myFile(filename.c_str());
-
-    if(myFile.is_open()){
-        while(std::getline(myFile, line)){
-            result += line + '\n';
+    // Embedded shaders are stored relative to part1, without the leading "./"
+    std::string path = filename.compare(0, 2, "./") == 0 ? filename.substr(2) : filename;
+    for (size_t i = 0; i < EmbeddedShaders::kShaderCount; ++i) {
+        if (path == EmbeddedShaders::kShaders[i].path) {
+            return std::string(EmbeddedShaders::kShaders[i].source, EmbeddedShaders::kShaders[i].length);
         }
-        myFile.close();
-
     }
 
-    return result;
+    // Not embedded, read the whole file at once
+    std::ifstream myFile(filename.c_str());
+    if(!myFile.is_open()){
+        std::cout << "Could not open shader: " << filename << std::endl;
+        return "";
+    }
+    std::stringstream buffer;
+    buffer << myFile.rdbuf();
+    return buffer.str();
 }
 
 
@@ -198,73 +207,58 @@ GLuint Create3ShaderProgram(const std::string& vertexShaderSource, const std::st
     return programObject;
 }
 
+GLuint CreateFeedbackProgram(const std::string& vertexShaderSource, const std::string& geometryShaderSource, const std::vector<const char*>& varyings){
+
+    GLuint programObject = glCreateProgram();
+
+    GLuint myVertexShader   = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint myGeometryShader = CompileShader(GL_GEOMETRY_SHADER, geometryShaderSource);
+
+    glAttachShader(programObject,myVertexShader);
+    glAttachShader(programObject,myGeometryShader);
+    // Captured outputs must be named before linking
+    glTransformFeedbackVaryings(programObject, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(programObject);
+
+    GLint success;
+    glGetProgramiv(programObject, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLchar infoLog[512];
+        glGetProgramInfoLog(programObject, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+
+    glDetachShader(programObject,myVertexShader);
+    glDetachShader(programObject,myGeometryShader);
+    glDeleteShader(myVertexShader);
+    glDeleteShader(myGeometryShader);
+
+    return programObject;
+}
+
 /**
- * Creates a array of possible (x,z) coordinates to place objects and return an array 
- * with 4 random coordinates that can be used to place 4 objects
+ * Structures keep the 5 unit spacing of the lattice they were picked from
+ * before, the start of the player stays free
  * 
  * @return array of 4 random coordinates
 */
-std::vector<glm::vec2> RandomObjectsPlacement() {
-    std::vector<glm::vec2> selectableCoordsArray; // x, z coordinate
-
-    // Map defined as 40.f by 40.f, possible placement for objects, min 5.f apart from each other and from the boundary
-    for (float x = -15.f; x <= 15.f; x += 5.0f) {
-        for (float y = -15.f; y <= 15.f; y += 5.0f) {
-            // exclude origin
-            if (!(x >= -0.5f && x <= 0.5f && y >= -0.5f && y <= 0.5f)) {
-                selectableCoordsArray.push_back(glm::vec2(x, y));
-            }
-        }
-    }
-
-    // Shuffle the array
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(selectableCoordsArray.begin(), selectableCoordsArray.end(), g);
-
-    // Pick the first 4 nonidentical glm::vec2
-    std::vector<glm::vec2> selectedVecs(selectableCoordsArray.begin(), selectableCoordsArray.begin() + 4);
-    return selectedVecs;
+std::vector<glm::vec2> RandomObjectsPlacement(uint32_t seed, float minValue, float maxValue) {
+    PoissonDisk sampler(minValue + 5.f, maxValue - 5.f, seed);
+    sampler.AddExclusion(glm::vec2(0.0f), 2.5f);
+    return sampler.Sample(5.0f, 4);
 }
 
 /**
- * Creates a array of possible (x,z) coordinates to place trees and return an array 
- * with random coordinates that can be used to place trees without interfering with structure objects
- * @param objectsCoords reserved coords for objects
- * @param numOfTrees number of trees to be placed, default as 40
+ * Trees keep 2 units from the coordinates of the structures, as the
+ * rejection test did before, and gTreeSpacing from each other
  * 
- * @return array of 40 random coordinates
+ * @return array of random coordinates
 */
-std::vector<glm::vec2> RandomTreesPlacement(std::vector<glm::vec2>& objectsCoords, int numOfTrees) {
-    std::vector<glm::vec2> selectedVecs;    // x, z coordinate
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    // Define the range
-    std::uniform_real_distribution<float> dis(-19.5, 19.5);
-
-    for (int i = 0; i <= numOfTrees; i ++) {
-        // Generate random coordinates
-        float x = dis(gen);
-        float y = dis(gen);
-        bool isValid = true;
-        // Exclude origin 
-        if (x != 0.f && y != 0.f) {
-            // Check against previous selected objects coords
-            for (const auto& objCoord : objectsCoords) {
-                float distance = glm::length(glm::vec2(x, y) - objCoord);
-                if (distance < 2.0f) {
-                    isValid = false;
-                    break;
-                }
-            }
-
-            // Only select the valid coords for trees
-            if (isValid) {
-                selectedVecs.push_back(glm::vec2(x, y));
-            }
-        }
+std::vector<glm::vec2> RandomTreesPlacement(const std::vector<glm::vec2>& objectsCoords, uint32_t seed, int numOfTrees) {
+    PoissonDisk sampler(g.gMinValue + 0.5f, g.gMaxValue - 0.5f, seed);
+    sampler.AddExclusion(glm::vec2(0.0f), 1.0f);
+    for (const auto& objCoord : objectsCoords) {
+        sampler.AddExclusion(objCoord, 2.0f);
     }
-
-    return selectedVecs;
+    return sampler.Sample(g.gTreeSpacing, numOfTrees);
 }
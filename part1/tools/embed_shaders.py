@@ -0,0 +1,213 @@
+# Run with: python3 tools/embed_shaders.py  (build.py runs it before compiling)
+#
+# Embeds every ./shaders/*.glsl file into the executable and generates C++
+# structs for the std140 uniform blocks declared in them, so that:
+#   - the program does not read shaders from the working directory at startup
+#   - uniform block updates are a plain struct copy into a uniform buffer
+#
+# Outputs (do not edit, they are regenerated on every build):
+#   ./include/generated/EmbeddedShaders.hpp
+#   ./include/generated/ShaderInterface.hpp
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SHADER_DIR = os.path.join(ROOT, "shaders")
+OUTPUT_DIR = os.path.join(ROOT, "include", "generated")
+
+# std140 base alignment, size and C++ type of each supported GLSL type
+STD140_TYPES = {
+    "float": (4, 4, "float"),
+    "int":   (4, 4, "int32_t"),
+    "uint":  (4, 4, "uint32_t"),
+    "bool":  (4, 4, "int32_t"),
+    "vec2":  (8, 8, "glm::vec2"),
+    "vec3":  (16, 12, "glm::vec3"),
+    "vec4":  (16, 16, "glm::vec4"),
+    "ivec2": (8, 8, "glm::ivec2"),
+    "ivec3": (16, 12, "glm::ivec3"),
+    "ivec4": (16, 16, "glm::ivec4"),
+    "mat4":  (16, 64, "glm::mat4"),
+}
+
+BLOCK_RE = re.compile(r"layout\s*\(\s*std140\s*\)\s*uniform\s+(\w+)\s*\{(.*?)\}\s*(\w*)\s*;", re.S)
+MEMBER_RE = re.compile(r"^\s*(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*$")
+
+
+def strip_comments(source):
+    source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    return re.sub(r"//[^\n]*", "", source)
+
+
+def round_up(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def parse_block(name, body, fileName):
+    """Returns a list of (glslType, cppType, memberName, arraySize, offset, size) and the block size"""
+    members = []
+    offset = 0
+    for statement in body.split(";"):
+        if not statement.strip():
+            continue
+        match = MEMBER_RE.match(statement)
+        if match is None or match.group(1) not in STD140_TYPES:
+            sys.exit("embed_shaders: unsupported member '" + statement.strip() + "' in block " + name + " (" + fileName + ")")
+        glslType, memberName, arraySize = match.group(1), match.group(2), match.group(3)
+        alignment, size, cppType = STD140_TYPES[glslType]
+        if arraySize is not None:
+            # Array elements are rounded up to the alignment of a vec4
+            alignment = round_up(alignment, 16)
+            size = round_up(size, 16) * int(arraySize)
+        offset = round_up(offset, alignment)
+        members.append((glslType, cppType, memberName, arraySize, offset, size))
+        offset += size
+    return members, round_up(offset, 16)
+
+
+def collect_shaders():
+    shaders = []
+    for fileName in sorted(os.listdir(SHADER_DIR)):
+        if fileName.endswith(".glsl"):
+            with open(os.path.join(SHADER_DIR, fileName)) as f:
+                shaders.append((fileName, f.read()))
+    return shaders
+
+
+def collect_blocks(shaders):
+    # Blocks are declared in every stage that uses them, all declarations must agree
+    blocks = {}
+    order = []
+    for fileName, source in shaders:
+        for match in BLOCK_RE.finditer(strip_comments(source)):
+            name = match.group(1)
+            layout = parse_block(name, match.group(2), fileName)
+            if name in blocks:
+                if blocks[name][0] != layout:
+                    sys.exit("embed_shaders: block " + name + " in " + fileName + " differs from " + blocks[name][1])
+            else:
+                blocks[name] = (layout, fileName)
+                order.append(name)
+    return [(name, blocks[name][0]) for name in order]
+
+
+def raw_string(source):
+    delimiter = "glsl"
+    while (")" + delimiter + "\"") in source:
+        delimiter += "_"
+    return "R\"" + delimiter + "(" + source + ")" + delimiter + "\""
+
+
+def write_if_changed(path, content):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == content:
+                return
+    with open(path, "w") as f:
+        f.write(content)
+
+
+def generate_embedded_shaders(shaders):
+    out = []
+    out.append("// Generated by tools/embed_shaders.py from ./shaders/*.glsl, do not edit.")
+    out.append("#ifndef EMBEDDEDSHADERS_HPP")
+    out.append("#define EMBEDDEDSHADERS_HPP")
+    out.append("")
+    out.append("#include <cstddef>")
+    out.append("")
+    out.append("namespace EmbeddedShaders {")
+    out.append("")
+    out.append("struct Entry {")
+    out.append("    const char* path;       // path relative to part1, e.g. \"shaders/frag.glsl\"")
+    out.append("    const char* source;")
+    out.append("    size_t length;")
+    out.append("};")
+    out.append("")
+    out.append("static const Entry kShaders[] = {")
+    for fileName, source in shaders:
+        out.append("    { \"shaders/" + fileName + "\", " + raw_string(source) + ", " + str(len(source.encode("utf-8"))) + " },")
+    out.append("};")
+    out.append("")
+    out.append("static const size_t kShaderCount = sizeof(kShaders) / sizeof(kShaders[0]);")
+    out.append("")
+    out.append("} // namespace EmbeddedShaders")
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def generate_shader_interface(blocks):
+    out = []
+    out.append("// Generated by tools/embed_shaders.py from ./shaders/*.glsl, do not edit.")
+    out.append("#ifndef SHADERINTERFACE_HPP")
+    out.append("#define SHADERINTERFACE_HPP")
+    out.append("")
+    out.append("#include <glad/glad.h>")
+    out.append("#include <glm/glm.hpp>")
+    out.append("#include <cstddef>")
+    out.append("#include <cstdint>")
+    out.append("")
+    out.append("namespace ShaderInterface {")
+    for binding, (name, (members, size)) in enumerate(blocks):
+        out.append("")
+        out.append("// layout(std140) uniform " + name + ", " + str(size) + " bytes")
+        out.append("struct " + name + " {")
+        out.append("    static constexpr const char* kName = \"" + name + "\";")
+        out.append("    static constexpr GLuint kBinding = " + str(binding) + ";")
+        out.append("")
+        cursor = 0
+        padCount = 0
+        for glslType, cppType, memberName, arraySize, offset, memberSize in members:
+            if offset > cursor:
+                out.append("    float _pad" + str(padCount) + "[" + str((offset - cursor) // 4) + "];")
+                padCount += 1
+            if arraySize is None:
+                out.append("    " + cppType + " " + memberName + ";" + " " * max(1, 28 - len(cppType + memberName)) + "// " + glslType + ", offset " + str(offset))
+                cursor = offset + memberSize
+            else:
+                # Elements are padded to 16 bytes, so arrays of scalars/vec3 are emitted as vec4
+                elementType = cppType if STD140_TYPES[glslType][1] % 16 == 0 else "glm::vec4"
+                out.append("    " + elementType + " " + memberName + "[" + arraySize + "];" + " // " + glslType + "[" + arraySize + "], offset " + str(offset))
+                cursor = offset + memberSize
+        if size > cursor:
+            out.append("    float _pad" + str(padCount) + "[" + str((size - cursor) // 4) + "];")
+        out.append("};")
+        out.append("static_assert(sizeof(" + name + ") == " + str(size) + ", \"std140 size of " + name + "\");")
+        for glslType, cppType, memberName, arraySize, offset, memberSize in members:
+            out.append("static_assert(offsetof(" + name + ", " + memberName + ") == " + str(offset) + ", \"std140 offset of " + name + "::" + memberName + "\");")
+    out.append("")
+    out.append("/**")
+    out.append("* Assigns every uniform block used by program to its fixed binding index.")
+    out.append("* Blocks the program does not use are skipped.")
+    out.append("*")
+    out.append("* @param program Linked program object")
+    out.append("* @return void")
+    out.append("*/")
+    out.append("inline void BindUniformBlocks(GLuint program) {")
+    for name, _ in blocks:
+        out.append("    {")
+        out.append("        GLuint index = glGetUniformBlockIndex(program, " + name + "::kName);")
+        out.append("        if (index != GL_INVALID_INDEX) {")
+        out.append("            glUniformBlockBinding(program, index, " + name + "::kBinding);")
+        out.append("        }")
+        out.append("    }")
+    out.append("}")
+    out.append("")
+    out.append("} // namespace ShaderInterface")
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    shaders = collect_shaders()
+    blocks = collect_blocks(shaders)
+    os.makedirs(OUTPUT_DIR, exist_ok=True)
+    write_if_changed(os.path.join(OUTPUT_DIR, "EmbeddedShaders.hpp"), generate_embedded_shaders(shaders))
+    write_if_changed(os.path.join(OUTPUT_DIR, "ShaderInterface.hpp"), generate_shader_interface(blocks))
+    print("Embedded " + str(len(shaders)) + " shaders, generated " + str(len(blocks)) + " uniform blocks")
+
+
+if __name__ == "__main__":
+    main()